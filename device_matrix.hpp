@@ -0,0 +1,840 @@
+#pragma once
+
+/**
+ * @file device_matrix.hpp
+ * @author Barak Shoshany (baraksh@gmail.com) (http://baraksh.com)
+ * @version 0.1
+ * @date 2020-11-30
+ * @copyright Copyright (c) 2020
+ *
+ * @brief A class template for matrices stored in the memory of a GPU, with asynchronous transfers to and from the matrix class template in matrix.hpp, and operators executed on the GPU.
+ *
+ * @details A device_matrix lives in device memory until it is explicitly copied back to the host using to_host(). Its operators enqueue work on a device_stream and return immediately, and their results are also device matrices, so a chain such as `a * b + 2.0f * c` runs entirely on the device, without copying any intermediate results back to the host. Products are computed using `gemm` from cuBLAS (or hipBLAS), and sums, differences, and multiplication by a scalar using `geam` and `scal`. Only `float` and `double` elements are supported. Device matrices are stored in row-major order, and transfers copy the elements of the host matrix as they are laid out in memory, so only row-major host matrices can be transferred.
+ *
+ * By default, the CUDA runtime and cuBLAS are used, so programs must be linked with `-lcudart -lcublas`. To use AMD GPUs instead, define `MATRIX_DEVICE_HIP` before including this header and link with `-lamdhip64 -lhipblas`.
+ */
+
+#include "matrix.hpp"
+
+#include <climits>
+#include <concepts>
+#include <utility>
+
+#if defined(MATRIX_DEVICE_HIP)
+#include <hip/hip_runtime.h>
+#include <hipblas/hipblas.h>
+#define MATRIX_DEVICE_API(name) hip##name
+#define MATRIX_DEVICE_BLAS_API(name) hipblas##name
+#define MATRIX_DEVICE_BLAS_SUCCESS HIPBLAS_STATUS_SUCCESS
+#define MATRIX_DEVICE_BLAS_OP_N HIPBLAS_OP_N
+#define MATRIX_DEVICE_HOST_MALLOC hipHostMalloc
+#define MATRIX_DEVICE_HOST_FREE hipHostFree
+#else
+#include <cublas_v2.h>
+#include <cuda_runtime.h>
+#define MATRIX_DEVICE_API(name) cuda##name
+#define MATRIX_DEVICE_BLAS_API(name) cublas##name
+#define MATRIX_DEVICE_BLAS_SUCCESS CUBLAS_STATUS_SUCCESS
+#define MATRIX_DEVICE_BLAS_OP_N CUBLAS_OP_N
+#define MATRIX_DEVICE_HOST_MALLOC cudaMallocHost
+#define MATRIX_DEVICE_HOST_FREE cudaFreeHost
+#endif
+
+namespace matrix_detail
+{
+    // ==========
+    // Exceptions
+    // ==========
+
+    /**
+     * @brief Exception to be thrown if a call to the GPU runtime or BLAS library fails, or if a matrix is too large for the BLAS library.
+     */
+    class device_error
+    {
+    };
+
+    // ==============
+    // Device runtime
+    // ==============
+
+    /**
+     * @brief Throw device_error if a call to the GPU runtime failed.
+     *
+     * @param status The status returned by the call.
+     */
+    inline void device_check(const MATRIX_DEVICE_API(Error_t) status)
+    {
+        if (status != MATRIX_DEVICE_API(Success))
+            throw device_error{};
+    }
+
+    /**
+     * @brief Throw device_error if a call to the GPU BLAS library failed.
+     *
+     * @param status The status returned by the call.
+     */
+    inline void device_check(const MATRIX_DEVICE_BLAS_API(Status_t) status)
+    {
+        if (status != MATRIX_DEVICE_BLAS_SUCCESS)
+            throw device_error{};
+    }
+
+    /**
+     * @brief A concept satisfied by the element types supported by the GPU BLAS library.
+     */
+    template <typename T>
+    concept device_type = std::same_as<T, float> or std::same_as<T, double>;
+
+    /**
+     * @brief Convert a size to the `int` expected by the GPU BLAS library.
+     *
+     * @param n The size.
+     * @return The size as an `int`.
+     * @throws device_error if the size does not fit in an `int`.
+     */
+    inline int device_int(const size_t &n)
+    {
+        if (n > static_cast<size_t>(INT_MAX))
+            throw device_error{};
+        return static_cast<int>(n);
+    }
+} // namespace matrix_detail
+
+// =============
+// Device stream
+// =============
+
+/**
+ * @brief A queue of work on the GPU, together with the BLAS handle used to enqueue operations on it. Operations on the same stream are executed in the order in which they were enqueued, and operations on different streams may run concurrently. Every device_matrix is associated with the stream on which its memory was allocated, and its operators are enqueued on that stream.
+ */
+class device_stream
+{
+public:
+    /**
+     * @brief Create a new stream, which does not synchronize with the legacy default stream.
+     *
+     * @throws device_error if the stream or the BLAS handle cannot be created.
+     */
+    device_stream()
+    {
+        matrix_detail::device_check(MATRIX_DEVICE_API(StreamCreateWithFlags)(&stream, MATRIX_DEVICE_API(StreamNonBlocking)));
+        try
+        {
+            matrix_detail::device_check(MATRIX_DEVICE_BLAS_API(Create)(&blas));
+            matrix_detail::device_check(MATRIX_DEVICE_BLAS_API(SetStream)(blas, stream));
+        }
+        catch (...)
+        {
+            if (blas != nullptr)
+                MATRIX_DEVICE_BLAS_API(Destroy)(blas);
+            MATRIX_DEVICE_API(StreamDestroy)(stream);
+            throw;
+        }
+    }
+
+    device_stream(const device_stream &) = delete;
+    device_stream &operator=(const device_stream &) = delete;
+
+    /**
+     * @brief Wait for all of the work on the stream to finish, and destroy it. All of the device matrices associated with the stream must be destroyed first.
+     */
+    ~device_stream()
+    {
+        MATRIX_DEVICE_API(StreamSynchronize)(stream);
+        MATRIX_DEVICE_BLAS_API(Destroy)(blas);
+        MATRIX_DEVICE_API(StreamDestroy)(stream);
+    }
+
+    /**
+     * @brief Block the calling thread until all of the work enqueued on the stream so far has finished, including any asynchronous transfers to the host.
+     *
+     * @throws device_error if any of the work failed.
+     */
+    void synchronize() const
+    {
+        matrix_detail::device_check(MATRIX_DEVICE_API(StreamSynchronize)(stream));
+    }
+
+    /**
+     * @brief Make all work enqueued on this stream from now on wait until the work enqueued on another stream so far has finished, without blocking the calling thread.
+     *
+     * @param other The other stream.
+     * @throws device_error if the event used to synchronize the streams cannot be created.
+     */
+    void wait_for(const device_stream &other) const
+    {
+        if (&other == this)
+            return;
+        MATRIX_DEVICE_API(Event_t) event{nullptr};
+        matrix_detail::device_check(MATRIX_DEVICE_API(EventCreateWithFlags)(&event, MATRIX_DEVICE_API(EventDisableTiming)));
+        const MATRIX_DEVICE_API(Error_t) recorded{MATRIX_DEVICE_API(EventRecord)(event, other.stream)};
+        const MATRIX_DEVICE_API(Error_t) waited{(recorded == MATRIX_DEVICE_API(Success)) ? MATRIX_DEVICE_API(StreamWaitEvent)(stream, event, 0) : recorded};
+        // The event is only released once the stream is done waiting for it, so it can be destroyed right away.
+        MATRIX_DEVICE_API(EventDestroy)(event);
+        matrix_detail::device_check(waited);
+    }
+
+    /**
+     * @brief Member function used to obtain the underlying runtime stream, for example to launch custom kernels on it.
+     *
+     * @return The stream.
+     */
+    inline MATRIX_DEVICE_API(Stream_t) get_stream() const
+    {
+        return stream;
+    }
+
+    /**
+     * @brief Member function used to obtain the BLAS handle associated with the stream.
+     *
+     * @return The BLAS handle.
+     */
+    inline MATRIX_DEVICE_BLAS_API(Handle_t) get_blas_handle() const
+    {
+        return blas;
+    }
+
+    /**
+     * @brief Get the stream used by default for device matrices created on the calling thread. Each thread has its own default stream.
+     *
+     * @return A reference to the default stream.
+     */
+    static device_stream &default_stream()
+    {
+        thread_local device_stream default_for_thread;
+        return default_for_thread;
+    }
+
+    /**
+     * @brief Exception to be thrown if a call to the GPU runtime or BLAS library fails.
+     */
+    using device_error = matrix_detail::device_error;
+
+private:
+    /**
+     * @brief The runtime stream.
+     */
+    MATRIX_DEVICE_API(Stream_t) stream{nullptr};
+
+    /**
+     * @brief The BLAS handle, whose operations are enqueued on the stream.
+     */
+    MATRIX_DEVICE_BLAS_API(Handle_t) blas{nullptr};
+};
+
+// =============
+// Pinned memory
+// =============
+
+/**
+ * @brief An allocator which allocates page-locked (pinned) host memory. Transfers between device matrices and host matrices using this allocator, such as `matrix<float, pinned_allocator<float>>`, are fully asynchronous, and are usually faster than transfers from ordinary memory, which the runtime has to copy through a pinned buffer of its own.
+ *
+ * @tparam T The type of the objects to allocate.
+ */
+template <typename T>
+class pinned_allocator
+{
+public:
+    using value_type = T;
+
+    pinned_allocator() = default;
+
+    template <typename U>
+    pinned_allocator(const pinned_allocator<U> &) {}
+
+    /**
+     * @brief Allocate uninitialized pinned memory for `n` objects of type `T`.
+     *
+     * @param n The number of objects.
+     * @return A pointer to the allocated memory.
+     * @throws std::bad_array_new_length if the size in bytes does not fit in a `size_t`.
+     * @throws std::bad_alloc if the allocation fails.
+     */
+    T *allocate(const size_t &n)
+    {
+        if (n > static_cast<size_t>(-1) / sizeof(T))
+            throw std::bad_array_new_length{};
+        void *p{nullptr};
+        if (MATRIX_DEVICE_HOST_MALLOC(&p, n * sizeof(T)) != MATRIX_DEVICE_API(Success))
+            throw std::bad_alloc{};
+        return static_cast<T *>(p);
+    }
+
+    /**
+     * @brief Deallocate memory previously allocated with allocate().
+     *
+     * @param p A pointer to the memory.
+     */
+    void deallocate(T *p, const size_t &)
+    {
+        MATRIX_DEVICE_HOST_FREE(p);
+    }
+
+    template <typename U>
+    friend bool operator==(const pinned_allocator &, const pinned_allocator<U> &)
+    {
+        return true;
+    }
+};
+
+// =============
+// Device matrix
+// =============
+
+/**
+ * @brief A class template for matrices stored in GPU memory. The elements are stored row by row, without padding, so that a device matrix can be passed to custom kernels or other GPU libraries using data().
+ * @details All of the operations of a device matrix, including its construction, destruction, and transfers to and from the host, are enqueued on its stream and return without waiting for the GPU, except for to_host() without arguments, which returns a host matrix and therefore waits for the transfer to finish. The result of an operator is associated with the stream of its first operand. If the operands are associated with different streams, the streams are synchronized with each other automatically, using events. A device matrix must not outlive its stream.
+ *
+ * @tparam T The type of the matrix elements. Must be `float` or `double`.
+ */
+template <matrix_detail::device_type T>
+class device_matrix
+{
+public:
+    using value_type = T;
+
+    // ============
+    // Constructors
+    // ============
+
+    /**
+     * @brief Construct an empty device matrix, with zero rows and columns, on the default stream of the calling thread. It can only be assigned to or destroyed.
+     */
+    device_matrix()
+        : stream(&device_stream::default_stream()) {}
+
+    /**
+     * @brief Construct a device matrix with the given number of rows and columns, and uninitialized elements. The memory is allocated in stream order, so it can be reused from memory freed earlier on the same stream without synchronizing with the host.
+     *
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @param input_stream The stream to associate the matrix with. By default, the default stream of the calling thread.
+     * @throws zero_size if the number of rows or columns is zero.
+     * @throws device_error if the memory cannot be allocated.
+     */
+    device_matrix(const size_t &input_rows, const size_t &input_cols, device_stream &input_stream = device_stream::default_stream())
+        : rows(input_rows), cols(input_cols), stream(&input_stream)
+    {
+        if (rows == 0 or cols == 0)
+            throw zero_size{};
+        allocate();
+    }
+
+    /**
+     * @brief Construct a device matrix by copying a host matrix to the device asynchronously. If the host matrix uses pinned_allocator, the copy is fully asynchronous, and the host matrix must not be modified or destroyed until the stream is synchronized. Otherwise, the host matrix may be reused as soon as the constructor returns. Padding between the rows of the host matrix is removed during the copy. See also to_device().
+     *
+     * @param m The host matrix.
+     * @param input_stream The stream to associate the matrix with. By default, the default stream of the calling thread.
+     * @throws device_error if the memory cannot be allocated or the copy fails.
+     */
+    template <typename Allocator>
+    explicit device_matrix(const matrix<T, Allocator> &m, device_stream &input_stream = device_stream::default_stream())
+        : device_matrix(m.get_rows(), m.get_cols(), input_stream)
+    {
+        if (size() > 0)
+            matrix_detail::device_check(MATRIX_DEVICE_API(Memcpy2DAsync)(elements, cols * sizeof(T), m.data(), m.get_stride() * sizeof(T), cols * sizeof(T), rows, MATRIX_DEVICE_API(MemcpyHostToDevice), stream->get_stream()));
+    }
+
+    /**
+     * @brief Copy constructor. The elements are copied on the device, on the stream of the existing matrix.
+     *
+     * @param m The device matrix to be copied.
+     * @throws device_error if the memory cannot be allocated or the copy fails.
+     */
+    device_matrix(const device_matrix<T> &m)
+        : device_matrix(m.rows, m.cols, *m.stream)
+    {
+        copy_from(m);
+    }
+
+    /**
+     * @brief Move constructor. The new matrix takes over the memory and the stream of the existing matrix, which becomes empty.
+     *
+     * @param m The device matrix to be moved.
+     */
+    device_matrix(device_matrix<T> &&m) noexcept
+        : rows(std::exchange(m.rows, 0)), cols(std::exchange(m.cols, 0)), elements(std::exchange(m.elements, nullptr)), stream(m.stream) {}
+
+    /**
+     * @brief Free the memory in stream order, after all of the work already enqueued on the stream has finished.
+     */
+    ~device_matrix()
+    {
+        deallocate();
+    }
+
+    // ==========
+    // Assignment
+    // ==========
+
+    /**
+     * @brief Copy assignment operator. The existing memory is reused if it has the right size. The copy is enqueued on the stream of this matrix.
+     *
+     * @param m The device matrix to be copied.
+     * @return A reference to this matrix.
+     * @throws device_error if the memory cannot be allocated or the copy fails.
+     */
+    device_matrix<T> &operator=(const device_matrix<T> &m)
+    {
+        if (this == &m)
+            return *this;
+        if (size() != m.size())
+        {
+            deallocate();
+            rows = m.rows;
+            cols = m.cols;
+            allocate();
+        }
+        else
+        {
+            rows = m.rows;
+            cols = m.cols;
+        }
+        copy_from(m);
+        return *this;
+    }
+
+    /**
+     * @brief Move assignment operator. This matrix takes over the memory and the stream of the other matrix, which becomes empty.
+     *
+     * @param m The device matrix to be moved.
+     * @return A reference to this matrix.
+     */
+    device_matrix<T> &operator=(device_matrix<T> &&m) noexcept
+    {
+        if (this != &m)
+        {
+            deallocate();
+            rows = std::exchange(m.rows, 0);
+            cols = std::exchange(m.cols, 0);
+            elements = std::exchange(m.elements, nullptr);
+            stream = m.stream;
+        }
+        return *this;
+    }
+
+    // ================
+    // Member functions
+    // ================
+
+    /**
+     * @brief Copy the matrix to a new host matrix, and wait for the copy to finish. The matrix must not be empty, since host matrices cannot have zero rows or columns.
+     *
+     * @return The host matrix.
+     * @throws zero_size if the matrix is empty, that is, default constructed or moved from.
+     * @throws device_error if the copy, or any of the work enqueued on the stream before it, fails.
+     */
+    matrix<T> to_host() const
+    {
+        if (size() == 0)
+            throw zero_size{};
+        matrix<T> m(rows, cols);
+        to_host(m);
+        stream->synchronize();
+        return m;
+    }
+
+    /**
+     * @brief Enqueue a copy of the matrix to an existing host matrix of the same size, and return without waiting for it. The elements of the host matrix must not be accessed until the stream is synchronized. If the host matrix uses pinned_allocator, the copy runs concurrently with the calling thread; otherwise, the runtime may block until the copy is done.
+     *
+     * @param m The host matrix to copy the elements into. Must have the same number of rows and columns.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     * @throws device_error if the copy fails.
+     */
+    template <typename Allocator>
+    void to_host(matrix<T, Allocator> &m) const
+    {
+        if (m.get_rows() != rows or m.get_cols() != cols)
+            throw incompatible_sizes_add{};
+        if (size() > 0)
+            matrix_detail::device_check(MATRIX_DEVICE_API(Memcpy2DAsync)(m.data(), m.get_stride() * sizeof(T), elements, cols * sizeof(T), cols * sizeof(T), rows, MATRIX_DEVICE_API(MemcpyDeviceToHost), stream->get_stream()));
+    }
+
+    /**
+     * @brief Block the calling thread until all of the work enqueued on the stream of this matrix has finished.
+     *
+     * @throws device_error if any of the work failed.
+     */
+    void synchronize() const
+    {
+        stream->synchronize();
+    }
+
+    /**
+     * @brief Member function used to obtain the number of rows in the matrix.
+     *
+     * @return The number of rows.
+     */
+    inline size_t get_rows() const
+    {
+        return rows;
+    }
+
+    /**
+     * @brief Member function used to obtain the number of columns in the matrix.
+     *
+     * @return The number of columns.
+     */
+    inline size_t get_cols() const
+    {
+        return cols;
+    }
+
+    /**
+     * @brief Member function used to obtain the stream the matrix is associated with.
+     *
+     * @return A reference to the stream.
+     */
+    inline device_stream &get_stream() const
+    {
+        return *stream;
+    }
+
+    /**
+     * @brief Member function used to obtain a device pointer to the first element, for use in custom kernels. The elements are stored row by row without padding.
+     *
+     * @return A device pointer to the elements.
+     */
+    inline T *data()
+    {
+        return elements;
+    }
+
+    /**
+     * @brief Member function used to obtain a device pointer to the first element, for use in custom kernels.
+     *
+     * @return A device pointer to the elements.
+     */
+    inline const T *data() const
+    {
+        return elements;
+    }
+
+    // ================
+    // Friend functions
+    // ================
+
+    /**
+     * @brief Overloaded binary operator `+` used to add two device matrices on the device. If the first operand is a temporary, its memory is reused for the result.
+     *
+     * @param a The first matrix to be added.
+     * @param b The second matrix to be added.
+     * @return The sum of the matrices.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    friend device_matrix<T> operator+(const device_matrix<T> &a, const device_matrix<T> &b)
+    {
+        device_matrix<T> c(a.rows, a.cols, *a.stream);
+        c.geam(T{1}, a, T{1}, b);
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add a temporary device matrix to another one, reusing the memory of the temporary for the result.
+     *
+     * @param a The first matrix to be added, which is overwritten with the sum.
+     * @param b The second matrix to be added.
+     * @return The sum of the matrices.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    friend device_matrix<T> operator+(device_matrix<T> &&a, const device_matrix<T> &b)
+    {
+        a += b;
+        return std::move(a);
+    }
+
+    /**
+     * @brief Overloaded binary operator `-` used to subtract two device matrices on the device. If the first operand is a temporary, its memory is reused for the result.
+     *
+     * @param a The first matrix to be subtracted.
+     * @param b The second matrix to be subtracted.
+     * @return The first matrix minus the second matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    friend device_matrix<T> operator-(const device_matrix<T> &a, const device_matrix<T> &b)
+    {
+        device_matrix<T> c(a.rows, a.cols, *a.stream);
+        c.geam(T{1}, a, T{-1}, b);
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `-` used to subtract a device matrix from a temporary one, reusing the memory of the temporary for the result.
+     *
+     * @param a The first matrix to be subtracted, which is overwritten with the difference.
+     * @param b The second matrix to be subtracted.
+     * @return The first matrix minus the second matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    friend device_matrix<T> operator-(device_matrix<T> &&a, const device_matrix<T> &b)
+    {
+        a -= b;
+        return std::move(a);
+    }
+
+    /**
+     * @brief Overloaded unary operator `-` used to take the negative of a device matrix on the device.
+     *
+     * @param m The matrix to be negated.
+     * @return The negative of the matrix.
+     */
+    friend device_matrix<T> operator-(const device_matrix<T> &m)
+    {
+        return T{-1} * m;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a scalar on the left and a device matrix on the right, on the device. If the matrix is a temporary, its memory is reused for the result.
+     *
+     * @param s The scalar.
+     * @param m The matrix.
+     * @return The product of the scalar with the matrix.
+     */
+    friend device_matrix<T> operator*(const T &s, const device_matrix<T> &m)
+    {
+        device_matrix<T> c(m.rows, m.cols, *m.stream);
+        c.geam(s, m, T{0}, m);
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a scalar on the left and a temporary device matrix on the right, reusing the memory of the temporary for the result.
+     *
+     * @param s The scalar.
+     * @param m The matrix, which is overwritten with the product.
+     * @return The product of the scalar with the matrix.
+     */
+    friend device_matrix<T> operator*(const T &s, device_matrix<T> &&m)
+    {
+        m *= s;
+        return std::move(m);
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a device matrix on the left and a scalar on the right, on the device.
+     *
+     * @param m The matrix.
+     * @param s The scalar.
+     * @return The product of the scalar with the matrix.
+     */
+    friend device_matrix<T> operator*(const device_matrix<T> &m, const T &s)
+    {
+        return s * m;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a temporary device matrix on the left and a scalar on the right, reusing the memory of the temporary for the result.
+     *
+     * @param m The matrix, which is overwritten with the product.
+     * @param s The scalar.
+     * @return The product of the scalar with the matrix.
+     */
+    friend device_matrix<T> operator*(device_matrix<T> &&m, const T &s)
+    {
+        return s * std::move(m);
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply two device matrices on the device, using `gemm` from the GPU BLAS library.
+     *
+     * @param a The first matrix to be multiplied.
+     * @param b The second matrix to be multiplied.
+     * @return The product of the matrices.
+     * @throws incompatible_sizes_multiply if the number of columns in the first matrix is not the same as the number of rows in the second matrix.
+     */
+    friend device_matrix<T> operator*(const device_matrix<T> &a, const device_matrix<T> &b)
+    {
+        if (a.cols != b.rows)
+            throw incompatible_sizes_multiply{};
+        device_matrix<T> c(a.rows, b.cols, *a.stream);
+        c.stream->wait_for(*b.stream);
+        // The BLAS library expects column-major matrices, and a row-major matrix is the column-major storage of its transpose, so C = A B is computed as C^T = B^T A^T.
+        const int m{matrix_detail::device_int(b.cols)}, n{matrix_detail::device_int(a.rows)}, k{matrix_detail::device_int(a.cols)};
+        const T alpha{1}, beta{0};
+        if constexpr (std::same_as<T, float>)
+            matrix_detail::device_check(MATRIX_DEVICE_BLAS_API(Sgemm)(c.stream->get_blas_handle(), MATRIX_DEVICE_BLAS_OP_N, MATRIX_DEVICE_BLAS_OP_N, m, n, k, &alpha, b.elements, m, a.elements, k, &beta, c.elements, m));
+        else
+            matrix_detail::device_check(MATRIX_DEVICE_BLAS_API(Dgemm)(c.stream->get_blas_handle(), MATRIX_DEVICE_BLAS_OP_N, MATRIX_DEVICE_BLAS_OP_N, m, n, k, &alpha, b.elements, m, a.elements, k, &beta, c.elements, m));
+        b.stream->wait_for(*c.stream);
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+=` used to add a device matrix to another in place, on the device.
+     *
+     * @param a The first matrix to be added. Will be replaced with the sum of the matrices.
+     * @param b The second matrix to be added.
+     * @return A reference to the first matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    friend device_matrix<T> &operator+=(device_matrix<T> &a, const device_matrix<T> &b)
+    {
+        a.geam(T{1}, a, T{1}, b);
+        return a;
+    }
+
+    /**
+     * @brief Overloaded binary operator `-=` used to subtract a device matrix from another in place, on the device.
+     *
+     * @param a The first matrix to be subtracted. Will be replaced with the first matrix minus the second matrix.
+     * @param b The second matrix to be subtracted.
+     * @return A reference to the first matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    friend device_matrix<T> &operator-=(device_matrix<T> &a, const device_matrix<T> &b)
+    {
+        a.geam(T{1}, a, T{-1}, b);
+        return a;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*=` used to multiply a device matrix by a scalar in place, on the device.
+     *
+     * @param m The matrix. Will be replaced with the product of the scalar with the matrix.
+     * @param s The scalar.
+     * @return A reference to the matrix.
+     */
+    friend device_matrix<T> &operator*=(device_matrix<T> &m, const T &s)
+    {
+        if (m.size() == 0)
+            return m;
+        if constexpr (std::same_as<T, float>)
+            matrix_detail::device_check(MATRIX_DEVICE_BLAS_API(Sscal)(m.stream->get_blas_handle(), matrix_detail::device_int(m.size()), &s, m.elements, 1));
+        else
+            matrix_detail::device_check(MATRIX_DEVICE_BLAS_API(Dscal)(m.stream->get_blas_handle(), matrix_detail::device_int(m.size()), &s, m.elements, 1));
+        return m;
+    }
+
+    // ==========
+    // Exceptions
+    // ==========
+
+    /**
+     * @brief Exception to be thrown if the number of rows or columns given to the constructor is zero.
+     */
+    using zero_size = matrix_detail::zero_size<T>;
+
+    /**
+     * @brief Exception to be thrown if two matrices to be added or subtracted, or copied to the host, do not have the same number of rows and columns.
+     */
+    using incompatible_sizes_add = matrix_detail::incompatible_sizes_add<T>;
+
+    /**
+     * @brief Exception to be thrown if two matrices to be multiplied have incompatible sizes.
+     */
+    using incompatible_sizes_multiply = matrix_detail::incompatible_sizes_multiply<T>;
+
+    /**
+     * @brief Exception to be thrown if a call to the GPU runtime or BLAS library fails.
+     */
+    using device_error = matrix_detail::device_error;
+
+private:
+    /**
+     * @brief Get the number of elements in the matrix.
+     */
+    inline size_t size() const
+    {
+        return rows * cols;
+    }
+
+    /**
+     * @brief Allocate device memory for the elements, in stream order.
+     *
+     * @throws device_error if the memory cannot be allocated.
+     */
+    void allocate()
+    {
+        if (size() == 0)
+            return;
+        void *p{nullptr};
+        matrix_detail::device_check(MATRIX_DEVICE_API(MallocAsync)(&p, size() * sizeof(T), stream->get_stream()));
+        elements = static_cast<T *>(p);
+    }
+
+    /**
+     * @brief Free the device memory, in stream order. Errors are ignored, since this is called from the destructor.
+     */
+    void deallocate()
+    {
+        if (elements != nullptr)
+            MATRIX_DEVICE_API(FreeAsync)(elements, stream->get_stream());
+        elements = nullptr;
+    }
+
+    /**
+     * @brief Enqueue a copy of the elements of another device matrix of the same size on the stream of this matrix.
+     *
+     * @param m The matrix to copy.
+     * @throws device_error if the copy fails.
+     */
+    void copy_from(const device_matrix<T> &m)
+    {
+        if (size() == 0)
+            return;
+        stream->wait_for(*m.stream);
+        matrix_detail::device_check(MATRIX_DEVICE_API(MemcpyAsync)(elements, m.elements, size() * sizeof(T), MATRIX_DEVICE_API(MemcpyDeviceToDevice), stream->get_stream()));
+        m.stream->wait_for(*stream);
+    }
+
+    /**
+     * @brief Compute alpha A + beta B into this matrix using `geam` from the GPU BLAS library, on the stream of this matrix. This matrix may be A or B, in which case the operation is done in place.
+     *
+     * @param alpha The factor to multiply A by.
+     * @param a The matrix A.
+     * @param beta The factor to multiply B by. If zero, B is not read.
+     * @param b The matrix B.
+     * @throws incompatible_sizes_add if the matrices do not all have the same number of rows and columns.
+     */
+    void geam(const T &alpha, const device_matrix<T> &a, const T &beta, const device_matrix<T> &b)
+    {
+        if (a.rows != rows or a.cols != cols or b.rows != rows or b.cols != cols)
+            throw incompatible_sizes_add{};
+        if (size() == 0)
+            return;
+        stream->wait_for(*a.stream);
+        stream->wait_for(*b.stream);
+        // As in operator*(), each row-major matrix is passed as the column-major storage of its transpose, which gives the same result since the operation is elementwise.
+        const int m{matrix_detail::device_int(cols)}, n{matrix_detail::device_int(rows)};
+        if constexpr (std::same_as<T, float>)
+            matrix_detail::device_check(MATRIX_DEVICE_BLAS_API(Sgeam)(stream->get_blas_handle(), MATRIX_DEVICE_BLAS_OP_N, MATRIX_DEVICE_BLAS_OP_N, m, n, &alpha, a.elements, m, &beta, b.elements, m, elements, m));
+        else
+            matrix_detail::device_check(MATRIX_DEVICE_BLAS_API(Dgeam)(stream->get_blas_handle(), MATRIX_DEVICE_BLAS_OP_N, MATRIX_DEVICE_BLAS_OP_N, m, n, &alpha, a.elements, m, &beta, b.elements, m, elements, m));
+        a.stream->wait_for(*stream);
+        b.stream->wait_for(*stream);
+    }
+
+    /**
+     * @brief The number of rows.
+     */
+    size_t rows{0};
+
+    /**
+     * @brief The number of columns.
+     */
+    size_t cols{0};
+
+    /**
+     * @brief A device pointer to the elements, or `nullptr` if the matrix is empty.
+     */
+    T *elements{nullptr};
+
+    /**
+     * @brief The stream the matrix is associated with.
+     */
+    device_stream *stream{nullptr};
+};
+
+/**
+ * @brief Copy a host matrix to a new device matrix asynchronously. See the corresponding constructor of device_matrix for details.
+ *
+ * @param m The host matrix. Its elements must be `float` or `double`.
+ * @param stream The stream to associate the device matrix with. By default, the default stream of the calling thread.
+ * @return The device matrix.
+ * @throws device_error if the memory cannot be allocated or the copy fails.
+ */
+template <matrix_detail::device_type T, typename Allocator>
+device_matrix<T> to_device(const matrix<T, Allocator> &m, device_stream &stream = device_stream::default_stream())
+{
+    return device_matrix<T>(m, stream);
+}
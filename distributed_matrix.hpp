@@ -0,0 +1,1089 @@
+#pragma once
+
+/**
+ * @file distributed_matrix.hpp
+ * @author Barak Shoshany (baraksh@gmail.com) (http://baraksh.com)
+ * @version 0.1
+ * @date 2020-11-30
+ * @copyright Copyright (c) 2020
+ *
+ * @brief A class template for matrices distributed across the processes of an MPI program in a 2D block-cyclic layout, with distributed matrix multiplication using the SUMMA algorithm.
+ *
+ * @details The processes are arranged in a P x Q process_grid. A distributed matrix is split into square blocks of a fixed size, and block (I, J) is stored by the process in row I mod P and column J mod Q of the grid, as in ScaLAPACK. Each process stores its blocks as separate matrices, so every local operation uses the ordinary matrix class template. Elementwise operations only involve the local blocks, and need no communication. Products are computed using SUMMA: at each step, one block column of A is broadcast along the rows of the grid and one block row of B along its columns, and the local blocks of C are updated using the blocked kernel behind operator*(). The broadcasts for the next step are started before the local update of the current step, so that communication overlaps with computation.
+ *
+ * Programs must be compiled with an MPI compiler wrapper, such as `mpicxx`, and MPI must be initialized before any process_grid is created. The matrices passed to scatter() and gather() must be row-major, since the blocks are copied row by row to and from their memory.
+ */
+
+#include "matrix.hpp"
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <complex>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace matrix_detail
+{
+    // ==========
+    // Exceptions
+    // ==========
+
+    /**
+     * @brief Exception to be thrown if an MPI call fails, or if a message is too large to be described by an `int` count.
+     */
+    class mpi_error
+    {
+    };
+
+    /**
+     * @brief Exception to be thrown if the number of processes in a communicator does not match the requested process grid.
+     */
+    class invalid_grid
+    {
+    };
+
+    // ===========
+    // MPI helpers
+    // ===========
+
+    /**
+     * @brief The default size of the blocks of a distributed matrix. Large enough that the local products in SUMMA run at close to the full speed of the blocked kernel, and small enough to balance the load between the processes for moderately sized matrices.
+     */
+    inline constexpr size_t distributed_block_size{256};
+
+    /**
+     * @brief Throw mpi_error if an MPI call failed. By default, MPI aborts the program on errors instead, unless the error handler of the communicator has been changed to `MPI_ERRORS_RETURN`.
+     *
+     * @param status The status returned by the call.
+     */
+    inline void mpi_check(const int status)
+    {
+        if (status != MPI_SUCCESS)
+            throw mpi_error{};
+    }
+
+    /**
+     * @brief Convert a number of elements to the `int` count expected by MPI.
+     *
+     * @param n The number of elements.
+     * @return The number of elements as an `int`.
+     * @throws mpi_error if the number does not fit in an `int`.
+     */
+    inline int mpi_count(const size_t &n)
+    {
+        if (n > static_cast<size_t>(INT_MAX))
+            throw mpi_error{};
+        return static_cast<int>(n);
+    }
+
+    /**
+     * @brief A concept satisfied by the element types with a predefined MPI datatype.
+     */
+    template <typename T>
+    concept mpi_type = std::same_as<T, float> or std::same_as<T, double> or std::same_as<T, long double> or std::same_as<T, int> or std::same_as<T, long> or std::same_as<T, long long> or std::same_as<T, unsigned> or std::same_as<T, unsigned long> or std::same_as<T, unsigned long long> or std::same_as<T, std::complex<float>> or std::same_as<T, std::complex<double>>;
+
+    /**
+     * @brief Get the MPI datatype corresponding to an element type.
+     *
+     * @tparam T The element type.
+     * @return The MPI datatype.
+     */
+    template <mpi_type T>
+    MPI_Datatype mpi_datatype()
+    {
+        if constexpr (std::same_as<T, float>)
+            return MPI_FLOAT;
+        else if constexpr (std::same_as<T, double>)
+            return MPI_DOUBLE;
+        else if constexpr (std::same_as<T, long double>)
+            return MPI_LONG_DOUBLE;
+        else if constexpr (std::same_as<T, int>)
+            return MPI_INT;
+        else if constexpr (std::same_as<T, long>)
+            return MPI_LONG;
+        else if constexpr (std::same_as<T, long long>)
+            return MPI_LONG_LONG;
+        else if constexpr (std::same_as<T, unsigned>)
+            return MPI_UNSIGNED;
+        else if constexpr (std::same_as<T, unsigned long>)
+            return MPI_UNSIGNED_LONG;
+        else if constexpr (std::same_as<T, unsigned long long>)
+            return MPI_UNSIGNED_LONG_LONG;
+        else if constexpr (std::same_as<T, std::complex<float>>)
+            return MPI_C_FLOAT_COMPLEX;
+        else
+            return MPI_C_DOUBLE_COMPLEX;
+    }
+
+    /**
+     * @brief Count the number of rows (or columns) of a block-cyclic matrix stored by one row (or column) of the process grid, as in the ScaLAPACK function `numroc`.
+     *
+     * @param n The global number of rows (or columns).
+     * @param block The block size.
+     * @param index The row (or column) of the process grid.
+     * @param procs The number of rows (or columns) in the process grid.
+     * @return The number of blocks and the number of rows (or columns) stored.
+     */
+    inline std::pair<size_t, size_t> block_cyclic_extent(const size_t &n, const size_t &block, const size_t &index, const size_t &procs)
+    {
+        const size_t blocks{(n + block - 1) / block};
+        const size_t local_blocks{(blocks > index) ? ((blocks - index - 1) / procs) + 1 : 0};
+        size_t local{local_blocks * block};
+        // Only the process that stores the last block can have a partial block.
+        if (local_blocks > 0 and (blocks - 1) % procs == index)
+            local -= (blocks * block) - n;
+        return {local_blocks, local};
+    }
+} // namespace matrix_detail
+
+// ============
+// Process grid
+// ============
+
+/**
+ * @brief A two-dimensional grid of the processes in an MPI communicator, used to distribute matrices. Process number r is in row r / Q and column r mod Q of a P x Q grid. The grid creates its own copies of the communicator, one for each row and one for each column, so its messages never interfere with other messages sent by the program.
+ */
+class process_grid
+{
+public:
+    /**
+     * @brief Create a process grid with the given number of rows and columns.
+     *
+     * @param comm The communicator whose processes form the grid. Every process in it must create the grid.
+     * @param input_rows The number of rows in the grid.
+     * @param input_cols The number of columns in the grid.
+     * @throws invalid_grid if the number of processes in the communicator is not the product of the number of rows and columns.
+     */
+    process_grid(MPI_Comm comm, const int &input_rows, const int &input_cols)
+        : rows(input_rows), cols(input_cols)
+    {
+        int size{0};
+        matrix_detail::mpi_check(MPI_Comm_size(comm, &size));
+        if (rows <= 0 or cols <= 0 or rows * cols != size)
+            throw invalid_grid{};
+        create(comm);
+    }
+
+    /**
+     * @brief Create a process grid which is as close to square as possible, as chosen by `MPI_Dims_create`.
+     *
+     * @param comm The communicator whose processes form the grid. By default, all of the processes. Every process in it must create the grid.
+     */
+    explicit process_grid(MPI_Comm comm = MPI_COMM_WORLD)
+    {
+        int size{0};
+        matrix_detail::mpi_check(MPI_Comm_size(comm, &size));
+        std::array<int, 2> dims{0, 0};
+        matrix_detail::mpi_check(MPI_Dims_create(size, 2, dims.data()));
+        rows = dims[0];
+        cols = dims[1];
+        create(comm);
+    }
+
+    process_grid(const process_grid &) = delete;
+    process_grid &operator=(const process_grid &) = delete;
+
+    /**
+     * @brief Free the communicators of the grid. All of the distributed matrices using the grid must be destroyed first, and MPI must not have been finalized yet.
+     */
+    ~process_grid()
+    {
+        MPI_Comm_free(&col_comm);
+        MPI_Comm_free(&row_comm);
+        MPI_Comm_free(&comm);
+    }
+
+    /**
+     * @brief Member function used to obtain the number of rows in the grid.
+     *
+     * @return The number of rows.
+     */
+    inline int get_rows() const
+    {
+        return rows;
+    }
+
+    /**
+     * @brief Member function used to obtain the number of columns in the grid.
+     *
+     * @return The number of columns.
+     */
+    inline int get_cols() const
+    {
+        return cols;
+    }
+
+    /**
+     * @brief Member function used to obtain the row of the calling process in the grid.
+     *
+     * @return The row.
+     */
+    inline int get_row() const
+    {
+        return rank / cols;
+    }
+
+    /**
+     * @brief Member function used to obtain the column of the calling process in the grid.
+     *
+     * @return The column.
+     */
+    inline int get_col() const
+    {
+        return rank % cols;
+    }
+
+    /**
+     * @brief Member function used to obtain the rank of the calling process in the grid.
+     *
+     * @return The rank.
+     */
+    inline int get_rank() const
+    {
+        return rank;
+    }
+
+    /**
+     * @brief Member function used to obtain the rank of the process in a given row and column of the grid.
+     *
+     * @param row The row.
+     * @param col The column.
+     * @return The rank.
+     */
+    inline int rank_of(const int &row, const int &col) const
+    {
+        return (row * cols) + col;
+    }
+
+    /**
+     * @brief Member function used to obtain the communicator of all of the processes in the grid.
+     *
+     * @return The communicator.
+     */
+    inline MPI_Comm get_communicator() const
+    {
+        return comm;
+    }
+
+    /**
+     * @brief Member function used to obtain the communicator of the processes in the same row of the grid as the calling process, ranked by their column.
+     *
+     * @return The communicator.
+     */
+    inline MPI_Comm get_row_communicator() const
+    {
+        return row_comm;
+    }
+
+    /**
+     * @brief Member function used to obtain the communicator of the processes in the same column of the grid as the calling process, ranked by their row.
+     *
+     * @return The communicator.
+     */
+    inline MPI_Comm get_col_communicator() const
+    {
+        return col_comm;
+    }
+
+    /**
+     * @brief Exception to be thrown if the number of processes does not match the size of the grid.
+     */
+    using invalid_grid = matrix_detail::invalid_grid;
+
+    /**
+     * @brief Exception to be thrown if an MPI call fails.
+     */
+    using mpi_error = matrix_detail::mpi_error;
+
+private:
+    /**
+     * @brief Create the communicators of the grid.
+     *
+     * @param input_comm The communicator whose processes form the grid.
+     */
+    void create(MPI_Comm input_comm)
+    {
+        matrix_detail::mpi_check(MPI_Comm_dup(input_comm, &comm));
+        matrix_detail::mpi_check(MPI_Comm_rank(comm, &rank));
+        matrix_detail::mpi_check(MPI_Comm_split(comm, get_row(), get_col(), &row_comm));
+        matrix_detail::mpi_check(MPI_Comm_split(comm, get_col(), get_row(), &col_comm));
+    }
+
+    /**
+     * @brief The number of rows in the grid.
+     */
+    int rows{0};
+
+    /**
+     * @brief The number of columns in the grid.
+     */
+    int cols{0};
+
+    /**
+     * @brief The rank of the calling process.
+     */
+    int rank{0};
+
+    /**
+     * @brief The communicator of all of the processes in the grid.
+     */
+    MPI_Comm comm{MPI_COMM_NULL};
+
+    /**
+     * @brief The communicator of the processes in the same row.
+     */
+    MPI_Comm row_comm{MPI_COMM_NULL};
+
+    /**
+     * @brief The communicator of the processes in the same column.
+     */
+    MPI_Comm col_comm{MPI_COMM_NULL};
+};
+
+// ==================
+// Distributed matrix
+// ==================
+
+/**
+ * @brief A class template for matrices distributed across the processes of a process_grid in a 2D block-cyclic layout. Each process stores the blocks it owns as separate matrices (tiles), which are ordered by block row and then by block column. All of the blocks are square, except for those in the last block row or column.
+ * @details The member functions that involve communication, namely scatter(), gather(), and operator*(), are collective: every process in the grid must call them, in the same order. Elementwise operations are purely local. The operands of all operators must be distributed in the same way, that is, over the same grid and with the same block size.
+ *
+ * @tparam T The type of the matrix elements. Must have a predefined MPI datatype (see matrix_detail::mpi_type).
+ */
+template <matrix_detail::mpi_type T>
+class distributed_matrix
+{
+public:
+    using value_type = T;
+
+    // ============
+    // Constructors
+    // ============
+
+    /**
+     * @brief Constructor to create a distributed matrix with UNINITIALIZED elements. Every process in the grid must call it with the same arguments.
+     *
+     * @param input_grid The process grid. Must outlive the matrix.
+     * @param input_rows The global number of rows.
+     * @param input_cols The global number of columns.
+     * @param input_block_size The number of rows and columns in each block.
+     * @throws zero_size if the number of rows or columns, or the block size, is zero.
+     */
+    distributed_matrix(const process_grid &input_grid, const size_t &input_rows, const size_t &input_cols, const size_t &input_block_size = matrix_detail::distributed_block_size)
+        : grid(&input_grid), rows(input_rows), cols(input_cols), block_size(checked_block_size(input_rows, input_cols, input_block_size))
+    {
+        for (size_t i{0}; i < local_block_rows; i++)
+            for (size_t j{0}; j < local_block_cols; j++)
+                tiles.emplace_back(tile_rows(i), tile_cols(j));
+    }
+
+    /**
+     * @brief Constructor to create a distributed matrix with all of its elements initialized to a specific value.
+     *
+     * @param input_grid The process grid. Must outlive the matrix.
+     * @param input_rows The global number of rows.
+     * @param input_cols The global number of columns.
+     * @param input_block_size The number of rows and columns in each block.
+     * @param input_init The value to initialize all of the elements to.
+     * @throws zero_size if the number of rows or columns, or the block size, is zero.
+     */
+    distributed_matrix(const process_grid &input_grid, const size_t &input_rows, const size_t &input_cols, const size_t &input_block_size, const T &input_init)
+        : grid(&input_grid), rows(input_rows), cols(input_cols), block_size(checked_block_size(input_rows, input_cols, input_block_size))
+    {
+        for (size_t i{0}; i < local_block_rows; i++)
+            for (size_t j{0}; j < local_block_cols; j++)
+                tiles.emplace_back(tile_rows(i), tile_cols(j), input_init);
+    }
+
+    /**
+     * @brief Distribute a matrix stored on one process to all of the processes in the grid. This is a collective operation. The root process sends each of the other processes its blocks, one process at a time, so it needs no memory beyond the matrix itself and the blocks of one process.
+     *
+     * @param grid The process grid. Must outlive the matrix.
+     * @param m On the root process, a pointer to the matrix to distribute. Ignored on the other processes, and may be `nullptr`.
+     * @param root The rank of the root process in the grid.
+     * @param block_size The number of rows and columns in each block. Only used on the root process.
+     * @return The distributed matrix.
+     * @throws zero_size if the block size is zero.
+     * @throws mpi_error if a message is too large.
+     */
+    template <typename Allocator = aligned_allocator<T>>
+    static distributed_matrix<T> scatter(const process_grid &grid, const matrix<T, Allocator> *m, const int &root = 0, const size_t &block_size = matrix_detail::distributed_block_size)
+    {
+        std::array<uint64_t, 3> sizes{0, 0, 0};
+        if (grid.get_rank() == root)
+            sizes = {m->get_rows(), m->get_cols(), block_size};
+        matrix_detail::mpi_check(MPI_Bcast(sizes.data(), 3, MPI_UINT64_T, root, grid.get_communicator()));
+        distributed_matrix<T> d(grid, sizes[0], sizes[1], sizes[2]);
+        if (grid.get_rank() == root)
+        {
+            std::vector<T> buffer;
+            for (int r{0}; r < grid.get_rows(); r++)
+                for (int c{0}; c < grid.get_cols(); c++)
+                {
+                    const int dest{grid.rank_of(r, c)};
+                    if (dest == root)
+                        d.for_each_tile_of(r, c, [&](matrix<T> &tile, const size_t &row, const size_t &col)
+                                           { tile = m->block(row, col, tile.get_rows(), tile.get_cols()); });
+                    else
+                    {
+                        buffer.clear();
+                        d.for_each_tile_of(r, c, [&](matrix<T> &tile, const size_t &row, const size_t &col)
+                                           {
+                                               for (size_t i{0}; i < tile.get_rows(); i++)
+                                                   buffer.insert(buffer.end(), m->data() + ((row + i) * m->get_stride()) + col, m->data() + ((row + i) * m->get_stride()) + col + tile.get_cols());
+                                           });
+                        if (not buffer.empty())
+                            matrix_detail::mpi_check(MPI_Send(buffer.data(), matrix_detail::mpi_count(buffer.size()), matrix_detail::mpi_datatype<T>(), dest, 0, grid.get_communicator()));
+                    }
+                }
+        }
+        else if (not d.tiles.empty())
+        {
+            std::vector<T> buffer(d.local_elements());
+            matrix_detail::mpi_check(MPI_Recv(buffer.data(), matrix_detail::mpi_count(buffer.size()), matrix_detail::mpi_datatype<T>(), root, 0, grid.get_communicator(), MPI_STATUS_IGNORE));
+            d.unpack(buffer);
+        }
+        return d;
+    }
+
+    // ================
+    // Member functions
+    // ================
+
+    /**
+     * @brief Collect the distributed matrix into a matrix on one process. This is a collective operation.
+     *
+     * @param m On the root process, a pointer to the matrix to write the elements into, which must have the same number of rows and columns. Ignored on the other processes, and may be `nullptr`.
+     * @param root The rank of the root process in the grid.
+     * @throws incompatible_sizes_add if the matrix on the root process does not have the right size.
+     * @throws mpi_error if a message is too large.
+     */
+    template <typename Allocator>
+    void gather(matrix<T, Allocator> *m, const int &root = 0) const
+    {
+        if (grid->get_rank() == root)
+        {
+            if (m->get_rows() != rows or m->get_cols() != cols)
+                throw incompatible_sizes_add{};
+            std::vector<T> buffer;
+            for (int r{0}; r < grid->get_rows(); r++)
+                for (int c{0}; c < grid->get_cols(); c++)
+                {
+                    const int source{grid->rank_of(r, c)};
+                    if (source == root)
+                    {
+                        for_each_tile_of(r, c, [&](const matrix<T> &tile, const size_t &row, const size_t &col)
+                                         { m->block(row, col, tile.get_rows(), tile.get_cols()) = tile; });
+                        continue;
+                    }
+                    buffer.resize(elements_of(r, c));
+                    if (buffer.empty())
+                        continue;
+                    matrix_detail::mpi_check(MPI_Recv(buffer.data(), matrix_detail::mpi_count(buffer.size()), matrix_detail::mpi_datatype<T>(), source, 0, grid->get_communicator(), MPI_STATUS_IGNORE));
+                    const T *next{buffer.data()};
+                    for_each_tile_of(r, c, [&](const matrix<T> &tile, const size_t &row, const size_t &col)
+                                     {
+                                         for (size_t i{0}; i < tile.get_rows(); i++, next += tile.get_cols())
+                                             std::copy_n(next, tile.get_cols(), m->data() + ((row + i) * m->get_stride()) + col);
+                                     });
+                }
+        }
+        else if (not tiles.empty())
+        {
+            const std::vector<T> buffer{pack()};
+            matrix_detail::mpi_check(MPI_Send(buffer.data(), matrix_detail::mpi_count(buffer.size()), matrix_detail::mpi_datatype<T>(), root, 0, grid->get_communicator()));
+        }
+    }
+
+    /**
+     * @brief Member function used to obtain the global number of rows.
+     *
+     * @return The number of rows.
+     */
+    inline size_t get_rows() const
+    {
+        return rows;
+    }
+
+    /**
+     * @brief Member function used to obtain the global number of columns.
+     *
+     * @return The number of columns.
+     */
+    inline size_t get_cols() const
+    {
+        return cols;
+    }
+
+    /**
+     * @brief Member function used to obtain the number of rows and columns in each block.
+     *
+     * @return The block size.
+     */
+    inline size_t get_block_size() const
+    {
+        return block_size;
+    }
+
+    /**
+     * @brief Member function used to obtain the process grid.
+     *
+     * @return A reference to the grid.
+     */
+    inline const process_grid &get_grid() const
+    {
+        return *grid;
+    }
+
+    /**
+     * @brief Member function used to obtain the number of block rows stored by the calling process.
+     *
+     * @return The number of local block rows.
+     */
+    inline size_t get_local_block_rows() const
+    {
+        return local_block_rows;
+    }
+
+    /**
+     * @brief Member function used to obtain the number of block columns stored by the calling process.
+     *
+     * @return The number of local block columns.
+     */
+    inline size_t get_local_block_cols() const
+    {
+        return local_block_cols;
+    }
+
+    /**
+     * @brief Member function used to access one of the blocks stored by the calling process.
+     *
+     * @param i The local block row, less than get_local_block_rows().
+     * @param j The local block column, less than get_local_block_cols().
+     * @return A reference to the block.
+     */
+    inline matrix<T> &tile(const size_t &i, const size_t &j)
+    {
+        return tiles[(i * local_block_cols) + j];
+    }
+
+    /**
+     * @brief Member function used to access one of the blocks stored by the calling process.
+     *
+     * @param i The local block row, less than get_local_block_rows().
+     * @param j The local block column, less than get_local_block_cols().
+     * @return A const reference to the block.
+     */
+    inline const matrix<T> &tile(const size_t &i, const size_t &j) const
+    {
+        return tiles[(i * local_block_cols) + j];
+    }
+
+    /**
+     * @brief Member function used to obtain the global index of the first row of a local block row.
+     *
+     * @param i The local block row.
+     * @return The global row index.
+     */
+    inline size_t global_row(const size_t &i) const
+    {
+        return ((i * grid_rows()) + static_cast<size_t>(grid->get_row())) * block_size;
+    }
+
+    /**
+     * @brief Member function used to obtain the global index of the first column of a local block column.
+     *
+     * @param j The local block column.
+     * @return The global column index.
+     */
+    inline size_t global_col(const size_t &j) const
+    {
+        return ((j * grid_cols()) + static_cast<size_t>(grid->get_col())) * block_size;
+    }
+
+    // ================
+    // Friend functions
+    // ================
+
+    /**
+     * @brief Overloaded binary operator `+` used to add two distributed matrices. Each process adds its own blocks, so no communication is needed. If the first operand is a temporary, its memory is reused for the result.
+     *
+     * @param a The first matrix to be added.
+     * @param b The second matrix to be added.
+     * @return The sum of the matrices.
+     * @throws incompatible_sizes_add if the matrices do not have the same size and distribution.
+     */
+    friend distributed_matrix<T> operator+(const distributed_matrix<T> &a, const distributed_matrix<T> &b)
+    {
+        distributed_matrix<T> c(a);
+        c += b;
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add a temporary distributed matrix to another one, reusing the memory of the temporary for the result, with no communication.
+     *
+     * @param a The first matrix to be added, which is overwritten with the sum.
+     * @param b The second matrix to be added.
+     * @return The sum of the matrices.
+     * @throws incompatible_sizes_add if the matrices do not have the same size and distribution.
+     */
+    friend distributed_matrix<T> operator+(distributed_matrix<T> &&a, const distributed_matrix<T> &b)
+    {
+        a += b;
+        return std::move(a);
+    }
+
+    /**
+     * @brief Overloaded binary operator `-` used to subtract two distributed matrices, with no communication. If the first operand is a temporary, its memory is reused for the result.
+     *
+     * @param a The first matrix to be subtracted.
+     * @param b The second matrix to be subtracted.
+     * @return The first matrix minus the second matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same size and distribution.
+     */
+    friend distributed_matrix<T> operator-(const distributed_matrix<T> &a, const distributed_matrix<T> &b)
+    {
+        distributed_matrix<T> c(a);
+        c -= b;
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `-` used to subtract a distributed matrix from a temporary one, reusing the memory of the temporary for the result, with no communication.
+     *
+     * @param a The first matrix to be subtracted, which is overwritten with the difference.
+     * @param b The second matrix to be subtracted.
+     * @return The first matrix minus the second matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same size and distribution.
+     */
+    friend distributed_matrix<T> operator-(distributed_matrix<T> &&a, const distributed_matrix<T> &b)
+    {
+        a -= b;
+        return std::move(a);
+    }
+
+    /**
+     * @brief Overloaded unary operator `-` used to take the negative of a distributed matrix, with no communication.
+     *
+     * @param m The matrix to be negated.
+     * @return The negative of the matrix.
+     */
+    friend distributed_matrix<T> operator-(distributed_matrix<T> m)
+    {
+        for (matrix<T> &t : m.tiles)
+            t = -t;
+        return m;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a scalar on the left and a distributed matrix on the right, with no communication.
+     *
+     * @param s The scalar.
+     * @param m The matrix.
+     * @return The product of the scalar with the matrix.
+     */
+    friend distributed_matrix<T> operator*(const T &s, distributed_matrix<T> m)
+    {
+        m *= s;
+        return m;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a distributed matrix on the left and a scalar on the right, with no communication.
+     *
+     * @param m The matrix.
+     * @param s The scalar.
+     * @return The product of the scalar with the matrix.
+     */
+    friend distributed_matrix<T> operator*(distributed_matrix<T> m, const T &s)
+    {
+        m *= s;
+        return m;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+=` used to add a distributed matrix to another in place, with no communication.
+     *
+     * @param a The first matrix to be added. Will be replaced with the sum of the matrices.
+     * @param b The second matrix to be added.
+     * @return A reference to the first matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same size and distribution.
+     */
+    friend distributed_matrix<T> &operator+=(distributed_matrix<T> &a, const distributed_matrix<T> &b)
+    {
+        a.check_same_distribution(b);
+        for (size_t t{0}; t < a.tiles.size(); t++)
+            a.tiles[t] += b.tiles[t];
+        return a;
+    }
+
+    /**
+     * @brief Overloaded binary operator `-=` used to subtract a distributed matrix from another in place, with no communication.
+     *
+     * @param a The first matrix to be subtracted. Will be replaced with the first matrix minus the second matrix.
+     * @param b The second matrix to be subtracted.
+     * @return A reference to the first matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same size and distribution.
+     */
+    friend distributed_matrix<T> &operator-=(distributed_matrix<T> &a, const distributed_matrix<T> &b)
+    {
+        a.check_same_distribution(b);
+        for (size_t t{0}; t < a.tiles.size(); t++)
+            a.tiles[t] -= b.tiles[t];
+        return a;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*=` used to multiply a distributed matrix by a scalar in place, with no communication.
+     *
+     * @param m The matrix. Will be replaced with the product of the scalar with the matrix.
+     * @param s The scalar.
+     * @return A reference to the matrix.
+     */
+    friend distributed_matrix<T> &operator*=(distributed_matrix<T> &m, const T &s)
+    {
+        for (matrix<T> &t : m.tiles)
+            t *= s;
+        return m;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply two distributed matrices using the SUMMA algorithm. This is a collective operation.
+     * @details For each block column k of A (and block row k of B), the processes in the grid column that owns it broadcast their blocks of that column along their grid rows, and the processes in the grid row that owns block row k of B broadcast their blocks along their grid columns. Each process then adds the products of the blocks it received to its blocks of C. The broadcasts are non-blocking and double-buffered: those for step k + 1 are started before the blocks of step k are multiplied, and are progressed between the local products, so the communication is hidden behind the computation whenever the local products take longer than the broadcasts.
+     *
+     * @param a The first matrix to be multiplied.
+     * @param b The second matrix to be multiplied.
+     * @return The product of the matrices, with the same block size and grid.
+     * @throws incompatible_sizes_multiply if the number of columns in the first matrix is not the same as the number of rows in the second matrix, or if the matrices are not distributed in the same way.
+     */
+    friend distributed_matrix<T> operator*(const distributed_matrix<T> &a, const distributed_matrix<T> &b)
+    {
+        if (a.cols != b.rows or a.grid != b.grid or a.block_size != b.block_size)
+            throw incompatible_sizes_multiply{};
+        distributed_matrix<T> c(*a.grid, a.rows, b.cols, a.block_size, T{0});
+        const size_t steps{(a.cols + a.block_size - 1) / a.block_size};
+        const size_t c_rows{c.local_rows()}, c_cols{c.local_cols()};
+        summa_step buffers[2];
+        const auto start = [&](const size_t &k, summa_step &step)
+        {
+            const size_t kb{std::min(a.block_size, a.cols - (k * a.block_size))};
+            const int a_root{static_cast<int>(k % a.grid_cols())}, b_root{static_cast<int>(k % a.grid_rows())};
+            step.a_panel.resize(c_rows * kb);
+            step.b_panel.resize(kb * c_cols);
+            step.num_requests = 0;
+            // Block column k of A, stacked into a panel with kb columns.
+            if (c_rows > 0)
+            {
+                if (a.grid->get_col() == a_root)
+                {
+                    T *next{step.a_panel.data()};
+                    for (size_t i{0}; i < a.local_block_rows; i++)
+                    {
+                        const matrix<T> &tile{a.tile(i, k / a.grid_cols())};
+                        for (size_t r{0}; r < tile.get_rows(); r++, next += kb)
+                            std::copy_n(tile.data() + (r * tile.get_stride()), kb, next);
+                    }
+                }
+                matrix_detail::mpi_check(MPI_Ibcast(step.a_panel.data(), matrix_detail::mpi_count(step.a_panel.size()), matrix_detail::mpi_datatype<T>(), a_root, a.grid->get_row_communicator(), &step.requests[step.num_requests++]));
+            }
+            // Block row k of B, placed side by side into a panel with kb rows.
+            if (c_cols > 0)
+            {
+                if (b.grid->get_row() == b_root)
+                {
+                    size_t offset{0};
+                    for (size_t j{0}; j < b.local_block_cols; j++)
+                    {
+                        const matrix<T> &tile{b.tile(k / b.grid_rows(), j)};
+                        for (size_t r{0}; r < kb; r++)
+                            std::copy_n(tile.data() + (r * tile.get_stride()), tile.get_cols(), step.b_panel.data() + (r * c_cols) + offset);
+                        offset += tile.get_cols();
+                    }
+                }
+                matrix_detail::mpi_check(MPI_Ibcast(step.b_panel.data(), matrix_detail::mpi_count(step.b_panel.size()), matrix_detail::mpi_datatype<T>(), b_root, b.grid->get_col_communicator(), &step.requests[step.num_requests++]));
+            }
+            step.kb = kb;
+        };
+        if (steps > 0)
+            start(0, buffers[0]);
+        for (size_t k{0}; k < steps; k++)
+        {
+            summa_step &current{buffers[k % 2]};
+            matrix_detail::mpi_check(MPI_Waitall(current.num_requests, current.requests.data(), MPI_STATUSES_IGNORE));
+            summa_step &next{buffers[(k + 1) % 2]};
+            next.num_requests = 0;
+            if (k + 1 < steps)
+                start(k + 1, next);
+            const size_t kb{current.kb};
+            size_t row_offset{0};
+            for (size_t i{0}; i < c.local_block_rows; i++)
+            {
+                size_t col_offset{0};
+                for (size_t j{0}; j < c.local_block_cols; j++)
+                {
+                    matrix<T> &tile{c.tile(i, j)};
+                    matrix_detail::gemm(tile.get_rows(), tile.get_cols(), kb, current.a_panel.data() + (row_offset * kb), kb, size_t{1}, current.b_panel.data() + col_offset, c_cols, size_t{1}, tile.data(), tile.get_stride(), size_t{1}, true);
+                    col_offset += tile.get_cols();
+                    // Give MPI a chance to progress the broadcasts for the next step.
+                    if (next.num_requests > 0)
+                    {
+                        int done{0};
+                        matrix_detail::mpi_check(MPI_Testall(next.num_requests, next.requests.data(), &done, MPI_STATUSES_IGNORE));
+                    }
+                }
+                row_offset += c.tile_rows(i);
+            }
+        }
+        return c;
+    }
+
+    // ==========
+    // Exceptions
+    // ==========
+
+    /**
+     * @brief Exception to be thrown if the number of rows or columns, or the block size, is zero.
+     */
+    using zero_size = matrix_detail::zero_size<T>;
+
+    /**
+     * @brief Exception to be thrown if two matrices to be added or subtracted do not have the same size and distribution, or if the matrix to gather into does not have the right size.
+     */
+    using incompatible_sizes_add = matrix_detail::incompatible_sizes_add<T>;
+
+    /**
+     * @brief Exception to be thrown if two matrices to be multiplied have incompatible sizes or distributions.
+     */
+    using incompatible_sizes_multiply = matrix_detail::incompatible_sizes_multiply<T>;
+
+    /**
+     * @brief Exception to be thrown if an MPI call fails, or if a message is too large.
+     */
+    using mpi_error = matrix_detail::mpi_error;
+
+private:
+    /**
+     * @brief The buffers and requests of one step of SUMMA.
+     */
+    struct summa_step
+    {
+        /**
+         * @brief The blocks of A received in this step, stacked vertically.
+         */
+        std::vector<T> a_panel;
+
+        /**
+         * @brief The blocks of B received in this step, placed side by side.
+         */
+        std::vector<T> b_panel;
+
+        /**
+         * @brief The requests of the two broadcasts.
+         */
+        std::array<MPI_Request, 2> requests{MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+
+        /**
+         * @brief The number of requests that were started.
+         */
+        int num_requests{0};
+
+        /**
+         * @brief The number of columns of A (and rows of B) in this step.
+         */
+        size_t kb{0};
+    };
+
+    /**
+     * @brief Get the number of rows in the process grid.
+     */
+    inline size_t grid_rows() const
+    {
+        return static_cast<size_t>(grid->get_rows());
+    }
+
+    /**
+     * @brief Get the number of columns in the process grid.
+     */
+    inline size_t grid_cols() const
+    {
+        return static_cast<size_t>(grid->get_cols());
+    }
+
+    /**
+     * @brief Check the size of a new matrix before the number of local blocks, which divides by the block size, is computed from it. Used in the member initializer lists of the constructors, since the default member initializers of local_block_rows and local_block_cols run before the body of the constructor.
+     *
+     * @param input_rows The global number of rows.
+     * @param input_cols The global number of columns.
+     * @param input_block_size The number of rows and columns in each block.
+     * @return The block size.
+     * @throws zero_size if the number of rows or columns, or the block size, is zero.
+     */
+    static size_t checked_block_size(const size_t &input_rows, const size_t &input_cols, const size_t &input_block_size)
+    {
+        if (input_rows == 0 or input_cols == 0 or input_block_size == 0)
+            throw zero_size{};
+        return input_block_size;
+    }
+
+    /**
+     * @brief Get the number of rows in a local block row.
+     *
+     * @param i The local block row.
+     */
+    inline size_t tile_rows(const size_t &i) const
+    {
+        return std::min(block_size, rows - global_row(i));
+    }
+
+    /**
+     * @brief Get the number of columns in a local block column.
+     *
+     * @param j The local block column.
+     */
+    inline size_t tile_cols(const size_t &j) const
+    {
+        return std::min(block_size, cols - global_col(j));
+    }
+
+    /**
+     * @brief Get the total number of rows stored by the calling process.
+     */
+    inline size_t local_rows() const
+    {
+        return matrix_detail::block_cyclic_extent(rows, block_size, static_cast<size_t>(grid->get_row()), grid_rows()).second;
+    }
+
+    /**
+     * @brief Get the total number of columns stored by the calling process.
+     */
+    inline size_t local_cols() const
+    {
+        return matrix_detail::block_cyclic_extent(cols, block_size, static_cast<size_t>(grid->get_col()), grid_cols()).second;
+    }
+
+    /**
+     * @brief Get the total number of elements stored by the calling process.
+     */
+    inline size_t local_elements() const
+    {
+        return local_rows() * local_cols();
+    }
+
+    /**
+     * @brief Get the total number of elements stored by the process in a given row and column of the grid.
+     *
+     * @param r The row of the process in the grid.
+     * @param c The column of the process in the grid.
+     */
+    inline size_t elements_of(const int &r, const int &c) const
+    {
+        return matrix_detail::block_cyclic_extent(rows, block_size, static_cast<size_t>(r), grid_rows()).second * matrix_detail::block_cyclic_extent(cols, block_size, static_cast<size_t>(c), grid_cols()).second;
+    }
+
+    /**
+     * @brief Call `f(tile, row, col)` for each block owned by the process in a given row and column of the grid, in the order in which that process stores them, where `row` and `col` are the global indices of the first element of the block. On the calling process, `tile` is the block itself. For other processes, `tile` is a reference to a matrix of the same size, whose elements must not be used.
+     *
+     * @param r The row of the process in the grid.
+     * @param c The column of the process in the grid.
+     * @param f The function to call.
+     */
+    template <typename F>
+    void for_each_tile_of(const int &r, const int &c, F &&f) const
+    {
+        const size_t block_rows{matrix_detail::block_cyclic_extent(rows, block_size, static_cast<size_t>(r), grid_rows()).first};
+        const size_t block_cols{matrix_detail::block_cyclic_extent(cols, block_size, static_cast<size_t>(c), grid_cols()).first};
+        const bool own{r == grid->get_row() and c == grid->get_col()};
+        for (size_t i{0}; i < block_rows; i++)
+            for (size_t j{0}; j < block_cols; j++)
+            {
+                const size_t row{((i * grid_rows()) + static_cast<size_t>(r)) * block_size}, col{((j * grid_cols()) + static_cast<size_t>(c)) * block_size};
+                if (own)
+                    f(const_cast<matrix<T> &>(tile(i, j)), row, col);
+                else
+                {
+                    matrix<T> shape(std::min(block_size, rows - row), std::min(block_size, cols - col));
+                    f(shape, row, col);
+                }
+            }
+    }
+
+    /**
+     * @brief Copy all of the local blocks, in order, into a contiguous buffer.
+     *
+     * @return The buffer.
+     */
+    std::vector<T> pack() const
+    {
+        std::vector<T> buffer;
+        buffer.reserve(local_elements());
+        for (const matrix<T> &t : tiles)
+            for (size_t i{0}; i < t.get_rows(); i++)
+                buffer.insert(buffer.end(), t.data() + (i * t.get_stride()), t.data() + (i * t.get_stride()) + t.get_cols());
+        return buffer;
+    }
+
+    /**
+     * @brief Copy the local blocks, in order, from a contiguous buffer created by pack().
+     *
+     * @param buffer The buffer.
+     */
+    void unpack(const std::vector<T> &buffer)
+    {
+        const T *next{buffer.data()};
+        for (matrix<T> &t : tiles)
+            for (size_t i{0}; i < t.get_rows(); i++, next += t.get_cols())
+                std::copy_n(next, t.get_cols(), t.data() + (i * t.get_stride()));
+    }
+
+    /**
+     * @brief Check that another matrix has the same size and distribution as this one.
+     *
+     * @param m The other matrix.
+     * @throws incompatible_sizes_add if the size or distribution is not the same.
+     */
+    void check_same_distribution(const distributed_matrix<T> &m) const
+    {
+        if (m.rows != rows or m.cols != cols or m.grid != grid or m.block_size != block_size)
+            throw incompatible_sizes_add{};
+    }
+
+    /**
+     * @brief The process grid.
+     */
+    const process_grid *grid{nullptr};
+
+    /**
+     * @brief The global number of rows.
+     */
+    size_t rows{0};
+
+    /**
+     * @brief The global number of columns.
+     */
+    size_t cols{0};
+
+    /**
+     * @brief The number of rows and columns in each block.
+     */
+    size_t block_size{0};
+
+    /**
+     * @brief The number of block rows stored by the calling process.
+     */
+    size_t local_block_rows{matrix_detail::block_cyclic_extent(rows, block_size, static_cast<size_t>(grid->get_row()), grid_rows()).first};
+
+    /**
+     * @brief The number of block columns stored by the calling process.
+     */
+    size_t local_block_cols{matrix_detail::block_cyclic_extent(cols, block_size, static_cast<size_t>(grid->get_col()), grid_cols()).first};
+
+    /**
+     * @brief The blocks stored by the calling process, ordered by block row and then by block column.
+     */
+    std::vector<matrix<T>> tiles;
+};
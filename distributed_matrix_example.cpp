@@ -0,0 +1,118 @@
+/**
+ * @file distributed_matrix_example.cpp
+ * @author Barak Shoshany (baraksh@gmail.com) (http://baraksh.com)
+ * @version 0.1
+ * @date 2020-11-30
+ * @copyright Copyright (c) 2020
+ *
+ * @brief An example file demonstrating the use of the distributed_matrix class template, which also checks its results against the ordinary matrix class template. Compile and run it with, for example,
+ *
+ *     mpicxx distributed_matrix_example.cpp -o distributed_matrix_example -O3 -std=c++20 -pthread
+ *     mpirun -np 4 ./distributed_matrix_example
+ *
+ * The program returns a non-zero exit code if any of the checks fails.
+ */
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#include "distributed_matrix.hpp"
+
+using std::cout;
+
+/**
+ * @brief Create a matrix with small integer elements, so that the products are exact.
+ *
+ * @param rows The number of rows.
+ * @param cols The number of columns.
+ * @param seed A number used to vary the elements between matrices.
+ * @return The matrix.
+ */
+matrix<double> make_matrix(const size_t &rows, const size_t &cols, const size_t &seed)
+{
+    matrix<double> m(rows, cols);
+    for (size_t i{0}; i < rows; i++)
+        for (size_t j{0}; j < cols; j++)
+            m(i, j) = static_cast<double>(((i * 7) + (j * 3) + seed) % 11) - 5;
+    return m;
+}
+
+/**
+ * @brief Check whether two matrices have the same size and elements.
+ *
+ * @param a The first matrix.
+ * @param b The second matrix.
+ * @return `true` if the matrices are equal.
+ */
+bool equal(const matrix<double> &a, const matrix<double> &b)
+{
+    if (a.get_rows() != b.get_rows() or a.get_cols() != b.get_cols())
+        return false;
+    for (size_t i{0}; i < a.get_rows(); i++)
+        for (size_t j{0}; j < a.get_cols(); j++)
+            if (a(i, j) != b(i, j))
+                return false;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int failures{0};
+    {
+        const process_grid grid;
+        const int root{(grid.get_rows() * grid.get_cols()) - 1};
+        const bool is_root{grid.get_rank() == root};
+        // Report the result of a check on the root process. Every process knows the result, so they all agree on the exit code.
+        const auto check = [&](const bool &passed, const std::string &what)
+        {
+            if (not passed)
+                failures++;
+            if (is_root)
+                cout << (passed ? "OK:     " : "FAILED: ") << what << '\n';
+        };
+
+        // A block size of zero, or zero rows or columns, must throw instead of dividing by zero.
+        const auto throws_zero_size = [&](const size_t &rows, const size_t &cols, const size_t &block_size)
+        {
+            try
+            {
+                const distributed_matrix<double> d(grid, rows, cols, block_size);
+            }
+            catch (const distributed_matrix<double>::zero_size &)
+            {
+                return true;
+            }
+            return false;
+        };
+        check(throws_zero_size(4, 4, 0), "block size 0 throws zero_size");
+        check(throws_zero_size(0, 4, 2), "0 rows throws zero_size");
+        check(throws_zero_size(4, 0, 2), "0 columns throws zero_size");
+
+        // Sizes which are not multiples of the block size, so that the last block row and column are partial.
+        const size_t m{37}, n{29}, k{23}, block_size{5};
+        const matrix<double> a{make_matrix(m, k, 1)}, b{make_matrix(k, n, 2)}, c{make_matrix(m, k, 3)};
+        const distributed_matrix<double> da{distributed_matrix<double>::scatter(grid, &a, root, block_size)};
+        const distributed_matrix<double> db{distributed_matrix<double>::scatter(grid, &b, root, block_size)};
+        const distributed_matrix<double> dc{distributed_matrix<double>::scatter(grid, &c, root, block_size)};
+
+        // Gather a distributed matrix on the root process, and compare it with the expected result there. The result of the comparison is broadcast, so that every process counts the same failures.
+        const auto matches = [&](const distributed_matrix<double> &d, const matrix<double> &expected)
+        {
+            matrix<double> gathered(expected.get_rows(), expected.get_cols(), 0);
+            d.gather(&gathered, root);
+            int same{is_root and equal(gathered, expected)};
+            MPI_Bcast(&same, 1, MPI_INT, root, grid.get_communicator());
+            return same != 0;
+        };
+        check(matches(da, a), "scatter and gather");
+        check(matches(da + dc, a + c), "addition");
+        check(matches(da - dc, a - c), "subtraction");
+        check(matches(2.0 * da, 2.0 * a), "multiplication by a scalar");
+        check(matches(-da, -a), "negation");
+        check(matches(da * db, a * b), "SUMMA multiplication");
+    }
+    MPI_Finalize();
+    return failures == 0 ? 0 : 1;
+}
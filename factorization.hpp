@@ -0,0 +1,911 @@
+#pragma once
+
+/**
+ * @file factorization.hpp
+ * @author Barak Shoshany (baraksh@gmail.com) (http://baraksh.com)
+ * @version 0.1
+ * @date 2020-11-30
+ * @copyright Copyright (c) 2020
+ *
+ * @brief Matrix factorizations (LU with partial pivoting, Cholesky, and Householder QR) and linear solvers for the matrix class template in matrix.hpp.
+ *
+ * @details All three factorizations use blocked, right-looking algorithms: a narrow panel of columns is factored at a time, and the rest of the matrix is then updated using the cache-blocked matrix multiplication kernel behind operator*(), which performs almost all of the arithmetic and is parallelized using the global thread pool for large matrices. Each factorization can be performed in place, overwriting a matrix with its factors, using lu_factorize(), cholesky_factorize(), or qr_factorize(), or stored in an lu_decomposition, cholesky_decomposition, or qr_decomposition object, which can then be used to solve systems with any number of right-hand sides. The factorizations work on the elements of a row-major matrix in place, so they only accept row-major matrices; to factor a column-major matrix, convert it to row-major order first.
+ */
+
+#include "matrix.hpp"
+
+#include <cmath>
+#include <concepts>
+#include <vector>
+
+namespace matrix_detail
+{
+    // ==========
+    // Exceptions
+    // ==========
+
+    /**
+     * @brief Exception to be thrown if a matrix that must be square is not.
+     */
+    template <typename T>
+    class not_square
+    {
+    };
+
+    /**
+     * @brief Exception to be thrown if a system of equations cannot be solved because the matrix is singular (or, for least squares, rank deficient).
+     */
+    template <typename T>
+    class singular_matrix
+    {
+    };
+
+    /**
+     * @brief Exception to be thrown if the Cholesky factorization is applied to a matrix that is not positive definite.
+     */
+    template <typename T>
+    class not_positive_definite
+    {
+    };
+
+    // =====================
+    // Factorization kernels
+    // =====================
+
+    /**
+     * @brief The number of columns in each panel of the blocked factorizations and triangular solves. The panels are factored with simple loops, and everything else is done using gemm().
+     */
+    inline constexpr size_t factorization_block{64};
+
+    /**
+     * @brief Copy a part of a matrix with its sign flipped into a contiguous row-major array. Used to turn the updates A -= B C of the blocked algorithms into the accumulating products A += (-B) C computed by gemm().
+     *
+     * @param a A pointer to the first element.
+     * @param rsa The distance between consecutive rows.
+     * @param csa The distance between consecutive columns.
+     * @param m The number of rows.
+     * @param n The number of columns.
+     * @param out The array to copy into, with room for m * n elements.
+     */
+    template <typename T>
+    void copy_negated(const T *a, const size_t rsa, const size_t csa, const size_t m, const size_t n, T *out)
+    {
+        for (size_t i{0}; i < m; i++)
+            for (size_t j{0}; j < n; j++)
+                out[(i * n) + j] = -a[(i * rsa) + (j * csa)];
+    }
+
+    /**
+     * @brief Solve the triangular system T X = B in place, overwriting B with X. One block of rows of X is solved at a time: the contributions of the rows that were already solved are first subtracted using gemm(), and then the block is solved by substitution, with the columns of B split between threads.
+     *
+     * @param lower Whether T is lower triangular (otherwise it is upper triangular). Only that triangle of T is read.
+     * @param unit Whether the diagonal of T is assumed to be all ones (in which case it is not read).
+     * @param n The number of rows and columns in T, and rows in B.
+     * @param m The number of columns in B.
+     * @param t A pointer to the first element of T.
+     * @param rst The distance between consecutive rows of T.
+     * @param cst The distance between consecutive columns of T.
+     * @param b A pointer to the first element of B, which must be row-major. Must not overlap with T.
+     * @param ldb The distance between consecutive rows of B.
+     */
+    template <typename T>
+    void trsm(const bool lower, const bool unit, const size_t n, const size_t m, const T *t, const size_t rst, const size_t cst, T *b, const size_t ldb)
+    {
+        std::vector<T, aligned_allocator<T>> workspace;
+        const size_t blocks{(n + factorization_block - 1) / factorization_block};
+        for (size_t s{0}; s < blocks; s++)
+        {
+            const size_t block{lower ? s : blocks - 1 - s};
+            const size_t i0{block * factorization_block}, i1{std::min(n, i0 + factorization_block)}, ib{i1 - i0};
+            const size_t k0{lower ? 0 : i1}, k1{lower ? i0 : n};
+            if (k1 > k0)
+            {
+                workspace.resize(ib * (k1 - k0));
+                copy_negated(t + (i0 * rst) + (k0 * cst), rst, cst, ib, k1 - k0, workspace.data());
+                gemm(ib, m, k1 - k0, workspace.data(), k1 - k0, size_t{1}, b + (k0 * ldb), ldb, size_t{1}, b + (i0 * ldb), ldb, size_t{1}, true);
+            }
+            for_each_row_chunk(m, ib * ib, [&](const size_t &col_begin, const size_t &col_end)
+                               {
+                                   for (size_t step{0}; step < ib; step++)
+                                   {
+                                       const size_t i{lower ? i0 + step : i1 - 1 - step};
+                                       T *b_i{b + (i * ldb)};
+                                       const size_t begin{lower ? i0 : i + 1}, end{lower ? i : i1};
+                                       for (size_t k{begin}; k < end; k++)
+                                       {
+                                           const T t_ik{t[(i * rst) + (k * cst)]};
+                                           const T *b_k{b + (k * ldb)};
+                                           for (size_t c{col_begin}; c < col_end; c++)
+                                               b_i[c] -= t_ik * b_k[c];
+                                       }
+                                       if (not unit)
+                                       {
+                                           const T diagonal{t[(i * rst) + (i * cst)]};
+                                           for (size_t c{col_begin}; c < col_end; c++)
+                                               b_i[c] /= diagonal;
+                                       }
+                                   }
+                               });
+        }
+    }
+
+    /**
+     * @brief Compute the LU factorization with partial pivoting P A = L U of an n x n row-major matrix in place, using a blocked right-looking algorithm. Each panel of columns is factored by Gaussian elimination, swapping whole rows of the matrix to bring the largest element of each column to the diagonal. The corresponding rows of U are then obtained by a triangular solve, and the rest of the matrix is updated with a single call to gemm().
+     *
+     * @param a A pointer to the first element of the matrix. On return, the strictly lower triangle contains L (whose diagonal elements are all ones) and the upper triangle contains U.
+     * @param lda The distance between consecutive rows.
+     * @param n The number of rows and columns.
+     * @param pivots An array of n elements. On return, row i was swapped with row pivots[i] at step i of the elimination.
+     * @return true if U has a zero on its diagonal, so the matrix is singular.
+     */
+    template <typename T>
+    bool lu_factorize(T *a, const size_t lda, const size_t n, size_t *pivots)
+    {
+        using std::abs;
+        bool singular{false};
+        std::vector<T, aligned_allocator<T>> workspace;
+        for (size_t j0{0}; j0 < n; j0 += factorization_block)
+        {
+            const size_t j1{std::min(n, j0 + factorization_block)}, jb{j1 - j0};
+            for (size_t j{j0}; j < j1; j++)
+            {
+                size_t p{j};
+                for (size_t i{j + 1}; i < n; i++)
+                    if (abs(a[(i * lda) + j]) > abs(a[(p * lda) + j]))
+                        p = i;
+                pivots[j] = p;
+                if (p != j)
+                    std::swap_ranges(a + (j * lda), a + (j * lda) + n, a + (p * lda));
+                const T pivot{a[(j * lda) + j]};
+                if (pivot == T{0})
+                {
+                    singular = true;
+                    continue;
+                }
+                const T *a_j{a + (j * lda)};
+                for_each_row_chunk(n - j - 1, j1 - j, [&](const size_t &begin, const size_t &end)
+                                   {
+                                       for (size_t i{j + 1 + begin}; i < j + 1 + end; i++)
+                                       {
+                                           T *a_i{a + (i * lda)};
+                                           const T l{a_i[j] / pivot};
+                                           a_i[j] = l;
+                                           for (size_t c{j + 1}; c < j1; c++)
+                                               a_i[c] -= l * a_j[c];
+                                       }
+                                   });
+            }
+            if (j1 == n)
+                break;
+            // U12 = L11^-1 A12.
+            trsm(true, true, jb, n - j1, a + (j0 * lda) + j0, lda, size_t{1}, a + (j0 * lda) + j1, lda);
+            // A22 -= L21 U12.
+            workspace.resize((n - j1) * jb);
+            copy_negated(a + (j1 * lda) + j0, lda, size_t{1}, n - j1, jb, workspace.data());
+            gemm(n - j1, n - j1, jb, workspace.data(), jb, size_t{1}, a + (j0 * lda) + j1, lda, size_t{1}, a + (j1 * lda) + j1, lda, size_t{1}, true);
+        }
+        return singular;
+    }
+
+    /**
+     * @brief Compute the Cholesky factorization A = L L^T of an n x n symmetric positive definite row-major matrix in place, using a blocked right-looking algorithm. Only the lower triangle of the matrix is read. After each diagonal block is factored, the panel below it is obtained by a triangular solve, and the lower triangle of the rest of the matrix is updated one block of columns at a time using gemm().
+     *
+     * @param a A pointer to the first element of the matrix. On return, the lower triangle contains L and the strictly upper triangle is set to zero.
+     * @param lda The distance between consecutive rows.
+     * @param n The number of rows and columns.
+     * @return false if the matrix is not positive definite, in which case the factorization is stopped and the contents of the matrix are unspecified.
+     */
+    template <typename T>
+    bool cholesky_factorize(T *a, const size_t lda, const size_t n)
+    {
+        using std::sqrt;
+        std::vector<T, aligned_allocator<T>> workspace;
+        for (size_t j0{0}; j0 < n; j0 += factorization_block)
+        {
+            const size_t j1{std::min(n, j0 + factorization_block)}, jb{j1 - j0};
+            for (size_t j{j0}; j < j1; j++)
+            {
+                T *a_j{a + (j * lda)};
+                if (not(a_j[j] > T{0}))
+                    return false;
+                a_j[j] = sqrt(a_j[j]);
+                for (size_t i{j + 1}; i < j1; i++)
+                {
+                    T *a_i{a + (i * lda)};
+                    a_i[j] /= a_j[j];
+                    for (size_t c{j + 1}; c <= i; c++)
+                        a_i[c] -= a_i[j] * a[(c * lda) + j];
+                }
+            }
+            if (j1 == n)
+                break;
+            // L21 = A21 L11^-T, one row at a time.
+            for_each_row_chunk(n - j1, jb * jb, [&](const size_t &begin, const size_t &end)
+                               {
+                                   for (size_t i{j1 + begin}; i < j1 + end; i++)
+                                   {
+                                       T *a_i{a + (i * lda)};
+                                       for (size_t c{j0}; c < j1; c++)
+                                       {
+                                           const T *a_c{a + (c * lda)};
+                                           T sum{a_i[c]};
+                                           for (size_t k{j0}; k < c; k++)
+                                               sum -= a_i[k] * a_c[k];
+                                           a_i[c] = sum / a_c[c];
+                                       }
+                                   }
+                               });
+            // A22 -= L21 L21^T, computing only the blocks of columns on or below the diagonal.
+            workspace.resize((n - j1) * jb);
+            copy_negated(a + (j1 * lda) + j0, lda, size_t{1}, n - j1, jb, workspace.data());
+            for (size_t c0{j1}; c0 < n; c0 += factorization_block)
+            {
+                const size_t cb{std::min(factorization_block, n - c0)};
+                gemm(n - c0, cb, jb, workspace.data() + ((c0 - j1) * jb), jb, size_t{1}, a + (c0 * lda) + j0, size_t{1}, lda, a + (c0 * lda) + c0, lda, size_t{1}, true);
+            }
+        }
+        for (size_t i{0}; i < n; i++)
+            std::fill(a + (i * lda) + i + 1, a + (i * lda) + n, T{0});
+        return true;
+    }
+
+    /**
+     * @brief Form the compact representation H_0 H_1 ... H_(k-1) = I - V T V^T of a block of k consecutive Householder reflectors, as stored by qr_factorize(). V is copied out explicitly, with ones on its diagonal and zeros above it, and T is upper triangular.
+     *
+     * @param a A pointer to the first element of the block, on the diagonal of the factored matrix.
+     * @param lda The distance between consecutive rows of the factored matrix.
+     * @param rows The number of rows from the start of the block to the bottom of the matrix.
+     * @param k The number of reflectors in the block.
+     * @param tau The scalar factors of the reflectors.
+     * @param v The array to store V in, with room for rows * k elements.
+     * @param t The array to store T in, with room for k * k elements.
+     */
+    template <typename T>
+    void block_reflector(const T *a, const size_t lda, const size_t rows, const size_t k, const T *tau, T *v, T *t)
+    {
+        for (size_t i{0}; i < rows; i++)
+            for (size_t j{0}; j < k; j++)
+                v[(i * k) + j] = (i > j) ? a[(i * lda) + j] : ((i == j) ? T{1} : T{0});
+        // G = V^T V, from which T is built column by column: T(0:i, i) = -tau_i T(0:i, 0:i) G(0:i, i).
+        std::vector<T> g(k * k);
+        gemm(k, k, rows, v, size_t{1}, k, v, k, size_t{1}, g.data(), k, size_t{1});
+        for (size_t i{0}; i < k; i++)
+        {
+            for (size_t r{0}; r < i; r++)
+            {
+                T sum{0};
+                for (size_t q{r}; q < i; q++)
+                    sum += t[(r * k) + q] * g[(q * k) + i];
+                t[(r * k) + i] = -tau[i] * sum;
+            }
+            t[(i * k) + i] = tau[i];
+            for (size_t r{i + 1}; r < k; r++)
+                t[(r * k) + i] = T{0};
+        }
+    }
+
+    /**
+     * @brief Apply a block of Householder reflectors I - V T V^T (or its transpose, I - V T^T V^T) to a row-major matrix B from the left, using three calls to gemm().
+     *
+     * @param v A pointer to V, as formed by block_reflector().
+     * @param t A pointer to T, as formed by block_reflector().
+     * @param rows The number of rows in V and B.
+     * @param k The number of reflectors.
+     * @param b A pointer to the first element of B.
+     * @param ldb The distance between consecutive rows of B.
+     * @param cols The number of columns in B.
+     * @param transpose Whether to apply the transpose.
+     */
+    template <typename T>
+    void apply_block_reflector(const T *v, const T *t, const size_t rows, const size_t k, T *b, const size_t ldb, const size_t cols, const bool transpose)
+    {
+        std::vector<T, aligned_allocator<T>> w(k * cols), tw(k * cols);
+        // W = V^T B.
+        gemm(k, cols, rows, v, size_t{1}, k, b, ldb, size_t{1}, w.data(), cols, size_t{1});
+        // W = -T W (or -T^T W).
+        gemm(k, cols, k, t, transpose ? size_t{1} : k, transpose ? k : size_t{1}, w.data(), cols, size_t{1}, tw.data(), cols, size_t{1});
+        for (T &x : tw)
+            x = -x;
+        // B += V W.
+        gemm(rows, cols, k, v, k, size_t{1}, tw.data(), cols, size_t{1}, b, ldb, size_t{1}, true);
+    }
+
+    /**
+     * @brief Compute the QR factorization A = Q R of an m x n row-major matrix in place using Householder reflectors and a blocked algorithm. Each panel of columns is factored one reflector at a time; the reflectors of the panel are then combined into the compact form I - V T V^T and applied to the rest of the matrix using gemm().
+     *
+     * @param a A pointer to the first element of the matrix. On return, the upper triangle contains R, and the elements below the diagonal contain the Householder vectors, whose first element is an implicit 1.
+     * @param lda The distance between consecutive rows.
+     * @param m The number of rows.
+     * @param n The number of columns.
+     * @param tau An array of min(m, n) elements. On return, the scalar factors of the reflectors H_j = I - tau_j v_j v_j^T, where Q = H_0 H_1 ... H_(min(m, n) - 1).
+     */
+    template <typename T>
+    void qr_factorize(T *a, const size_t lda, const size_t m, const size_t n, T *tau)
+    {
+        using std::sqrt;
+        const size_t k{std::min(m, n)};
+        std::vector<T, aligned_allocator<T>> v, t;
+        std::vector<T> w;
+        for (size_t j0{0}; j0 < k; j0 += factorization_block)
+        {
+            const size_t j1{std::min(k, j0 + factorization_block)}, jb{j1 - j0};
+            for (size_t j{j0}; j < j1; j++)
+            {
+                T *a_j{a + (j * lda)};
+                T norm2{0};
+                for (size_t i{j + 1}; i < m; i++)
+                    norm2 += a[(i * lda) + j] * a[(i * lda) + j];
+                if (norm2 == T{0})
+                {
+                    tau[j] = T{0};
+                    continue;
+                }
+                const T alpha{a_j[j]}, norm{sqrt((alpha * alpha) + norm2)}, beta{(alpha >= T{0}) ? -norm : norm};
+                tau[j] = (beta - alpha) / beta;
+                const T scale{T{1} / (alpha - beta)};
+                for (size_t i{j + 1}; i < m; i++)
+                    a[(i * lda) + j] *= scale;
+                a_j[j] = beta;
+                // Apply H_j to the remaining columns of the panel: w = v^T A, then A -= tau v w.
+                w.assign(a_j + j + 1, a_j + j1);
+                for (size_t i{j + 1}; i < m; i++)
+                {
+                    const T *a_i{a + (i * lda)};
+                    for (size_t c{j + 1}; c < j1; c++)
+                        w[c - j - 1] += a_i[j] * a_i[c];
+                }
+                for (size_t c{j + 1}; c < j1; c++)
+                    a_j[c] -= tau[j] * w[c - j - 1];
+                for (size_t i{j + 1}; i < m; i++)
+                {
+                    T *a_i{a + (i * lda)};
+                    const T factor{tau[j] * a_i[j]};
+                    for (size_t c{j + 1}; c < j1; c++)
+                        a_i[c] -= factor * w[c - j - 1];
+                }
+            }
+            if (j1 == n)
+                continue;
+            v.resize((m - j0) * jb);
+            t.resize(jb * jb);
+            block_reflector(a + (j0 * lda) + j0, lda, m - j0, jb, tau + j0, v.data(), t.data());
+            apply_block_reflector(v.data(), t.data(), m - j0, jb, a + (j0 * lda) + j1, lda, n - j1, true);
+        }
+    }
+
+    /**
+     * @brief Apply Q or Q^T, where Q is stored as Householder reflectors by qr_factorize(), to a row-major matrix B from the left.
+     *
+     * @param a A pointer to the first element of the factored matrix.
+     * @param lda The distance between consecutive rows of the factored matrix.
+     * @param m The number of rows in the factored matrix and in B.
+     * @param k The number of reflectors, min(m, n).
+     * @param tau The scalar factors of the reflectors.
+     * @param b A pointer to the first element of B.
+     * @param ldb The distance between consecutive rows of B.
+     * @param cols The number of columns in B.
+     * @param transpose Whether to apply Q^T instead of Q.
+     */
+    template <typename T>
+    void apply_q(const T *a, const size_t lda, const size_t m, const size_t k, const T *tau, T *b, const size_t ldb, const size_t cols, const bool transpose)
+    {
+        std::vector<T, aligned_allocator<T>> v, t;
+        const size_t blocks{(k + factorization_block - 1) / factorization_block};
+        // Q^T = H_(k-1) ... H_0 applies the blocks in order, and Q = H_0 ... H_(k-1) in reverse order.
+        for (size_t s{0}; s < blocks; s++)
+        {
+            const size_t block{transpose ? s : blocks - 1 - s};
+            const size_t j0{block * factorization_block}, jb{std::min(factorization_block, k - j0)};
+            v.resize((m - j0) * jb);
+            t.resize(jb * jb);
+            block_reflector(a + (j0 * lda) + j0, lda, m - j0, jb, tau + j0, v.data(), t.data());
+            apply_block_reflector(v.data(), t.data(), m - j0, jb, b + (j0 * ldb), ldb, cols, transpose);
+        }
+    }
+} // namespace matrix_detail
+
+// =======================
+// In-place factorizations
+// =======================
+
+/**
+ * @brief Compute the LU factorization with partial pivoting P A = L U of a square matrix in place. Uses a blocked algorithm that performs almost all of its arithmetic using the same kernel as operator*(), so it is fast and parallelized for large matrices.
+ *
+ * @param a The matrix A. On return, the strictly lower triangle contains L (whose diagonal elements are all ones, and are not stored) and the upper triangle contains U. If A is singular, the factorization is still completed, but U has a zero on its diagonal.
+ * @return The pivots: at step i of the elimination, row i was swapped with row pivots[i].
+ * @throws lu_decomposition::not_square if the matrix is not square.
+ */
+template <std::floating_point T, typename Allocator>
+std::vector<size_t> lu_factorize(matrix<T, Allocator> &a)
+{
+    if (a.get_rows() != a.get_cols())
+        throw matrix_detail::not_square<T>{};
+    std::vector<size_t> pivots(a.get_rows());
+    matrix_detail::lu_factorize(a.data(), a.get_stride(), a.get_rows(), pivots.data());
+    return pivots;
+}
+
+/**
+ * @brief Compute the Cholesky factorization A = L L^T of a symmetric positive definite matrix in place. Only the lower triangle of A is read. Uses a blocked algorithm that performs almost all of its arithmetic using the same kernel as operator*().
+ *
+ * @param a The matrix A. On return, the lower triangle contains L, and the strictly upper triangle is set to zero.
+ * @throws cholesky_decomposition::not_square if the matrix is not square.
+ * @throws cholesky_decomposition::not_positive_definite if the matrix is not positive definite. The contents of the matrix are then unspecified.
+ */
+template <std::floating_point T, typename Allocator>
+void cholesky_factorize(matrix<T, Allocator> &a)
+{
+    if (a.get_rows() != a.get_cols())
+        throw matrix_detail::not_square<T>{};
+    if (not matrix_detail::cholesky_factorize(a.data(), a.get_stride(), a.get_rows()))
+        throw matrix_detail::not_positive_definite<T>{};
+}
+
+/**
+ * @brief Compute the QR factorization A = Q R of an m x n matrix in place, using Householder reflectors and a blocked algorithm that applies the reflectors to the rest of the matrix using the same kernel as operator*().
+ *
+ * @param a The matrix A. On return, the upper triangle contains R (which is upper trapezoidal if the matrix is not square), and the elements below the diagonal contain the Householder vectors v_j, whose first element is an implicit 1.
+ * @return The scalar factors tau_j of the Householder reflectors H_j = I - tau_j v_j v_j^T, where Q = H_0 H_1 ... H_(min(m, n) - 1).
+ */
+template <std::floating_point T, typename Allocator>
+std::vector<T> qr_factorize(matrix<T, Allocator> &a)
+{
+    std::vector<T> tau(std::min(a.get_rows(), a.get_cols()));
+    matrix_detail::qr_factorize(a.data(), a.get_stride(), a.get_rows(), a.get_cols(), tau.data());
+    return tau;
+}
+
+// ================
+// LU decomposition
+// ================
+
+/**
+ * @brief The LU factorization with partial pivoting P A = L U of a square matrix, used to solve systems of equations, and to compute the determinant and inverse.
+ *
+ * @tparam T The type of the matrix elements. Must be a floating-point type.
+ * @tparam Allocator The allocator of the matrix.
+ */
+template <std::floating_point T, typename Allocator = aligned_allocator<T>>
+class lu_decomposition
+{
+public:
+    /**
+     * @brief Factor a matrix. The matrix is taken by value, so pass it using `std::move()` to factor it in place without making a copy.
+     *
+     * @param a The matrix to factor.
+     * @throws not_square if the matrix is not square.
+     */
+    explicit lu_decomposition(matrix<T, Allocator> a)
+        : lu(std::move(a)), pivots(lu_factorize(lu))
+    {
+        for (size_t i{0}; i < lu.get_rows(); i++)
+        {
+            if (lu(i, i) == T{0})
+                singular = true;
+            if (pivots[i] != i)
+                swaps++;
+        }
+    }
+
+    /**
+     * @brief Solve the system A X = B for any number of right-hand sides, given as the columns of B, using one forward and one back substitution with blocked triangular solves.
+     *
+     * @param b The matrix B.
+     * @return The solution X.
+     * @throws incompatible_sizes_multiply if the number of rows in B is not the same as the size of A.
+     * @throws singular_matrix if A is singular.
+     */
+    matrix<T, Allocator> solve(const matrix<T, Allocator> &b) const
+    {
+        const size_t n{lu.get_rows()};
+        if (b.get_rows() != n)
+            throw incompatible_sizes_multiply{};
+        if (singular)
+            throw singular_matrix{};
+        matrix<T, Allocator> x(b);
+        for (size_t i{0}; i < n; i++)
+            if (pivots[i] != i)
+                std::swap_ranges(x.data() + (i * x.get_stride()), x.data() + (i * x.get_stride()) + x.get_cols(), x.data() + (pivots[i] * x.get_stride()));
+        matrix_detail::trsm(true, true, n, x.get_cols(), lu.data(), lu.get_stride(), size_t{1}, x.data(), x.get_stride());
+        matrix_detail::trsm(false, false, n, x.get_cols(), lu.data(), lu.get_stride(), size_t{1}, x.data(), x.get_stride());
+        return x;
+    }
+
+    /**
+     * @brief Solve the system A x = b for a single right-hand side.
+     *
+     * @param b The vector b.
+     * @return The solution x.
+     * @throws incompatible_sizes_multiply if the size of b is not the same as the size of A.
+     * @throws singular_matrix if A is singular.
+     */
+    std::vector<T> solve(const std::vector<T> &b) const
+    {
+        if (b.size() != lu.get_rows())
+            throw incompatible_sizes_multiply{};
+        const matrix<T, Allocator> x{solve(matrix<T, Allocator>(b.size(), 1, b))};
+        std::vector<T> result(b.size());
+        for (size_t i{0}; i < result.size(); i++)
+            result[i] = x(i, 0);
+        return result;
+    }
+
+    /**
+     * @brief Compute the determinant of A, the product of the diagonal of U with a sign for each row swap.
+     *
+     * @return The determinant.
+     */
+    T determinant() const
+    {
+        T det{(swaps % 2 == 0) ? T{1} : T{-1}};
+        for (size_t i{0}; i < lu.get_rows(); i++)
+            det *= lu(i, i);
+        return det;
+    }
+
+    /**
+     * @brief Compute the inverse of A by solving A X = I. Solving systems using solve() directly is faster and more accurate than multiplying by the inverse.
+     *
+     * @return The inverse.
+     * @throws singular_matrix if A is singular.
+     */
+    matrix<T, Allocator> inverse() const
+    {
+        const size_t n{lu.get_rows()};
+        matrix<T, Allocator> identity(n, n, T{0});
+        for (size_t i{0}; i < n; i++)
+            identity(i, i) = T{1};
+        return solve(identity);
+    }
+
+    /**
+     * @brief Check whether A is singular, that is, whether U has a zero on its diagonal.
+     *
+     * @return true if A is singular.
+     */
+    inline bool is_singular() const
+    {
+        return singular;
+    }
+
+    /**
+     * @brief Member function used to obtain the combined factors: L (without its unit diagonal) in the strictly lower triangle and U in the upper triangle.
+     *
+     * @return A reference to the combined factors.
+     */
+    inline const matrix<T, Allocator> &get_lu() const
+    {
+        return lu;
+    }
+
+    /**
+     * @brief Member function used to obtain the pivots: at step i of the elimination, row i was swapped with row pivots[i].
+     *
+     * @return A reference to the pivots.
+     */
+    inline const std::vector<size_t> &get_pivots() const
+    {
+        return pivots;
+    }
+
+    /**
+     * @brief Exception to be thrown if the matrix to factor is not square.
+     */
+    using not_square = matrix_detail::not_square<T>;
+
+    /**
+     * @brief Exception to be thrown if a system is solved with a singular matrix.
+     */
+    using singular_matrix = matrix_detail::singular_matrix<T>;
+
+    /**
+     * @brief Exception to be thrown if the number of rows in the right-hand side is not the same as the size of the matrix.
+     */
+    using incompatible_sizes_multiply = matrix_detail::incompatible_sizes_multiply<T>;
+
+private:
+    /**
+     * @brief The combined factors L and U.
+     */
+    matrix<T, Allocator> lu;
+
+    /**
+     * @brief The pivots.
+     */
+    std::vector<size_t> pivots;
+
+    /**
+     * @brief The number of row swaps, used to compute the sign of the determinant.
+     */
+    size_t swaps{0};
+
+    /**
+     * @brief Whether the matrix is singular.
+     */
+    bool singular{false};
+};
+
+// ======================
+// Cholesky decomposition
+// ======================
+
+/**
+ * @brief The Cholesky factorization A = L L^T of a symmetric positive definite matrix, used to solve systems of equations about twice as fast as the LU factorization.
+ *
+ * @tparam T The type of the matrix elements. Must be a floating-point type.
+ * @tparam Allocator The allocator of the matrix.
+ */
+template <std::floating_point T, typename Allocator = aligned_allocator<T>>
+class cholesky_decomposition
+{
+public:
+    /**
+     * @brief Factor a matrix. Only the lower triangle of the matrix is read. The matrix is taken by value, so pass it using `std::move()` to factor it in place without making a copy.
+     *
+     * @param a The matrix to factor.
+     * @throws not_square if the matrix is not square.
+     * @throws not_positive_definite if the matrix is not positive definite.
+     */
+    explicit cholesky_decomposition(matrix<T, Allocator> a)
+        : l(std::move(a))
+    {
+        cholesky_factorize(l);
+    }
+
+    /**
+     * @brief Solve the system A X = B for any number of right-hand sides, given as the columns of B, by solving L Y = B and then L^T X = Y.
+     *
+     * @param b The matrix B.
+     * @return The solution X.
+     * @throws incompatible_sizes_multiply if the number of rows in B is not the same as the size of A.
+     */
+    matrix<T, Allocator> solve(const matrix<T, Allocator> &b) const
+    {
+        const size_t n{l.get_rows()};
+        if (b.get_rows() != n)
+            throw incompatible_sizes_multiply{};
+        matrix<T, Allocator> x(b);
+        matrix_detail::trsm(true, false, n, x.get_cols(), l.data(), l.get_stride(), size_t{1}, x.data(), x.get_stride());
+        matrix_detail::trsm(false, false, n, x.get_cols(), l.data(), size_t{1}, l.get_stride(), x.data(), x.get_stride());
+        return x;
+    }
+
+    /**
+     * @brief Solve the system A x = b for a single right-hand side.
+     *
+     * @param b The vector b.
+     * @return The solution x.
+     * @throws incompatible_sizes_multiply if the size of b is not the same as the size of A.
+     */
+    std::vector<T> solve(const std::vector<T> &b) const
+    {
+        if (b.size() != l.get_rows())
+            throw incompatible_sizes_multiply{};
+        const matrix<T, Allocator> x{solve(matrix<T, Allocator>(b.size(), 1, b))};
+        std::vector<T> result(b.size());
+        for (size_t i{0}; i < result.size(); i++)
+            result[i] = x(i, 0);
+        return result;
+    }
+
+    /**
+     * @brief Compute the determinant of A, the square of the product of the diagonal of L.
+     *
+     * @return The determinant.
+     */
+    T determinant() const
+    {
+        T det{1};
+        for (size_t i{0}; i < l.get_rows(); i++)
+            det *= l(i, i) * l(i, i);
+        return det;
+    }
+
+    /**
+     * @brief Member function used to obtain the factor L, which is lower triangular.
+     *
+     * @return A reference to L.
+     */
+    inline const matrix<T, Allocator> &get_l() const
+    {
+        return l;
+    }
+
+    /**
+     * @brief Exception to be thrown if the matrix to factor is not square.
+     */
+    using not_square = matrix_detail::not_square<T>;
+
+    /**
+     * @brief Exception to be thrown if the matrix to factor is not positive definite.
+     */
+    using not_positive_definite = matrix_detail::not_positive_definite<T>;
+
+    /**
+     * @brief Exception to be thrown if the number of rows in the right-hand side is not the same as the size of the matrix.
+     */
+    using incompatible_sizes_multiply = matrix_detail::incompatible_sizes_multiply<T>;
+
+private:
+    /**
+     * @brief The factor L.
+     */
+    matrix<T, Allocator> l;
+};
+
+// ================
+// QR decomposition
+// ================
+
+/**
+ * @brief The QR factorization A = Q R of an m x n matrix, computed using Householder reflectors, used to solve linear least squares problems (or square systems, more stably but about twice as slowly as the LU factorization).
+ *
+ * @tparam T The type of the matrix elements. Must be a floating-point type.
+ * @tparam Allocator The allocator of the matrix.
+ */
+template <std::floating_point T, typename Allocator = aligned_allocator<T>>
+class qr_decomposition
+{
+public:
+    /**
+     * @brief Factor a matrix. The matrix is taken by value, so pass it using `std::move()` to factor it in place without making a copy.
+     *
+     * @param a The matrix to factor.
+     */
+    explicit qr_decomposition(matrix<T, Allocator> a)
+        : qr(std::move(a)), tau(qr_factorize(qr)) {}
+
+    /**
+     * @brief Find the X that minimizes the norm of A X - B for each column of B. If A is square, this is the solution of A X = B. Computed as R^-1 (Q^T B), without forming Q.
+     *
+     * @param b The matrix B.
+     * @return The solution X, with as many rows as A has columns.
+     * @throws incompatible_sizes_multiply if the number of rows in B is not the same as the number of rows in A.
+     * @throws singular_matrix if A has fewer rows than columns, or R has a zero on its diagonal, so the solution is not unique.
+     */
+    matrix<T, Allocator> solve(const matrix<T, Allocator> &b) const
+    {
+        const size_t m{qr.get_rows()}, n{qr.get_cols()};
+        if (b.get_rows() != m)
+            throw incompatible_sizes_multiply{};
+        if (m < n)
+            throw singular_matrix{};
+        for (size_t i{0}; i < n; i++)
+            if (qr(i, i) == T{0})
+                throw singular_matrix{};
+        matrix<T, Allocator> c(b);
+        matrix_detail::apply_q(qr.data(), qr.get_stride(), m, n, tau.data(), c.data(), c.get_stride(), c.get_cols(), true);
+        matrix<T, Allocator> x(n, b.get_cols());
+        for (size_t i{0}; i < n; i++)
+            for (size_t j{0}; j < b.get_cols(); j++)
+                x(i, j) = c(i, j);
+        matrix_detail::trsm(false, false, n, x.get_cols(), qr.data(), qr.get_stride(), size_t{1}, x.data(), x.get_stride());
+        return x;
+    }
+
+    /**
+     * @brief Find the x that minimizes the norm of A x - b.
+     *
+     * @param b The vector b.
+     * @return The solution x.
+     * @throws incompatible_sizes_multiply if the size of b is not the same as the number of rows in A.
+     * @throws singular_matrix if A has fewer rows than columns, or R has a zero on its diagonal.
+     */
+    std::vector<T> solve(const std::vector<T> &b) const
+    {
+        if (b.size() != qr.get_rows())
+            throw incompatible_sizes_multiply{};
+        const matrix<T, Allocator> x{solve(matrix<T, Allocator>(b.size(), 1, b))};
+        std::vector<T> result(x.get_rows());
+        for (size_t i{0}; i < result.size(); i++)
+            result[i] = x(i, 0);
+        return result;
+    }
+
+    /**
+     * @brief Form the first min(m, n) columns of the orthogonal matrix Q explicitly (the "thin" Q), by applying the reflectors to the corresponding columns of the identity matrix.
+     *
+     * @return The m x min(m, n) matrix Q.
+     */
+    matrix<T, Allocator> get_q() const
+    {
+        const size_t m{qr.get_rows()}, k{tau.size()};
+        matrix<T, Allocator> q(m, k, T{0});
+        for (size_t i{0}; i < k; i++)
+            q(i, i) = T{1};
+        matrix_detail::apply_q(qr.data(), qr.get_stride(), m, k, tau.data(), q.data(), q.get_stride(), k, false);
+        return q;
+    }
+
+    /**
+     * @brief Form the upper triangular (or trapezoidal) factor R, with min(m, n) rows.
+     *
+     * @return The min(m, n) x n matrix R.
+     */
+    matrix<T, Allocator> get_r() const
+    {
+        const size_t k{tau.size()}, n{qr.get_cols()};
+        matrix<T, Allocator> r(k, n, T{0});
+        for (size_t i{0}; i < k; i++)
+            for (size_t j{i}; j < n; j++)
+                r(i, j) = qr(i, j);
+        return r;
+    }
+
+    /**
+     * @brief Member function used to obtain the factors as stored by qr_factorize(): R in the upper triangle, and the Householder vectors below the diagonal.
+     *
+     * @return A reference to the factors.
+     */
+    inline const matrix<T, Allocator> &get_qr() const
+    {
+        return qr;
+    }
+
+    /**
+     * @brief Member function used to obtain the scalar factors of the Householder reflectors.
+     *
+     * @return A reference to the scalar factors.
+     */
+    inline const std::vector<T> &get_tau() const
+    {
+        return tau;
+    }
+
+    /**
+     * @brief Exception to be thrown if a least squares problem does not have a unique solution.
+     */
+    using singular_matrix = matrix_detail::singular_matrix<T>;
+
+    /**
+     * @brief Exception to be thrown if the number of rows in the right-hand side is not the same as the number of rows in the matrix.
+     */
+    using incompatible_sizes_multiply = matrix_detail::incompatible_sizes_multiply<T>;
+
+private:
+    /**
+     * @brief The factors as stored by qr_factorize().
+     */
+    matrix<T, Allocator> qr;
+
+    /**
+     * @brief The scalar factors of the Householder reflectors.
+     */
+    std::vector<T> tau;
+};
+
+// ==============
+// Linear solvers
+// ==============
+
+/**
+ * @brief Solve the system A X = B for any number of right-hand sides, given as the columns of B, using the LU factorization with partial pivoting. To solve several systems with the same A, create an lu_decomposition once and call its solve() member function instead.
+ *
+ * @param a The square matrix A.
+ * @param b The matrix B.
+ * @return The solution X.
+ * @throws lu_decomposition::not_square if A is not square.
+ * @throws lu_decomposition::incompatible_sizes_multiply if the number of rows in B is not the same as the size of A.
+ * @throws lu_decomposition::singular_matrix if A is singular.
+ */
+template <std::floating_point T, typename Allocator>
+matrix<T, Allocator> solve(const matrix<T, Allocator> &a, const matrix<T, Allocator> &b)
+{
+    return lu_decomposition<T, Allocator>(a).solve(b);
+}
+
+/**
+ * @brief Solve the system A x = b using the LU factorization with partial pivoting.
+ *
+ * @param a The square matrix A.
+ * @param b The vector b.
+ * @return The solution x.
+ * @throws lu_decomposition::not_square if A is not square.
+ * @throws lu_decomposition::incompatible_sizes_multiply if the size of b is not the same as the size of A.
+ * @throws lu_decomposition::singular_matrix if A is singular.
+ */
+template <std::floating_point T, typename Allocator>
+std::vector<T> solve(const matrix<T, Allocator> &a, const std::vector<T> &b)
+{
+    return lu_decomposition<T, Allocator>(a).solve(b);
+}
@@ -0,0 +1,466 @@
+#pragma once
+
+/**
+ * @file fixed_matrix.hpp
+ * @author Barak Shoshany (baraksh@gmail.com) (http://baraksh.com)
+ * @version 0.1
+ * @date 2020-11-30
+ * @copyright Copyright (c) 2020
+ *
+ * @brief A C++ class template for small matrices whose size is known at compile time, complementing the dynamic matrix class template in matrix.hpp.
+ *
+ * @details The elements of a fixed_matrix are stored inline in a `std::array`, so creating one never allocates memory, and it can live on the stack or inside other objects. All operations are `constexpr` and fully unrolled, and operations on matrices of incompatible sizes fail to compile rather than throwing an exception. A fixed_matrix converts implicitly to a dynamic matrix of either layout, and can be constructed explicitly from a dynamic matrix of the right size and either layout.
+ */
+
+#include "matrix.hpp"
+
+#include <array>
+#include <utility>
+
+/**
+ * @brief A class template for matrices whose number of rows and columns is fixed at compile time.
+ *
+ * @tparam T The type to use for the matrix elements. Can be any type that has addition, subtraction, negation, and multiplication defined.
+ * @tparam R The number of rows.
+ * @tparam C The number of columns.
+ */
+template <typename T, size_t R, size_t C>
+class fixed_matrix
+{
+    static_assert(R > 0 and C > 0, "A fixed_matrix must have at least one row and one column.");
+
+public:
+    /**
+     * @brief The type of the matrix elements.
+     */
+    using value_type = T;
+
+    /**
+     * @brief The number of rows.
+     */
+    static constexpr size_t rows{R};
+
+    /**
+     * @brief The number of columns.
+     */
+    static constexpr size_t cols{C};
+
+    // ============
+    // Constructors
+    // ============
+
+    /**
+     * @brief Constructor to create a matrix with all of its elements initialized to zero. Unlike the dynamic matrix, a fixed_matrix is never left uninitialized, so that it can be used in constant expressions.
+     */
+    constexpr fixed_matrix()
+        : elements{} {}
+
+    /**
+     * @brief Constructor to create a matrix with all of its elements initialized to a specific value.
+     *
+     * @param input_init The value to initialize all of the elements to.
+     */
+    constexpr explicit fixed_matrix(const T &input_init)
+        : elements{}
+    {
+        elements.fill(input_init);
+    }
+
+    /**
+     * @brief Constructor to create a matrix and initialize it to the given elements, in flattened 1-dimensional form. For example, for a 2x2 matrix A, the arguments will be A(0, 0), A(0, 1), A(1, 0), A(1, 1). The number of arguments must equal the total number of matrix elements; this is checked at compile time.
+     *
+     * @param input_elements The elements in flattened 1-dimensional form.
+     */
+    template <typename... Args>
+        requires((sizeof...(Args) == R * C) and (sizeof...(Args) > 1) and (std::convertible_to<Args, T> and ...))
+    constexpr fixed_matrix(const Args &...input_elements)
+        : elements{static_cast<T>(input_elements)...} {}
+
+    /**
+     * @brief Constructor to create a matrix and initialize it to the elements given by an `array`, in flattened 1-dimensional form.
+     *
+     * @param input_elements An `array` containing the elements in flattened 1-dimensional form.
+     */
+    constexpr explicit fixed_matrix(const std::array<T, R * C> &input_elements)
+        : elements(input_elements) {}
+
+    /**
+     * @brief Constructor to create a fixed-size matrix from a dynamic matrix.
+     *
+     * @param m The dynamic matrix to be copied.
+     * @throws initializer_wrong_size if the number of rows or columns of the dynamic matrix does not match the number of rows or columns of this matrix.
+     */
+    template <typename Allocator, layout Layout>
+    explicit fixed_matrix(const matrix<T, Allocator, Layout> &m)
+        : elements{}
+    {
+        if (m.get_rows() != R or m.get_cols() != C)
+            throw initializer_wrong_size{};
+        for (size_t i{0}; i < R; i++)
+            for (size_t j{0}; j < C; j++)
+                elements[(C * i) + j] = m(i, j);
+    }
+
+    /**
+     * @brief Static member function used to create an identity matrix. Only available for square matrices.
+     *
+     * @return The identity matrix.
+     */
+    static constexpr fixed_matrix<T, R, C> identity()
+        requires(R == C)
+    {
+        return generate([](const size_t &i)
+                        { return ((i / C) == (i % C)) ? T{1} : T{0}; });
+    }
+
+    // ==============================
+    // Conversion to a dynamic matrix
+    // ==============================
+
+    /**
+     * @brief Convert this matrix to a dynamic matrix with the same elements.
+     *
+     * @tparam Allocator The allocator of the dynamic matrix.
+     * @tparam Layout The storage order of the dynamic matrix.
+     * @return The dynamic matrix.
+     */
+    template <typename Allocator = aligned_allocator<T>, layout Layout = layout::row_major>
+    matrix<T, Allocator, Layout> to_matrix() const
+    {
+        matrix<T, Allocator, Layout> m(R, C);
+        if constexpr (Layout == layout::row_major)
+            std::copy(elements.begin(), elements.end(), m.data());
+        else
+            for (size_t i{0}; i < R; i++)
+                for (size_t j{0}; j < C; j++)
+                    m(i, j) = elements[(C * i) + j];
+        return m;
+    }
+
+    /**
+     * @brief Implicit conversion to a dynamic matrix with the same elements, so that a fixed_matrix can be passed wherever a dynamic matrix is expected.
+     *
+     * @tparam Allocator The allocator of the dynamic matrix.
+     * @tparam Layout The storage order of the dynamic matrix.
+     */
+    template <typename Allocator, layout Layout>
+    operator matrix<T, Allocator, Layout>() const
+    {
+        return to_matrix<Allocator, Layout>();
+    }
+
+    // ================
+    // Member functions
+    // ================
+
+    /**
+     * @brief Member function used to obtain the number of rows in the matrix.
+     *
+     * @return The number of rows.
+     */
+    static constexpr size_t get_rows()
+    {
+        return R;
+    }
+
+    /**
+     * @brief Member function used to obtain the number of columns in the matrix.
+     *
+     * @return The number of columns.
+     */
+    static constexpr size_t get_cols()
+    {
+        return C;
+    }
+
+    /**
+     * @brief Member function used to obtain direct access to the elements of the matrix, stored in flattened 1-dimensional form, with the element at row `i` and column `j` at index `(C * i) + j`.
+     *
+     * @return A pointer to the first element.
+     */
+    constexpr T *data()
+    {
+        return elements.data();
+    }
+
+    /**
+     * @brief Member function used to obtain direct access to the elements of the matrix, stored in flattened 1-dimensional form, with the element at row `i` and column `j` at index `(C * i) + j`.
+     *
+     * @return A pointer to the first element, which cannot be used to modify the elements.
+     */
+    constexpr const T *data() const
+    {
+        return elements.data();
+    }
+
+    /**
+     * @brief Overloaded operator () used to access matrix elements WITHOUT range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return A reference to the element, which can also be used to modify it.
+     */
+    constexpr T &operator()(const size_t &row, const size_t &col)
+    {
+        return elements[(C * row) + col];
+    }
+
+    /**
+     * @brief Overloaded operator () used to access matrix elements WITHOUT range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return The value of the element.
+     */
+    constexpr T operator()(const size_t &row, const size_t &col) const
+    {
+        return elements[(C * row) + col];
+    }
+
+    /**
+     * @brief Member function used to access matrix elements WITH range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return A reference to the element, which can also be used to modify it.
+     * @throws index_out_of_range if the requested element is out of range.
+     */
+    constexpr T &at(const size_t &row, const size_t &col)
+    {
+        if (row >= R or col >= C)
+            throw index_out_of_range{};
+        return elements[(C * row) + col];
+    }
+
+    /**
+     * @brief Member function used to access matrix elements WITH range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return The value of the element.
+     * @throws index_out_of_range if the requested element is out of range.
+     */
+    constexpr T at(const size_t &row, const size_t &col) const
+    {
+        if (row >= R or col >= C)
+            throw index_out_of_range{};
+        return elements[(C * row) + col];
+    }
+
+    /**
+     * @brief Static member function used to set the character width of the elements when printing a matrix. Will be used with `std::setw`.
+     *
+     * @param w The new character width of the matrix elements. Will be used in operator<<() by inserting `std::setw` into the output stream.
+     */
+    static void set_output_width(const int &w)
+    {
+        output_width = w;
+    }
+
+    // ====================
+    // Overloaded operators
+    // ====================
+
+    /**
+     * @brief Overloaded binary operator `<<` used to easily print out a matrix to a stream, in the same format as a dynamic matrix.
+     *
+     * @param out The output stream.
+     * @param m The matrix to be printed.
+     * @return A reference to the output stream.
+     */
+    friend std::ostream &operator<<(std::ostream &out, const fixed_matrix<T, R, C> &m)
+    {
+        for (size_t i{0}; i < R; i++)
+        {
+            out << "( ";
+            for (size_t j{0}; j < C; j++)
+                out << std::setw(output_width) << m(i, j) << ' ';
+            out << ")\n";
+        }
+        out << '\n';
+        return out;
+    }
+
+    /**
+     * @brief Overloaded binary operator `==` used to compare two matrices elementwise.
+     */
+    friend constexpr bool operator==(const fixed_matrix<T, R, C> &, const fixed_matrix<T, R, C> &) = default;
+
+    /**
+     * @brief Overloaded binary operator `+` used to add two matrices. Matrices of different sizes cannot be added; this is checked at compile time.
+     *
+     * @param a The first matrix to be added.
+     * @param b The second matrix to be added.
+     * @return The sum of the matrices.
+     */
+    friend constexpr fixed_matrix<T, R, C> operator+(const fixed_matrix<T, R, C> &a, const fixed_matrix<T, R, C> &b)
+    {
+        return generate([&](const size_t &i)
+                        { return a.elements[i] + b.elements[i]; });
+    }
+
+    /**
+     * @brief Overloaded unary operator `-` used to take the negative of a matrix.
+     *
+     * @param m The matrix.
+     * @return The negative of the matrix.
+     */
+    friend constexpr fixed_matrix<T, R, C> operator-(const fixed_matrix<T, R, C> &m)
+    {
+        return generate([&](const size_t &i)
+                        { return -m.elements[i]; });
+    }
+
+    /**
+     * @brief Overloaded binary operator `-` used to subtract two matrices. Matrices of different sizes cannot be subtracted; this is checked at compile time.
+     *
+     * @param a The first matrix.
+     * @param b The second matrix to be subtracted from the first.
+     * @return The difference of the matrices.
+     */
+    friend constexpr fixed_matrix<T, R, C> operator-(const fixed_matrix<T, R, C> &a, const fixed_matrix<T, R, C> &b)
+    {
+        return generate([&](const size_t &i)
+                        { return a.elements[i] - b.elements[i]; });
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a scalar on the left and a matrix on the right.
+     *
+     * @param s The scalar.
+     * @param m The matrix.
+     * @return The scalar multiple of the matrix.
+     */
+    friend constexpr fixed_matrix<T, R, C> operator*(const T &s, const fixed_matrix<T, R, C> &m)
+    {
+        return generate([&](const size_t &i)
+                        { return s * m.elements[i]; });
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a matrix on the left and a scalar on the right.
+     *
+     * @param m The matrix.
+     * @param s The scalar.
+     * @return The scalar multiple of the matrix.
+     */
+    friend constexpr fixed_matrix<T, R, C> operator*(const fixed_matrix<T, R, C> &m, const T &s)
+    {
+        return s * m;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply two matrices. The number of columns in the first matrix must be the same as the number of rows in the second matrix; this is checked at compile time. The products are fully unrolled, and accumulated in the same order as the dynamic matrix.
+     *
+     * @tparam K The number of columns in the second matrix.
+     * @param a The first matrix to be multiplied.
+     * @param b The second matrix to be multiplied.
+     * @return The product of the matrices.
+     */
+    template <size_t K>
+    friend constexpr fixed_matrix<T, R, K> operator*(const fixed_matrix<T, R, C> &a, const fixed_matrix<T, C, K> &b)
+    {
+        return [&]<size_t... I>(std::index_sequence<I...>)
+        {
+            return fixed_matrix<T, R, K>(std::array<T, R * K>{dot(a, b, I / K, I % K, std::make_index_sequence<C>{})...});
+        }(std::make_index_sequence<R * K>{});
+    }
+
+    /**
+     * @brief Overloaded binary operator `+=` used to add two matrices and assign the result to the first one.
+     *
+     * @param a The first matrix to be added, which will hold the result.
+     * @param b The second matrix to be added.
+     * @return A reference to the first matrix.
+     */
+    friend constexpr fixed_matrix<T, R, C> &operator+=(fixed_matrix<T, R, C> &a, const fixed_matrix<T, R, C> &b)
+    {
+        return a = a + b;
+    }
+
+    /**
+     * @brief Overloaded binary operator `-=` used to subtract two matrices and assign the result to the first one.
+     *
+     * @param a The first matrix, which will hold the result.
+     * @param b The second matrix to be subtracted from the first.
+     * @return A reference to the first matrix.
+     */
+    friend constexpr fixed_matrix<T, R, C> &operator-=(fixed_matrix<T, R, C> &a, const fixed_matrix<T, R, C> &b)
+    {
+        return a = a - b;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*=` used to multiply a matrix by a scalar and assign the result to the matrix.
+     *
+     * @param m The matrix.
+     * @param s The scalar.
+     * @return A reference to the matrix.
+     */
+    friend constexpr fixed_matrix<T, R, C> &operator*=(fixed_matrix<T, R, C> &m, const T &s)
+    {
+        return m = s * m;
+    }
+
+    /**
+     * @brief Overloaded binary operator `/=` used to divide a matrix by a scalar and assign the result to the matrix.
+     *
+     * @param m The matrix.
+     * @param s The scalar.
+     * @return A reference to the matrix.
+     */
+    friend constexpr fixed_matrix<T, R, C> &operator/=(fixed_matrix<T, R, C> &m, const T &s)
+    {
+        return m = generate([&](const size_t &i)
+                            { return m.elements[i] / s; });
+    }
+
+    // ==========
+    // Exceptions
+    // ==========
+
+    /**
+     * @brief Exception to be thrown if a dynamic matrix given to the constructor does not have the same number of rows and columns as the fixed-size matrix.
+     */
+    using initializer_wrong_size = matrix_detail::initializer_wrong_size<T>;
+
+    /**
+     * @brief Exception to be thrown if the requested matrix element is out of range.
+     */
+    using index_out_of_range = matrix_detail::index_out_of_range<T>;
+
+private:
+    /**
+     * @brief Create a matrix whose element at flattened index `i` is `f(i)`, with the loop over the elements fully unrolled.
+     *
+     * @param f A function taking the flattened index and returning the element.
+     * @return The new matrix.
+     */
+    template <typename F>
+    static constexpr fixed_matrix<T, R, C> generate(const F &f)
+    {
+        return [&]<size_t... I>(std::index_sequence<I...>)
+        {
+            return fixed_matrix<T, R, C>(std::array<T, R * C>{f(I)...});
+        }(std::make_index_sequence<R * C>{});
+    }
+
+    /**
+     * @brief Compute the dot product of a row of one matrix and a column of another, with the sum over `k` fully unrolled.
+     */
+    template <size_t K, size_t... Ks>
+    static constexpr T dot(const fixed_matrix<T, R, C> &a, const fixed_matrix<T, C, K> &b, const size_t &i, const size_t &j, std::index_sequence<Ks...>)
+    {
+        return (... + (a(i, Ks) * b(Ks, j)));
+    }
+
+    /**
+     * @brief The elements of the matrix, in flattened 1-dimensional form.
+     */
+    std::array<T, R * C> elements;
+
+    /**
+     * @brief The character width of the matrix elements. Will be used in operator<<() by inserting std::setw into the output stream.
+     */
+    inline static int output_width{5};
+};
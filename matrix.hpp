@@ -9,505 +9,6858 @@
  *
  * @brief A simple C++ matrix class template with dynamic memory allocation and overloaded operators for common matrix operations.
  *
- * @details This library contains a simple C++ class template for matrices. The matrices can be of arbitrary size. Memory is allocated dynamically on the heap using smart pointers. Overloaded operators for common matrix operations such as addition and multiplication are defined.
+ * @details This library contains a simple C++ class template for matrices. The matrices can be of arbitrary size. Memory is allocated dynamically on the heap using smart pointers. Overloaded operators for common matrix operations such as addition and multiplication are defined. Elementwise operations such as addition, subtraction, and multiplication by a scalar return lazy expressions, so that a chain such as `a + b - 2.0 * c` is evaluated in a single loop without any temporary matrices.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <concepts>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
 #include <initializer_list>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#if defined(__unix__) or defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__AVX2__) or defined(__AVX512F__) or defined(__F16C__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) and defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#if defined(MATRIX_INSTRUMENT)
+#include <chrono>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+#if defined(MATRIX_USE_BLAS)
+#include <climits>
+#if defined(MATRIX_BLAS_HEADER)
+#include MATRIX_BLAS_HEADER
+#else
+#include <cblas.h>
+#endif
+#endif
+
 /**
- * @brief A class template for matrices.
+ * @brief An allocator which allocates memory aligned to a given boundary, by default 64 bytes (the size of a cache line and of an AVX-512 register). This is the default allocator used by the matrix class template.
  *
- * @tparam T The type to use for the matrix elements. Can be any type that has addition, subtraction, negation, and multiplication defined.
+ * @tparam T The type of the objects to allocate.
+ * @tparam Alignment The alignment in bytes. Must be a power of two. If smaller than `alignof(T)`, `alignof(T)` is used instead.
  */
-template <typename T>
-class matrix
+template <typename T, size_t Alignment = 64>
+class aligned_allocator
 {
 public:
-    // ============
-    // Constructors
-    // ============
+    using value_type = T;
 
     /**
-     * @brief Constructor to create an UNINITIALIZED matrix. WARNING: Good for performance, but make sure to never use any uninitialized elements!
-     *
-     * @param input_rows The number of rows.
-     * @param input_cols The number of columns.
-     * @throws zero_size if the number of rows or columns is zero.
+     * @brief The actual alignment of the allocated memory in bytes.
      */
-    matrix(const size_t &input_rows, const size_t &input_cols)
-        : rows(input_rows), cols(input_cols)
+    static constexpr size_t alignment{std::max(Alignment, alignof(T))};
+
+    template <typename U>
+    struct rebind
     {
-        if (rows == 0 or cols == 0)
-            throw zero_size{};
-        smart.reset(new T[rows * cols]);
-        elements = smart.get();
-    }
+        using other = aligned_allocator<U, Alignment>;
+    };
+
+    aligned_allocator() = default;
+
+    template <typename U>
+    aligned_allocator(const aligned_allocator<U, Alignment> &) {}
 
     /**
-     * @brief Constructor to create a matrix with all of its elements initialized to a specific value.
+     * @brief Allocate uninitialized memory for `n` objects of type `T`.
      *
-     * @param input_rows The number of rows.
-     * @param input_cols The number of columns.
-     * @param input_init The value to initialize all of the elements to.
-     * @throws zero_size if the number of rows or columns is zero.
+     * @param n The number of objects.
+     * @return A pointer to the allocated memory.
+     * @throws std::bad_array_new_length if the size in bytes does not fit in a `size_t`.
+     * @throws std::bad_alloc if the allocation fails.
      */
-    matrix(const size_t &input_rows, const size_t &input_cols, const T &input_init)
-        : rows(input_rows), cols(input_cols)
+    T *allocate(const size_t &n)
     {
-        if (rows == 0 or cols == 0)
-            throw zero_size{};
-        smart.reset(new T[rows * cols]);
-        elements = smart.get();
-        for (size_t i{0}; i < rows * cols; i++)
-            elements[i] = input_init;
+        if (n > static_cast<size_t>(-1) / sizeof(T))
+            throw std::bad_array_new_length{};
+        return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t{alignment}));
     }
 
     /**
-     * @brief Constructor to create a diagonal matrix from a `vector`.
+     * @brief Deallocate memory previously allocated with allocate().
      *
-     * @param input_diagonal A `vector` containing the elements on the diagonal. The number of rows and columns is inferred automatically from the size of the `vector`.
-     * @throws zero_size if the size of the `vector` is zero.
+     * @param p A pointer to the memory.
      */
-    matrix(const std::vector<T> &input_diagonal)
-        : rows(input_diagonal.size()), cols(input_diagonal.size())
+    void deallocate(T *p, const size_t &)
     {
-        if (rows == 0)
-            throw zero_size{};
-        smart.reset(new T[rows * cols]);
-        elements = smart.get();
-        for (size_t i{0}; i < rows; i++)
-            for (size_t j{0}; j < cols; j++)
-                elements[(cols * i) + j] = ((i == j) ? input_diagonal[i] : 0);
+        ::operator delete(p, std::align_val_t{alignment});
+    }
+
+    template <typename U>
+    friend bool operator==(const aligned_allocator &, const aligned_allocator<U, Alignment> &)
+    {
+        return true;
     }
+};
 
+/**
+ * @brief An arena for short-lived matrices. While a matrix_arena::scope is active on a thread, every matrix with a trivially destructible element type and the default allocator that is created on that thread, including the return values of operators, takes its memory from the arena by bumping a pointer, instead of calling the global allocator. When the scope ends, all of that memory is released at once, and is reused by the next scope.
+ *
+ * @details The arena allocates memory in large blocks, which are kept until the arena itself is destroyed. Scopes may be nested; each scope only releases the memory allocated since it began. An arena must only be used by one thread at a time. WARNING: A matrix that takes its memory from an arena must not be used after the scope in which it was created has ended. This includes matrices declared outside the scope that are moved into, copied into, or assigned to inside the scope, since copies made inside the scope also take their memory from the arena. To keep a result, copy it while a matrix_arena::suspend guard is active, so that the copy takes its memory from the allocator.
+ */
+class matrix_arena
+{
+public:
     /**
-     * @brief Constructor to create a diagonal matrix from an `initializer_list`.
+     * @brief Construct a new arena.
      *
-     * @param input_diagonal An `initializer_list` containing the elements on the diagonal. The number of rows and columns is inferred automatically from the size of the `initializer_list`.
-     * @throws zero_size if the size of the `initializer_list` is zero.
+     * @param input_block_size The size in bytes of each block of memory allocated by the arena. Requests larger than this get a block of their own.
      */
-    matrix(const std::initializer_list<T> &input_diagonal)
-        : matrix(std::vector<T>{input_diagonal}) {}
+    explicit matrix_arena(const size_t &input_block_size = size_t{1} << 20)
+        : block_size(input_block_size) {}
+
+    matrix_arena(const matrix_arena &) = delete;
+    matrix_arena &operator=(const matrix_arena &) = delete;
 
     /**
-     * @brief Constructor to create a matrix and initialize it to the elements given by a `vector`.
-     * @details The elements should be given in flattened 1-dimensional form, with the matrix element at row `i` and column `j` (counting from zero) given by element number `(cols * i) + j` of the `vector` (also counting from zero), where `cols` is the number of columns, that is, the number of element in each row. For example, for a 2x2 matrix A, the `vector` will be [A(0, 0), A(0, 1), A(1, 0), A(1, 1)].
-     *
-     * @param input_rows The number of rows.
-     * @param input_cols The number of columns.
-     * @param input_elements A `vector` containing the elements in flattened 1-dimensional form.
-     * @throws zero_size if the number of rows or columns is zero.
-     * @throws initializer_wrong_size if the size of the `vector` does not equal the total number of matrix elements.
+     * @brief An RAII guard that makes an arena the active arena of the current thread for its lifetime. When the guard is destroyed, the memory allocated since it was created is released, and the previously active arena (if any) becomes active again.
      */
-    matrix(const size_t &input_rows, const size_t &input_cols, const std::vector<T> &input_elements)
-        : rows(input_rows), cols(input_cols)
+    class scope
     {
-        if (rows == 0 or cols == 0)
-            throw zero_size{};
-        if (input_elements.size() != rows * cols)
-            throw initializer_wrong_size{};
-        smart.reset(new T[rows * cols]);
-        elements = smart.get();
-        for (size_t i{0}; i < rows * cols; i++)
-            elements[i] = input_elements[i];
-    }
+    public:
+        /**
+         * @brief Begin a new scope.
+         *
+         * @param input_arena The arena to use.
+         */
+        explicit scope(matrix_arena &input_arena)
+            : arena(input_arena), previous(active_arena()), saved_block(input_arena.current_block), saved_offset(input_arena.offset)
+        {
+            active_arena() = &arena;
+        }
+
+        scope(const scope &) = delete;
+        scope &operator=(const scope &) = delete;
+
+        /**
+         * @brief End the scope, releasing all memory allocated from the arena since the scope began.
+         */
+        ~scope()
+        {
+            arena.current_block = saved_block;
+            arena.offset = saved_offset;
+            active_arena() = previous;
+        }
+
+    private:
+        /**
+         * @brief The arena used by this scope.
+         */
+        matrix_arena &arena;
+
+        /**
+         * @brief The arena that was active before this scope began.
+         */
+        matrix_arena *previous{nullptr};
+
+        /**
+         * @brief The position in the arena when this scope began.
+         */
+        size_t saved_block{0}, saved_offset{0};
+    };
 
     /**
-     * @brief Constructor to create a matrix and initialize it to the elements given by an `initializer_list`.
-     * @details The elements should be given in flattened 1-dimensional form, with the matrix element at row `i` and column `j` (counting from zero) given by element number `(cols * i) + j` of the `initializer_list` (also counting from zero), where `cols` is the number of columns, that is, the number of element in each row. For example, for a 2x2 matrix A, the `initializer_list` will be [A(0, 0), A(0, 1), A(1, 0), A(1, 1)].
-     *
-     * @param input_rows The number of rows.
-     * @param input_cols The number of columns.
-     * @param input_elements An `initializer_list` containing the elements in flattened 1-dimensional form.
-     * @throws zero_size if the number of rows or columns is zero.
-     * @throws initializer_wrong_size if the size of the `initializer_list` does not equal the total number of matrix elements.
+     * @brief An RAII guard that suspends the active arena of the current thread for its lifetime, so that matrices created meanwhile take their memory from their allocator, and may outlive the enclosing scope. When the guard is destroyed, the previously active arena (if any) becomes active again.
      */
-    matrix(const size_t &input_rows, const size_t &input_cols, const std::initializer_list<T> &input_elements)
-        : matrix(input_rows, input_cols, std::vector<T>{input_elements}) {}
+    class suspend
+    {
+    public:
+        /**
+         * @brief Suspend the active arena.
+         */
+        suspend()
+            : previous(active_arena())
+        {
+            active_arena() = nullptr;
+        }
+
+        suspend(const suspend &) = delete;
+        suspend &operator=(const suspend &) = delete;
+
+        /**
+         * @brief Make the suspended arena active again.
+         */
+        ~suspend()
+        {
+            active_arena() = previous;
+        }
+
+    private:
+        /**
+         * @brief The arena that was active before the guard was created.
+         */
+        matrix_arena *previous{nullptr};
+    };
 
     /**
-     * @brief Copy constructor to create a new matrix with the same elements as an existing matrix.
+     * @brief Get the arena that is currently active on this thread.
      *
-     * @param m The matrix to be copied.
+     * @return A pointer to the active arena, or `nullptr` if no scope is active.
      */
-    matrix(const matrix<T> &m)
-        : rows(m.rows), cols(m.cols)
+    static matrix_arena *active()
     {
-        smart.reset(new T[rows * cols]);
-        elements = smart.get();
-        for (size_t i{0}; i < rows * cols; i++)
-            elements[i] = m.elements[i];
+        return active_arena();
     }
 
     /**
-     * @brief Move constructor to move the elements of an existing matrix to a new matrix.
+     * @brief Allocate memory from the arena. The memory is released when the innermost active scope ends.
      *
-     * @param m The matrix to be moved.
+     * @param bytes The number of bytes to allocate.
+     * @param alignment The alignment in bytes. Must be a power of two, no larger than 64.
+     * @return A pointer to the allocated memory.
+     * @throws std::bad_alloc if the allocation fails.
      */
-    matrix(matrix<T> &&m)
-        : rows(m.rows), cols(m.cols)
+    void *allocate(const size_t &bytes, const size_t &alignment)
     {
-        smart = move(m.smart);
-        elements = smart.get();
-        m.rows = 0;
-        m.cols = 0;
-        m.elements = nullptr;
+        while (current_block < blocks.size())
+        {
+            const size_t start{(offset + alignment - 1) & ~(alignment - 1)};
+            if (start + bytes <= blocks[current_block].size)
+            {
+                offset = start + bytes;
+                return blocks[current_block].memory.get() + start;
+            }
+            current_block++;
+            offset = 0;
+        }
+        blocks.push_back(block{std::max(block_size, bytes)});
+        offset = bytes;
+        return blocks[current_block].memory.get();
     }
 
-    // ================
-    // Member functions
-    // ================
-
     /**
-     * @brief Overloaded operator = to copy the elements of one matrix to another matrix.
+     * @brief Get the total number of bytes currently reserved by the arena.
      *
-     * @param m The matrix to be copied.
-     * @return matrix<T>& A reference to the target matrix.
+     * @return The number of bytes.
      */
-    matrix<T> &operator=(const matrix<T> &m)
+    size_t capacity() const
     {
-        rows = m.rows;
-        cols = m.cols;
-        smart.reset(new T[rows * cols]);
-        elements = smart.get();
-        for (size_t i{0}; i < rows * cols; i++)
-            elements[i] = m.elements[i];
-        return *this;
+        size_t total{0};
+        for (const block &b : blocks)
+            total += b.size;
+        return total;
     }
 
+private:
     /**
-     * @brief Overloaded operator = to move the elements of one matrix to another matrix.
-     *
-     * @param m The matrix to be moved.
-     * @return matrix<T>& A reference to the target matrix.
+     * @brief A block of memory aligned to 64 bytes.
      */
-    matrix<T> &operator=(matrix<T> &&m)
+    struct block
     {
-        rows = m.rows;
-        cols = m.cols;
-        smart = move(m.smart);
-        elements = smart.get();
-        m.rows = 0;
-        m.cols = 0;
-        m.elements = nullptr;
-        return *this;
-    }
+        explicit block(const size_t &input_size)
+            : size(input_size), memory(static_cast<std::byte *>(::operator new(input_size, std::align_val_t{64}))) {}
+
+        struct deleter
+        {
+            void operator()(std::byte *p) const
+            {
+                ::operator delete(p, std::align_val_t{64});
+            }
+        };
+
+        size_t size{0};
+        std::unique_ptr<std::byte[], deleter> memory;
+    };
 
     /**
-     * @brief Member function used to obtain (but not modify) the number of rows in the matrix.
-     *
-     * @return The number of rows.
+     * @brief Get a reference to the pointer to the arena that is currently active on this thread.
      */
-    inline size_t get_rows() const
+    static matrix_arena *&active_arena()
     {
-        return rows;
+        static thread_local matrix_arena *arena{nullptr};
+        return arena;
     }
 
     /**
-     * @brief Member function used to obtain (but not modify) the number of columns in the matrix
-     *
-     * @return The number of columns.
+     * @brief The size in bytes of each new block.
      */
-    inline size_t get_cols() const
-    {
-        return cols;
-    }
+    size_t block_size{0};
 
     /**
-     * @brief Overloaded operator () used to access matrix elements WITHOUT range checking.
-     *
-     * @param row The row index (starting from zero).
-     * @param col The column index (starting from zero).
-     * @return A reference to the element, which can also be used to modify it.
+     * @brief The blocks allocated so far.
      */
-    inline T &operator()(const size_t &row, const size_t &col)
-    {
-        return elements[(cols * row) + col];
-    }
+    std::vector<block> blocks;
 
     /**
-     * @brief Overloaded operator () used to access matrix elements WITHOUT range checking.
+     * @brief The index of the block currently being allocated from, and the offset of the first free byte within it.
+     */
+    size_t current_block{0}, offset{0};
+};
+
+// ===========================
+// Low-precision element types
+// ===========================
+
+/**
+ * @brief A 16-bit "brain" floating-point number, in the bfloat16 format, with the same 8-bit exponent as a `float` but only 8 bits of precision. Used to store large matrices in half the memory of `float`, for example the weights of a neural network. Arithmetic is performed by converting to `float`, so `bf16` can be used wherever a `float` is expected. To multiply `bf16` matrices accurately, use multiply<float>(), which accumulates the products in `float`.
+ */
+class bf16
+{
+public:
+    /**
+     * @brief Default constructor. As for a `float`, the value is uninitialized, unless the object is value-initialized, as in `bf16{}`, in which case it is zero.
+     */
+    bf16() = default;
+
+    /**
+     * @brief Convert a `float` to the nearest `bf16`, with ties rounded to even.
      *
-     * @param row The row index (starting from zero).
-     * @param col The column index (starting from zero).
-     * @return The value of the element.
+     * @param f The number to convert.
      */
-    inline T operator()(const size_t &row, const size_t &col) const
-    {
-        return elements[(cols * row) + col];
-    }
+    bf16(const float &f) : bits(round(f)) {}
 
     /**
-     * @brief Member function used to access matrix elements WITH range checking.
+     * @brief Convert the number to a `float`. The conversion is exact.
      *
-     * @param row The row index (starting from zero).
-     * @param col The column index (starting from zero).
-     * @return A reference to the element, which can also be used to modify it.
-     * @throws index_out_of_range if the requested element is out of range.
+     * @return The number as a `float`.
      */
-    inline T &at(const size_t &row, const size_t &col)
+    operator float() const
     {
-        if (row >= rows or col >= cols)
-            throw index_out_of_range{};
-        return elements[(cols * row) + col];
+        return std::bit_cast<float>(static_cast<uint32_t>(bits) << 16);
     }
 
     /**
-     * @brief Member function used to access matrix elements WITH range checking.
+     * @brief Member function used to obtain the bits of the number: the sign bit, followed by 8 bits of exponent and 7 bits of mantissa.
      *
-     * @param row The row index (starting from zero).
-     * @param col The column index (starting from zero).
-     * @return The value of the element.
-     * @throws index_out_of_range if the requested element is out of range.
+     * @return The bits.
      */
-    inline T at(const size_t &row, const size_t &col) const
+    uint16_t get_bits() const
     {
-        if (row >= rows or col >= cols)
-            throw index_out_of_range{};
-        return elements[(cols * row) + col];
+        return bits;
     }
 
+private:
     /**
-     * @brief Static member function used to set the character width of the matrix elements when printing a matrix to a stream.
+     * @brief Round a `float` to the nearest `bf16`, with ties rounded to even, by keeping the top 16 bits of the rounded `float`. NaNs are kept NaNs, instead of possibly being rounded to infinity.
      *
-     * @param w The new character width of the matrix elements. Will be used in operator<<() by inserting `std::setw` into the output stream.
+     * @param f The number to round.
+     * @return The bits of the rounded number.
      */
-    inline static void set_output_width(const int &w)
+    static uint16_t round(const float &f)
     {
-        output_width = w;
+        const uint32_t u{std::bit_cast<uint32_t>(f)};
+        if ((u & 0x7FFFFFFF) > 0x7F800000)
+            return static_cast<uint16_t>((u >> 16) | 0x40);
+        return static_cast<uint16_t>((u + 0x7FFF + ((u >> 16) & 1)) >> 16);
     }
 
-    // ================
-    // Friend functions
-    // ================
+    /**
+     * @brief The bits of the number.
+     */
+    uint16_t bits;
+};
 
+/**
+ * @brief A 16-bit IEEE 754 half-precision floating-point number (binary16), with 5 bits of exponent and 11 bits of precision, so it can only represent numbers up to 65504. Used to store large matrices in half the memory of `float`. Arithmetic is performed by converting to `float`, so `fp16` can be used wherever a `float` is expected. The conversions use the F16C instructions if they are available (compile with e.g. `-march=native`). To multiply `fp16` matrices accurately, use multiply<float>(), which accumulates the products in `float`.
+ */
+class fp16
+{
+public:
     /**
-     * @brief Overloaded binary operator `<<` used to easily print out a matrix to a stream.
-     *
-     * @param out The output stream.
-     * @param m The matrix to be printed.
-     * @return A reference to the output stream.
+     * @brief Default constructor. As for a `float`, the value is uninitialized, unless the object is value-initialized, as in `fp16{}`, in which case it is zero.
      */
-    friend std::ostream &operator<<(std::ostream &out, const matrix<T> &m)
-    {
-        if (m.rows == 0 and m.cols == 0)
-            out << "()\n";
-        else
-        {
-            for (size_t i{0}; i < m.rows; i++)
-            {
-                out << "( ";
-                for (size_t j{0}; j < m.cols; j++)
-                    out << std::setw(m.output_width) << m(i, j) << ' ';
-                out << ")\n";
-            }
-            out << '\n';
-        }
-        return out;
-    }
+    fp16() = default;
 
     /**
-     * @brief Overloaded binary operator `+` used to add two matrices.
+     * @brief Convert a `float` to the nearest `fp16`, with ties rounded to even. Numbers too large to be represented become infinite.
      *
-     * @param a The first matrix to be added.
-     * @param b The second matrix to be added.
-     * @return The sum of the matrices.
-     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     * @param f The number to convert.
      */
-    friend matrix<T> operator+(const matrix<T> &a, const matrix<T> &b)
-    {
-        if ((a.rows != b.rows) or (a.cols != b.cols))
-            throw typename matrix<T>::incompatible_sizes_add{};
-        matrix<T> c(a.rows, a.cols);
-        for (size_t i{0}; i < a.rows; i++)
-            for (size_t j{0}; j < a.cols; j++)
-                c(i, j) = a(i, j) + b(i, j);
-        return c;
-    }
+    fp16(const float &f) : bits(round(f)) {}
 
     /**
-     * @brief Overloaded binary operator `+=` used to add two matrices and assign the result to the first one.
+     * @brief Convert the number to a `float`. The conversion is exact.
      *
-     * @param a The first matrix to be added. Will be replaced with the sum of the matrices.
-     * @param b The second matrix to be added.
-     * @return The sum of the matrices.
-     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     * @return The number as a `float`.
      */
-    inline friend matrix<T> operator+=(matrix<T> &a, const matrix<T> &b)
+    operator float() const
     {
-        a = a + b;
-        return a;
+#if defined(__F16C__)
+        return _cvtsh_ss(bits);
+#else
+        const uint32_t sign{static_cast<uint32_t>(bits & 0x8000) << 16};
+        const uint32_t exponent{static_cast<uint32_t>(bits >> 10) & 0x1F}, mantissa{static_cast<uint32_t>(bits) & 0x3FF};
+        if (exponent == 0x1F)
+            return std::bit_cast<float>(sign | 0x7F800000 | (mantissa << 13));
+        if (exponent == 0)
+        {
+            // Zero or subnormal: the value is mantissa * 2^-24, which a float represents exactly.
+            const float magnitude{static_cast<float>(mantissa) * 0x1p-24f};
+            return sign ? -magnitude : magnitude;
+        }
+        return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+#endif
     }
 
     /**
-     * @brief Overloaded unary operator `-` used to take the negative of a matrix.
+     * @brief Member function used to obtain the bits of the number: the sign bit, followed by 5 bits of exponent and 10 bits of mantissa.
      *
-     * @param m The matrix to be negated.
-     * @return The negative of the matrix.
+     * @return The bits.
      */
-    friend matrix<T> operator-(const matrix<T> &m)
+    uint16_t get_bits() const
     {
-        matrix<T> c(m.rows, m.cols);
-        for (size_t i{0}; i < m.rows; i++)
-            for (size_t j{0}; j < m.cols; j++)
-                c(i, j) = -m(i, j);
-        return c;
+        return bits;
     }
 
+private:
     /**
-     * @brief Overloaded binary operator `-` used to subtract two matrices.
+     * @brief Round a `float` to the nearest `fp16`, with ties rounded to even.
      *
-     * @param a The first matrix to be subtracted.
-     * @param b The second matrix to be subtracted.
-     * @return The first matrix minus the second matrix.
-     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     * @param f The number to round.
+     * @return The bits of the rounded number.
      */
-    friend matrix<T> operator-(const matrix<T> &a, const matrix<T> &b)
+    static uint16_t round(const float &f)
     {
-        if ((a.rows != b.rows) or (a.cols != b.cols))
-            throw typename matrix<T>::incompatible_sizes_add{};
-        matrix<T> c(a.rows, a.cols);
-        for (size_t i{0}; i < a.rows; i++)
-            for (size_t j{0}; j < a.cols; j++)
-                c(i, j) = a(i, j) - b(i, j);
-        return c;
+#if defined(__F16C__)
+        return _cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT);
+#else
+        uint32_t u{std::bit_cast<uint32_t>(f)};
+        const uint16_t sign{static_cast<uint16_t>((u >> 16) & 0x8000)};
+        u &= 0x7FFFFFFF;
+        // Infinity or NaN.
+        if (u >= 0x7F800000)
+            return sign | 0x7C00 | (u > 0x7F800000 ? 0x200 : 0);
+        // Numbers from 65520 up round to infinity.
+        if (u >= 0x477FF000)
+            return sign | 0x7C00;
+        // Zero or subnormal result: adding 0.5 (in float arithmetic, which rounds to nearest even) shifts the bits of the mantissa into place.
+        if (u < 0x38800000)
+            return sign | static_cast<uint16_t>(std::bit_cast<uint32_t>(std::bit_cast<float>(u) + 0.5f) - 0x3F000000);
+        // Normal result: adjust the exponent bias, and round to nearest even.
+        u += 0xC8000FFF + ((u >> 13) & 1);
+        return sign | static_cast<uint16_t>(u >> 13);
+#endif
     }
 
     /**
-     * @brief Overloaded binary operator `-=` used to subtract two matrices and assign the result to the first one.
-     *
-     * @param a The first matrix to be subtracted. Will be replaced with first matrix minus the second matrix.
-     * @param b The second matrix to be subtracted.
-     * @return The first matrix minus the second matrix.
-     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     * @brief The bits of the number.
      */
-    inline friend matrix<T> operator-=(matrix<T> &a, const matrix<T> &b)
-    {
-        a = a - b;
-        return a;
-    }
+    uint16_t bits;
+};
 
+/**
+ * @brief The orders in which the elements of a matrix can be stored in memory, selected by the third template parameter of the matrix class template.
+ */
+enum class layout
+{
     /**
-     * @brief Overloaded binary operator `*` used to multiply two matrices.
+     * @brief Row-major order: the elements of each row are stored contiguously, and the rows are stored one after another. This is the default, and the order used by C and C++ arrays.
+     */
+    row_major,
+
+    /**
+     * @brief Column-major order: the elements of each column are stored contiguously, and the columns are stored one after another. This is the order used by Fortran, LAPACK, and the default layout of most BLAS routines, so the elements of such a matrix can be passed to them directly.
+     */
+    col_major
+};
+
+template <typename T, typename Allocator = aligned_allocator<T>, layout Layout = layout::row_major>
+class matrix;
+
+template <typename T>
+class matrix_view;
+
+/**
+ * @brief Implementation details of the matrix class template. Not intended to be used directly.
+ */
+namespace matrix_detail
+{
+    // ==========
+    // Exceptions
+    // ==========
+
+    // The exceptions are defined here, and exposed as member types of the matrix class template, so that matrices with the same element type but different allocators throw the same exceptions.
+
+    /**
+     * @brief See matrix::zero_size.
+     */
+    template <typename T>
+    class zero_size
+    {
+    };
+
+    /**
+     * @brief See matrix::initializer_wrong_size.
+     */
+    template <typename T>
+    class initializer_wrong_size
+    {
+    };
+
+    /**
+     * @brief See matrix::incompatible_sizes_add.
+     */
+    template <typename T>
+    class incompatible_sizes_add
+    {
+    };
+
+    /**
+     * @brief See matrix::incompatible_sizes_multiply.
+     */
+    template <typename T>
+    class incompatible_sizes_multiply
+    {
+    };
+
+    /**
+     * @brief See matrix::index_out_of_range.
+     */
+    template <typename T>
+    class index_out_of_range
+    {
+    };
+
+    /**
+     * @brief See matrix::file_error.
+     */
+    template <typename T>
+    class file_error
+    {
+    };
+
+    /**
+     * @brief See matrix::invalid_file_format.
+     */
+    template <typename T>
+    class invalid_file_format
+    {
+    };
+
+    // ============
+    // Binary files
+    // ============
+
+    /**
+     * @brief The header at the start of a binary matrix file, as written by matrix::save(). The elements follow immediately after the header, in flattened 1-dimensional form with no padding between rows. Since the header is 64 bytes long, the elements of a memory-mapped file are aligned to 64 bytes.
+     * @details All fields are stored in the byte order of the machine that wrote the file, which is indicated by `byte_order`.
+     */
+    struct file_header
+    {
+        /**
+         * @brief Identifies the file as a binary matrix file.
+         */
+        char magic[8]{'M', 'A', 'T', 'R', 'I', 'X', 'B', 'N'};
+
+        /**
+         * @brief The value 0x01020304, written in the byte order of the machine that wrote the file.
+         */
+        uint32_t byte_order{0x01020304};
+
+        /**
+         * @brief The version of the file format.
+         */
+        uint32_t version{1};
+
+        /**
+         * @brief A code for the type of the elements. See dtype_code().
+         */
+        uint32_t dtype{0};
+
+        /**
+         * @brief The size of each element in bytes.
+         */
+        uint32_t element_size{0};
+
+        /**
+         * @brief The number of rows.
+         */
+        uint64_t rows{0};
+
+        /**
+         * @brief The number of columns.
+         */
+        uint64_t cols{0};
+
+        /**
+         * @brief Reserved for future use; always zero.
+         */
+        uint8_t reserved[24]{};
+    };
+
+    static_assert(sizeof(file_header) == 64);
+
+    /**
+     * @brief Get the code used in the file header for the type of the elements: 1 to 4 for signed integers of 1, 2, 4, and 8 bytes, 5 to 8 for unsigned integers of 1, 2, 4, and 8 bytes, 9 for `float`, 10 for `double`, and 0 for any other trivially copyable type, which is then identified by its size alone.
      *
-     * @param a The first matrix to be multiplied.
-     * @param b The second matrix to be multiplied.
-     * @return The product of the matrices.
-     * @throws incompatible_sizes_multiply if the number of columns in the first matrix is not the same as the number of rows in the second matrix.
+     * @tparam T The type of the elements.
+     * @return The code.
      */
-    friend matrix<T> operator*(const matrix<T> &a, const matrix<T> &b)
+    template <typename T>
+    constexpr uint32_t dtype_code()
     {
-        if (a.cols != b.rows)
-            throw typename matrix<T>::incompatible_sizes_multiply{};
-        matrix<T> c(a.rows, b.cols);
-        for (size_t i{0}; i < a.rows; i++)
-            for (size_t j{0}; j < b.cols; j++)
-            {
-                c(i, j) = 0;
-                for (size_t k{0}; k < a.cols; k++)
-                    c(i, j) += a(i, k) * b(k, j);
-            }
-        return c;
+        constexpr uint32_t size_index{(sizeof(T) == 1) ? 1u : (sizeof(T) == 2) ? 2u : (sizeof(T) == 4) ? 3u : (sizeof(T) == 8) ? 4u : 0u};
+        if constexpr (std::is_same_v<T, float>)
+            return 9;
+        else if constexpr (std::is_same_v<T, double>)
+            return 10;
+        else if constexpr (std::is_integral_v<T> and size_index != 0)
+            return std::is_signed_v<T> ? size_index : size_index + 4;
+        else
+            return 0;
     }
 
     /**
-     * @brief Overloaded binary operator `*` used to multiply a scalar on the left and a matrix on the right.
+     * @brief Reverse the order of the bytes of each of `count` objects of `size` bytes each, to convert between big-endian and little-endian representations.
      *
-     * @param s The scalar.
-     * @param m The matrix.
-     * @return The product of the scalar with the matrix.
+     * @param data A pointer to the first object.
+     * @param count The number of objects.
+     * @param size The size of each object in bytes.
      */
-    friend matrix<T> operator*(const T &s, const matrix<T> &m)
+    inline void byte_swap(void *data, const size_t &count, const size_t &size)
     {
-        matrix<T> c(m.rows, m.cols);
-        for (size_t i{0}; i < m.rows; i++)
-            for (size_t j{0}; j < m.cols; j++)
-                c(i, j) = s * m(i, j);
-        return c;
+        unsigned char *bytes{static_cast<unsigned char *>(data)};
+        for (size_t i{0}; i < count; i++, bytes += size)
+            std::reverse(bytes, bytes + size);
     }
 
     /**
-     * @brief Overloaded binary operator `*` used to multiply a matrix on the left and a scalar on the right.
+     * @brief Read and validate the header of a binary matrix file.
      *
-     * @param m The matrix.
-     * @param s The scalar.
-     * @return The product of the scalar with the matrix.
+     * @tparam T The type of the matrix elements.
+     * @param in The stream to read from.
+     * @param swapped Set to true if the file was written on a machine with the opposite byte order, in which case the fields of the returned header have already been converted, but the elements still need to be.
+     * @return The header.
+     * @throws invalid_file_format if the file is not a binary matrix file, or its elements are not of type `T`.
      */
-    inline friend matrix<T> operator*(const matrix<T> &m, const T &s)
+    template <typename T>
+    file_header read_header(std::istream &in, bool &swapped)
     {
-        return s * m;
+        file_header header;
+        const file_header expected;
+        if (not in.read(reinterpret_cast<char *>(&header), sizeof(header)) or std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0)
+            throw invalid_file_format<T>{};
+        swapped = (header.byte_order != expected.byte_order);
+        if (swapped)
+        {
+            byte_swap(&header.byte_order, 4, sizeof(uint32_t));
+            byte_swap(&header.rows, 2, sizeof(uint64_t));
+        }
+        if (header.byte_order != expected.byte_order or header.version != expected.version or header.dtype != dtype_code<T>() or header.element_size != sizeof(T))
+            throw invalid_file_format<T>{};
+        if (header.cols != 0 and header.rows > (static_cast<uint64_t>(-1) / sizeof(T)) / header.cols)
+            throw invalid_file_format<T>{};
+        return header;
     }
 
     // ==========
-    // Exceptions
+    // Text files
     // ==========
 
     /**
-     * @brief Exception to be thrown if the number of rows or columns given to the constructor is zero.
+     * @brief A concept satisfied by the types that `std::to_chars()` and `std::from_chars()` can convert to and from text, namely integers (other than `bool`) and floating-point numbers.
      */
-    class zero_size
+    template <typename T>
+    concept text_convertible = (std::is_integral_v<T> and not std::same_as<T, bool>) or std::is_floating_point_v<T>;
+
+    /**
+     * @brief Get a buffer used to format or parse text on the current thread. The buffer is reused between calls, so that repeated writes and reads do not allocate memory.
+     *
+     * @return A reference to the buffer.
+     */
+    inline std::string &text_buffer()
     {
-    };
+        static thread_local std::string buffer;
+        return buffer;
+    }
 
     /**
-     * @brief Exception to be thrown if the size of the `vector` or `initializer_list` provided to the constructor does not equal the total number of matrix elements.
+     * @brief Write the elements of a matrix to a stream as text, one row per line, with the elements separated by a delimiter. The elements are formatted using `std::to_chars()`, which for floating-point numbers gives the shortest representation that reads back to exactly the same value, into a buffer that is written to the stream in large chunks.
+     *
+     * @param m A view of the matrix.
+     * @param out The output stream.
+     * @param delimiter The character used to separate the elements in each row.
      */
-    class initializer_wrong_size
+    template <text_convertible T>
+    void write_delimited(const matrix_view<const T> &m, std::ostream &out, const char &delimiter)
     {
-    };
+        // The number of characters that one element, one delimiter, and one newline can take up, with room to spare.
+        constexpr size_t max_element_chars{64};
+        constexpr size_t chunk_size{size_t{1} << 16};
+        std::string &buffer{text_buffer()};
+        buffer.resize(chunk_size + max_element_chars);
+        char *const begin{buffer.data()};
+        char *position{begin};
+        for (size_t i{0}; i < m.get_rows(); i++)
+        {
+            for (size_t j{0}; j < m.get_cols(); j++)
+            {
+                if (j != 0)
+                    *position++ = delimiter;
+                position = std::to_chars(position, begin + buffer.size(), m(i, j)).ptr;
+                if (static_cast<size_t>(position - begin) >= chunk_size)
+                {
+                    out.write(begin, position - begin);
+                    position = begin;
+                }
+            }
+            *position++ = '\n';
+        }
+        out.write(begin, position - begin);
+    }
 
     /**
-     * @brief Exception to be thrown if two matrices that are added or subtracted do not have the same number of rows and columns.
+     * @brief Read a matrix written as text, one row per line, with the elements separated by a delimiter. The whole stream is read into a buffer first, and the elements are then parsed using `std::from_chars()`. Spaces and tabs around the elements, empty lines, and Windows line endings are ignored.
+     *
+     * @param in The input stream.
+     * @param delimiter The character used to separate the elements in each row. If it is a space, elements may be separated by any number of spaces and tabs.
+     * @param elements A vector to store the elements in, in flattened 1-dimensional form.
+     * @param cols Set to the number of columns.
+     * @return The number of rows.
+     * @throws invalid_file_format if an element could not be parsed, or the rows do not all have the same number of elements.
      */
-    class incompatible_sizes_add
+    template <text_convertible T>
+    size_t read_delimited(std::istream &in, const char &delimiter, std::vector<T> &elements, size_t &cols)
+    {
+        std::string &buffer{text_buffer()};
+        constexpr size_t chunk_size{size_t{1} << 20};
+        buffer.clear();
+        while (in)
+        {
+            const size_t size{buffer.size()};
+            buffer.resize(size + chunk_size);
+            in.read(buffer.data() + size, static_cast<std::streamsize>(chunk_size));
+            buffer.resize(size + static_cast<size_t>(in.gcount()));
+        }
+        const char *p{buffer.data()};
+        const char *const end{p + buffer.size()};
+        const auto skip_blanks = [&]
+        {
+            while (p != end and (*p == ' ' or *p == '\t' or *p == '\r'))
+                p++;
+        };
+        size_t rows{0};
+        cols = 0;
+        while (p != end)
+        {
+            skip_blanks();
+            if (p == end)
+                break;
+            if (*p == '\n')
+            {
+                p++;
+                continue;
+            }
+            size_t row_cols{0};
+            while (true)
+            {
+                T value;
+                const std::from_chars_result result{std::from_chars(p, end, value)};
+                if (result.ec != std::errc{})
+                    throw invalid_file_format<T>{};
+                elements.push_back(value);
+                row_cols++;
+                p = result.ptr;
+                skip_blanks();
+                if (p == end or *p == '\n')
+                    break;
+                if (delimiter != ' ')
+                {
+                    if (*p != delimiter)
+                        throw invalid_file_format<T>{};
+                    p++;
+                    skip_blanks();
+                }
+            }
+            if (rows == 0)
+                cols = row_cols;
+            else if (row_cols != cols)
+                throw invalid_file_format<T>{};
+            rows++;
+        }
+        return rows;
+    }
+
+    /**
+     * @brief A simple fork-join thread pool, used to parallelize the matrix operations. The thread calling parallel_for() also does its share of the work, so a pool with `n` threads has `n - 1` worker threads.
+     */
+    class thread_pool
     {
+    public:
+        /**
+         * @brief Construct a new thread pool.
+         *
+         * @param num_threads The total number of threads, including the calling thread. If zero, the number of hardware threads is used.
+         */
+        thread_pool(const size_t &num_threads = 0)
+        {
+            start_workers(num_threads);
+        }
+
+        /**
+         * @brief Destruct the thread pool, waiting for all of the worker threads to finish.
+         */
+        ~thread_pool()
+        {
+            stop_workers();
+        }
+
+        thread_pool(const thread_pool &) = delete;
+        thread_pool &operator=(const thread_pool &) = delete;
+
+        /**
+         * @brief Change the number of threads in the pool. Waits for any running parallel_for() to finish first.
+         *
+         * @param num_threads The total number of threads, including the calling thread. If zero, the number of hardware threads is used.
+         */
+        void set_num_threads(const size_t &num_threads)
+        {
+            const std::scoped_lock job_lock(job_mutex);
+            stop_workers();
+            start_workers(num_threads);
+        }
+
+        /**
+         * @brief Get the total number of threads, including the calling thread.
+         *
+         * @return The number of threads.
+         */
+        size_t get_num_threads() const
+        {
+            return total_threads;
+        }
+
+        /**
+         * @brief Split the range [`begin`, `end`) into contiguous chunks and call `f(chunk_begin, chunk_end)` for each chunk in parallel, returning once all of the chunks are done. The work is done serially in the calling thread if the range is too small to be split into chunks of at least `grain` indices, if there is only one thread, if the pool is already being used by another thread, or if called from within another parallel_for() (so nested parallelism cannot deadlock). Any exception thrown by `f` is rethrown in the calling thread.
+         *
+         * @param begin The first index in the range.
+         * @param end One past the last index in the range.
+         * @param grain The minimal number of indices in each chunk.
+         * @param f The function to call for each chunk.
+         */
+        template <typename F>
+        void parallel_for(const size_t &begin, const size_t &end, const size_t &grain, F &&f)
+        {
+            if (end <= begin)
+                return;
+            const size_t size{end - begin};
+            const size_t num_chunks{std::min(total_threads, size / std::max<size_t>(grain, 1))};
+            if (num_chunks <= 1 or inside_parallel_for)
+            {
+                f(begin, end);
+                return;
+            }
+            std::unique_lock job_lock(job_mutex, std::try_to_lock);
+            if (not job_lock.owns_lock())
+            {
+                f(begin, end);
+                return;
+            }
+            const auto run_chunk = [&](const size_t &chunk) { f(begin + ((size * chunk) / num_chunks), begin + ((size * (chunk + 1)) / num_chunks)); };
+            // Passing the lambda by reference means the std::function does not need to allocate memory to store it.
+            job current_job{std::ref(run_chunk), num_chunks};
+            {
+                const std::scoped_lock state_lock(state_mutex);
+                active_job = &current_job;
+                generation++;
+            }
+            work_available.notify_all();
+            inside_parallel_for = true;
+            work_on(current_job);
+            inside_parallel_for = false;
+            std::unique_lock state_lock(state_mutex);
+            job_done.wait(state_lock, [&] { return current_job.remaining == 0; });
+            active_job = nullptr;
+            job_done.wait(state_lock, [&] { return workers_in_job == 0; });
+            if (current_job.error)
+                std::rethrow_exception(current_job.error);
+        }
+
+        /**
+         * @brief Get the global thread pool used by all matrix operations.
+         *
+         * @return A reference to the global thread pool.
+         */
+        static thread_pool &global()
+        {
+            static thread_pool pool;
+            return pool;
+        }
+
+    private:
+        /**
+         * @brief A job submitted by parallel_for(), consisting of a number of chunks to be executed by any of the threads.
+         */
+        struct job
+        {
+            /**
+             * @brief The function to call for each chunk index.
+             */
+            std::function<void(const size_t &)> run_chunk;
+
+            /**
+             * @brief The number of chunks.
+             */
+            size_t num_chunks{0};
+
+            /**
+             * @brief The index of the next chunk to be executed.
+             */
+            std::atomic<size_t> next_chunk{0};
+
+            /**
+             * @brief The number of chunks that have not finished executing yet.
+             */
+            size_t remaining{0};
+
+            /**
+             * @brief The first exception thrown by any of the chunks, if any.
+             */
+            std::exception_ptr error{nullptr};
+
+            job(std::function<void(const size_t &)> input_run_chunk, const size_t &input_num_chunks)
+                : run_chunk(std::move(input_run_chunk)), num_chunks(input_num_chunks), remaining(input_num_chunks) {}
+        };
+
+        /**
+         * @brief Execute chunks of a job until there are none left.
+         *
+         * @param j The job.
+         */
+        void work_on(job &j)
+        {
+            for (size_t chunk{j.next_chunk++}; chunk < j.num_chunks; chunk = j.next_chunk++)
+            {
+                std::exception_ptr error{nullptr};
+                try
+                {
+                    j.run_chunk(chunk);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+                const std::scoped_lock state_lock(state_mutex);
+                if (error and not j.error)
+                    j.error = error;
+                if (--j.remaining == 0)
+                    job_done.notify_all();
+            }
+        }
+
+        /**
+         * @brief The function executed by each worker thread: wait for a new job, work on it, and repeat until the pool is stopped.
+         */
+        void worker()
+        {
+            inside_parallel_for = true;
+            size_t seen_generation{0};
+            std::unique_lock state_lock(state_mutex);
+            while (true)
+            {
+                work_available.wait(state_lock, [&] { return stopping or generation != seen_generation; });
+                if (stopping)
+                    return;
+                seen_generation = generation;
+                if (active_job == nullptr)
+                    continue;
+                job &j{*active_job};
+                workers_in_job++;
+                state_lock.unlock();
+                work_on(j);
+                state_lock.lock();
+                if (--workers_in_job == 0)
+                    job_done.notify_all();
+            }
+        }
+
+        /**
+         * @brief Start the worker threads.
+         *
+         * @param num_threads The total number of threads, including the calling thread. If zero, the number of hardware threads is used.
+         */
+        void start_workers(const size_t &num_threads)
+        {
+            total_threads = (num_threads == 0) ? std::max(1U, std::thread::hardware_concurrency()) : num_threads;
+            stopping = false;
+            for (size_t i{1}; i < total_threads; i++)
+                workers.emplace_back(&thread_pool::worker, this);
+        }
+
+        /**
+         * @brief Stop and join all of the worker threads.
+         */
+        void stop_workers()
+        {
+            {
+                const std::scoped_lock state_lock(state_mutex);
+                stopping = true;
+            }
+            work_available.notify_all();
+            for (std::thread &t : workers)
+                t.join();
+            workers.clear();
+        }
+
+        /**
+         * @brief The worker threads.
+         */
+        std::vector<std::thread> workers;
+
+        /**
+         * @brief The total number of threads, including the calling thread.
+         */
+        size_t total_threads{1};
+
+        /**
+         * @brief A mutex ensuring only one parallel_for() uses the pool at any given time.
+         */
+        std::mutex job_mutex;
+
+        /**
+         * @brief A mutex protecting the state shared between the calling thread and the worker threads.
+         */
+        std::mutex state_mutex;
+
+        /**
+         * @brief Used to notify the worker threads that a new job is available or that the pool is stopping.
+         */
+        std::condition_variable work_available;
+
+        /**
+         * @brief Used to notify the calling thread that all of the chunks are done, or that all of the worker threads have left the job.
+         */
+        std::condition_variable job_done;
+
+        /**
+         * @brief The job currently being executed, or `nullptr` if there is none.
+         */
+        job *active_job{nullptr};
+
+        /**
+         * @brief Incremented every time a new job is submitted.
+         */
+        size_t generation{0};
+
+        /**
+         * @brief The number of worker threads currently working on the active job.
+         */
+        size_t workers_in_job{0};
+
+        /**
+         * @brief Whether the worker threads should stop.
+         */
+        bool stopping{false};
+
+        /**
+         * @brief Whether the current thread is a worker thread or is executing a parallel_for(). Used to run nested calls to parallel_for() serially.
+         */
+        inline static thread_local bool inside_parallel_for{false};
     };
 
     /**
-     * @brief Exception to be thrown when multiplying two matrices if the number of columns in the first matrix is not the same as the number of rows in the second matrix.
+     * @brief The minimal number of elements in a matrix for which elementwise operations are parallelized. Smaller matrices are processed serially, so they do not pay the cost of dispatching work to the thread pool.
      */
-    class incompatible_sizes_multiply
+    inline constexpr size_t parallel_elementwise_threshold{1 << 16};
+
+    /**
+     * @brief The minimal number of elements processed by each thread in a parallelized elementwise operation.
+     */
+    inline constexpr size_t parallel_elementwise_grain{1 << 15};
+
+    /**
+     * @brief Call `f(begin, end)` on chunks of the range [0, `size`) of flattened element indices, in parallel using the global thread pool if `size` is at least parallel_elementwise_threshold, or serially in one chunk otherwise.
+     *
+     * @param size The number of elements.
+     * @param f The function to call for each chunk.
+     */
+    template <typename F>
+    void for_each_chunk(const size_t &size, F &&f)
+    {
+        if (size < parallel_elementwise_threshold)
+            f(size_t{0}, size);
+        else
+            thread_pool::global().parallel_for(0, size, parallel_elementwise_grain, f);
+    }
+
+    /**
+     * @brief Call `f(begin, end)` on chunks of the range [0, `rows`) of row indices of a matrix, in parallel using the global thread pool if the matrix has at least parallel_elementwise_threshold elements, or serially in one chunk otherwise.
+     *
+     * @param rows The number of rows.
+     * @param cols The number of columns.
+     * @param f The function to call for each chunk.
+     */
+    template <typename F>
+    void for_each_row_chunk(const size_t &rows, const size_t &cols, F &&f)
+    {
+        if (rows * cols < parallel_elementwise_threshold)
+            f(size_t{0}, rows);
+        else
+            thread_pool::global().parallel_for(0, rows, std::max<size_t>(1, parallel_elementwise_grain / cols), f);
+    }
+
+#if defined(MATRIX_INSTRUMENT)
+    // ===============
+    // Instrumentation
+    // ===============
+
+    /**
+     * @brief The operations recorded by the instrumentation layer. See matrix_instrumentation.
+     */
+    enum class operation : size_t
     {
+        multiply,
+        add,
+        subtract,
+        elementwise,
+        copy_construct,
+        copy_assign,
+        allocate,
+        count
     };
 
     /**
-     * @brief Exception to be thrown if the requested matrix element is out of range.
+     * @brief The names of the operations, in the same order as the operation enumeration, as they appear in matrix_instrumentation::record and matrix_instrumentation::dump().
      */
-    class index_out_of_range
+    inline constexpr const char *operation_names[]{"operator*", "operator+", "operator-", "elementwise", "copy constructor", "operator=", "allocation"};
+
+    /**
+     * @brief The number of size buckets per operation. An operation whose result has `n` elements is recorded in bucket `std::bit_width(n)`, so bucket `b` holds sizes from 2^(b-1) to 2^b - 1.
+     */
+    inline constexpr size_t instrumentation_buckets{65};
+
+    /**
+     * @brief The totals recorded for one operation and size bucket. Updated with relaxed atomic additions, so operations on different threads can be recorded concurrently.
+     */
+    struct instrumentation_counters
     {
+        std::atomic<uint64_t> calls{0}, bytes_allocated{0}, flops{0}, nanoseconds{0}, cycles{0}, instructions{0}, cache_misses{0};
     };
 
-private:
     /**
-     * @brief The number of rows.
+     * @brief The table of counters for all operations and size buckets.
      */
-    size_t rows{0};
+    inline instrumentation_counters instrumentation_table[static_cast<size_t>(operation::count)][instrumentation_buckets];
 
     /**
-     * @brief The number of columns.
+     * @brief Whether operations are currently being recorded. See matrix_instrumentation::set_enabled().
      */
-    size_t cols{0};
+    inline std::atomic<bool> instrumentation_enabled{true};
 
     /**
-     * @brief A pointer to an array storing the elements of the matrix in flattened 1-dimensional form.
+     * @brief Whether the hardware performance counters should be read. See matrix_instrumentation::enable_perf_counters().
      */
-    T *elements{nullptr};
+    inline std::atomic<bool> perf_counters_enabled{false};
 
     /**
-     * @brief A smart pointer to manage the memory allocated for the matrix elements.
+     * @brief The number of bytes allocated for matrix elements by the current thread so far, used to attribute allocations to the operations that caused them.
      */
-    std::unique_ptr<T[]> smart{nullptr};
+    inline thread_local uint64_t thread_bytes_allocated{0};
 
     /**
-     * @brief The character width of the matrix elements. Will be used in operator<<() by inserting std::setw into the output stream.
+     * @brief The hardware performance counters of the current thread: CPU cycles, instructions, and cache misses, in user space only. On Linux, they are opened using `perf_event_open()` the first time they are needed. On other systems, or if opening them fails (for example, because of the `perf_event_paranoid` setting), all of them read as zero.
      */
-    static int output_width;
-};
+    class perf_counters
+    {
+    public:
+        perf_counters()
+        {
+#if defined(__linux__)
+            const uint64_t configs[3]{PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+            for (size_t i{0}; i < 3; i++)
+            {
+                perf_event_attr attr{};
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.size = sizeof(attr);
+                attr.config = configs[i];
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            }
+#endif
+        }
 
-// Initialize output_width to have a default value of 5
-template <typename T>
-int matrix<T>::output_width{5};
+        perf_counters(const perf_counters &) = delete;
+        perf_counters &operator=(const perf_counters &) = delete;
+
+        ~perf_counters()
+        {
+#if defined(__linux__)
+            for (const int &fd : fds)
+                if (fd >= 0)
+                    close(fd);
+#endif
+        }
+
+        /**
+         * @brief Read the current values of the counters.
+         *
+         * @param values An array of three elements to store the number of cycles, instructions, and cache misses in.
+         */
+        void read_values(uint64_t *values) const
+        {
+            for (size_t i{0}; i < 3; i++)
+            {
+                values[i] = 0;
+#if defined(__linux__)
+                if (fds[i] >= 0 and read(fds[i], &values[i], sizeof(uint64_t)) != static_cast<ssize_t>(sizeof(uint64_t)))
+                    values[i] = 0;
+#endif
+            }
+        }
+
+        /**
+         * @brief Check whether all of the counters were opened successfully.
+         *
+         * @return true if the counters are available.
+         */
+        bool available() const
+        {
+            return fds[0] >= 0 and fds[1] >= 0 and fds[2] >= 0;
+        }
+
+        /**
+         * @brief Get the counters of the current thread, opening them if this is the first call on this thread.
+         *
+         * @return A reference to the counters.
+         */
+        static const perf_counters &this_thread()
+        {
+            static thread_local const perf_counters counters;
+            return counters;
+        }
+
+    private:
+        /**
+         * @brief The file descriptors of the counters, or -1 for counters that could not be opened.
+         */
+        int fds[3]{-1, -1, -1};
+    };
+
+    /**
+     * @brief Add a record of an operation to the table of counters.
+     *
+     * @param op The operation.
+     * @param elements The number of elements in the result, which selects the size bucket.
+     * @param bytes The number of bytes allocated.
+     * @param flops The number of arithmetic operations performed.
+     * @param nanoseconds The wall time taken.
+     * @param perf The number of cycles, instructions, and cache misses, or nullptr if they were not measured.
+     */
+    inline void record_operation(const operation op, const size_t elements, const uint64_t bytes, const uint64_t flops, const uint64_t nanoseconds, const uint64_t *perf)
+    {
+        instrumentation_counters &counters{instrumentation_table[static_cast<size_t>(op)][std::bit_width(elements)]};
+        counters.calls.fetch_add(1, std::memory_order_relaxed);
+        counters.bytes_allocated.fetch_add(bytes, std::memory_order_relaxed);
+        counters.flops.fetch_add(flops, std::memory_order_relaxed);
+        counters.nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+        if (perf)
+        {
+            counters.cycles.fetch_add(perf[0], std::memory_order_relaxed);
+            counters.instructions.fetch_add(perf[1], std::memory_order_relaxed);
+            counters.cache_misses.fetch_add(perf[2], std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Record an allocation of memory for matrix elements.
+     *
+     * @param elements The number of elements allocated.
+     * @param bytes The number of bytes allocated.
+     */
+    inline void record_allocation(const size_t elements, const uint64_t bytes)
+    {
+        thread_bytes_allocated += bytes;
+        if (instrumentation_enabled.load(std::memory_order_relaxed))
+            record_operation(operation::allocate, elements, bytes, 0, 0, nullptr);
+    }
+
+    /**
+     * @brief A scope guard that records the wall time, the memory allocated, and optionally the hardware performance counters of an operation, from its construction to its destruction. The measurements are inclusive: an operation that calls another operation, such as operator=() calling the copy constructor, includes the time of the inner operation.
+     */
+    class instrument_scope
+    {
+    public:
+        /**
+         * @brief Start recording an operation.
+         *
+         * @param input_op The operation.
+         * @param input_elements The number of elements in the result, which selects the size bucket.
+         * @param input_flops The number of arithmetic operations that the operation performs.
+         */
+        instrument_scope(const operation input_op, const size_t input_elements, const uint64_t input_flops)
+            : op(input_op), elements(input_elements), flops(input_flops), active(instrumentation_enabled.load(std::memory_order_relaxed))
+        {
+            if (not active)
+                return;
+            perf = perf_counters_enabled.load(std::memory_order_relaxed) and perf_counters::this_thread().available();
+            if (perf)
+                perf_counters::this_thread().read_values(perf_start);
+            bytes_start = thread_bytes_allocated;
+            time_start = std::chrono::steady_clock::now();
+        }
+
+        instrument_scope(const instrument_scope &) = delete;
+        instrument_scope &operator=(const instrument_scope &) = delete;
+
+        /**
+         * @brief Stop recording the operation, and add the measurements to the table of counters.
+         */
+        ~instrument_scope()
+        {
+            if (not active)
+                return;
+            const uint64_t nanoseconds{static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - time_start).count())};
+            uint64_t perf_delta[3];
+            if (perf)
+            {
+                perf_counters::this_thread().read_values(perf_delta);
+                for (size_t i{0}; i < 3; i++)
+                    perf_delta[i] -= perf_start[i];
+            }
+            record_operation(op, elements, thread_bytes_allocated - bytes_start, flops, nanoseconds, perf ? perf_delta : nullptr);
+        }
+
+    private:
+        operation op;
+        size_t elements;
+        uint64_t flops;
+        bool active;
+        bool perf{false};
+        uint64_t bytes_start{0};
+        uint64_t perf_start[3]{};
+        std::chrono::steady_clock::time_point time_start;
+    };
+
+    template <typename E, typename Op>
+    class unary_expression;
+
+    template <typename L, typename R, typename Op>
+    class binary_expression;
+
+    template <typename E, typename F>
+    class map_expression;
+
+    template <typename L, typename R, typename F>
+    class zip_expression;
+
+    struct add_op;
+    struct subtract_op;
+
+    /**
+     * @brief The number of arithmetic operations per element of an elementwise expression: one for each unary or binary operation it contains, counting each call of a function applied by map() or zip_with() as one operation.
+     */
+    template <typename E>
+    inline constexpr uint64_t expression_flops{0};
+
+    template <typename E, typename Op>
+    inline constexpr uint64_t expression_flops<unary_expression<E, Op>>{1 + expression_flops<E>};
+
+    template <typename L, typename R, typename Op>
+    inline constexpr uint64_t expression_flops<binary_expression<L, R, Op>>{1 + expression_flops<L> + expression_flops<R>};
+
+    template <typename E, typename F>
+    inline constexpr uint64_t expression_flops<map_expression<E, F>>{1 + expression_flops<E>};
+
+    template <typename L, typename R, typename F>
+    inline constexpr uint64_t expression_flops<zip_expression<L, R, F>>{1 + expression_flops<L> + expression_flops<R>};
+
+    /**
+     * @brief The operation under which the evaluation of an elementwise expression is recorded, determined by its outermost operation: operator+ for sums, operator- for differences, and elementwise for everything else.
+     */
+    template <typename E>
+    inline constexpr operation expression_operation{operation::elementwise};
+
+    template <typename L, typename R>
+    inline constexpr operation expression_operation<binary_expression<L, R, add_op>>{operation::add};
+
+    template <typename L, typename R>
+    inline constexpr operation expression_operation<binary_expression<L, R, subtract_op>>{operation::subtract};
+#endif
+
+    // =============
+    // SIMD packets
+    // =============
+
+    /**
+     * @brief A wrapper around the SIMD instructions of the target CPU, used to explicitly vectorize the elementwise operations. The instruction set is selected at compile time: AVX-512 if `__AVX512F__` is defined, otherwise AVX2 if `__AVX2__` is defined, otherwise NEON on 64-bit ARM. Compile with e.g. `-march=native` to enable them. Specializations are provided for `float`, `double`, and 32-bit and 64-bit integers; for all other types (or if no instruction set is available) `enabled` is false and the scalar code is used instead.
+     * @details Each specialization defines the packet type `type`, the number of elements in a packet `width`, and the functions `load()`, `store()` (both unaligned), `set1()` (broadcast a scalar), `add()`, `sub()`, `mul()`, and `neg()`. The floating-point specializations also define `div()` and set `has_div` to true. Every operation gives exactly the same result as the corresponding scalar operation.
+     *
+     * @tparam T The type of the elements.
+     */
+    template <typename T>
+    struct simd
+    {
+        static constexpr bool enabled{false};
+        static constexpr bool has_div{false};
+        static constexpr size_t width{1};
+    };
+
+#if defined(__AVX512F__)
+    template <>
+    struct simd<float>
+    {
+        using type = __m512;
+        static constexpr bool enabled{true};
+        static constexpr bool has_div{true};
+        static constexpr size_t width{16};
+        static inline type load(const float *p) { return _mm512_loadu_ps(p); }
+        static inline void store(float *p, const type &a) { _mm512_storeu_ps(p, a); }
+        static inline type set1(const float &s) { return _mm512_set1_ps(s); }
+        static inline type add(const type &a, const type &b) { return _mm512_add_ps(a, b); }
+        static inline type sub(const type &a, const type &b) { return _mm512_sub_ps(a, b); }
+        static inline type mul(const type &a, const type &b) { return _mm512_mul_ps(a, b); }
+        static inline type div(const type &a, const type &b) { return _mm512_div_ps(a, b); }
+        static inline type neg(const type &a) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_set1_epi32(INT32_MIN))); }
+    };
+
+    template <>
+    struct simd<double>
+    {
+        using type = __m512d;
+        static constexpr bool enabled{true};
+        static constexpr bool has_div{true};
+        static constexpr size_t width{8};
+        static inline type load(const double *p) { return _mm512_loadu_pd(p); }
+        static inline void store(double *p, const type &a) { _mm512_storeu_pd(p, a); }
+        static inline type set1(const double &s) { return _mm512_set1_pd(s); }
+        static inline type add(const type &a, const type &b) { return _mm512_add_pd(a, b); }
+        static inline type sub(const type &a, const type &b) { return _mm512_sub_pd(a, b); }
+        static inline type mul(const type &a, const type &b) { return _mm512_mul_pd(a, b); }
+        static inline type div(const type &a, const type &b) { return _mm512_div_pd(a, b); }
+        static inline type neg(const type &a) { return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), _mm512_set1_epi64(INT64_MIN))); }
+    };
+
+    template <typename T>
+        requires(std::is_integral_v<T> and sizeof(T) == 4)
+    struct simd<T>
+    {
+        using type = __m512i;
+        static constexpr bool enabled{true};
+        static constexpr bool has_div{false};
+        static constexpr size_t width{16};
+        static inline type load(const T *p) { return _mm512_loadu_si512(p); }
+        static inline void store(T *p, const type &a) { _mm512_storeu_si512(p, a); }
+        static inline type set1(const T &s) { return _mm512_set1_epi32(static_cast<int32_t>(s)); }
+        static inline type add(const type &a, const type &b) { return _mm512_add_epi32(a, b); }
+        static inline type sub(const type &a, const type &b) { return _mm512_sub_epi32(a, b); }
+        static inline type mul(const type &a, const type &b) { return _mm512_mullo_epi32(a, b); }
+        static inline type neg(const type &a) { return _mm512_sub_epi32(_mm512_setzero_si512(), a); }
+    };
+
+    template <typename T>
+        requires(std::is_integral_v<T> and sizeof(T) == 8)
+    struct simd<T>
+    {
+        using type = __m512i;
+        static constexpr bool enabled{true};
+        static constexpr bool has_div{false};
+        static constexpr size_t width{8};
+        static inline type load(const T *p) { return _mm512_loadu_si512(p); }
+        static inline void store(T *p, const type &a) { _mm512_storeu_si512(p, a); }
+        static inline type set1(const T &s) { return _mm512_set1_epi64(static_cast<int64_t>(s)); }
+        static inline type add(const type &a, const type &b) { return _mm512_add_epi64(a, b); }
+        static inline type sub(const type &a, const type &b) { return _mm512_sub_epi64(a, b); }
+        static inline type mul(const type &a, const type &b)
+        {
+#if defined(__AVX512DQ__)
+            return _mm512_mullo_epi64(a, b);
+#else
+            // Without AVX-512DQ there is no 64-bit multiplication, so combine three 32-bit multiplications (the product of the two high halves does not contribute to the low 64 bits).
+            const type cross{_mm512_add_epi64(_mm512_mul_epu32(_mm512_srli_epi64(a, 32), b), _mm512_mul_epu32(a, _mm512_srli_epi64(b, 32)))};
+            return _mm512_add_epi64(_mm512_mul_epu32(a, b), _mm512_slli_epi64(cross, 32));
+#endif
+        }
+        static inline type neg(const type &a) { return _mm512_sub_epi64(_mm512_setzero_si512(), a); }
+    };
+#elif defined(__AVX2__)
+    template <>
+    struct simd<float>
+    {
+        using type = __m256;
+        static constexpr bool enabled{true};
+        static constexpr bool has_div{true};
+        static constexpr size_t width{8};
+        static inline type load(const float *p) { return _mm256_loadu_ps(p); }
+        static inline void store(float *p, const type &a) { _mm256_storeu_ps(p, a); }
+        static inline type set1(const float &s) { return _mm256_set1_ps(s); }
+        static inline type add(const type &a, const type &b) { return _mm256_add_ps(a, b); }
+        static inline type sub(const type &a, const type &b) { return _mm256_sub_ps(a, b); }
+        static inline type mul(const type &a, const type &b) { return _mm256_mul_ps(a, b); }
+        static inline type div(const type &a, const type &b) { return _mm256_div_ps(a, b); }
+        static inline type neg(const type &a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+    };
+
+    template <>
+    struct simd<double>
+    {
+        using type = __m256d;
+        static constexpr bool enabled{true};
+        static constexpr bool has_div{true};
+        static constexpr size_t width{4};
+        static inline type load(const double *p) { return _mm256_loadu_pd(p); }
+        static inline void store(double *p, const type &a) { _mm256_storeu_pd(p, a); }
+        static inline type set1(const double &s) { return _mm256_set1_pd(s); }
+        static inline type add(const type &a, const type &b) { return _mm256_add_pd(a, b); }
+        static inline type sub(const type &a, const type &b) { return _mm256_sub_pd(a, b); }
+        static inline type mul(const type &a, const type &b) { return _mm256_mul_pd(a, b); }
+        static inline type div(const type &a, const type &b) { return _mm256_div_pd(a, b); }
+        static inline type neg(const type &a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+    };
+
+    template <typename T>
+        requires(std::is_integral_v<T> and sizeof(T) == 4)
+    struct simd<T>
+    {
+        using type = __m256i;
+        static constexpr bool enabled{true};
+        static constexpr bool has_div{false};
+        static constexpr size_t width{8};
+        static inline type load(const T *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+        static inline void store(T *p, const type &a) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), a); }
+        static inline type set1(const T &s) { return _mm256_set1_epi32(static_cast<int32_t>(s)); }
+        static inline type add(const type &a, const type &b) { return _mm256_add_epi32(a, b); }
+        static inline type sub(const type &a, const type &b) { return _mm256_sub_epi32(a, b); }
+        static inline type mul(const type &a, const type &b) { return _mm256_mullo_epi32(a, b); }
+        static inline type neg(const type &a) { return _mm256_sub_epi32(_mm256_setzero_si256(), a); }
+    };
+
+    template <typename T>
+        requires(std::is_integral_v<T> and sizeof(T) == 8)
+    struct simd<T>
+    {
+        using type = __m256i;
+        static constexpr bool enabled{true};
+        static constexpr bool has_div{false};
+        static constexpr size_t width{4};
+        static inline type load(const T *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+        static inline void store(T *p, const type &a) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), a); }
+        static inline type set1(const T &s) { return _mm256_set1_epi64x(static_cast<int64_t>(s)); }
+        static inline type add(const type &a, const type &b) { return _mm256_add_epi64(a, b); }
+        static inline type sub(const type &a, const type &b) { return _mm256_sub_epi64(a, b); }
+        static inline type mul(const type &a, const type &b)
+        {
+            // AVX2 has no 64-bit multiplication, so combine three 32-bit multiplications (the product of the two high halves does not contribute to the low 64 bits).
+            const type cross{_mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b), _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)))};
+            return _mm256_add_epi64(_mm256_mul_epu32(a, b), _mm256_slli_epi64(cross, 32));
+        }
+        static inline type neg(const type &a) { return _mm256_sub_epi64(_mm256_setzero_si256(), a); }
+    };
+#elif defined(__ARM_NEON) and defined(__aarch64__)
+    template <>
+    struct simd<float>
+    {
+        using type = float32x4_t;
+        static constexpr bool enabled{true};
+        static constexpr bool has_div{true};
+        static constexpr size_t width{4};
+        static inline type load(const float *p) { return vld1q_f32(p); }
+        static inline void store(float *p, const type &a) { vst1q_f32(p, a); }
+        static inline type set1(const float &s) { return vdupq_n_f32(s); }
+        static inline type add(const type &a, const type &b) { return vaddq_f32(a, b); }
+        static inline type sub(const type &a, const type &b) { return vsubq_f32(a, b); }
+        static inline type mul(const type &a, const type &b) { return vmulq_f32(a, b); }
+        static inline type div(const type &a, const type &b) { return vdivq_f32(a, b); }
+        static inline type neg(const type &a) { return vnegq_f32(a); }
+    };
+
+    template <>
+    struct simd<double>
+    {
+        using type = float64x2_t;
+        static constexpr bool enabled{true};
+        static constexpr bool has_div{true};
+        static constexpr size_t width{2};
+        static inline type load(const double *p) { return vld1q_f64(p); }
+        static inline void store(double *p, const type &a) { vst1q_f64(p, a); }
+        static inline type set1(const double &s) { return vdupq_n_f64(s); }
+        static inline type add(const type &a, const type &b) { return vaddq_f64(a, b); }
+        static inline type sub(const type &a, const type &b) { return vsubq_f64(a, b); }
+        static inline type mul(const type &a, const type &b) { return vmulq_f64(a, b); }
+        static inline type div(const type &a, const type &b) { return vdivq_f64(a, b); }
+        static inline type neg(const type &a) { return vnegq_f64(a); }
+    };
+
+    template <typename T>
+        requires(std::is_integral_v<T> and sizeof(T) == 4)
+    struct simd<T>
+    {
+        using type = int32x4_t;
+        static constexpr bool enabled{true};
+        static constexpr bool has_div{false};
+        static constexpr size_t width{4};
+        static inline type load(const T *p) { return vld1q_s32(reinterpret_cast<const int32_t *>(p)); }
+        static inline void store(T *p, const type &a) { vst1q_s32(reinterpret_cast<int32_t *>(p), a); }
+        static inline type set1(const T &s) { return vdupq_n_s32(static_cast<int32_t>(s)); }
+        static inline type add(const type &a, const type &b) { return vaddq_s32(a, b); }
+        static inline type sub(const type &a, const type &b) { return vsubq_s32(a, b); }
+        static inline type mul(const type &a, const type &b) { return vmulq_s32(a, b); }
+        static inline type neg(const type &a) { return vnegq_s32(a); }
+    };
+
+    template <typename T>
+        requires(std::is_integral_v<T> and sizeof(T) == 8)
+    struct simd<T>
+    {
+        using type = int64x2_t;
+        static constexpr bool enabled{true};
+        static constexpr bool has_div{false};
+        static constexpr size_t width{2};
+        static inline type load(const T *p) { return vld1q_s64(reinterpret_cast<const int64_t *>(p)); }
+        static inline void store(T *p, const type &a) { vst1q_s64(reinterpret_cast<int64_t *>(p), a); }
+        static inline type set1(const T &s) { return vdupq_n_s64(static_cast<int64_t>(s)); }
+        static inline type add(const type &a, const type &b) { return vaddq_s64(a, b); }
+        static inline type sub(const type &a, const type &b) { return vsubq_s64(a, b); }
+        // NEON has no 64-bit multiplication, so multiply each lane separately (using unsigned arithmetic to avoid overflow).
+        static inline type mul(const type &a, const type &b) { return vreinterpretq_s64_u64(vsetq_lane_u64(vgetq_lane_u64(vreinterpretq_u64_s64(a), 1) * vgetq_lane_u64(vreinterpretq_u64_s64(b), 1), vdupq_n_u64(vgetq_lane_u64(vreinterpretq_u64_s64(a), 0) * vgetq_lane_u64(vreinterpretq_u64_s64(b), 0)), 1)); }
+        static inline type neg(const type &a) { return vnegq_s64(a); }
+    };
+#endif
+
+    // ====================
+    // Expression templates
+    // ====================
+
+    /**
+     * @brief An empty base class for all elementwise matrix expressions, used to identify them.
+     */
+    struct expression_tag
+    {
+    };
+
+    template <typename E, typename F>
+    class map_expression;
+
+    /**
+     * @brief A base class for elementwise matrix expressions, which do not store their elements but compute them on demand. An expression is evaluated in a single fused loop when it is converted to or assigned to a matrix, so no temporary matrices are created for the intermediate results. Each derived class must define `value_type`, `get_rows()`, `get_cols()`, `operator()`, which returns the value of an element given its row and column, `rows_contiguous()`, which indicates whether all of the matrices in the expression store the elements of each row contiguously, and `contiguous(order)`, which indicates whether they all store their elements with no padding in the given layout. In that case, `operator[]`, which returns the value of an element given its index in flattened 1-dimensional form in that layout, may be used instead. It must also define `conflicts_with()`, which indicates whether writing the expression elementwise into the given view could overwrite elements of the expression before they are read. If `vectorizable` is true, it must also define two overloads of `packet()`, which return a SIMD packet of simd::width consecutive elements in the same row, starting at a given row and column or at a given flattened index; these may only be used if `rows_contiguous()` or `contiguous()`, respectively, is true.
+     * @details Expressions refer to the matrices they were built from, so they must not outlive them. In particular, when using `auto` to store an expression built from temporary matrices, use eval() to convert it to a matrix.
+     *
+     * @tparam E The derived class.
+     */
+    template <typename E>
+    struct expression_base : expression_tag
+    {
+        /**
+         * @brief Evaluate the expression into a new matrix.
+         *
+         * @return The evaluated matrix.
+         */
+        auto eval() const
+        {
+            return matrix<typename E::value_type>(static_cast<const E &>(*this));
+        }
+
+        /**
+         * @brief Apply a function to each element of the expression. The function is not applied immediately; instead, an expression is returned, so a chain such as `(a + b).map(f).map(g)` is evaluated in a single fused loop over the elements, split between threads for large matrices, when it is assigned to or converted to a matrix. See map_expression for the requirements on the function.
+         *
+         * @param f The function, taking one element and returning the new element, which may be of a different type.
+         * @return An expression for the result.
+         */
+        template <typename F>
+        auto map(const F &f) const
+        {
+            return map_expression<E, F>(static_cast<const E &>(*this), f);
+        }
+    };
+
+    /**
+     * @brief A trait to check whether a type is a specialization of the matrix class template.
+     */
+    template <typename M>
+    struct is_matrix : std::false_type
+    {
+    };
+
+    template <typename T, typename Allocator, layout Layout>
+    struct is_matrix<matrix<T, Allocator, Layout>> : std::true_type
+    {
+    };
+
+    /**
+     * @brief A trait to check whether a type is a specialization of the matrix_view class template.
+     */
+    template <typename M>
+    struct is_view : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct is_view<matrix_view<T>> : std::true_type
+    {
+    };
+
+    /**
+     * @brief A concept satisfied by elementwise matrix expressions (but not by matrices themselves).
+     */
+    template <typename E>
+    concept expression = std::derived_from<E, expression_tag>;
+
+    /**
+     * @brief A concept satisfied by matrices and elementwise matrix expressions, which may be used as operands of the elementwise operators.
+     */
+    template <typename E>
+    concept operand = expression<E> or is_matrix<E>::value;
+
+    /**
+     * @brief An expression applying a unary operation to each element of another expression.
+     *
+     * @tparam E The type of the operand.
+     * @tparam Op The type of the operation.
+     */
+    template <typename E, typename Op>
+    class unary_expression : public expression_base<unary_expression<E, Op>>
+    {
+    public:
+        using value_type = typename E::value_type;
+
+        static constexpr bool vectorizable{E::vectorizable and Op::template vectorizable<value_type>};
+
+        unary_expression(const E &input_operand, const Op &input_op)
+            : operand(input_operand), op(input_op) {}
+
+        inline size_t get_rows() const
+        {
+            return operand.get_rows();
+        }
+
+        inline size_t get_cols() const
+        {
+            return operand.get_cols();
+        }
+
+        inline bool rows_contiguous() const
+        {
+            return operand.rows_contiguous();
+        }
+
+        inline bool contiguous(const layout &order) const
+        {
+            return operand.contiguous(order);
+        }
+
+        inline bool conflicts_with(const matrix_view<const value_type> &target) const
+        {
+            return operand.conflicts_with(target);
+        }
+
+        inline value_type operator()(const size_t &row, const size_t &col) const
+        {
+            return op(operand(row, col));
+        }
+
+        inline value_type operator[](const size_t &i) const
+        {
+            return op(operand[i]);
+        }
+
+        inline auto packet(const size_t &row, const size_t &col) const
+        {
+            return op.template packet<simd<value_type>>(operand.packet(row, col));
+        }
+
+        inline auto packet(const size_t &i) const
+        {
+            return op.template packet<simd<value_type>>(operand.packet(i));
+        }
+
+    private:
+        E operand;
+        Op op;
+    };
+
+    /**
+     * @brief An expression applying a binary operation to each pair of corresponding elements of two other expressions of the same size.
+     *
+     * @tparam L The type of the left operand.
+     * @tparam R The type of the right operand.
+     * @tparam Op The type of the operation.
+     */
+    template <typename L, typename R, typename Op>
+    class binary_expression : public expression_base<binary_expression<L, R, Op>>
+    {
+    public:
+        using value_type = typename L::value_type;
+
+        static constexpr bool vectorizable{L::vectorizable and R::vectorizable and Op::template vectorizable<value_type>};
+
+        binary_expression(const L &input_left, const R &input_right, const Op &input_op)
+            : left(input_left), right(input_right), op(input_op) {}
+
+        inline size_t get_rows() const
+        {
+            return left.get_rows();
+        }
+
+        inline size_t get_cols() const
+        {
+            return left.get_cols();
+        }
+
+        inline bool rows_contiguous() const
+        {
+            return left.rows_contiguous() and right.rows_contiguous();
+        }
+
+        inline bool contiguous(const layout &order) const
+        {
+            return left.contiguous(order) and right.contiguous(order);
+        }
+
+        inline bool conflicts_with(const matrix_view<const value_type> &target) const
+        {
+            return left.conflicts_with(target) or right.conflicts_with(target);
+        }
+
+        inline value_type operator()(const size_t &row, const size_t &col) const
+        {
+            return op(left(row, col), right(row, col));
+        }
+
+        inline value_type operator[](const size_t &i) const
+        {
+            return op(left[i], right[i]);
+        }
+
+        inline auto packet(const size_t &row, const size_t &col) const
+        {
+            return op.template packet<simd<value_type>>(left.packet(row, col), right.packet(row, col));
+        }
+
+        inline auto packet(const size_t &i) const
+        {
+            return op.template packet<simd<value_type>>(left.packet(i), right.packet(i));
+        }
+
+    private:
+        L left;
+        R right;
+        Op op;
+    };
+
+    /**
+     * @brief The operation `a + b`.
+     */
+    struct add_op
+    {
+        template <typename T>
+        static constexpr bool vectorizable{simd<T>::enabled};
+
+        template <typename A, typename B>
+        inline auto operator()(const A &a, const B &b) const
+        {
+            return a + b;
+        }
+
+        template <typename S>
+        inline auto packet(const typename S::type &a, const typename S::type &b) const
+        {
+            return S::add(a, b);
+        }
+    };
+
+    /**
+     * @brief The operation `a - b`.
+     */
+    struct subtract_op
+    {
+        template <typename T>
+        static constexpr bool vectorizable{simd<T>::enabled};
+
+        template <typename A, typename B>
+        inline auto operator()(const A &a, const B &b) const
+        {
+            return a - b;
+        }
+
+        template <typename S>
+        inline auto packet(const typename S::type &a, const typename S::type &b) const
+        {
+            return S::sub(a, b);
+        }
+    };
+
+    /**
+     * @brief The operation `-a`.
+     */
+    struct negate_op
+    {
+        template <typename T>
+        static constexpr bool vectorizable{simd<T>::enabled};
+
+        template <typename A>
+        inline auto operator()(const A &a) const
+        {
+            return -a;
+        }
+
+        template <typename S>
+        inline auto packet(const typename S::type &a) const
+        {
+            return S::neg(a);
+        }
+    };
+
+    /**
+     * @brief The operation `s * a` for a fixed scalar `s`.
+     *
+     * @tparam T The type of the scalar.
+     */
+    template <typename T>
+    struct scale_op
+    {
+        T s;
+
+        template <typename U>
+        static constexpr bool vectorizable{simd<U>::enabled};
+
+        template <typename A>
+        inline auto operator()(const A &a) const
+        {
+            return s * a;
+        }
+
+        template <typename S>
+        inline auto packet(const typename S::type &a) const
+        {
+            return S::mul(S::set1(s), a);
+        }
+    };
+
+    /**
+     * @brief The operation `a / s` for a fixed scalar `s`.
+     *
+     * @tparam T The type of the scalar.
+     */
+    template <typename T>
+    struct divide_op
+    {
+        T s;
+
+        template <typename U>
+        static constexpr bool vectorizable{simd<U>::has_div};
+
+        template <typename A>
+        inline auto operator()(const A &a) const
+        {
+            return a / s;
+        }
+
+        template <typename S>
+        inline auto packet(const typename S::type &a) const
+        {
+            return S::div(a, S::set1(s));
+        }
+    };
+
+    /**
+     * @brief An expression applying a user-provided function to each element of another expression, created by map(). The type of the elements is the type returned by the function, which may differ from the type of the elements of the operand. The function is called once per element when the expression is evaluated, possibly concurrently from several threads and in any order, so it must not have side effects that depend on the order of the calls. It is not vectorized explicitly, but a simple inlined function is usually auto-vectorized by the compiler in the flat loop used for contiguous matrices.
+     *
+     * @tparam E The type of the operand.
+     * @tparam F The type of the function.
+     */
+    template <typename E, typename F>
+    class map_expression : public expression_base<map_expression<E, F>>
+    {
+    public:
+        using value_type = std::remove_cvref_t<std::invoke_result_t<const F &, typename E::value_type>>;
+
+        static constexpr bool vectorizable{false};
+
+        map_expression(const E &input_operand, const F &input_function)
+            : operand(input_operand), function(input_function) {}
+
+        inline size_t get_rows() const
+        {
+            return operand.get_rows();
+        }
+
+        inline size_t get_cols() const
+        {
+            return operand.get_cols();
+        }
+
+        inline bool rows_contiguous() const
+        {
+            return operand.rows_contiguous();
+        }
+
+        inline bool contiguous(const layout &order) const
+        {
+            return operand.contiguous(order);
+        }
+
+        inline bool conflicts_with(const matrix_view<const value_type> &target) const
+        {
+            if constexpr (std::same_as<typename E::value_type, value_type>)
+                return operand.conflicts_with(target);
+            else
+                return false;
+        }
+
+        inline value_type operator()(const size_t &row, const size_t &col) const
+        {
+            return function(operand(row, col));
+        }
+
+        inline value_type operator[](const size_t &i) const
+        {
+            return function(operand[i]);
+        }
+
+    private:
+        E operand;
+        F function;
+    };
+
+    /**
+     * @brief An expression applying a user-provided function to each pair of corresponding elements of two other expressions of the same size, created by zip_with(). As with map_expression, the type of the elements is the type returned by the function, and the operands may have different element types.
+     *
+     * @tparam L The type of the left operand.
+     * @tparam R The type of the right operand.
+     * @tparam F The type of the function.
+     */
+    template <typename L, typename R, typename F>
+    class zip_expression : public expression_base<zip_expression<L, R, F>>
+    {
+    public:
+        using value_type = std::remove_cvref_t<std::invoke_result_t<const F &, typename L::value_type, typename R::value_type>>;
+
+        static constexpr bool vectorizable{false};
+
+        zip_expression(const L &input_left, const R &input_right, const F &input_function)
+            : left(input_left), right(input_right), function(input_function) {}
+
+        inline size_t get_rows() const
+        {
+            return left.get_rows();
+        }
+
+        inline size_t get_cols() const
+        {
+            return left.get_cols();
+        }
+
+        inline bool rows_contiguous() const
+        {
+            return left.rows_contiguous() and right.rows_contiguous();
+        }
+
+        inline bool contiguous(const layout &order) const
+        {
+            return left.contiguous(order) and right.contiguous(order);
+        }
+
+        inline bool conflicts_with(const matrix_view<const value_type> &target) const
+        {
+            bool conflict{false};
+            if constexpr (std::same_as<typename L::value_type, value_type>)
+                conflict = left.conflicts_with(target);
+            if constexpr (std::same_as<typename R::value_type, value_type>)
+                conflict = conflict or right.conflicts_with(target);
+            return conflict;
+        }
+
+        inline value_type operator()(const size_t &row, const size_t &col) const
+        {
+            return function(left(row, col), right(row, col));
+        }
+
+        inline value_type operator[](const size_t &i) const
+        {
+            return function(left[i], right[i]);
+        }
+
+    private:
+        L left;
+        R right;
+        F function;
+    };
+
+    /**
+     * @brief Convert an operand of an elementwise operator to an expression: matrices are wrapped in a matrix_view, and expressions (including views) are returned as is.
+     *
+     * @param e The operand.
+     * @return The operand as an expression.
+     */
+    template <typename T, typename Allocator, layout Layout>
+    inline matrix_view<const T> as_expression(const matrix<T, Allocator, Layout> &m)
+    {
+        return matrix_view<const T>(m);
+    }
+
+    template <expression E>
+    inline const E &as_expression(const E &e)
+    {
+        return e;
+    }
+
+    /**
+     * @brief The type of an operand after conversion to an expression using as_expression().
+     */
+    template <typename E>
+    using expression_t = std::remove_cvref_t<decltype(as_expression(std::declval<const E &>()))>;
+
+    /**
+     * @brief The number of rows and columns in the tiles used by evaluate() when the expression and the array are not all stored in the same order.
+     */
+    inline constexpr size_t evaluate_tile{64};
+
+    /**
+     * @brief Evaluate an expression into an array of elements, in parallel for large matrices, and using SIMD packets if the expression is vectorizable. The array may be one of the matrices the expression refers to, since each element only depends on the corresponding elements of the operands.
+     * @details If neither the expression nor the array have any padding, and they are all stored in the same layout, all of the elements are evaluated in one flat loop. Otherwise, if the rows of the expression and the array are all stored contiguously, they are evaluated row by row. In any other case, for example when adding a row-major matrix to a column-major matrix, the elements are evaluated in square tiles, so that the operands that are read across their contiguous direction still use every element of each cache line they load. Within each tile, the elements are written in the order in which they are stored in the array. SIMD packets are only used for rows that are stored contiguously, both in the expression and in the array.
+     *
+     * @param e The expression.
+     * @param elements The array to store the elements in.
+     * @param stride The distance between consecutive rows in the array.
+     * @param col_stride The distance between consecutive columns in the array.
+     */
+#if defined(__GNUC__)
+// GCC cannot see that the packet loops are skipped for small matrices whose size is known at compile time, and issues false warnings about the stores.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Warray-bounds"
+#endif
+    template <typename E, typename T>
+    void evaluate(const E &e, T *elements, const size_t &stride, const size_t &col_stride = 1)
+    {
+        constexpr size_t width{simd<T>::width};
+        const size_t rows{e.get_rows()}, cols{e.get_cols()};
+        if ((stride == cols and col_stride == 1 and e.contiguous(layout::row_major)) or (stride == 1 and col_stride == rows and e.contiguous(layout::col_major)))
+            for_each_chunk(rows * cols, [&](const size_t &begin, const size_t &end)
+                           {
+                               size_t i{begin};
+                               if constexpr (E::vectorizable)
+                               {
+                                   const size_t num_packets{(end - begin) / width};
+                                   for (size_t p{0}; p < num_packets; p++, i += width)
+                                       simd<T>::store(elements + i, e.packet(i));
+                               }
+                               for (; i < end; i++)
+                                   elements[i] = e[i];
+                           });
+        else if (col_stride == 1 and e.rows_contiguous())
+            for_each_row_chunk(rows, cols, [&](const size_t &begin, const size_t &end)
+                               {
+                                   for (size_t row{begin}; row < end; row++)
+                                   {
+                                       T *row_elements{elements + (stride * row)};
+                                       size_t col{0};
+                                       if constexpr (E::vectorizable)
+                                       {
+                                           const size_t num_packets{cols / width};
+                                           for (size_t p{0}; p < num_packets; p++, col += width)
+                                               simd<T>::store(row_elements + col, e.packet(row, col));
+                                       }
+                                       for (; col < cols; col++)
+                                           row_elements[col] = e(row, col);
+                                   }
+                               });
+        else if (stride < col_stride)
+            // The columns of the array are contiguous, so each tile is written column by column, and the threads work on different columns of tiles.
+            for_each_row_chunk((cols + evaluate_tile - 1) / evaluate_tile, evaluate_tile * rows, [&](const size_t &begin, const size_t &end)
+                               {
+                                   for (size_t col_tile{begin * evaluate_tile}; col_tile < std::min(end * evaluate_tile, cols); col_tile += evaluate_tile)
+                                       for (size_t row_tile{0}; row_tile < rows; row_tile += evaluate_tile)
+                                           for (size_t col{col_tile}; col < std::min(col_tile + evaluate_tile, cols); col++)
+                                               for (size_t row{row_tile}; row < std::min(row_tile + evaluate_tile, rows); row++)
+                                                   elements[(stride * row) + (col_stride * col)] = e(row, col);
+                               });
+        else
+            for_each_row_chunk((rows + evaluate_tile - 1) / evaluate_tile, evaluate_tile * cols, [&](const size_t &begin, const size_t &end)
+                               {
+                                   for (size_t row_tile{begin * evaluate_tile}; row_tile < std::min(end * evaluate_tile, rows); row_tile += evaluate_tile)
+                                       for (size_t col_tile{0}; col_tile < cols; col_tile += evaluate_tile)
+                                           for (size_t row{row_tile}; row < std::min(row_tile + evaluate_tile, rows); row++)
+                                               for (size_t col{col_tile}; col < std::min(col_tile + evaluate_tile, cols); col++)
+                                                   elements[(stride * row) + (col_stride * col)] = e(row, col);
+                               });
+    }
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+
+    /**
+     * @brief Blocking parameters for the cache-blocked matrix multiplication kernel.
+     * @details The micro-kernel keeps an `mr` x `nr` tile of the product in registers. The `kc` x `nr` panels of the second matrix are sized to stay in the L1 cache, the `mc` x `kc` blocks of the first matrix to stay in the L2 cache, and the `kc` x `nc` blocks of the second matrix to stay in the L3 cache. For types that are not arithmetic, a small 4x4 tile is used.
+     *
+     * @tparam T The type of the matrix elements.
+     */
+    template <typename T>
+    struct gemm_blocking
+    {
+        /**
+         * @brief The assumed size of a SIMD register in bytes.
+         */
+#if defined(__AVX512F__)
+        static constexpr size_t simd_bytes{64};
+#elif defined(__AVX__)
+        static constexpr size_t simd_bytes{32};
+#else
+        static constexpr size_t simd_bytes{16};
+#endif
+
+        /**
+         * @brief The assumed sizes of the L1, L2, and L3 data caches in bytes.
+         */
+        static constexpr size_t l1_bytes{32 * 1024}, l2_bytes{256 * 1024}, l3_bytes{8 * 1024 * 1024};
+
+        /**
+         * @brief Whether the micro-kernel uses explicit SIMD vectors (through the GCC vector extensions) for this type. The compiler's auto-vectorizer does not reliably keep the register tile in registers, so this makes the performance of the kernel predictable.
+         */
+#if defined(__GNUC__)
+        static constexpr bool vectorized{std::is_arithmetic_v<T> and not std::is_same_v<T, bool> and sizeof(T) <= 8};
+#else
+        static constexpr bool vectorized{false};
+#endif
+
+        /**
+         * @brief The number of elements in one SIMD vector.
+         */
+        static constexpr size_t lanes{vectorized ? simd_bytes / sizeof(T) : 1};
+
+        /**
+         * @brief The number of rows in the register tile. With AVX-512 there are 32 vector registers, so the tile can be twice as tall as with 16 registers.
+         */
+        static constexpr size_t mr{vectorized ? (simd_bytes == 64 ? 12 : 6) : 4};
+
+        /**
+         * @brief The number of columns in the register tile: two SIMD vectors per row.
+         */
+        static constexpr size_t nr{vectorized ? 2 * lanes : 4};
+
+        /**
+         * @brief The depth of the panels, chosen so that one panel of each matrix fills 3/4 of the L1 cache.
+         */
+        static constexpr size_t kc{std::max<size_t>(16, ((3 * l1_bytes / 4) / ((mr + nr) * sizeof(T))) / 8 * 8)};
+
+        /**
+         * @brief The number of rows in a block of the first matrix, chosen to fill half of the L2 cache.
+         */
+        static constexpr size_t mc{std::max<size_t>(mr, ((l2_bytes / 2) / (kc * sizeof(T))) / mr * mr)};
+
+        /**
+         * @brief The number of columns in a block of the second matrix, chosen to fill half of the L3 cache.
+         */
+        static constexpr size_t nc{std::max<size_t>(nr, ((l3_bytes / 2) / (kc * sizeof(T))) / nr * nr)};
+    };
+
+    /**
+     * @brief Pack an `mc` x `kc` block of the first matrix into consecutive `mr`-row panels, stored column by column. Rows beyond the edge of the matrix are padded with zeros.
+     *
+     * @param a A pointer to the first element of the block.
+     * @param rsa The distance between consecutive rows of the first matrix.
+     * @param csa The distance between consecutive columns of the first matrix.
+     * @param mc The number of rows in the block.
+     * @param kc The number of columns in the block.
+     * @param buffer The buffer to pack into. Must have room for `mc` rounded up to a multiple of `mr`, times `kc`, elements. The elements are converted to the type of the buffer.
+     */
+    template <typename T, typename TA>
+    void gemm_pack_a(const TA *a, const size_t rsa, const size_t csa, const size_t mc, const size_t kc, T *buffer)
+    {
+        constexpr size_t mr{gemm_blocking<T>::mr};
+        for (size_t ir{0}; ir < mc; ir += mr)
+        {
+            const size_t m{std::min(mr, mc - ir)};
+            for (size_t k{0}; k < kc; k++)
+            {
+                for (size_t i{0}; i < m; i++)
+                    buffer[i] = static_cast<T>(a[((ir + i) * rsa) + (k * csa)]);
+                for (size_t i{m}; i < mr; i++)
+                    buffer[i] = 0;
+                buffer += mr;
+            }
+        }
+    }
+
+    /**
+     * @brief Pack a `kc` x `nc` block of the second matrix into consecutive `nr`-column panels, stored row by row. Columns beyond the edge of the matrix are padded with zeros.
+     *
+     * @param b A pointer to the first element of the block.
+     * @param rsb The distance between consecutive rows of the second matrix.
+     * @param csb The distance between consecutive columns of the second matrix.
+     * @param kc The number of rows in the block.
+     * @param nc The number of columns in the block.
+     * @param buffer The buffer to pack into. Must have room for `kc` times `nc` rounded up to a multiple of `nr` elements. The elements are converted to the type of the buffer.
+     */
+    template <typename T, typename TB>
+    void gemm_pack_b(const TB *b, const size_t rsb, const size_t csb, const size_t kc, const size_t nc, T *buffer)
+    {
+        constexpr size_t nr{gemm_blocking<T>::nr};
+        for (size_t jr{0}; jr < nc; jr += nr)
+        {
+            const size_t n{std::min(nr, nc - jr)};
+            for (size_t k{0}; k < kc; k++)
+            {
+                for (size_t j{0}; j < n; j++)
+                    buffer[j] = static_cast<T>(b[(k * rsb) + ((jr + j) * csb)]);
+                for (size_t j{n}; j < nr; j++)
+                    buffer[j] = 0;
+                buffer += nr;
+            }
+        }
+    }
+
+    /**
+     * @brief The register-tiled micro-kernel. Computes an `mr` x `nr` tile of the product from one packed panel of each matrix and adds it to a full tile of the result.
+     *
+     * @param kc The depth of the panels.
+     * @param ap The packed panel of the first matrix.
+     * @param bp The packed panel of the second matrix.
+     * @param c A pointer to the first element of the tile of the result.
+     * @param rsc The distance between consecutive rows of the result.
+     * @param csc The distance between consecutive columns of the result.
+     * @param first Whether this is the first panel, in which case the tile starts from zero instead of being loaded from the result.
+     */
+    template <typename T>
+    void gemm_micro_kernel(const size_t kc, const T *__restrict ap, const T *__restrict bp, T *__restrict c, const size_t rsc, const size_t csc, const bool first)
+    {
+        using blocking = gemm_blocking<T>;
+        constexpr size_t mr{blocking::mr};
+        constexpr size_t nr{blocking::nr};
+        // Each element of the tile is updated with one product at a time, in order of increasing k, so the result is exactly the same as for the naive triple loop.
+#if defined(__GNUC__)
+        if constexpr (blocking::vectorized)
+        {
+            constexpr size_t lanes{blocking::lanes};
+            constexpr size_t nv{nr / lanes};
+            typedef T vec __attribute__((vector_size(blocking::simd_bytes)));
+            vec acc[mr][nv];
+            for (size_t i{0}; i < mr; i++)
+                for (size_t v{0}; v < nv; v++)
+                {
+                    acc[i][v] = vec{};
+                    if (not first)
+                        for (size_t l{0}; l < lanes; l++)
+                            acc[i][v][l] = c[(i * rsc) + (((v * lanes) + l) * csc)];
+                }
+            for (size_t k{0}; k < kc; k++)
+            {
+                vec b[nv];
+                for (size_t v{0}; v < nv; v++)
+                    __builtin_memcpy(&b[v], bp + (v * lanes), sizeof(vec));
+                for (size_t i{0}; i < mr; i++)
+                    for (size_t v{0}; v < nv; v++)
+                        acc[i][v] += ap[i] * b[v];
+                ap += mr;
+                bp += nr;
+            }
+            for (size_t i{0}; i < mr; i++)
+                for (size_t v{0}; v < nv; v++)
+                    for (size_t l{0}; l < lanes; l++)
+                        c[(i * rsc) + (((v * lanes) + l) * csc)] = acc[i][v][l];
+            return;
+        }
+#endif
+        T acc[mr][nr];
+        for (size_t i{0}; i < mr; i++)
+            for (size_t j{0}; j < nr; j++)
+            {
+                if (first)
+                    acc[i][j] = 0;
+                else
+                    acc[i][j] = c[(i * rsc) + (j * csc)];
+            }
+        for (size_t k{0}; k < kc; k++)
+        {
+            for (size_t i{0}; i < mr; i++)
+                for (size_t j{0}; j < nr; j++)
+                    acc[i][j] += ap[i] * bp[j];
+            ap += mr;
+            bp += nr;
+        }
+        for (size_t i{0}; i < mr; i++)
+            for (size_t j{0}; j < nr; j++)
+                c[(i * rsc) + (j * csc)] = acc[i][j];
+    }
+
+    /**
+     * @brief The kernel used by gemm_blocked() to compute C = A B, where the elements of C have type T, and those of A and B have types TA and TB. By default, the elements of A and B are converted to T while they are packed, and then multiplied using gemm_micro_kernel() with the blocking parameters of gemm_blocking, so products of low-precision matrices are accumulated at the precision of T. Specializations for combinations of types which have dedicated dot-product instructions pack the elements without converting them, and use their own micro-kernels.
+     * @details Each kernel defines the types of the packed elements, `packed_a` and `packed_b`; the number of consecutive products summed by each dot-product instruction, `group`, to a multiple of which the depth of the packed panels is padded with zeros; the blocking parameters `mr`, `nr`, `kc`, `mc`, and `nc` (see gemm_blocking); and the functions `pack_a()`, `pack_b()`, and `micro_kernel()`, which take the same arguments as gemm_pack_a(), gemm_pack_b(), and gemm_micro_kernel().
+     *
+     * @tparam T The type of the elements of C, in which the products are accumulated.
+     * @tparam TA The type of the elements of A.
+     * @tparam TB The type of the elements of B.
+     */
+    template <typename T, typename TA, typename TB>
+    struct gemm_kernel
+    {
+        using blocking = gemm_blocking<T>;
+        using packed_a = T;
+        using packed_b = T;
+        static constexpr size_t group{1};
+        static constexpr size_t mr{blocking::mr}, nr{blocking::nr}, kc{blocking::kc}, mc{blocking::mc}, nc{blocking::nc};
+
+        static void pack_a(const TA *a, const size_t rsa, const size_t csa, const size_t rows, const size_t depth, T *buffer)
+        {
+            gemm_pack_a(a, rsa, csa, rows, depth, buffer);
+        }
+
+        static void pack_b(const TB *b, const size_t rsb, const size_t csb, const size_t depth, const size_t cols, T *buffer)
+        {
+            gemm_pack_b(b, rsb, csb, depth, cols, buffer);
+        }
+
+        static void micro_kernel(const size_t depth, const T *ap, const T *bp, T *c, const size_t rsc, const size_t csc, const bool first)
+        {
+            gemm_micro_kernel(depth, ap, bp, c, rsc, csc, first);
+        }
+    };
+
+#if defined(__AVX512BF16__) or defined(__AVX512VNNI__)
+    /**
+     * @brief Pack a block of a matrix for a micro-kernel based on dot-product instructions, which multiply and add `Group` consecutive elements along the depth of the product at once. The block is stored in consecutive `Rows`-row panels; within each panel, the elements are stored in groups of `Group` columns, and in each group, row by row, so that every row contributes `Group` consecutive elements. Rows beyond the edge of the block, and columns beyond the last group, are padded with zeros. To pack the second matrix, whose panels consist of columns, pass its transpose, by swapping the row and column distances.
+     *
+     * @tparam Rows The number of rows in each panel.
+     * @tparam Group The number of columns in each group.
+     * @param a A pointer to the first element of the block.
+     * @param rs The distance between consecutive rows.
+     * @param cs The distance between consecutive columns.
+     * @param rows The number of rows in the block.
+     * @param depth The number of columns in the block.
+     * @param buffer The buffer to pack into. Must have room for `rows` rounded up to a multiple of `Rows`, times `depth` rounded up to a multiple of `Group`, elements.
+     * @param convert A function used to convert each element to the type of the buffer. Zero is converted in the same way for the padding.
+     */
+    template <size_t Rows, size_t Group, typename T, typename P, typename F>
+    void gemm_pack_grouped(const T *a, const size_t rs, const size_t cs, const size_t rows, const size_t depth, P *buffer, const F &convert)
+    {
+        const P zero{convert(T{})};
+        for (size_t ir{0}; ir < rows; ir += Rows)
+        {
+            const size_t m{std::min(Rows, rows - ir)};
+            for (size_t k{0}; k < depth; k += Group)
+            {
+                const size_t g{std::min(Group, depth - k)};
+                for (size_t i{0}; i < Rows; i++)
+                    for (size_t t{0}; t < Group; t++)
+                        buffer[(i * Group) + t] = (i < m and t < g) ? convert(a[((ir + i) * rs) + ((k + t) * cs)]) : zero;
+                buffer += Rows * Group;
+            }
+        }
+    }
+
+    /**
+     * @brief Load an `Rows` x (`Vectors` times simd::width) tile of the result into SIMD registers, or set it to zero.
+     *
+     * @param acc The registers to load into.
+     * @param c A pointer to the first element of the tile.
+     * @param rsc The distance between consecutive rows of the result.
+     * @param csc The distance between consecutive columns of the result.
+     * @param first Whether to set the tile to zero instead of loading it.
+     */
+    template <typename T, size_t Rows, size_t Vectors>
+    void gemm_load_tile(typename simd<T>::type (&acc)[Rows][Vectors], const T *c, const size_t rsc, const size_t csc, const bool first)
+    {
+        constexpr size_t width{simd<T>::width};
+        for (size_t i{0}; i < Rows; i++)
+            for (size_t v{0}; v < Vectors; v++)
+            {
+                if (first)
+                    acc[i][v] = simd<T>::set1(T{0});
+                else if (csc == 1)
+                    acc[i][v] = simd<T>::load(c + (i * rsc) + (v * width));
+                else
+                {
+                    T elements[width];
+                    for (size_t l{0}; l < width; l++)
+                        elements[l] = c[(i * rsc) + (((v * width) + l) * csc)];
+                    acc[i][v] = simd<T>::load(elements);
+                }
+            }
+    }
+
+    /**
+     * @brief Store a tile of the result loaded by gemm_load_tile().
+     *
+     * @param acc The registers to store.
+     * @param c A pointer to the first element of the tile.
+     * @param rsc The distance between consecutive rows of the result.
+     * @param csc The distance between consecutive columns of the result.
+     */
+    template <typename T, size_t Rows, size_t Vectors>
+    void gemm_store_tile(const typename simd<T>::type (&acc)[Rows][Vectors], T *c, const size_t rsc, const size_t csc)
+    {
+        constexpr size_t width{simd<T>::width};
+        for (size_t i{0}; i < Rows; i++)
+            for (size_t v{0}; v < Vectors; v++)
+            {
+                if (csc == 1)
+                    simd<T>::store(c + (i * rsc) + (v * width), acc[i][v]);
+                else
+                {
+                    T elements[width];
+                    simd<T>::store(elements, acc[i][v]);
+                    for (size_t l{0}; l < width; l++)
+                        c[(i * rsc) + (((v * width) + l) * csc)] = elements[l];
+                }
+            }
+    }
+
+    /**
+     * @brief The blocking parameters of the dot-product kernels, which compute a 12 x 32 tile of the product in 24 of the 32 AVX-512 registers. The cache blocks are chosen as in gemm_blocking, but for the size of the packed elements.
+     *
+     * @tparam P The type of the packed elements.
+     */
+    template <typename P>
+    struct gemm_dot_blocking
+    {
+        static constexpr size_t mr{12}, nr{32};
+        static constexpr size_t kc{((3 * gemm_blocking<float>::l1_bytes / 4) / ((mr + nr) * sizeof(P))) / 8 * 8};
+        static constexpr size_t mc{((gemm_blocking<float>::l2_bytes / 2) / (kc * sizeof(P))) / mr * mr};
+        static constexpr size_t nc{((gemm_blocking<float>::l3_bytes / 2) / (kc * sizeof(P))) / nr * nr};
+    };
+#endif
+
+#if defined(__AVX512BF16__)
+    /**
+     * @brief A kernel for products of `bf16` matrices accumulated in `float`, using the AVX512-BF16 instruction `vdpbf16ps`, which multiplies pairs of `bf16` numbers and adds both products to a `float`. The elements are packed without conversion, so the kernel reads half as much memory as the `float` kernel.
+     */
+    template <>
+    struct gemm_kernel<float, bf16, bf16> : gemm_dot_blocking<bf16>
+    {
+        using packed_a = bf16;
+        using packed_b = bf16;
+        static constexpr size_t group{2};
+
+        static void pack_a(const bf16 *a, const size_t rsa, const size_t csa, const size_t rows, const size_t depth, bf16 *buffer)
+        {
+            gemm_pack_grouped<mr, group>(a, rsa, csa, rows, depth, buffer, [](const bf16 &x) { return x; });
+        }
+
+        static void pack_b(const bf16 *b, const size_t rsb, const size_t csb, const size_t depth, const size_t cols, bf16 *buffer)
+        {
+            gemm_pack_grouped<nr, group>(b, csb, rsb, cols, depth, buffer, [](const bf16 &x) { return x; });
+        }
+
+        static void micro_kernel(const size_t depth, const bf16 *__restrict ap, const bf16 *__restrict bp, float *__restrict c, const size_t rsc, const size_t csc, const bool first)
+        {
+            __m512 acc[mr][2];
+            gemm_load_tile(acc, c, rsc, csc, first);
+            for (size_t k{0}; k < depth; k += group)
+            {
+                const __m512bh b0{std::bit_cast<__m512bh>(_mm512_loadu_si512(bp))}, b1{std::bit_cast<__m512bh>(_mm512_loadu_si512(bp + 32))};
+                for (size_t i{0}; i < mr; i++)
+                {
+                    int32_t pair;
+                    __builtin_memcpy(&pair, ap + (i * group), sizeof(pair));
+                    const __m512bh a{std::bit_cast<__m512bh>(_mm512_set1_epi32(pair))};
+                    acc[i][0] = _mm512_dpbf16_ps(acc[i][0], a, b0);
+                    acc[i][1] = _mm512_dpbf16_ps(acc[i][1], a, b1);
+                }
+                ap += mr * group;
+                bp += nr * group;
+            }
+            gemm_store_tile(acc, c, rsc, csc);
+        }
+    };
+#endif
+
+#if defined(__AVX512VNNI__)
+    /**
+     * @brief A kernel for products of `int8_t` matrices accumulated in `int32_t`, using the AVX512-VNNI instruction `vpdpbusd`, which multiplies groups of four unsigned 8-bit integers by four signed 8-bit integers and adds the products to a 32-bit integer.
+     * @details Since the instruction requires one of the operands to be unsigned, the elements of A are packed as a + 128, and 128 times the sum of each column of the panel of B, computed using the same instruction with all of the elements of A replaced by 128, is subtracted from the result. All of the arithmetic wraps around modulo 2^32, so the result is exact, and the same as for the naive triple loop.
+     */
+    template <>
+    struct gemm_kernel<int32_t, int8_t, int8_t> : gemm_dot_blocking<int8_t>
+    {
+        using packed_a = uint8_t;
+        using packed_b = int8_t;
+        static constexpr size_t group{4};
+
+        static void pack_a(const int8_t *a, const size_t rsa, const size_t csa, const size_t rows, const size_t depth, uint8_t *buffer)
+        {
+            gemm_pack_grouped<mr, group>(a, rsa, csa, rows, depth, buffer, [](const int8_t &x) { return static_cast<uint8_t>(x + 128); });
+        }
+
+        static void pack_b(const int8_t *b, const size_t rsb, const size_t csb, const size_t depth, const size_t cols, int8_t *buffer)
+        {
+            gemm_pack_grouped<nr, group>(b, csb, rsb, cols, depth, buffer, [](const int8_t &x) { return x; });
+        }
+
+        static void micro_kernel(const size_t depth, const uint8_t *__restrict ap, const int8_t *__restrict bp, int32_t *__restrict c, const size_t rsc, const size_t csc, const bool first)
+        {
+            __m512i acc[mr][2];
+            gemm_load_tile(acc, c, rsc, csc, first);
+            const __m512i offset{_mm512_set1_epi8(static_cast<char>(128))};
+            __m512i sums[2]{_mm512_setzero_si512(), _mm512_setzero_si512()};
+            for (size_t k{0}; k < depth; k += group)
+            {
+                const __m512i b0{_mm512_loadu_si512(bp)}, b1{_mm512_loadu_si512(bp + 64)};
+                sums[0] = _mm512_dpbusd_epi32(sums[0], offset, b0);
+                sums[1] = _mm512_dpbusd_epi32(sums[1], offset, b1);
+                for (size_t i{0}; i < mr; i++)
+                {
+                    int32_t quad;
+                    __builtin_memcpy(&quad, ap + (i * group), sizeof(quad));
+                    const __m512i a{_mm512_set1_epi32(quad)};
+                    acc[i][0] = _mm512_dpbusd_epi32(acc[i][0], a, b0);
+                    acc[i][1] = _mm512_dpbusd_epi32(acc[i][1], a, b1);
+                }
+                ap += mr * group;
+                bp += nr * group;
+            }
+            for (size_t i{0}; i < mr; i++)
+                for (size_t v{0}; v < 2; v++)
+                    acc[i][v] = _mm512_sub_epi32(acc[i][v], sums[v]);
+            gemm_store_tile(acc, c, rsc, csc);
+        }
+    };
+#endif
+
+    /**
+     * @brief The micro-kernel for tiles on the bottom and right edges of the result, where only the top-left `m` x `n` part of the tile lies inside the matrix. The tile is computed in a temporary buffer using the micro-kernel of the gemm_kernel and then only the valid part is copied to the result.
+     *
+     * @tparam Kernel The gemm_kernel used for the product.
+     * @param m The number of valid rows in the tile.
+     * @param n The number of valid columns in the tile.
+     * @see gemm_micro_kernel() for a description of the other arguments.
+     */
+    template <typename Kernel, typename T>
+    void gemm_edge_kernel(const size_t kc, const typename Kernel::packed_a *ap, const typename Kernel::packed_b *bp, T *c, const size_t rsc, const size_t csc, const size_t m, const size_t n, const bool first)
+    {
+        constexpr size_t mr{Kernel::mr};
+        constexpr size_t nr{Kernel::nr};
+        T tile[mr * nr];
+        if (not first)
+            for (size_t i{0}; i < m; i++)
+                for (size_t j{0}; j < n; j++)
+                    tile[(i * nr) + j] = c[(i * rsc) + (j * csc)];
+        Kernel::micro_kernel(kc, ap, bp, tile, nr, 1, first);
+        for (size_t i{0}; i < m; i++)
+            for (size_t j{0}; j < n; j++)
+                c[(i * rsc) + (j * csc)] = tile[(i * nr) + j];
+    }
+
+    /**
+     * @brief The minimal value of m * n * k for which gemm_blocked() is parallelized.
+     */
+    inline constexpr size_t gemm_parallel_threshold{128 * 128 * 128};
+
+    /**
+     * @brief Get a buffer for packed blocks, owned by the calling thread and kept for later calls, so that gemm_blocked() does not allocate any memory once the buffers of each thread have grown to the largest block size (which is bounded by gemm_blocking).
+     *
+     * @tparam T The type of the elements.
+     * @tparam Index Which of the buffers of the thread to use: 0 for blocks of A, which are packed by every thread, and 1 for panels of B, which are packed once by the calling thread and shared.
+     * @param size The number of elements needed.
+     * @return A pointer to the first element of the buffer.
+     */
+    template <typename T, size_t Index>
+    T *gemm_buffer(const size_t &size)
+    {
+        thread_local std::vector<T, aligned_allocator<T>> buffer;
+        if (buffer.size() < size)
+            buffer.resize(size);
+        return buffer.data();
+    }
+
+    /**
+     * @brief Compute the matrix product C = A B using a cache-blocked algorithm with packed panels and a register-tiled micro-kernel. Each matrix is described by a pointer to its first element and the distances between consecutive rows and columns, so any row-major or column-major layout, or a part of a larger matrix, may be used. Large products are parallelized over blocks of rows of A, and if needed also over panels of columns of B, using the global thread pool.
+     *
+     * @param m The number of rows in A and C.
+     * @param n The number of columns in B and C.
+     * @param k The number of columns in A and rows in B. Must not be zero.
+     * @param a A pointer to the first element of A.
+     * @param rsa The distance between consecutive rows of A.
+     * @param csa The distance between consecutive columns of A.
+     * @param b A pointer to the first element of B.
+     * @param rsb The distance between consecutive rows of B.
+     * @param csb The distance between consecutive columns of B.
+     * @param c A pointer to the first element of C. Must not overlap with A or B.
+     * @param rsc The distance between consecutive rows of C.
+     * @param csc The distance between consecutive columns of C.
+     * @param accumulate Whether to add the product to the existing elements of C, computing C += A B, instead of overwriting them.
+     * @see gemm_kernel for products where the elements of A and B have a different type than those of C.
+     */
+    template <typename T, typename TA, typename TB>
+    void gemm_blocked(const size_t m, const size_t n, const size_t k, const TA *a, const size_t rsa, const size_t csa, const TB *b, const size_t rsb, const size_t csb, T *c, const size_t rsc, const size_t csc, const bool accumulate = false)
+    {
+        using kernel = gemm_kernel<T, TA, TB>;
+        constexpr size_t mr{kernel::mr}, nr{kernel::nr}, kc{kernel::kc}, nc{kernel::nc};
+        thread_pool &pool{thread_pool::global()};
+        const bool parallel{m * n * k >= gemm_parallel_threshold and pool.get_num_threads() > 1};
+        const size_t num_threads{parallel ? pool.get_num_threads() : 1};
+        // Make the blocks of A smaller if needed, so that there are enough of them for all of the threads.
+        const size_t mc{std::min(kernel::mc, std::max(mr, (((m + num_threads - 1) / num_threads) + mr - 1) / mr * mr))};
+        const size_t m_blocks{(m + mc - 1) / mc};
+        // If there are still not enough blocks of A, also split the columns of each block of B between the threads.
+        const size_t n_splits{std::max<size_t>(1, num_threads / m_blocks)};
+        typename kernel::packed_b *b_packed{gemm_buffer<typename kernel::packed_b, 1>(kc * (std::min(nc, ((n + nr - 1) / nr) * nr)))};
+        for (size_t jc{0}; jc < n; jc += nc)
+        {
+            const size_t nb{std::min(nc, n - jc)};
+            const size_t n_panels{(nb + nr - 1) / nr};
+            for (size_t pc{0}; pc < k; pc += kc)
+            {
+                const size_t kb{std::min(kc, k - pc)};
+                // The depth of the packed panels, which the kernel may pad to a multiple of the number of products in each of its dot-product instructions.
+                const size_t kp{(kb + kernel::group - 1) / kernel::group * kernel::group};
+                const auto pack_b_panels = [&](const size_t &panel_begin, const size_t &panel_end)
+                {
+                    const size_t j_begin{panel_begin * nr}, j_end{std::min(nb, panel_end * nr)};
+                    kernel::pack_b(b + (pc * rsb) + ((jc + j_begin) * csb), rsb, csb, kb, j_end - j_begin, b_packed + (j_begin * kp));
+                };
+                const auto multiply_blocks = [&](const size_t &task_begin, const size_t &task_end)
+                {
+                    typename kernel::packed_a *a_packed{gemm_buffer<typename kernel::packed_a, 0>(mc * kc)};
+                    size_t packed_block{m_blocks};
+                    for (size_t task{task_begin}; task < task_end; task++)
+                    {
+                        const size_t block{task / n_splits}, split{task % n_splits};
+                        const size_t ic{block * mc};
+                        const size_t mb{std::min(mc, m - ic)};
+                        if (packed_block != block)
+                        {
+                            kernel::pack_a(a + (ic * rsa) + (pc * csa), rsa, csa, mb, kb, a_packed);
+                            packed_block = block;
+                        }
+                        const size_t jr_begin{((n_panels * split) / n_splits) * nr}, jr_end{std::min(nb, ((n_panels * (split + 1)) / n_splits) * nr)};
+                        for (size_t jr{jr_begin}; jr < jr_end; jr += nr)
+                            for (size_t ir{0}; ir < mb; ir += mr)
+                            {
+                                T *c_tile{c + ((ic + ir) * rsc) + ((jc + jr) * csc)};
+                                if (ir + mr <= mb and jr + nr <= nb)
+                                    kernel::micro_kernel(kb, a_packed + (ir * kp), b_packed + (jr * kp), c_tile, rsc, csc, pc == 0 and not accumulate);
+                                else
+                                    gemm_edge_kernel<kernel>(kb, a_packed + (ir * kp), b_packed + (jr * kp), c_tile, rsc, csc, std::min(mr, mb - ir), std::min(nr, nb - jr), pc == 0 and not accumulate);
+                            }
+                    }
+                };
+                if (parallel)
+                {
+                    pool.parallel_for(0, n_panels, 1, pack_b_panels);
+                    pool.parallel_for(0, m_blocks * n_splits, 1, multiply_blocks);
+                }
+                else
+                {
+                    pack_b_panels(0, n_panels);
+                    multiply_blocks(0, m_blocks * n_splits);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Compute the matrix product C = A B using a simple i-k-j loop, which accesses all three matrices contiguously if they are row-major. Used for small products, where packing would cost more than it saves. Gives exactly the same result as gemm_blocked().
+     *
+     * @param m The number of rows in A and C.
+     * @param n The number of columns in B and C.
+     * @param k The number of columns in A and rows in B.
+     * @param a A pointer to the first element of A.
+     * @param rsa The distance between consecutive rows of A.
+     * @param csa The distance between consecutive columns of A.
+     * @param b A pointer to the first element of B.
+     * @param rsb The distance between consecutive rows of B.
+     * @param csb The distance between consecutive columns of B.
+     * @param c A pointer to the first element of C. Must not overlap with A or B.
+     * @param rsc The distance between consecutive rows of C.
+     * @param csc The distance between consecutive columns of C.
+     * @param accumulate Whether to add the product to the existing elements of C, computing C += A B, instead of overwriting them.
+     */
+    template <typename T, typename TA, typename TB>
+    void gemm_small(const size_t m, const size_t n, const size_t k, const TA *a, const size_t rsa, const size_t csa, const TB *b, const size_t rsb, const size_t csb, T *c, const size_t rsc, const size_t csc, const bool accumulate = false)
+    {
+        for (size_t i{0}; i < m; i++)
+        {
+            if (not accumulate)
+                for (size_t j{0}; j < n; j++)
+                    c[(i * rsc) + (j * csc)] = 0;
+            for (size_t p{0}; p < k; p++)
+            {
+                const T aip{static_cast<T>(a[(i * rsa) + (p * csa)])};
+                for (size_t j{0}; j < n; j++)
+                    c[(i * rsc) + (j * csc)] += aip * static_cast<T>(b[(p * rsb) + (j * csb)]);
+            }
+        }
+    }
+
+#if defined(MATRIX_USE_BLAS)
+    // ============
+    // BLAS backend
+    // ============
+
+    /**
+     * @brief Whether operations on matrices with elements of type T can be performed by the BLAS library, which is the case for `float` and `double`.
+     */
+    template <typename T>
+    inline constexpr bool blas_type{std::same_as<T, float> or std::same_as<T, double>};
+
+    /**
+     * @brief The minimal value of m * n * k for which gemm() calls the BLAS library. Smaller products are computed by the built-in kernels, which avoid the overhead of the library call. Can be changed at runtime using matrix::set_blas_thresholds().
+     */
+    inline size_t blas_gemm_threshold{32 * 32 * 32};
+
+    /**
+     * @brief The minimal number of elements for which in-place elementwise operations (`+=`, `-=`, add_scaled(), and `*=` by a scalar) call the BLAS library. Can be changed at runtime using matrix::set_blas_thresholds().
+     */
+    inline size_t blas_vector_threshold{1 << 14};
+
+    /**
+     * @brief Find the storage order of a matrix for BLAS, which only supports matrices whose rows or columns are contiguous.
+     *
+     * @param rs The distance between consecutive rows.
+     * @param cs The distance between consecutive columns.
+     * @param rows The number of rows.
+     * @param cols The number of columns.
+     * @param trans Set to CblasNoTrans if the rows are contiguous, or CblasTrans if the columns are contiguous.
+     * @param ld Set to the leading dimension.
+     * @return false if neither the rows nor the columns are contiguous, or the leading dimension is not supported.
+     */
+    inline bool blas_layout(const size_t rs, const size_t cs, const size_t rows, const size_t cols, CBLAS_TRANSPOSE &trans, size_t &ld)
+    {
+        if (cs == 1 and rs >= std::max<size_t>(1, cols))
+        {
+            trans = CblasNoTrans;
+            ld = rs;
+        }
+        else if (rs == 1 and cs >= std::max<size_t>(1, rows))
+        {
+            trans = CblasTrans;
+            ld = cs;
+        }
+        else
+            return false;
+        return ld <= INT_MAX;
+    }
+
+    /**
+     * @brief Compute the matrix product C = A B (or C += A B if `accumulate` is true) by calling `sgemm` or `dgemm` from the BLAS library. See gemm_blocked() for a description of the arguments.
+     *
+     * @return false if the product was not computed, because T is not supported, or the layout of one of the matrices is not supported, or the product is too small.
+     */
+    template <typename T>
+    bool blas_gemm(const size_t m, const size_t n, const size_t k, const T *a, const size_t rsa, const size_t csa, const T *b, const size_t rsb, const size_t csb, T *c, const size_t rsc, const size_t csc, const bool accumulate)
+    {
+        if constexpr (blas_type<T>)
+        {
+            if (m * n * k < blas_gemm_threshold or m > INT_MAX or n > INT_MAX or k > INT_MAX)
+                return false;
+            // BLAS requires C to be row-major here, so if it is column-major we compute C^T = B^T A^T instead.
+            if (csc != 1)
+                return rsc == 1 and blas_gemm(n, m, k, b, csb, rsb, a, csa, rsa, c, csc, rsc, accumulate);
+            CBLAS_TRANSPOSE trans_a, trans_b;
+            size_t lda, ldb;
+            if (rsc < n or rsc > INT_MAX or not blas_layout(rsa, csa, m, k, trans_a, lda) or not blas_layout(rsb, csb, k, n, trans_b, ldb))
+                return false;
+            const T beta{accumulate ? T{1} : T{0}};
+            if constexpr (std::same_as<T, float>)
+                cblas_sgemm(CblasRowMajor, trans_a, trans_b, static_cast<int>(m), static_cast<int>(n), static_cast<int>(k), 1.0f, a, static_cast<int>(lda), b, static_cast<int>(ldb), beta, c, static_cast<int>(rsc));
+            else
+                cblas_dgemm(CblasRowMajor, trans_a, trans_b, static_cast<int>(m), static_cast<int>(n), static_cast<int>(k), 1.0, a, static_cast<int>(lda), b, static_cast<int>(ldb), beta, c, static_cast<int>(rsc));
+            return true;
+        }
+        else
+            return false;
+    }
+
+    /**
+     * @brief Compute y = alpha x + y for n contiguous elements by calling `saxpy` or `daxpy` from the BLAS library. Large arrays are split into several calls so that the number of elements in each call fits in an `int`.
+     *
+     * @param n The number of elements.
+     * @param alpha The scalar.
+     * @param x A pointer to the first element of x. Must not overlap with y.
+     * @param y A pointer to the first element of y.
+     */
+    template <typename T>
+        requires blas_type<T>
+    void blas_axpy(const size_t n, const T alpha, const T *x, T *y)
+    {
+        for (size_t i{0}; i < n; i += INT_MAX)
+        {
+            const int count{static_cast<int>(std::min<size_t>(n - i, INT_MAX))};
+            if constexpr (std::same_as<T, float>)
+                cblas_saxpy(count, alpha, x + i, 1, y + i, 1);
+            else
+                cblas_daxpy(count, alpha, x + i, 1, y + i, 1);
+        }
+    }
+
+    /**
+     * @brief Compute x = alpha x for n contiguous elements by calling `sscal` or `dscal` from the BLAS library.
+     *
+     * @param n The number of elements.
+     * @param alpha The scalar.
+     * @param x A pointer to the first element of x.
+     */
+    template <typename T>
+        requires blas_type<T>
+    void blas_scal(const size_t n, const T alpha, T *x)
+    {
+        for (size_t i{0}; i < n; i += INT_MAX)
+        {
+            const int count{static_cast<int>(std::min<size_t>(n - i, INT_MAX))};
+            if constexpr (std::same_as<T, float>)
+                cblas_sscal(count, alpha, x + i, 1);
+            else
+                cblas_dscal(count, alpha, x + i, 1);
+        }
+    }
+#endif
+
+    /**
+     * @brief The minimal value of m * n * k for which gemm() uses the blocked algorithm.
+     */
+    inline constexpr size_t gemm_blocked_threshold{48 * 48 * 48};
+
+    /**
+     * @brief Compute the matrix product C = A B (or C += A B if `accumulate` is true), using either gemm_small() or gemm_blocked() depending on the size of the product. See gemm_blocked() for a description of the arguments. If `MATRIX_USE_BLAS` is defined, products of `float` or `double` matrices with at least blas_gemm_threshold multiplications are computed by the BLAS library instead. The elements of A and B may have a different type than those of C, in which case they are converted to the type of C before they are multiplied, and the BLAS library is not used.
+     */
+    template <typename T, typename TA, typename TB>
+    void gemm(const size_t m, const size_t n, const size_t k, const TA *a, const size_t rsa, const size_t csa, const TB *b, const size_t rsb, const size_t csb, T *c, const size_t rsc, const size_t csc, const bool accumulate = false)
+    {
+#if defined(MATRIX_USE_BLAS)
+        if constexpr (std::same_as<TA, T> and std::same_as<TB, T>)
+            if (blas_gemm(m, n, k, a, rsa, csa, b, rsb, csb, c, rsc, csc, accumulate))
+                return;
+#endif
+        if (m * n * k < gemm_blocked_threshold)
+            gemm_small(m, n, k, a, rsa, csa, b, rsb, csb, c, rsc, csc, accumulate);
+        else
+            gemm_blocked(m, n, k, a, rsa, csa, b, rsb, csb, c, rsc, csc, accumulate);
+    }
+
+    /**
+     * @brief Compute the product C = A B of matrix views using gemm(), which reads and writes the elements directly through the strides of the views, so no copies are made even for blocks or transposed views. The sizes of the views must be compatible.
+     *
+     * @param a The view of A.
+     * @param b The view of B.
+     * @param c The view of C. Must not overlap with A or B.
+     * @param accumulate Whether to compute C += A B instead of C = A B.
+     */
+    template <typename T>
+    void gemm(const matrix_view<const T> &a, const matrix_view<const T> &b, const matrix_view<T> &c, const bool accumulate = false)
+    {
+        gemm(a.get_rows(), b.get_cols(), a.get_cols(), a.data(), a.get_row_stride(), a.get_col_stride(), b.data(), b.get_row_stride(), b.get_col_stride(), c.data(), c.get_row_stride(), c.get_col_stride(), accumulate);
+    }
+
+    /**
+     * @brief Check whether two views may refer to any of the same elements, by comparing the ranges of memory between their first and last elements. Unlike matrix_view::conflicts_with(), two views of exactly the same elements also count as overlapping, since gemm() cannot write into one of its inputs even then.
+     *
+     * @param a The first view.
+     * @param b The second view.
+     * @return Whether the views overlap.
+     */
+    template <typename T>
+    bool overlaps(const matrix_view<const T> &a, const matrix_view<const T> &b)
+    {
+        if (a.get_rows() == 0 or a.get_cols() == 0 or b.get_rows() == 0 or b.get_cols() == 0)
+            return false;
+        const std::less<const T *> less;
+        const T *a_last{a.data() + (a.get_row_stride() * (a.get_rows() - 1)) + (a.get_col_stride() * (a.get_cols() - 1))};
+        const T *b_last{b.data() + (b.get_row_stride() * (b.get_rows() - 1)) + (b.get_col_stride() * (b.get_cols() - 1))};
+        return not(less(a_last, b.data()) or less(b_last, a.data()));
+    }
+
+    /**
+     * @brief Multiply two matrix views using gemm().
+     *
+     * @param a The first view to be multiplied.
+     * @param b The second view to be multiplied.
+     * @return The product of the views.
+     * @throws incompatible_sizes_multiply if the number of columns in the first view is not the same as the number of rows in the second view.
+     */
+    template <typename T>
+    matrix<T> multiply(const matrix_view<const T> &a, const matrix_view<const T> &b)
+    {
+        if (a.get_cols() != b.get_rows())
+            throw incompatible_sizes_multiply<T>{};
+#if defined(MATRIX_INSTRUMENT)
+        const instrument_scope scope{operation::multiply, a.get_rows() * b.get_cols(), 2 * static_cast<uint64_t>(a.get_rows()) * a.get_cols() * b.get_cols()};
+#endif
+        matrix<T> c(a.get_rows(), b.get_cols());
+        gemm(a, b, matrix_view<T>(c));
+        return c;
+    }
+
+    // ==========
+    // Reductions
+    // ==========
+
+    /**
+     * @brief The number of elements reduced in each block. A reduction is split into blocks of (about) this many elements in a way that depends only on the size and layout of the data, and the results of the blocks are combined in the same order regardless of how many threads computed them, so the result is the same for any number of threads.
+     */
+    inline constexpr size_t reduction_block{1 << 13};
+
+    /**
+     * @brief A running sum, used by reductions with summation::fast. Terms are simply added to it.
+     *
+     * @tparam T The type of the elements.
+     */
+    template <typename T>
+    struct plain_sum
+    {
+        static constexpr bool compensated{false};
+        T sum{0};
+
+        void add(const T &x)
+        {
+            sum += x;
+        }
+
+        void merge(const plain_sum &other)
+        {
+            sum += other.sum;
+        }
+
+        T result() const
+        {
+            return sum;
+        }
+    };
+
+    /**
+     * @brief A running sum with Kahan compensation, used by reductions with summation::kahan. The low-order bits lost when adding a term are kept in `compensation` and taken into account when adding the next term, so the error does not grow with the number of terms. Only used for floating-point types, and requires the compiler not to reassociate floating-point operations (so it does not work with `-ffast-math`).
+     *
+     * @tparam T The type of the elements.
+     */
+    template <typename T>
+    struct kahan_sum
+    {
+        static constexpr bool compensated{true};
+        T sum{0}, compensation{0};
+
+        void add(const T &x)
+        {
+            const T y{x - compensation};
+            const T t{sum + y};
+            compensation = (t - sum) - y;
+            sum = t;
+        }
+
+        void merge(const kahan_sum &other)
+        {
+            add(other.sum);
+            add(-other.compensation);
+        }
+
+        T result() const
+        {
+            return sum - compensation;
+        }
+    };
+
+    /**
+     * @brief The running sum used for a reduction: Kahan summation if requested and `T` is a floating-point type, simple summation otherwise.
+     */
+    template <bool Kahan, typename T>
+    using reduction_sum = std::conditional_t<Kahan and std::is_floating_point_v<T>, kahan_sum<T>, plain_sum<T>>;
+
+    /**
+     * @brief The terms of sum(): the elements themselves.
+     */
+    struct element_term
+    {
+        template <typename T>
+        static T scalar(const T *a, const T *)
+        {
+            return *a;
+        }
+
+        template <typename P, typename T>
+        static typename P::type packet(const T *a, const T *)
+        {
+            return P::load(a);
+        }
+    };
+
+    /**
+     * @brief The terms of frobenius_norm(): the squares of the elements.
+     */
+    struct square_term
+    {
+        template <typename T>
+        static T scalar(const T *a, const T *)
+        {
+            return *a * *a;
+        }
+
+        template <typename P, typename T>
+        static typename P::type packet(const T *a, const T *)
+        {
+            const typename P::type x{P::load(a)};
+            return P::mul(x, x);
+        }
+    };
+
+    /**
+     * @brief The terms of dot(): the products of the corresponding elements of two arrays.
+     */
+    struct product_term
+    {
+        template <typename T>
+        static T scalar(const T *a, const T *b)
+        {
+            return *a * *b;
+        }
+
+        template <typename P, typename T>
+        static typename P::type packet(const T *a, const T *b)
+        {
+            return P::mul(P::load(a), P::load(b));
+        }
+    };
+
+    /**
+     * @brief Add the terms of one line of a reduction to a running sum. If both lines are contiguous and SIMD packets are available, four independent accumulators (each with its own compensation, for Kahan summation) are used, so that consecutive additions do not wait for each other; they are added to the running sum at the end of the line.
+     *
+     * @tparam Term The terms to add: element_term, square_term, or product_term.
+     * @param a A pointer to the first element of the line.
+     * @param b A pointer to the first element of the corresponding line of the second operand, only used by product_term.
+     * @param n The number of elements in the line.
+     * @param inner_a The distance between consecutive elements of the line.
+     * @param inner_b The distance between consecutive elements of the line of the second operand.
+     * @param sum The running sum.
+     */
+    template <typename Term, typename T, typename Sum>
+    void sum_line(const T *a, const T *b, const size_t &n, const size_t &inner_a, const size_t &inner_b, Sum &sum)
+    {
+        size_t j{0};
+        if constexpr (simd<T>::enabled)
+        {
+            using packet = simd<T>;
+            constexpr size_t width{packet::width};
+            if (inner_a == 1 and inner_b == 1 and n >= 4 * width)
+            {
+                T lanes[width];
+                typename packet::type acc[4]{packet::set1(T{0}), packet::set1(T{0}), packet::set1(T{0}), packet::set1(T{0})};
+                if constexpr (Sum::compensated)
+                {
+                    typename packet::type comp[4]{acc[0], acc[0], acc[0], acc[0]};
+                    for (; j + (4 * width) <= n; j += 4 * width)
+                        for (size_t v{0}; v < 4; v++)
+                        {
+                            const typename packet::type y{packet::sub(Term::template packet<packet>(a + j + (v * width), b + j + (v * width)), comp[v])};
+                            const typename packet::type t{packet::add(acc[v], y)};
+                            comp[v] = packet::sub(packet::sub(t, acc[v]), y);
+                            acc[v] = t;
+                        }
+                    for (size_t v{0}; v < 4; v++)
+                    {
+                        packet::store(lanes, acc[v]);
+                        T comp_lanes[width];
+                        packet::store(comp_lanes, comp[v]);
+                        for (size_t l{0}; l < width; l++)
+                            sum.merge(Sum{lanes[l], comp_lanes[l]});
+                    }
+                }
+                else
+                {
+                    for (; j + (4 * width) <= n; j += 4 * width)
+                    {
+                        acc[0] = packet::add(acc[0], Term::template packet<packet>(a + j, b + j));
+                        acc[1] = packet::add(acc[1], Term::template packet<packet>(a + j + width, b + j + width));
+                        acc[2] = packet::add(acc[2], Term::template packet<packet>(a + j + (2 * width), b + j + (2 * width)));
+                        acc[3] = packet::add(acc[3], Term::template packet<packet>(a + j + (3 * width), b + j + (3 * width)));
+                    }
+                    packet::store(lanes, packet::add(packet::add(acc[0], acc[1]), packet::add(acc[2], acc[3])));
+                    for (size_t l{0}; l < width; l++)
+                        sum.add(lanes[l]);
+                }
+            }
+        }
+        for (; j < n; j++)
+            sum.add(Term::scalar(a + (j * inner_a), b + (j * inner_b)));
+    }
+
+    /**
+     * @brief Compute the dot product of two contiguous arrays. When SIMD packets are available, four independent accumulators are used, so that consecutive additions do not wait for each other.
+     *
+     * @param a A pointer to the first array.
+     * @param x A pointer to the second array.
+     * @param n The number of elements in each array.
+     * @return The dot product.
+     */
+    template <typename T>
+    T dot(const T *a, const T *x, const size_t n)
+    {
+        plain_sum<T> sum;
+        sum_line<product_term>(a, x, n, 1, 1, sum);
+        return sum.result();
+    }
+
+    /**
+     * @brief The smallest or largest element seen so far, used by min() and max(). NaNs are ignored: an element replaces the current one if it compares better, or if the current one is a NaN, so the result is a NaN only if all the elements are NaNs.
+     *
+     * @tparam Max Whether to find the largest element rather than the smallest.
+     * @tparam T The type of the elements.
+     */
+    template <bool Max, typename T>
+    struct extremum
+    {
+        T value{};
+        bool found{false};
+
+        static bool better(const T &x, const T &current)
+        {
+            if constexpr (Max)
+                return (x > current) or (current != current);
+            else
+                return (x < current) or (current != current);
+        }
+
+        void add(const T &x)
+        {
+            if (not found or better(x, value))
+            {
+                value = x;
+                found = true;
+            }
+        }
+
+        void merge(const extremum &other)
+        {
+            if (other.found)
+                add(other.value);
+        }
+    };
+
+    /**
+     * @brief Take the elements of one line of a reduction into account in the smallest or largest element seen so far. If the line is contiguous, four SIMD vectors of candidates are kept (through the GCC vector extensions), one per position within each group of four vectors, and compared with the running result at the end of the line.
+     *
+     * @param a A pointer to the first element of the line.
+     * @param n The number of elements in the line.
+     * @param inner The distance between consecutive elements of the line.
+     * @param result The smallest or largest element seen so far.
+     */
+    template <bool Max, typename T>
+    void extremum_line(const T *a, const size_t &n, const size_t &inner, extremum<Max, T> &result)
+    {
+        size_t j{0};
+#if defined(__GNUC__)
+        using blocking = gemm_blocking<T>;
+        if constexpr (blocking::vectorized)
+        {
+            constexpr size_t lanes{blocking::lanes};
+            if (inner == 1 and n >= 4 * lanes)
+            {
+                typedef T vec __attribute__((vector_size(blocking::simd_bytes)));
+                vec acc[4], x[4];
+                __builtin_memcpy(acc, a, sizeof(acc));
+                for (j = 4 * lanes; j + (4 * lanes) <= n; j += 4 * lanes)
+                {
+                    __builtin_memcpy(x, a + j, sizeof(x));
+                    for (size_t v{0}; v < 4; v++)
+                    {
+                        if constexpr (Max)
+                            acc[v] = ((x[v] > acc[v]) | (acc[v] != acc[v])) ? x[v] : acc[v];
+                        else
+                            acc[v] = ((x[v] < acc[v]) | (acc[v] != acc[v])) ? x[v] : acc[v];
+                    }
+                }
+                for (size_t v{0}; v < 4; v++)
+                    for (size_t l{0}; l < lanes; l++)
+                        result.add(acc[v][l]);
+            }
+        }
+#endif
+        for (; j < n; j++)
+            result.add(a[j * inner]);
+    }
+
+    /**
+     * @brief The order in which a reduction visits the elements of one or two matrices of the same size: as `lines` lines of `length` elements, where the first element of line `l` is at offset `l * outer` and consecutive elements of a line are `inner` apart (with separate strides for each matrix).
+     */
+    struct reduction_layout
+    {
+        size_t lines{0}, length{0}, outer_a{0}, inner_a{0}, outer_b{0}, inner_b{0};
+    };
+
+    /**
+     * @brief Choose the order in which to visit the elements of one or two matrices for a reduction: as a single contiguous line if the elements of both occupy consecutive memory (in either order), otherwise by rows if the rows of both are contiguous or the matrices are vectors, and by columns if the columns of both are contiguous.
+     *
+     * @param rows The number of rows.
+     * @param cols The number of columns.
+     * @param rsa The distance between consecutive rows of the first matrix.
+     * @param csa The distance between consecutive columns of the first matrix.
+     * @param rsb The distance between consecutive rows of the second matrix.
+     * @param csb The distance between consecutive columns of the second matrix.
+     * @return The order.
+     */
+    inline reduction_layout make_reduction_layout(size_t rows, size_t cols, size_t rsa, size_t csa, size_t rsb, size_t csb)
+    {
+        if (rows * cols == 0)
+            return {};
+        if ((cols == 1 and rows > 1) or ((csa != 1 or csb != 1) and rsa == 1 and rsb == 1))
+        {
+            std::swap(rows, cols);
+            std::swap(rsa, csa);
+            std::swap(rsb, csb);
+        }
+        if (rows == 1 or (csa == 1 and csb == 1 and rsa == cols and rsb == cols))
+            return {1, rows * cols, 0, csa, 0, csb};
+        return {rows, cols, rsa, csa, rsb, csb};
+    }
+
+    /**
+     * @brief The number of blocks a reduction with a given layout is split into: each line is split into pieces of up to reduction_block elements if it is long, and otherwise consecutive lines are grouped so each block has up to reduction_block elements.
+     *
+     * @param order The order in which the elements are visited, from make_reduction_layout().
+     * @return The number of blocks.
+     */
+    inline size_t reduction_blocks(const reduction_layout &order)
+    {
+        if (order.lines == 0)
+            return 0;
+        if (order.length >= reduction_block)
+            return order.lines * ((order.length + reduction_block - 1) / reduction_block);
+        const size_t lines_per_block{reduction_block / order.length};
+        return (order.lines + lines_per_block - 1) / lines_per_block;
+    }
+
+    /**
+     * @brief Call `f(line, begin, end)` for each piece of a line in a block of a reduction, where [`begin`, `end`) is the range of positions within the line. See reduction_blocks().
+     *
+     * @param order The order in which the elements are visited, from make_reduction_layout().
+     * @param block The index of the block.
+     * @param f The function to call.
+     */
+    template <typename F>
+    void for_each_reduction_piece(const reduction_layout &order, const size_t &block, F &&f)
+    {
+        if (order.length >= reduction_block)
+        {
+            const size_t pieces{(order.length + reduction_block - 1) / reduction_block};
+            const size_t begin{(block % pieces) * reduction_block};
+            f(block / pieces, begin, std::min(order.length, begin + reduction_block));
+        }
+        else
+        {
+            const size_t lines_per_block{reduction_block / order.length};
+            for (size_t l{block * lines_per_block}; l < std::min(order.lines, (block + 1) * lines_per_block); l++)
+                f(l, size_t{0}, order.length);
+        }
+    }
+
+    /**
+     * @brief Combines the results of the blocks of a reduction pairwise, as in a balanced binary tree, using a stack of partial results with one entry per level, so the error of a sum grows only logarithmically with the number of blocks. The results must be pushed in order.
+     *
+     * @tparam State The type of the partial results, which must have a member function `merge()`.
+     */
+    template <typename State>
+    class pairwise_combiner
+    {
+    public:
+        /**
+         * @brief Add the result of the next block.
+         *
+         * @param state The result.
+         */
+        void push(State state)
+        {
+            size_t level{0};
+            while (size > 0 and levels[size - 1] == level)
+            {
+                State left{states[size - 1]};
+                left.merge(state);
+                state = left;
+                size--;
+                level++;
+            }
+            states[size] = state;
+            levels[size] = level;
+            size++;
+        }
+
+        /**
+         * @brief Combine the remaining partial results.
+         *
+         * @return The result of the reduction.
+         */
+        State result() const
+        {
+            if (size == 0)
+                return State{};
+            State right{states[size - 1]};
+            for (size_t i{size - 1}; i-- > 0;)
+            {
+                State left{states[i]};
+                left.merge(right);
+                right = left;
+            }
+            return right;
+        }
+
+    private:
+        State states[64]{};
+        size_t levels[64]{};
+        size_t size{0};
+    };
+
+    /**
+     * @brief Perform a reduction: compute the result of each block with `block(b)`, in parallel over the blocks using the global thread pool if there are at least parallel_elementwise_threshold elements, and combine the results with a pairwise_combiner. The serial and parallel paths give exactly the same result.
+     *
+     * @param order The order in which the elements are visited, from make_reduction_layout().
+     * @param block The function computing the result of one block.
+     * @return The result of the reduction.
+     */
+    template <typename State, typename F>
+    State reduce(const reduction_layout &order, F &&block)
+    {
+        const size_t blocks{reduction_blocks(order)};
+        pairwise_combiner<State> combiner;
+        if (order.lines * order.length < parallel_elementwise_threshold)
+        {
+            for (size_t b{0}; b < blocks; b++)
+                combiner.push(block(b));
+        }
+        else
+        {
+            std::vector<State> partials(blocks);
+            thread_pool::global().parallel_for(0, blocks, std::max<size_t>(1, parallel_elementwise_grain / reduction_block), [&](const size_t &begin, const size_t &end)
+                                               {
+                                                   for (size_t b{begin}; b < end; b++)
+                                                       partials[b] = block(b);
+                                               });
+            for (const State &partial : partials)
+                combiner.push(partial);
+        }
+        return combiner.result();
+    }
+
+    /**
+     * @brief Sum the terms of one or two matrices of the same size.
+     *
+     * @tparam Kahan Whether to use Kahan summation (for floating-point types).
+     * @tparam Term The terms to add: element_term, square_term, or product_term.
+     * @param rows The number of rows.
+     * @param cols The number of columns.
+     * @param a A pointer to the first element of the first matrix.
+     * @param rsa The distance between consecutive rows of the first matrix.
+     * @param csa The distance between consecutive columns of the first matrix.
+     * @param b A pointer to the first element of the second matrix. Only used by product_term, but must be valid (for example, equal to `a`) for the other terms.
+     * @param rsb The distance between consecutive rows of the second matrix.
+     * @param csb The distance between consecutive columns of the second matrix.
+     * @return The sum.
+     */
+    template <bool Kahan, typename Term, typename T>
+    T reduce_sum(const size_t &rows, const size_t &cols, const T *a, const size_t &rsa, const size_t &csa, const T *b, const size_t &rsb, const size_t &csb)
+    {
+        using sum_type = reduction_sum<Kahan, T>;
+        const reduction_layout order{make_reduction_layout(rows, cols, rsa, csa, rsb, csb)};
+        return reduce<sum_type>(order, [&](const size_t &block)
+                                {
+                                    sum_type sum;
+                                    for_each_reduction_piece(order, block, [&](const size_t &line, const size_t &begin, const size_t &end)
+                                                             { sum_line<Term>(a + (line * order.outer_a) + (begin * order.inner_a), b + (line * order.outer_b) + (begin * order.inner_b), end - begin, order.inner_a, order.inner_b, sum); });
+                                    return sum;
+                                })
+            .result();
+    }
+
+    /**
+     * @brief Find the smallest or largest element of a matrix, ignoring NaNs.
+     *
+     * @tparam Max Whether to find the largest element rather than the smallest.
+     * @param rows The number of rows. Must be positive.
+     * @param cols The number of columns. Must be positive.
+     * @param a A pointer to the first element.
+     * @param rs The distance between consecutive rows.
+     * @param cs The distance between consecutive columns.
+     * @return The smallest or largest element, or a NaN if all the elements are NaNs.
+     */
+    template <bool Max, typename T>
+    T reduce_extremum(const size_t &rows, const size_t &cols, const T *a, const size_t &rs, const size_t &cs)
+    {
+        const reduction_layout order{make_reduction_layout(rows, cols, rs, cs, rs, cs)};
+        return reduce<extremum<Max, T>>(order, [&](const size_t &block)
+                                        {
+                                            extremum<Max, T> result;
+                                            for_each_reduction_piece(order, block, [&](const size_t &line, const size_t &begin, const size_t &end)
+                                                                     { extremum_line(a + (line * order.outer_a) + (begin * order.inner_a), end - begin, order.inner_a, result); });
+                                            return result;
+                                        })
+            .value;
+    }
+
+    /**
+     * @brief Find the position of the first element of a matrix, in row-major order, equal to a given value.
+     *
+     * @param rows The number of rows.
+     * @param cols The number of columns.
+     * @param a A pointer to the first element.
+     * @param rs The distance between consecutive rows.
+     * @param cs The distance between consecutive columns.
+     * @param value The value to look for.
+     * @return The row and column of the element, or (0, 0) if there is no such element.
+     */
+    template <typename T>
+    std::pair<size_t, size_t> find_first(const size_t &rows, const size_t &cols, const T *a, const size_t &rs, const size_t &cs, const T &value)
+    {
+        for (size_t i{0}; i < rows; i++)
+        {
+            const T *row{a + (i * rs)};
+            if (cs == 1)
+            {
+                const T *found{std::find(row, row + cols, value)};
+                if (found != row + cols)
+                    return {i, static_cast<size_t>(found - row)};
+            }
+            else
+                for (size_t j{0}; j < cols; j++)
+                    if (row[j * cs] == value)
+                        return {i, j};
+        }
+        return {0, 0};
+    }
+
+    /**
+     * @brief Compute the sum of each of a number of lines, writing the sums into an array. The lines are split between threads for large inputs.
+     *
+     * @tparam Kahan Whether to use Kahan summation (for floating-point types).
+     * @param a A pointer to the first element of the first line.
+     * @param lines The number of lines.
+     * @param length The number of elements in each line.
+     * @param outer The distance between the first elements of consecutive lines.
+     * @param inner The distance between consecutive elements of a line.
+     * @param out A pointer to an array with `lines` elements, which is overwritten with the sums.
+     */
+    template <bool Kahan, typename T>
+    void line_sums(const T *a, const size_t &lines, const size_t &length, const size_t &outer, const size_t &inner, T *out)
+    {
+        for_each_row_chunk(lines, length, [&](const size_t &begin, const size_t &end)
+                           {
+                               for (size_t l{begin}; l < end; l++)
+                               {
+                                   reduction_sum<Kahan, T> sum;
+                                   sum_line<element_term>(a + (l * outer), a + (l * outer), length, inner, inner, sum);
+                                   out[l] = sum.result();
+                               }
+                           });
+    }
+
+    /**
+     * @brief The number of positions processed at a time by cross_sums(), chosen so the partial sums (and compensations) stay in the L1 cache while they are added to.
+     */
+    inline constexpr size_t cross_sum_tile{1024};
+
+    /**
+     * @brief Compute the sums of the elements at each position across a number of contiguous lines, writing the sums into an array, so that `out[k]` is the sum of element `k` of every line. The lines are added in order using SIMD packets, one tile of positions at a time, and the positions are split between threads for large inputs.
+     *
+     * @tparam Kahan Whether to use Kahan summation (for floating-point types).
+     * @param a A pointer to the first element of the first line.
+     * @param lines The number of lines.
+     * @param length The number of elements in each line.
+     * @param outer The distance between the first elements of consecutive lines.
+     * @param out A pointer to an array with `length` elements, which is overwritten with the sums.
+     */
+    template <bool Kahan, typename T>
+    void cross_sums(const T *a, const size_t &lines, const size_t &length, const size_t &outer, T *out)
+    {
+        constexpr bool compensated{reduction_sum<Kahan, T>::compensated};
+        const auto chunk{[&](const size_t &begin, const size_t &end)
+                         {
+                             for (size_t tile{begin}; tile < end; tile += cross_sum_tile)
+                             {
+                                 const size_t size{std::min(end - tile, cross_sum_tile)};
+                                 T *sums{out + tile};
+                                 T comp[reduction_sum<Kahan, T>::compensated ? cross_sum_tile : 1]{};
+                                 std::fill_n(sums, size, T{0});
+                                 for (size_t l{0}; l < lines; l++)
+                                 {
+                                     const T *line{a + (l * outer) + tile};
+                                     size_t k{0};
+                                     if constexpr (simd<T>::enabled)
+                                     {
+                                         using packet = simd<T>;
+                                         for (; k + packet::width <= size; k += packet::width)
+                                         {
+                                             if constexpr (compensated)
+                                             {
+                                                 const typename packet::type s{packet::load(sums + k)};
+                                                 const typename packet::type y{packet::sub(packet::load(line + k), packet::load(comp + k))};
+                                                 const typename packet::type t{packet::add(s, y)};
+                                                 packet::store(comp + k, packet::sub(packet::sub(t, s), y));
+                                                 packet::store(sums + k, t);
+                                             }
+                                             else
+                                                 packet::store(sums + k, packet::add(packet::load(sums + k), packet::load(line + k)));
+                                         }
+                                     }
+                                     for (; k < size; k++)
+                                     {
+                                         if constexpr (compensated)
+                                         {
+                                             const T y{line[k] - comp[k]};
+                                             const T t{sums[k] + y};
+                                             comp[k] = (t - sums[k]) - y;
+                                             sums[k] = t;
+                                         }
+                                         else
+                                             sums[k] += line[k];
+                                     }
+                                 }
+                                 if constexpr (compensated)
+                                     for (size_t k{0}; k < size; k++)
+                                         sums[k] -= comp[k];
+                             }
+                         }};
+        if (lines * length < parallel_elementwise_threshold)
+            chunk(0, length);
+        else
+            thread_pool::global().parallel_for(0, length, std::max<size_t>(cross_sum_tile, parallel_elementwise_grain / lines), chunk);
+    }
+
+    // ======================
+    // Matrix-vector products
+    // ======================
+
+    /**
+     * @brief Compute the matrix-vector product y = alpha A x + beta y, where A is an m x n matrix accessed through strides. If the rows of A are contiguous, each element of y is a dot product with a row of A; otherwise (for example, for a transposed view), the columns of A scaled by the elements of x are added to y. Either way the rows of y are split between threads for large matrices, and no temporary memory is allocated.
+     *
+     * @param m The number of rows of A and elements of y.
+     * @param n The number of columns of A and elements of x.
+     * @param a A pointer to the first element of A.
+     * @param rsa The distance between consecutive rows of A.
+     * @param csa The distance between consecutive columns of A.
+     * @param x A pointer to the first element of x.
+     * @param y A pointer to the first element of y. Must not overlap with A or x.
+     * @param alpha The factor to multiply A x by.
+     * @param beta The factor to multiply y by. If it is zero, y is not read, so it does not need to be initialized.
+     */
+    template <typename T>
+    void gemv(const size_t m, const size_t n, const T *a, const size_t rsa, const size_t csa, const T *x, T *y, const T &alpha, const T &beta)
+    {
+        for_each_row_chunk(m, n, [&](const size_t &begin, const size_t &end)
+                           {
+                               if (csa == 1)
+                               {
+                                   for (size_t i{begin}; i < end; i++)
+                                   {
+                                       const T sum{alpha * dot(a + (i * rsa), x, n)};
+                                       y[i] = (beta == T{0}) ? sum : sum + (beta * y[i]);
+                                   }
+                                   return;
+                               }
+                               for (size_t i{begin}; i < end; i++)
+                                   y[i] = (beta == T{0}) ? T{0} : beta * y[i];
+                               for (size_t j{0}; j < n; j++)
+                               {
+                                   const T *a_col{a + (j * csa)};
+                                   const T ax{alpha * x[j]};
+                                   for (size_t i{begin}; i < end; i++)
+                                       y[i] += ax * a_col[i * rsa];
+                               }
+                           });
+    }
+
+    // =======================
+    // Batched matrix products
+    // =======================
+
+    /**
+     * @brief Multiply a batch of small matrices, whose sizes are either known at compile time (if `M`, `N`, and `K` are non-zero) or given at run time. Each row of each product is accumulated as a sum of rows of B scaled by the elements of the corresponding row of A, so that the innermost loop runs along the contiguous rows of B and C. When the sizes are known at compile time, each row of C is kept in registers until it is complete: in SIMD registers if the row is a whole number of packets, or in scalar registers if it is very short.
+     *
+     * @param a A pointer to the first element of the first A matrix.
+     * @param stride_a The distance between the first elements of consecutive A matrices.
+     * @param b A pointer to the first element of the first B matrix.
+     * @param stride_b The distance between the first elements of consecutive B matrices. Can be zero to multiply every A matrix by the same B matrix.
+     * @param c A pointer to the first element of the first C matrix.
+     * @param stride_c The distance between the first elements of consecutive C matrices.
+     * @param m The number of rows in each A and C matrix (ignored if `M` is non-zero).
+     * @param n The number of columns in each B and C matrix (ignored if `N` is non-zero).
+     * @param k The number of columns in each A matrix and rows in each B matrix (ignored if `K` is non-zero).
+     * @param begin The index of the first product in the batch to compute.
+     * @param end One past the index of the last product to compute.
+     */
+    template <size_t M, size_t N, size_t K, typename T>
+    void batched_kernel(const T *a, const size_t stride_a, const T *b, const size_t stride_b, T *c, const size_t stride_c, const size_t m, const size_t n, const size_t k, const size_t begin, const size_t end)
+    {
+        const size_t rows{(M != 0) ? M : m}, cols{(N != 0) ? N : n}, depth{(K != 0) ? K : k};
+        for (size_t p{begin}; p < end; p++)
+        {
+            const T *__restrict ap{a + (p * stride_a)};
+            const T *__restrict bp{b + (p * stride_b)};
+            T *__restrict cp{c + (p * stride_c)};
+            for (size_t i{0}; i < rows; i++)
+            {
+                T *c_row{cp + (i * cols)};
+                const T *a_row{ap + (i * depth)};
+                if constexpr (N != 0 and simd<T>::enabled and N % simd<T>::width == 0)
+                {
+                    // Keep the row of C in SIMD registers until it is complete.
+                    using packet = simd<T>;
+                    constexpr size_t width{packet::width}, packets{N / width};
+                    typename packet::type acc[packets];
+                    for (size_t v{0}; v < packets; v++)
+                        acc[v] = packet::mul(packet::set1(a_row[0]), packet::load(bp + (v * width)));
+                    for (size_t q{1}; q < depth; q++)
+                    {
+                        const typename packet::type aiq{packet::set1(a_row[q])};
+                        for (size_t v{0}; v < packets; v++)
+                            acc[v] = packet::add(acc[v], packet::mul(aiq, packet::load(bp + (q * N) + (v * width))));
+                    }
+                    for (size_t v{0}; v < packets; v++)
+                        packet::store(c_row + (v * width), acc[v]);
+                }
+                else if constexpr (N != 0 and N <= 4)
+                {
+                    // The row is too short for a SIMD register, so accumulate it in a local array, which the compiler keeps in scalar registers. (For longer rows, which the compiler would split between both kinds of registers, the loop below is faster.)
+                    T acc[N];
+                    for (size_t j{0}; j < N; j++)
+                        acc[j] = a_row[0] * bp[j];
+                    for (size_t q{1}; q < depth; q++)
+                        for (size_t j{0}; j < N; j++)
+                            acc[j] += a_row[q] * bp[(q * N) + j];
+                    for (size_t j{0}; j < N; j++)
+                        c_row[j] = acc[j];
+                }
+                else
+                {
+                    for (size_t j{0}; j < cols; j++)
+                        c_row[j] = a_row[0] * bp[j];
+                    for (size_t q{1}; q < depth; q++)
+                    {
+                        const T aiq{a_row[q]};
+                        const T *b_row{bp + (q * cols)};
+                        for (size_t j{0}; j < cols; j++)
+                            c_row[j] += aiq * b_row[j];
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Multiply a batch of small matrices stored consecutively in memory, using a kernel specialized for the sizes of the matrices if they are square with size 2, 3, 4, 8, or 16, and splitting the batch between threads if it is large. See batched_kernel() for a description of the arguments.
+     */
+    template <typename T>
+    void batched_gemm(const T *a, const size_t stride_a, const T *b, const size_t stride_b, T *c, const size_t stride_c, const size_t m, const size_t n, const size_t k, const size_t batch)
+    {
+        const size_t work{m * n * k};
+        const auto run{[&](auto kernel)
+                       {
+                           const auto chunk{[&](const size_t &begin, const size_t &end)
+                                            { kernel(a, stride_a, b, stride_b, c, stride_c, m, n, k, begin, end); }};
+                           if (batch * work < parallel_elementwise_threshold)
+                               chunk(size_t{0}, batch);
+                           else
+                               thread_pool::global().parallel_for(0, batch, std::max<size_t>(1, parallel_elementwise_grain / work), chunk);
+                       }};
+        if (m == n and n == k)
+        {
+            switch (n)
+            {
+            case 2:
+                return run(batched_kernel<2, 2, 2, T>);
+            case 3:
+                return run(batched_kernel<3, 3, 3, T>);
+            case 4:
+                return run(batched_kernel<4, 4, 4, T>);
+            case 8:
+                return run(batched_kernel<8, 8, 8, T>);
+            case 16:
+                return run(batched_kernel<16, 16, 16, T>);
+            default:
+                break;
+            }
+        }
+        run(batched_kernel<0, 0, 0, T>);
+    }
+
+    // ======================
+    // Strassen-Winograd GEMM
+    // ======================
+
+    /**
+     * @brief Compute the number of elements of workspace needed by strassen().
+     *
+     * @param m The number of rows in A and C.
+     * @param n The number of columns in B and C.
+     * @param k The number of columns in A and rows in B.
+     * @param cutoff The size below which the recursion stops.
+     * @return The number of elements.
+     */
+    inline size_t strassen_workspace(const size_t &m, const size_t &n, const size_t &k, const size_t &cutoff)
+    {
+        if (std::min({m, n, k}) <= std::max(cutoff, size_t{1}))
+            return 0;
+        const size_t m2{m / 2}, n2{n / 2}, k2{k / 2};
+        return (m2 * k2) + (k2 * n2) + (m2 * n2) + strassen_workspace(m2, n2, k2, cutoff);
+    }
+
+    /**
+     * @brief Compute the product C = A B using the Winograd variant of Strassen's algorithm, which multiplies 2x2 block matrices using 7 block multiplications and 15 block additions instead of 8 multiplications and 4 additions. The recursion stops, and gemm() is used instead, once any of the dimensions is no larger than the cutoff. If a dimension is odd, the last row or column is peeled off and handled separately using gemm() or a rank-1 update.
+     * @details The temporaries are scheduled so that each level of the recursion only needs three of them, for one block of A, one block of B, and one block of C, and the quadrants of C itself hold the other intermediate results. The temporaries of each level are reused by all 7 multiplications at that level, so the total workspace is given by strassen_workspace(), which is at most (mk + kn + mn) / 3 elements.
+     *
+     * @param a The view of A.
+     * @param b The view of B.
+     * @param c The view of C. Must not overlap with A or B.
+     * @param workspace A pointer to at least strassen_workspace() elements of workspace.
+     * @param cutoff The size below which the recursion stops.
+     */
+    template <typename T>
+    void strassen(const matrix_view<const T> &a, const matrix_view<const T> &b, const matrix_view<T> &c, T *workspace, const size_t &cutoff)
+    {
+        const size_t m{a.get_rows()}, n{b.get_cols()}, k{a.get_cols()};
+        if (std::min({m, n, k}) <= std::max(cutoff, size_t{1}))
+        {
+            gemm(a, b, c);
+            return;
+        }
+        const size_t m2{m / 2}, n2{n / 2}, k2{k / 2};
+        const matrix_view<const T> a11{a.block(0, 0, m2, k2)}, a12{a.block(0, k2, m2, k2)}, a21{a.block(m2, 0, m2, k2)}, a22{a.block(m2, k2, m2, k2)};
+        const matrix_view<const T> b11{b.block(0, 0, k2, n2)}, b12{b.block(0, n2, k2, n2)}, b21{b.block(k2, 0, k2, n2)}, b22{b.block(k2, n2, k2, n2)};
+        matrix_view<T> c11{c.block(0, 0, m2, n2)}, c12{c.block(0, n2, m2, n2)}, c21{c.block(m2, 0, m2, n2)}, c22{c.block(m2, n2, m2, n2)};
+        matrix_view<T> x(workspace, m2, k2), y(workspace + (m2 * k2), k2, n2), z(workspace + (m2 * k2) + (k2 * n2), m2, n2);
+        T *const next{workspace + (m2 * k2) + (k2 * n2) + (m2 * n2)};
+        const auto multiply = [&](const matrix_view<const T> &p, const matrix_view<const T> &q, const matrix_view<T> &r)
+        { strassen(p, q, r, next, cutoff); };
+
+        // In terms of the usual notation for the Winograd variant (S1-S4, T1-T4, P1-P7), the results are computed in the following order.
+        x = a11 - a21;       // S3
+        y = b22 - b12;       // T3
+        multiply(x, y, c21); // P7
+        x = a21 + a22;       // S1
+        y = b12 - b11;       // T1
+        multiply(x, y, c22); // P5
+        x -= a11;            // S2 = S1 - A11
+        y = b22 - y;         // T2 = B22 - T1
+        multiply(x, y, c12); // P6
+        x = a12 - x;         // S4 = A12 - S2
+        multiply(a11, b11, c11);
+        c12 += c11; // U2 = P1 + P6
+        c21 += c12; // U3 = U2 + P7
+        c12 += c22; // U4 = U2 + P5
+        c22 += c21; // C22 = U3 + P5
+        multiply(x, b22, z);
+        c12 += z; // C12 = U4 + P3
+        y -= b21; // T4 = T2 - B21
+        multiply(a22, y, z);
+        c21 -= z; // C21 = U3 - P4
+        multiply(a12, b21, z);
+        c11 += z; // C11 = P1 + P2
+
+        // Peel off the last column of A and row of B if k is odd, using a rank-1 update.
+        if (k % 2 != 0)
+        {
+            const matrix_view<const T> a_col{a.block(0, k - 1, 2 * m2, 1)}, b_row{b.block(k - 1, 0, 1, 2 * n2)};
+            for_each_row_chunk(2 * m2, 2 * n2, [&](const size_t &begin, const size_t &end)
+                               {
+                                   for (size_t i{begin}; i < end; i++)
+                                   {
+                                       const T aik{a_col(i, 0)};
+                                       for (size_t j{0}; j < 2 * n2; j++)
+                                           c(i, j) += aik * b_row(0, j);
+                                   }
+                               });
+        }
+        // Peel off the last column of B and C if n is odd, and the last row of A and C if m is odd.
+        if (n % 2 != 0)
+            gemm(a, b.col(n - 1), c.col(n - 1));
+        if (m % 2 != 0)
+            gemm(a.row(m - 1), b.block(0, 0, k, 2 * n2), c.block(m - 1, 0, 1, 2 * n2));
+    }
+
+    // =============
+    // Transposition
+    // =============
+
+    /**
+     * @brief The size of the tiles at which the recursion in transpose_recursive() and transpose_in_place() stops. A tile of the source and a tile of the destination fit together in the L1 cache for elements of up to 8 bytes.
+     */
+    inline constexpr size_t transpose_block{32};
+
+    /**
+     * @brief Transpose a `rows` x `cols` tile, writing element (i, j) of the source to element (j, i) of the destination. Elements of 4 or 8 bytes are transposed in 8x8 or 4x4 sub-tiles using SIMD shuffles if AVX is available.
+     *
+     * @param rows The number of rows in the source.
+     * @param cols The number of columns in the source.
+     * @param src A pointer to the first element of the source.
+     * @param lds The distance between consecutive rows of the source.
+     * @param dst A pointer to the first element of the destination. Must not overlap with the source.
+     * @param ldd The distance between consecutive rows of the destination.
+     */
+    template <typename T>
+    void transpose_tile(const size_t rows, const size_t cols, const T *src, const size_t lds, T *dst, const size_t ldd)
+    {
+        size_t i0{0};
+#if defined(__AVX2__) or defined(__AVX512F__)
+        if constexpr (std::is_trivially_copyable_v<T> and sizeof(T) == 4)
+        {
+            // The loads and stores are may-alias, so the elements can be moved as floats whatever their type.
+            const float *s{reinterpret_cast<const float *>(src)};
+            float *d{reinterpret_cast<float *>(dst)};
+            for (; i0 + 8 <= rows; i0 += 8)
+                for (size_t j{0}; j + 8 <= cols; j += 8)
+                {
+                    __m256 r[8], t[8];
+                    for (size_t k{0}; k < 8; k++)
+                        r[k] = _mm256_loadu_ps(s + ((i0 + k) * lds) + j);
+                    for (size_t k{0}; k < 8; k += 2)
+                    {
+                        t[k] = _mm256_unpacklo_ps(r[k], r[k + 1]);
+                        t[k + 1] = _mm256_unpackhi_ps(r[k], r[k + 1]);
+                    }
+                    for (size_t k{0}; k < 8; k += 4)
+                    {
+                        r[k] = _mm256_shuffle_ps(t[k], t[k + 2], _MM_SHUFFLE(1, 0, 1, 0));
+                        r[k + 1] = _mm256_shuffle_ps(t[k], t[k + 2], _MM_SHUFFLE(3, 2, 3, 2));
+                        r[k + 2] = _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(1, 0, 1, 0));
+                        r[k + 3] = _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(3, 2, 3, 2));
+                    }
+                    for (size_t k{0}; k < 4; k++)
+                    {
+                        _mm256_storeu_ps(d + ((j + k) * ldd) + i0, _mm256_permute2f128_ps(r[k], r[k + 4], 0x20));
+                        _mm256_storeu_ps(d + ((j + k + 4) * ldd) + i0, _mm256_permute2f128_ps(r[k], r[k + 4], 0x31));
+                    }
+                }
+        }
+        else if constexpr (std::is_trivially_copyable_v<T> and sizeof(T) == 8)
+        {
+            const double *s{reinterpret_cast<const double *>(src)};
+            double *d{reinterpret_cast<double *>(dst)};
+            for (; i0 + 4 <= rows; i0 += 4)
+                for (size_t j{0}; j + 4 <= cols; j += 4)
+                {
+                    const __m256d r0{_mm256_loadu_pd(s + (i0 * lds) + j)}, r1{_mm256_loadu_pd(s + ((i0 + 1) * lds) + j)};
+                    const __m256d r2{_mm256_loadu_pd(s + ((i0 + 2) * lds) + j)}, r3{_mm256_loadu_pd(s + ((i0 + 3) * lds) + j)};
+                    const __m256d t0{_mm256_unpacklo_pd(r0, r1)}, t1{_mm256_unpackhi_pd(r0, r1)};
+                    const __m256d t2{_mm256_unpacklo_pd(r2, r3)}, t3{_mm256_unpackhi_pd(r2, r3)};
+                    _mm256_storeu_pd(d + (j * ldd) + i0, _mm256_permute2f128_pd(t0, t2, 0x20));
+                    _mm256_storeu_pd(d + ((j + 1) * ldd) + i0, _mm256_permute2f128_pd(t1, t3, 0x20));
+                    _mm256_storeu_pd(d + ((j + 2) * ldd) + i0, _mm256_permute2f128_pd(t0, t2, 0x31));
+                    _mm256_storeu_pd(d + ((j + 3) * ldd) + i0, _mm256_permute2f128_pd(t1, t3, 0x31));
+                }
+        }
+        // The SIMD loops above cover whole sub-tiles only, so the columns to their right are left to the scalar loop below.
+        constexpr size_t sub{(std::is_trivially_copyable_v<T> and (sizeof(T) == 4 or sizeof(T) == 8)) ? 32 / sizeof(T) : 1};
+        const size_t simd_cols{(sub > 1) ? cols - (cols % sub) : 0};
+        for (size_t i{0}; i < i0; i++)
+            for (size_t j{simd_cols}; j < cols; j++)
+                dst[(j * ldd) + i] = src[(i * lds) + j];
+#endif
+        for (size_t i{i0}; i < rows; i++)
+            for (size_t j{0}; j < cols; j++)
+                dst[(j * ldd) + i] = src[(i * lds) + j];
+    }
+
+    /**
+     * @brief Transpose a matrix using a cache-oblivious algorithm: the larger of the two dimensions is split in half recursively, until the tiles are small enough for transpose_tile(). This keeps the accesses to both the source and the destination local at every level of the memory hierarchy, including the TLB, without tuning for any particular cache size. See transpose_tile() for a description of the arguments.
+     */
+    template <typename T>
+    void transpose_recursive(const size_t rows, const size_t cols, const T *src, const size_t lds, T *dst, const size_t ldd)
+    {
+        if (rows <= transpose_block and cols <= transpose_block)
+            transpose_tile(rows, cols, src, lds, dst, ldd);
+        else if (rows >= cols)
+        {
+            // Split at a multiple of the block size, so that the SIMD sub-tiles stay aligned with the edges of the tiles.
+            const size_t half{((rows / 2) + transpose_block - 1) / transpose_block * transpose_block};
+            transpose_recursive(half, cols, src, lds, dst, ldd);
+            transpose_recursive(rows - half, cols, src + (half * lds), lds, dst + half, ldd);
+        }
+        else
+        {
+            const size_t half{((cols / 2) + transpose_block - 1) / transpose_block * transpose_block};
+            transpose_recursive(rows, half, src, lds, dst, ldd);
+            transpose_recursive(rows, cols - half, src + half, lds, dst + (half * ldd), ldd);
+        }
+    }
+
+    /**
+     * @brief Transpose a matrix out of place using transpose_recursive(). Large matrices are split into blocks of columns of the source (rows of the destination), which are transposed in parallel using the global thread pool. See transpose_tile() for a description of the arguments.
+     */
+    template <typename T>
+    void transpose(const size_t rows, const size_t cols, const T *src, const size_t lds, T *dst, const size_t ldd)
+    {
+        if (rows * cols < parallel_elementwise_threshold)
+            transpose_recursive(rows, cols, src, lds, dst, ldd);
+        else
+        {
+            const size_t blocks{(cols + transpose_block - 1) / transpose_block};
+            thread_pool::global().parallel_for(0, blocks, 1, [&](const size_t &begin, const size_t &end)
+                                               {
+                                                   const size_t j0{begin * transpose_block}, j1{std::min(cols, end * transpose_block)};
+                                                   transpose_recursive(rows, j1 - j0, src + j0, lds, dst + (j0 * ldd), ldd);
+                                               });
+        }
+    }
+
+    /**
+     * @brief Swap a `rows` x `cols` tile A with the transpose of a `cols` x `rows` tile B, of the same matrix, using a cache-oblivious recursion as in transpose_recursive(). Used by transpose_in_place() for the tiles on either side of the diagonal.
+     *
+     * @param rows The number of rows in A.
+     * @param cols The number of columns in A.
+     * @param a A pointer to the first element of A.
+     * @param b A pointer to the first element of B. Must not overlap with A.
+     * @param lda The distance between consecutive rows of the matrix.
+     */
+    template <typename T>
+    void transpose_swap(const size_t rows, const size_t cols, T *a, T *b, const size_t lda)
+    {
+        if (rows <= transpose_block and cols <= transpose_block)
+        {
+            if constexpr (std::is_trivially_copyable_v<T> and std::is_default_constructible_v<T>)
+            {
+                // Go through a buffer, so that both tiles can be transposed using transpose_tile().
+                T buffer[transpose_block * transpose_block];
+                transpose_tile(cols, rows, b, lda, buffer, cols);
+                transpose_tile(rows, cols, a, lda, b, lda);
+                for (size_t i{0}; i < rows; i++)
+                    std::memcpy(a + (i * lda), buffer + (i * cols), cols * sizeof(T));
+            }
+            else
+                for (size_t i{0}; i < rows; i++)
+                    for (size_t j{0}; j < cols; j++)
+                        std::swap(a[(i * lda) + j], b[(j * lda) + i]);
+        }
+        else if (rows >= cols)
+        {
+            const size_t half{((rows / 2) + transpose_block - 1) / transpose_block * transpose_block};
+            transpose_swap(half, cols, a, b, lda);
+            transpose_swap(rows - half, cols, a + (half * lda), b + half, lda);
+        }
+        else
+        {
+            const size_t half{((cols / 2) + transpose_block - 1) / transpose_block * transpose_block};
+            transpose_swap(rows, half, a, b, lda);
+            transpose_swap(rows, cols - half, a + half, b + (half * lda), lda);
+        }
+    }
+
+    /**
+     * @brief Transpose a square matrix in place. The matrix is divided into tiles; each tile on the diagonal is transposed in place, and each tile above the diagonal is swapped with the transpose of the corresponding tile below it. For large matrices, the rows of tiles are processed in parallel using the global thread pool; they are independent, since each pair of tiles is handled by the row of the tile above the diagonal.
+     *
+     * @param n The number of rows and columns.
+     * @param a A pointer to the first element.
+     * @param lda The distance between consecutive rows.
+     */
+    template <typename T>
+    void transpose_in_place(const size_t n, T *a, const size_t lda)
+    {
+        const size_t blocks{(n + transpose_block - 1) / transpose_block};
+        const auto transpose_rows = [&](const size_t &begin, const size_t &end)
+        {
+            for (size_t bi{begin}; bi < end; bi++)
+            {
+                const size_t i0{bi * transpose_block}, ib{std::min(transpose_block, n - i0)};
+                T *diagonal{a + (i0 * lda) + i0};
+                for (size_t i{0}; i < ib; i++)
+                    for (size_t j{i + 1}; j < ib; j++)
+                        std::swap(diagonal[(i * lda) + j], diagonal[(j * lda) + i]);
+                if (i0 + ib < n)
+                    transpose_swap(ib, n - i0 - ib, diagonal + ib, diagonal + (ib * lda), lda);
+            }
+        };
+        // The rows of tiles near the top have more tiles to swap, so a grain of one row is used to balance the load.
+        if (n * n < parallel_elementwise_threshold)
+            transpose_rows(0, blocks);
+        else
+            thread_pool::global().parallel_for(0, blocks, 1, transpose_rows);
+    }
+} // namespace matrix_detail
+
+#if defined(MATRIX_INSTRUMENT)
+// ===============
+// Instrumentation
+// ===============
+
+/**
+ * @brief The interface to the instrumentation layer, which is only available if `MATRIX_INSTRUMENT` is defined before including matrix.hpp. If it is not defined, no instrumentation code is compiled at all, so there is no overhead.
+ * @details When enabled, every call to operator*() (for matrices and views, and multiply_transposed()), the evaluation of an elementwise expression into a matrix (by construction or operator=(), recorded as "operator+" or "operator-" if that is the outermost operation of the expression and as "elementwise" otherwise, including compound assignments such as `+=`), the copy constructor, and copy assignment is recorded, together with every allocation of memory for matrix elements. For each operation and each size bucket (by the number of elements in the result, in powers of two), the number of calls, the bytes allocated, the arithmetic operations performed, and the total wall time are accumulated. Optionally, the CPU cycles, instructions, and cache misses are also read from the hardware performance counters on Linux. The measurements are inclusive, so an operation that performs another operation internally includes its cost. Recording an operation takes two reads of the clock and a few relaxed atomic additions, plus two system calls per counter if the performance counters are enabled.
+ */
+class matrix_instrumentation
+{
+public:
+    /**
+     * @brief The totals recorded for one operation in one size bucket.
+     */
+    struct record
+    {
+        /**
+         * @brief The name of the operation, such as "operator*" or "copy constructor".
+         */
+        std::string operation;
+
+        /**
+         * @brief The smallest number of elements in the result for operations in this bucket.
+         */
+        uint64_t min_elements{0};
+
+        /**
+         * @brief The largest number of elements in the result for operations in this bucket.
+         */
+        uint64_t max_elements{0};
+
+        /**
+         * @brief The number of calls.
+         */
+        uint64_t calls{0};
+
+        /**
+         * @brief The number of bytes allocated for matrix elements during the calls.
+         */
+        uint64_t bytes_allocated{0};
+
+        /**
+         * @brief The number of arithmetic operations performed.
+         */
+        uint64_t flops{0};
+
+        /**
+         * @brief The total wall time of the calls, in nanoseconds.
+         */
+        uint64_t nanoseconds{0};
+
+        /**
+         * @brief The number of CPU cycles, if the performance counters are enabled. Dividing `instructions` by `cycles` gives the instructions per cycle (IPC).
+         */
+        uint64_t cycles{0};
+
+        /**
+         * @brief The number of instructions executed, if the performance counters are enabled.
+         */
+        uint64_t instructions{0};
+
+        /**
+         * @brief The number of cache misses (at the last level of the cache), if the performance counters are enabled.
+         */
+        uint64_t cache_misses{0};
+    };
+
+    /**
+     * @brief Static member function used to obtain a snapshot of all of the counters. Other threads may continue to record operations while the snapshot is taken, so the totals of different operations may be from slightly different times.
+     *
+     * @return One record for each operation and size bucket with at least one call.
+     */
+    static std::vector<record> snapshot()
+    {
+        std::vector<record> records;
+        for (size_t op{0}; op < static_cast<size_t>(matrix_detail::operation::count); op++)
+            for (size_t b{0}; b < matrix_detail::instrumentation_buckets; b++)
+            {
+                const matrix_detail::instrumentation_counters &counters{matrix_detail::instrumentation_table[op][b]};
+                const uint64_t calls{counters.calls.load(std::memory_order_relaxed)};
+                if (calls == 0)
+                    continue;
+                record r;
+                r.operation = matrix_detail::operation_names[op];
+                r.min_elements = (b == 0) ? 0 : (uint64_t{1} << (b - 1));
+                r.max_elements = (b == 0) ? 0 : (r.min_elements - 1) + r.min_elements;
+                r.calls = calls;
+                r.bytes_allocated = counters.bytes_allocated.load(std::memory_order_relaxed);
+                r.flops = counters.flops.load(std::memory_order_relaxed);
+                r.nanoseconds = counters.nanoseconds.load(std::memory_order_relaxed);
+                r.cycles = counters.cycles.load(std::memory_order_relaxed);
+                r.instructions = counters.instructions.load(std::memory_order_relaxed);
+                r.cache_misses = counters.cache_misses.load(std::memory_order_relaxed);
+                records.push_back(r);
+            }
+        return records;
+    }
+
+    /**
+     * @brief Static member function used to write a snapshot of all of the counters to a stream in CSV format, with a header line followed by one line for each record returned by snapshot(), for export to a metrics system.
+     *
+     * @param out The output stream.
+     */
+    static void dump(std::ostream &out)
+    {
+        out << "operation,min_elements,max_elements,calls,bytes_allocated,flops,nanoseconds,cycles,instructions,cache_misses\n";
+        for (const record &r : snapshot())
+            out << r.operation << ',' << r.min_elements << ',' << r.max_elements << ',' << r.calls << ',' << r.bytes_allocated << ',' << r.flops << ',' << r.nanoseconds << ',' << r.cycles << ',' << r.instructions << ',' << r.cache_misses << '\n';
+    }
+
+    /**
+     * @brief Static member function used to reset all of the counters to zero.
+     */
+    static void reset()
+    {
+        for (auto &row : matrix_detail::instrumentation_table)
+            for (matrix_detail::instrumentation_counters &counters : row)
+            {
+                counters.calls.store(0, std::memory_order_relaxed);
+                counters.bytes_allocated.store(0, std::memory_order_relaxed);
+                counters.flops.store(0, std::memory_order_relaxed);
+                counters.nanoseconds.store(0, std::memory_order_relaxed);
+                counters.cycles.store(0, std::memory_order_relaxed);
+                counters.instructions.store(0, std::memory_order_relaxed);
+                counters.cache_misses.store(0, std::memory_order_relaxed);
+            }
+    }
+
+    /**
+     * @brief Static member function used to pause or resume recording at runtime. Recording is enabled by default.
+     *
+     * @param enabled Whether to record operations.
+     */
+    static void set_enabled(const bool &enabled)
+    {
+        matrix_detail::instrumentation_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Static member function used to start or stop reading the hardware performance counters (cycles, instructions, and cache misses) for each operation. They are disabled by default. The counters only measure the thread that calls each operation, not the threads of the thread pool that it uses, so for the most accurate results use `matrix<T>::set_num_threads(1)`.
+     *
+     * @param enabled Whether to read the performance counters.
+     * @return true if the performance counters are available on the calling thread. They are only available on Linux, and only if the system allows it (see `/proc/sys/kernel/perf_event_paranoid`).
+     */
+    static bool enable_perf_counters(const bool &enabled = true)
+    {
+        matrix_detail::perf_counters_enabled.store(enabled, std::memory_order_relaxed);
+        return matrix_detail::perf_counters::this_thread().available();
+    }
+};
+#endif
+
+// ==========================
+// Lazy elementwise operators
+// ==========================
+
+/**
+ * @brief Overloaded binary operator `+` used to add two matrices or elementwise matrix expressions. The sum is not computed immediately; instead, an expression is returned, which is evaluated in a single fused loop when it is assigned to or converted to a matrix.
+ *
+ * @param a The first matrix to be added.
+ * @param b The second matrix to be added.
+ * @return An expression for the sum of the matrices.
+ * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+ */
+template <matrix_detail::operand L, matrix_detail::operand R>
+    requires std::same_as<typename L::value_type, typename R::value_type>
+inline auto operator+(const L &a, const R &b)
+{
+    if ((a.get_rows() != b.get_rows()) or (a.get_cols() != b.get_cols()))
+        throw matrix_detail::incompatible_sizes_add<typename L::value_type>{};
+    return matrix_detail::binary_expression(matrix_detail::as_expression(a), matrix_detail::as_expression(b), matrix_detail::add_op{});
+}
+
+/**
+ * @brief Overloaded unary operator `-` used to take the negative of a matrix or elementwise matrix expression. Returns an expression which is evaluated lazily, as with operator+().
+ *
+ * @param m The matrix to be negated.
+ * @return An expression for the negative of the matrix.
+ */
+template <matrix_detail::operand E>
+inline auto operator-(const E &m)
+{
+    return matrix_detail::unary_expression(matrix_detail::as_expression(m), matrix_detail::negate_op{});
+}
+
+/**
+ * @brief Overloaded binary operator `-` used to subtract two matrices or elementwise matrix expressions. Returns an expression which is evaluated lazily, as with operator+().
+ *
+ * @param a The first matrix to be subtracted.
+ * @param b The second matrix to be subtracted.
+ * @return An expression for the first matrix minus the second matrix.
+ * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+ */
+template <matrix_detail::operand L, matrix_detail::operand R>
+    requires std::same_as<typename L::value_type, typename R::value_type>
+inline auto operator-(const L &a, const R &b)
+{
+    if ((a.get_rows() != b.get_rows()) or (a.get_cols() != b.get_cols()))
+        throw matrix_detail::incompatible_sizes_add<typename L::value_type>{};
+    return matrix_detail::binary_expression(matrix_detail::as_expression(a), matrix_detail::as_expression(b), matrix_detail::subtract_op{});
+}
+
+/**
+ * @brief Apply a function to each pair of corresponding elements of two matrices or elementwise matrix expressions of the same size. Returns an expression which is evaluated lazily, as with operator+(), so for example `matrix<double> c = zip_with(a, b.map(f), g);` computes `g(a(i, j), f(b(i, j)))` for all elements in a single fused loop. The operands may have different element types. See matrix_detail::zip_expression for the requirements on the function.
+ *
+ * @param a The first matrix or expression.
+ * @param b The second matrix or expression.
+ * @param f The function, taking an element of each operand and returning the element of the result, which may be of a different type.
+ * @return An expression for the result.
+ * @throws incompatible_sizes_add if the operands do not have the same number of rows and columns.
+ */
+template <matrix_detail::operand L, matrix_detail::operand R, typename F>
+inline auto zip_with(const L &a, const R &b, const F &f)
+{
+    if ((a.get_rows() != b.get_rows()) or (a.get_cols() != b.get_cols()))
+        throw matrix_detail::incompatible_sizes_add<typename L::value_type>{};
+    return matrix_detail::zip_expression(matrix_detail::as_expression(a), matrix_detail::as_expression(b), f);
+}
+
+/**
+ * @brief Overloaded binary operator `*` used to multiply a scalar on the left and a matrix or elementwise matrix expression on the right. Returns an expression which is evaluated lazily, as with operator+().
+ *
+ * @param s The scalar.
+ * @param m The matrix.
+ * @return An expression for the product of the scalar with the matrix.
+ */
+template <matrix_detail::operand E>
+inline auto operator*(const typename E::value_type &s, const E &m)
+{
+    return matrix_detail::unary_expression(matrix_detail::as_expression(m), matrix_detail::scale_op<typename E::value_type>{s});
+}
+
+/**
+ * @brief Overloaded binary operator `*` used to multiply a matrix or elementwise matrix expression on the left and a scalar on the right. Returns an expression which is evaluated lazily, as with operator+().
+ *
+ * @param m The matrix.
+ * @param s The scalar.
+ * @return An expression for the product of the scalar with the matrix.
+ */
+template <matrix_detail::operand E>
+inline auto operator*(const E &m, const typename E::value_type &s)
+{
+    return s * m;
+}
+
+/**
+ * @brief Overloaded binary operator `*` used to multiply two matrices, at least one of which is a view or an elementwise matrix expression. Views are multiplied directly, without copying their elements. Other expressions are evaluated first.
+ *
+ * @param a The first matrix to be multiplied.
+ * @param b The second matrix to be multiplied.
+ * @return The product of the matrices.
+ * @throws incompatible_sizes_multiply if the number of columns in the first matrix is not the same as the number of rows in the second matrix.
+ */
+template <matrix_detail::operand L, matrix_detail::operand R>
+    requires std::same_as<typename L::value_type, typename R::value_type> and (matrix_detail::expression<L> or matrix_detail::expression<R>)
+inline auto operator*(const L &a, const R &b)
+{
+    using T = typename L::value_type;
+    if constexpr (not(matrix_detail::is_matrix<L>::value or matrix_detail::is_view<L>::value))
+        return matrix<T>(a) * b;
+    else if constexpr (not(matrix_detail::is_matrix<R>::value or matrix_detail::is_view<R>::value))
+        return a * matrix<T>(b);
+    else
+        return matrix_detail::multiply(matrix_view<const T>(a), matrix_view<const T>(b));
+}
+
+/**
+ * @brief Overloaded binary operator `*` used to multiply two matrices with different layouts or allocators. The matrices are multiplied directly through views, without converting either of them first, and the product is returned as a row-major matrix with the default allocator, as for views.
+ *
+ * @param a The first matrix to be multiplied.
+ * @param b The second matrix to be multiplied.
+ * @return The product of the matrices.
+ * @throws incompatible_sizes_multiply if the number of columns in the first matrix is not the same as the number of rows in the second matrix.
+ */
+template <typename T, typename AllocatorA, layout LayoutA, typename AllocatorB, layout LayoutB>
+    requires(not std::same_as<AllocatorA, AllocatorB> or LayoutA != LayoutB)
+inline matrix<T> operator*(const matrix<T, AllocatorA, LayoutA> &a, const matrix<T, AllocatorB, LayoutB> &b)
+{
+    return matrix_detail::multiply(matrix_view<const T>(a), matrix_view<const T>(b));
+}
+
+/**
+ * @brief Overloaded binary operator `<<` used to easily print out an elementwise matrix expression to a stream, by evaluating it and printing the resulting matrix.
+ *
+ * @param out The output stream.
+ * @param e The expression to be printed.
+ * @return A reference to the output stream.
+ */
+template <matrix_detail::expression E>
+std::ostream &operator<<(std::ostream &out, const E &e)
+{
+    return out << e.eval();
+}
+
+/**
+ * @brief A class template for non-owning views of matrices. A view refers to elements stored elsewhere, either in a matrix or in any other buffer, such as a network receive buffer or a shared memory region, and accesses them through a row stride and a column stride. Blocks, rows, columns, and transposes of matrices and views are themselves views, so they are obtained without copying any elements.
+ * @details Views can be used as operands of all of the matrix operators, and a view of non-const elements can be assigned to, which writes to the elements it refers to. A view must not outlive the memory it refers to.
+ *
+ * @tparam T The type of the matrix elements. Use a const type, such as `matrix_view<const double>`, for a read-only view.
+ */
+template <typename T>
+class matrix_view : public matrix_detail::expression_base<matrix_view<T>>
+{
+public:
+    /**
+     * @brief The type of the matrix elements.
+     */
+    using value_type = std::remove_const_t<T>;
+
+    static constexpr bool vectorizable{matrix_detail::simd<value_type>::enabled};
+
+    // ============
+    // Constructors
+    // ============
+
+    /**
+     * @brief Constructor to create a view of an existing buffer.
+     * @details The element at row `i` and column `j` (counting from zero) is `input_elements[(input_row_stride * i) + (input_col_stride * j)]`.
+     *
+     * @param input_elements A pointer to the first element.
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @param input_row_stride The distance between consecutive rows. If zero, the number of columns is used.
+     * @param input_col_stride The distance between consecutive columns.
+     * @throws zero_size if the number of rows or columns is zero.
+     */
+    matrix_view(T *input_elements, const size_t &input_rows, const size_t &input_cols, const size_t &input_row_stride = 0, const size_t &input_col_stride = 1)
+        : rows(input_rows), cols(input_cols), row_stride((input_row_stride == 0) ? input_cols : input_row_stride), col_stride(input_col_stride), elements(input_elements)
+    {
+        if (rows == 0 or cols == 0)
+            throw zero_size{};
+    }
+
+    /**
+     * @brief Constructor to create a view of all of the elements of a matrix.
+     *
+     * @param m The matrix.
+     */
+    template <typename Allocator, layout Layout>
+        requires(not std::is_const_v<T>)
+    matrix_view(matrix<value_type, Allocator, Layout> &m)
+        : rows(m.get_rows()), cols(m.get_cols()), row_stride(m.get_row_stride()), col_stride(m.get_col_stride()), elements(m.data()) {}
+
+    /**
+     * @brief Constructor to create a read-only view of all of the elements of a matrix.
+     *
+     * @param m The matrix.
+     */
+    template <typename Allocator, layout Layout>
+        requires std::is_const_v<T>
+    matrix_view(const matrix<value_type, Allocator, Layout> &m)
+        : rows(m.get_rows()), cols(m.get_cols()), row_stride(m.get_row_stride()), col_stride(m.get_col_stride()), elements(m.data()) {}
+
+    /**
+     * @brief Constructor to create a read-only view from a view of non-const elements.
+     *
+     * @param v The view.
+     */
+    template <typename U>
+        requires(std::is_const_v<T> and std::same_as<U, value_type>)
+    matrix_view(const matrix_view<U> &v)
+        : rows(v.get_rows()), cols(v.get_cols()), row_stride(v.get_row_stride()), col_stride(v.get_col_stride()), elements(v.data()) {}
+
+    /**
+     * @brief Copy constructor. The new view refers to the same elements as the existing view.
+     */
+    matrix_view(const matrix_view<T> &) = default;
+
+    // ==========
+    // Assignment
+    // ==========
+
+    /**
+     * @brief Overloaded operator = to copy the elements of another view into the elements referred to by this view. Note that, unlike the copy constructor, this does not change which elements the view refers to.
+     *
+     * @param v The view to be copied.
+     * @return A reference to this view.
+     * @throws incompatible_sizes_add if the views do not have the same number of rows and columns.
+     */
+    matrix_view<T> &operator=(const matrix_view<T> &v)
+        requires(not std::is_const_v<T>)
+    {
+        return assign(v);
+    }
+
+    /**
+     * @brief Overloaded operator = to assign a matrix or an elementwise matrix expression to the elements referred to by this view. If the expression refers to the same elements in a different arrangement, for example in `v = v.transpose()`, it is evaluated into a temporary matrix first.
+     *
+     * @param e The matrix or expression.
+     * @return A reference to this view.
+     * @throws incompatible_sizes_add if the view and the expression do not have the same number of rows and columns.
+     */
+    template <matrix_detail::operand E>
+        requires(not std::is_const_v<T>) and std::same_as<typename E::value_type, value_type>
+    matrix_view<T> &operator=(const E &e)
+    {
+        return assign(matrix_detail::as_expression(e));
+    }
+
+    /**
+     * @brief Overloaded binary operator `+=` used to add a matrix or an elementwise matrix expression to the elements referred to by this view.
+     *
+     * @param e The matrix or expression to be added.
+     * @return A reference to this view.
+     * @throws incompatible_sizes_add if the view and the expression do not have the same number of rows and columns.
+     */
+    template <matrix_detail::operand E>
+        requires(not std::is_const_v<T>) and std::same_as<typename E::value_type, value_type>
+    matrix_view<T> &operator+=(const E &e)
+    {
+        return assign(*this + e);
+    }
+
+    /**
+     * @brief Overloaded binary operator `-=` used to subtract a matrix or an elementwise matrix expression from the elements referred to by this view.
+     *
+     * @param e The matrix or expression to be subtracted.
+     * @return A reference to this view.
+     * @throws incompatible_sizes_add if the view and the expression do not have the same number of rows and columns.
+     */
+    template <matrix_detail::operand E>
+        requires(not std::is_const_v<T>) and std::same_as<typename E::value_type, value_type>
+    matrix_view<T> &operator-=(const E &e)
+    {
+        return assign(*this - e);
+    }
+
+    /**
+     * @brief Overloaded binary operator `*=` used to multiply the elements referred to by this view by a scalar.
+     *
+     * @param s The scalar.
+     * @return A reference to this view.
+     */
+    matrix_view<T> &operator*=(const value_type &s)
+        requires(not std::is_const_v<T>)
+    {
+        return assign(s * *this);
+    }
+
+    /**
+     * @brief Overloaded binary operator `/=` used to divide the elements referred to by this view by a scalar.
+     *
+     * @param s The scalar.
+     * @return A reference to this view.
+     */
+    matrix_view<T> &operator/=(const value_type &s)
+        requires(not std::is_const_v<T>)
+    {
+        return assign(matrix_detail::unary_expression(*this, matrix_detail::divide_op<value_type>{s}));
+    }
+
+    // ================
+    // Member functions
+    // ================
+
+    /**
+     * @brief Member function used to obtain (but not modify) the number of rows in the view.
+     *
+     * @return The number of rows.
+     */
+    inline size_t get_rows() const
+    {
+        return rows;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the number of columns in the view.
+     *
+     * @return The number of columns.
+     */
+    inline size_t get_cols() const
+    {
+        return cols;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the distance between consecutive rows of the view.
+     *
+     * @return The row stride.
+     */
+    inline size_t get_row_stride() const
+    {
+        return row_stride;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the distance between consecutive columns of the view.
+     *
+     * @return The column stride.
+     */
+    inline size_t get_col_stride() const
+    {
+        return col_stride;
+    }
+
+    /**
+     * @brief Member function used to obtain direct access to the elements referred to by the view, with the element at row `i` and column `j` at index `(row_stride * i) + (col_stride * j)`.
+     *
+     * @return A pointer to the first element.
+     */
+    inline T *data() const
+    {
+        return elements;
+    }
+
+    /**
+     * @brief Overloaded operator () used to access elements WITHOUT range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return A reference to the element, which can also be used to modify it if the view is not read-only.
+     */
+    inline T &operator()(const size_t &row, const size_t &col) const
+    {
+        return elements[(row_stride * row) + (col_stride * col)];
+    }
+
+    /**
+     * @brief Member function used to access elements WITH range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return A reference to the element, which can also be used to modify it if the view is not read-only.
+     * @throws index_out_of_range if the requested element is out of range.
+     */
+    inline T &at(const size_t &row, const size_t &col) const
+    {
+        if (row >= rows or col >= cols)
+            throw index_out_of_range{};
+        return (*this)(row, col);
+    }
+
+    /**
+     * @brief Member function used to obtain a view of a rectangular block of this view.
+     *
+     * @param first_row The first row of the block.
+     * @param first_col The first column of the block.
+     * @param block_rows The number of rows in the block.
+     * @param block_cols The number of columns in the block.
+     * @return A view of the block.
+     * @throws zero_size if the number of rows or columns is zero.
+     * @throws index_out_of_range if the block does not fit inside the view.
+     */
+    matrix_view<T> block(const size_t &first_row, const size_t &first_col, const size_t &block_rows, const size_t &block_cols) const
+    {
+        if (block_rows == 0 or block_cols == 0)
+            throw zero_size{};
+        if (first_row >= rows or first_col >= cols or block_rows > rows - first_row or block_cols > cols - first_col)
+            throw index_out_of_range{};
+        return matrix_view<T>(elements + (row_stride * first_row) + (col_stride * first_col), block_rows, block_cols, row_stride, col_stride);
+    }
+
+    /**
+     * @brief Member function used to obtain a view of one row of this view, as a matrix with one row.
+     *
+     * @param row The row index (starting from zero).
+     * @return A view of the row.
+     * @throws index_out_of_range if the row is out of range.
+     */
+    matrix_view<T> row(const size_t &row) const
+    {
+        return block(row, 0, 1, cols);
+    }
+
+    /**
+     * @brief Member function used to obtain a view of one column of this view, as a matrix with one column.
+     *
+     * @param col The column index (starting from zero).
+     * @return A view of the column.
+     * @throws index_out_of_range if the column is out of range.
+     */
+    matrix_view<T> col(const size_t &col) const
+    {
+        return block(0, col, rows, 1);
+    }
+
+    /**
+     * @brief Member function used to obtain a view of the transpose of this view. No elements are moved; the row and column strides are simply swapped.
+     *
+     * @return A view of the transpose.
+     */
+    matrix_view<T> transpose() const
+    {
+        return matrix_view<T>(elements, cols, rows, col_stride, row_stride);
+    }
+
+    /**
+     * @brief Member function used to replace each element referred to by the view with the result of applying a function to it. See matrix::map_inplace() for details.
+     *
+     * @param f The function, taking one element and returning the new element.
+     * @return A reference to this view.
+     */
+    template <typename F>
+        requires(not std::is_const_v<T>)
+    matrix_view<T> &map_inplace(const F &f)
+    {
+        return assign(this->map([&f](const value_type &x)
+                                { return static_cast<value_type>(f(x)); }));
+    }
+
+    // =========================================================
+    // Expression interface (see matrix_detail::expression_base)
+    // =========================================================
+
+    inline bool rows_contiguous() const
+    {
+        return col_stride == 1;
+    }
+
+    inline bool contiguous(const layout &order) const
+    {
+        if (order == layout::row_major)
+            return col_stride == 1 and row_stride == cols;
+        return row_stride == 1 and col_stride == rows;
+    }
+
+    inline bool conflicts_with(const matrix_view<const value_type> &target) const
+    {
+        const std::less<const value_type *> less;
+        if (less(last(), target.data()) or less(target.last(), elements))
+            return false;
+        return not(elements == target.data() and row_stride == target.get_row_stride() and col_stride == target.get_col_stride());
+    }
+
+    inline value_type operator[](const size_t &i) const
+    {
+        return elements[i];
+    }
+
+    inline auto packet(const size_t &row, const size_t &col) const
+    {
+        return matrix_detail::simd<value_type>::load(elements + (row_stride * row) + col);
+    }
+
+    inline auto packet(const size_t &i) const
+    {
+        return matrix_detail::simd<value_type>::load(elements + i);
+    }
+
+    // ==========
+    // Exceptions
+    // ==========
+
+    /**
+     * @brief Exception to be thrown if the number of rows or columns of a view is zero.
+     */
+    using zero_size = matrix_detail::zero_size<value_type>;
+
+    /**
+     * @brief Exception to be thrown if a view is assigned an expression that does not have the same number of rows and columns.
+     */
+    using incompatible_sizes_add = matrix_detail::incompatible_sizes_add<value_type>;
+
+    /**
+     * @brief Exception to be thrown if the requested element, row, column, or block is out of range.
+     */
+    using index_out_of_range = matrix_detail::index_out_of_range<value_type>;
+
+private:
+    template <typename>
+    friend class matrix_view;
+
+    /**
+     * @brief Get a pointer to the last element referred to by the view.
+     */
+    inline T *last() const
+    {
+        return elements + (row_stride * (rows - 1)) + (col_stride * (cols - 1));
+    }
+
+    /**
+     * @brief Write an expression into the elements referred to by this view, going through a temporary matrix if the expression conflicts with this view.
+     *
+     * @param e The expression.
+     * @return A reference to this view.
+     * @throws incompatible_sizes_add if the view and the expression do not have the same number of rows and columns.
+     */
+    template <typename E>
+    matrix_view<T> &assign(const E &e)
+    {
+        if (e.get_rows() != rows or e.get_cols() != cols)
+            throw incompatible_sizes_add{};
+        if (e.conflicts_with(*this))
+            matrix_detail::evaluate(matrix_detail::as_expression(matrix<value_type>(e)), elements, row_stride, col_stride);
+        else
+            matrix_detail::evaluate(e, elements, row_stride, col_stride);
+        return *this;
+    }
+
+    /**
+     * @brief The number of rows.
+     */
+    size_t rows{0};
+
+    /**
+     * @brief The number of columns.
+     */
+    size_t cols{0};
+
+    /**
+     * @brief The distance between consecutive rows.
+     */
+    size_t row_stride{0};
+
+    /**
+     * @brief The distance between consecutive columns.
+     */
+    size_t col_stride{0};
+
+    /**
+     * @brief A pointer to the first element.
+     */
+    T *elements{nullptr};
+};
+
+/**
+ * @brief A class template for matrices.
+ *
+ * @tparam T The type to use for the matrix elements. Can be any type that has addition, subtraction, negation, and multiplication defined.
+ * @tparam Allocator The allocator to use for the matrix elements. Must be default constructible. By default, aligned_allocator is used, so that the elements start on a 64-byte boundary. Custom allocators may be used, for example, to allocate memory local to a NUMA node or in huge pages.
+ * @tparam Layout The order in which the elements are stored: layout::row_major (the default) or layout::col_major. The interface is the same for both; only the arrangement of the elements returned by data() differs. Operations on matrices of different layouts, or on views, access each operand through its row and column strides, so no converted copies are made.
+ */
+template <typename T, typename Allocator, layout Layout>
+class matrix
+{
+public:
+    /**
+     * @brief The type of the matrix elements.
+     */
+    using value_type = T;
+
+    /**
+     * @brief The type of the allocator.
+     */
+    using allocator_type = Allocator;
+
+    /**
+     * @brief The order in which the elements are stored.
+     */
+    static constexpr layout storage_layout{Layout};
+
+    // ============
+    // Constructors
+    // ============
+
+    /**
+     * @brief Constructor to create an UNINITIALIZED matrix. WARNING: Good for performance, but make sure to never use any uninitialized elements!
+     *
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @throws zero_size if the number of rows or columns is zero.
+     */
+    matrix(const size_t &input_rows, const size_t &input_cols)
+        : rows(input_rows), cols(input_cols), stride(leading_dimension(input_rows, input_cols))
+    {
+        if (rows == 0 or cols == 0)
+            throw zero_size{};
+        allocate();
+    }
+
+    /**
+     * @brief Constructor to create a matrix with all of its elements initialized to a specific value. If the value is zero, the memory is obtained in the same way as for zeros().
+     *
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @param input_init The value to initialize all of the elements to.
+     * @throws zero_size if the number of rows or columns is zero.
+     */
+    matrix(const size_t &input_rows, const size_t &input_cols, const T &input_init)
+        : rows(input_rows), cols(input_cols), stride(leading_dimension(input_rows, input_cols))
+    {
+        if (rows == 0 or cols == 0)
+            throw zero_size{};
+        if constexpr (std::is_arithmetic_v<T>)
+        {
+            // Compare the bits rather than the values, so that -0.0 is not stored as +0.0.
+            const T zero{0};
+            if (std::memcmp(&input_init, &zero, sizeof(T)) == 0)
+            {
+                allocate_zeroed();
+                return;
+            }
+        }
+        allocate();
+        matrix_detail::for_each_chunk(rows * cols, [&](const size_t &begin, const size_t &end)
+                                      { std::fill(elements + begin, elements + end, input_init); });
+    }
+
+    /**
+     * @brief Constructor to create a diagonal matrix from a `vector`.
+     *
+     * @param input_diagonal A `vector` containing the elements on the diagonal. The number of rows and columns is inferred automatically from the size of the `vector`.
+     * @throws zero_size if the size of the `vector` is zero.
+     */
+    matrix(const std::vector<T> &input_diagonal)
+        : rows(input_diagonal.size()), cols(input_diagonal.size()), stride(input_diagonal.size())
+    {
+        if (rows == 0)
+            throw zero_size{};
+        allocate_zeroed();
+        for (size_t i{0}; i < rows; i++)
+            elements[index(i, i)] = input_diagonal[i];
+    }
+
+    /**
+     * @brief Constructor to create a diagonal matrix from an `initializer_list`.
+     *
+     * @param input_diagonal An `initializer_list` containing the elements on the diagonal. The number of rows and columns is inferred automatically from the size of the `initializer_list`.
+     * @throws zero_size if the size of the `initializer_list` is zero.
+     */
+    matrix(const std::initializer_list<T> &input_diagonal)
+        : matrix(std::vector<T>{input_diagonal}) {}
+
+    /**
+     * @brief Constructor to create a matrix and initialize it to the elements given by a `vector`.
+     * @details The elements should be given in flattened 1-dimensional form, with the matrix element at row `i` and column `j` (counting from zero) given by element number `(cols * i) + j` of the `vector` (also counting from zero), where `cols` is the number of columns, that is, the number of element in each row. For example, for a 2x2 matrix A, the `vector` will be [A(0, 0), A(0, 1), A(1, 0), A(1, 1)]. The elements are given in this order for both layouts; for a column-major matrix, they are rearranged as they are copied.
+     *
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @param input_elements A `vector` containing the elements in flattened 1-dimensional form.
+     * @throws zero_size if the number of rows or columns is zero.
+     * @throws initializer_wrong_size if the size of the `vector` does not equal the total number of matrix elements.
+     */
+    matrix(const size_t &input_rows, const size_t &input_cols, const std::vector<T> &input_elements)
+        : rows(input_rows), cols(input_cols), stride(leading_dimension(input_rows, input_cols))
+    {
+        if (rows == 0 or cols == 0)
+            throw zero_size{};
+        if (input_elements.size() != rows * cols)
+            throw initializer_wrong_size{};
+        allocate();
+        assign_flattened(input_elements.begin());
+    }
+
+    /**
+     * @brief Constructor to create a matrix and initialize it to the elements given by a `vector`, which is moved from. See matrix(const size_t &, const size_t &, const std::vector<T> &) for the order of the elements.
+     * @details The elements are moved rather than copied, which makes a difference for types such as `std::string`, and for trivially copyable types they are copied in bulk using `memcpy()`. The `vector` cannot give up its memory, and its memory is not aligned the way the matrix requires, so the elements are still copied once, but the memory of the `vector` is released as soon as the copy is done, instead of when the `vector` goes out of scope.
+     *
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @param input_elements A `vector` containing the elements in flattened 1-dimensional form. It is left empty.
+     * @throws zero_size if the number of rows or columns is zero.
+     * @throws initializer_wrong_size if the size of the `vector` does not equal the total number of matrix elements.
+     */
+    matrix(const size_t &input_rows, const size_t &input_cols, std::vector<T> &&input_elements)
+        : rows(input_rows), cols(input_cols), stride(leading_dimension(input_rows, input_cols))
+    {
+        if (rows == 0 or cols == 0)
+            throw zero_size{};
+        if (input_elements.size() != rows * cols)
+            throw initializer_wrong_size{};
+        allocate();
+        assign_flattened(std::make_move_iterator(input_elements.begin()));
+        std::vector<T>().swap(input_elements);
+    }
+
+    /**
+     * @brief Constructor to create a matrix and initialize it to the elements given by an `initializer_list`.
+     * @details The elements should be given in flattened 1-dimensional form, with the matrix element at row `i` and column `j` (counting from zero) given by element number `(cols * i) + j` of the `initializer_list` (also counting from zero), where `cols` is the number of columns, that is, the number of element in each row. For example, for a 2x2 matrix A, the `initializer_list` will be [A(0, 0), A(0, 1), A(1, 0), A(1, 1)].
+     *
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @param input_elements An `initializer_list` containing the elements in flattened 1-dimensional form.
+     * @throws zero_size if the number of rows or columns is zero.
+     * @throws initializer_wrong_size if the size of the `initializer_list` does not equal the total number of matrix elements.
+     */
+    matrix(const size_t &input_rows, const size_t &input_cols, const std::initializer_list<T> &input_elements)
+        : rows(input_rows), cols(input_cols), stride(leading_dimension(input_rows, input_cols))
+    {
+        if (rows == 0 or cols == 0)
+            throw zero_size{};
+        if (input_elements.size() != rows * cols)
+            throw initializer_wrong_size{};
+        allocate();
+        assign_flattened(input_elements.begin());
+    }
+
+    /**
+     * @brief Copy constructor to create a new matrix with the same elements as an existing matrix. The new matrix has the same stride as the existing matrix. Elements of trivially copyable types are copied in bulk using `memcpy()`, split between threads for large matrices.
+     *
+     * @param m The matrix to be copied.
+     */
+    matrix(const matrix<T, Allocator, Layout> &m)
+        : rows(m.rows), cols(m.cols), stride(m.stride)
+    {
+#if defined(MATRIX_INSTRUMENT)
+        const matrix_detail::instrument_scope scope{matrix_detail::operation::copy_construct, rows * cols, 0};
+#endif
+#if defined(MATRIX_COPY_ON_WRITE)
+        if (m.shareable())
+        {
+            smart = m.smart;
+            elements = m.elements;
+            return;
+        }
+#endif
+        allocate();
+        copy_elements(m.elements);
+    }
+
+    /**
+     * @brief Constructor to create a new matrix with the same elements as an existing matrix that uses a different allocator or layout. Converting between layouts reads the elements in blocks, so both matrices are accessed in cache-friendly order.
+     *
+     * @param m The matrix to be copied.
+     */
+    template <typename OtherAllocator, layout OtherLayout>
+        requires(not std::same_as<OtherAllocator, Allocator> or OtherLayout != Layout)
+    explicit matrix(const matrix<T, OtherAllocator, OtherLayout> &m)
+        : rows(m.get_rows()), cols(m.get_cols()), stride(leading_dimension(m.get_rows(), m.get_cols()))
+    {
+#if defined(MATRIX_INSTRUMENT)
+        const matrix_detail::instrument_scope scope{matrix_detail::operation::copy_construct, rows * cols, 0};
+#endif
+        allocate();
+        matrix_detail::evaluate(matrix_detail::as_expression(m), elements, get_row_stride(), get_col_stride());
+    }
+
+    /**
+     * @brief Move constructor to move the elements of an existing matrix to a new matrix.
+     *
+     * @param m The matrix to be moved.
+     */
+    matrix(matrix<T, Allocator, Layout> &&m)
+        : rows(m.rows), cols(m.cols), stride(m.stride)
+    {
+        smart = move(m.smart);
+        elements = smart.get();
+        m.rows = 0;
+        m.cols = 0;
+        m.stride = 0;
+        m.elements = nullptr;
+    }
+
+    /**
+     * @brief Constructor to create a new matrix by evaluating an elementwise matrix expression, such as `a + b` or `2.0 * a - b`. All of the elements are computed in a single fused loop, without creating any temporary matrices.
+     *
+     * @param e The expression to be evaluated.
+     */
+    template <matrix_detail::expression E>
+        requires std::same_as<typename E::value_type, T>
+    matrix(const E &e)
+        : rows(e.get_rows()), cols(e.get_cols()), stride(leading_dimension(e.get_rows(), e.get_cols()))
+    {
+#if defined(MATRIX_INSTRUMENT)
+        const matrix_detail::instrument_scope scope{matrix_detail::expression_operation<E>, rows * cols, static_cast<uint64_t>(rows) * cols * matrix_detail::expression_flops<E>};
+#endif
+        allocate();
+        matrix_detail::evaluate(e, elements, get_row_stride(), get_col_stride());
+    }
+
+    /**
+     * @brief Static member function used to create an UNINITIALIZED matrix whose rows (or columns, for a column-major matrix) are padded, so that each row starts on a 64-byte boundary (if the size of `T` divides 64). This avoids SIMD loads that cross cache lines, and false sharing between threads that work on different rows. The padding elements are never used. WARNING: Make sure to never use any uninitialized elements!
+     *
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @return The new matrix.
+     * @throws zero_size if the number of rows or columns is zero.
+     */
+    static matrix<T, Allocator, Layout> padded(const size_t &input_rows, const size_t &input_cols)
+    {
+        constexpr size_t row_alignment{(64 % sizeof(T) == 0) ? 64 / sizeof(T) : 1};
+        return matrix<T, Allocator, Layout>(input_rows, input_cols, ((leading_dimension(input_rows, input_cols) + row_alignment - 1) / row_alignment) * row_alignment, padding_tag{});
+    }
+
+    /**
+     * @brief Static member function used to create a matrix with all of its elements initialized to zero.
+     * @details For large matrices of arithmetic types with the default allocator, the memory is mapped directly from the operating system, which provides pages that are already zero, as `calloc()` does. The pages are only allocated when they are first accessed, so creating the matrix takes constant time, and the cost of zeroing is spread over the first pass over the elements, usually by several threads. Otherwise, the memory is allocated as usual and then filled with zeros.
+     *
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @return The new matrix.
+     * @throws zero_size if the number of rows or columns is zero.
+     */
+    static matrix<T, Allocator, Layout> zeros(const size_t &input_rows, const size_t &input_cols)
+    {
+        return matrix<T, Allocator, Layout>(input_rows, input_cols, zeros_tag{});
+    }
+
+    /**
+     * @brief Static member function used to read a matrix from a binary file written by save(). If the file was written on a machine with the opposite byte order, the elements are converted. The file always stores the elements in row-major order, so for a column-major matrix they are rearranged after reading.
+     *
+     * @param path The path of the file.
+     * @return The matrix.
+     * @throws file_error if the file could not be opened or read.
+     * @throws invalid_file_format if the file is not a binary matrix file, or its elements are not of type `T`.
+     * @throws zero_size if the number of rows or columns in the file is zero.
+     */
+    static matrix<T, Allocator, Layout> load(const std::string &path)
+        requires std::is_trivially_copyable_v<T>
+    {
+        if constexpr (Layout != layout::row_major)
+            return matrix<T, Allocator, Layout>(matrix<T, Allocator>::load(path));
+        std::ifstream in(path, std::ios::binary);
+        if (not in)
+            throw file_error{};
+        bool swapped{false};
+        const matrix_detail::file_header header{matrix_detail::read_header<T>(in, swapped)};
+        matrix<T, Allocator, Layout> m(static_cast<size_t>(header.rows), static_cast<size_t>(header.cols));
+        if (not in.read(reinterpret_cast<char *>(m.elements), static_cast<std::streamsize>(m.rows * m.cols * sizeof(T))))
+            throw file_error{};
+        if (swapped)
+            matrix_detail::byte_swap(m.elements, m.rows * m.cols, sizeof(T));
+        return m;
+    }
+
+    /**
+     * @brief Static member function used to read a matrix in CSV format, as written by write_csv(), from a stream. The number of rows and columns is inferred from the number of lines and the number of elements in each line. The elements are parsed using `std::from_chars()`. Spaces and tabs around the elements, empty lines, and Windows line endings are ignored.
+     *
+     * @param in The input stream.
+     * @param delimiter The character used to separate the elements in each row.
+     * @return The matrix.
+     * @throws invalid_file_format if an element could not be parsed, or the rows do not all have the same number of elements.
+     * @throws zero_size if the stream contains no elements.
+     */
+    static matrix<T, Allocator, Layout> read_csv(std::istream &in, const char &delimiter = ',')
+        requires matrix_detail::text_convertible<T>
+    {
+        std::vector<T> input_elements;
+        size_t input_cols{0};
+        const size_t input_rows{matrix_detail::read_delimited(in, delimiter, input_elements, input_cols)};
+        return matrix<T, Allocator, Layout>(input_rows, input_cols, std::move(input_elements));
+    }
+
+    /**
+     * @brief Static member function used to read a matrix in plain text format, as written by write_text(), from a stream. The elements in each row may be separated by any number of spaces and tabs. See read_csv() for details.
+     *
+     * @param in The input stream.
+     * @return The matrix.
+     * @throws invalid_file_format if an element could not be parsed, or the rows do not all have the same number of elements.
+     * @throws zero_size if the stream contains no elements.
+     */
+    static matrix<T, Allocator, Layout> read_text(std::istream &in)
+        requires matrix_detail::text_convertible<T>
+    {
+        return read_csv(in, ' ');
+    }
+
+    /**
+     * @brief Static member function used to map a binary file written by save() into memory, and use the mapped file directly as the elements of the matrix, with no copy. Pages of the file are only read from disk when the corresponding elements are first accessed, so the time taken depends on how much of the matrix is actually used, not on the size of the file. The mapping is released when the matrix is destroyed.
+     * @details By default, the mapping is private: the matrix can be modified, but the modifications are not written to the file. If `write_back` is true, the file must be writable, and modifications to the elements are written back to the file. A copy of a mapped matrix is an ordinary matrix. On systems without `mmap()`, the file is read into memory using load() instead. Only available for row-major matrices, since that is the order of the elements in the file.
+     *
+     * @param path The path of the file.
+     * @param write_back Whether modifications to the elements are written back to the file.
+     * @return The matrix.
+     * @throws file_error if the file could not be opened or mapped.
+     * @throws invalid_file_format if the file is not a binary matrix file, its elements are not of type `T`, it is shorter than the header indicates, or it was written on a machine with the opposite byte order.
+     * @throws zero_size if the number of rows or columns in the file is zero.
+     */
+    static matrix<T, Allocator, Layout> mapped(const std::string &path, const bool &write_back = false)
+        requires std::is_trivially_copyable_v<T> and (Layout == layout::row_major)
+    {
+#if defined(__unix__) or defined(__APPLE__)
+        std::ifstream in(path, std::ios::binary);
+        if (not in)
+            throw file_error{};
+        bool swapped{false};
+        const matrix_detail::file_header header{matrix_detail::read_header<T>(in, swapped)};
+        in.close();
+        if (swapped)
+            throw invalid_file_format{};
+        if (header.rows == 0 or header.cols == 0)
+            throw zero_size{};
+        const size_t length{sizeof(header) + static_cast<size_t>(header.rows * header.cols * sizeof(T))};
+        const int fd{::open(path.c_str(), write_back ? O_RDWR : O_RDONLY)};
+        if (fd < 0)
+            throw file_error{};
+        struct stat file_status;
+        if (::fstat(fd, &file_status) != 0 or static_cast<size_t>(file_status.st_size) < length)
+        {
+            ::close(fd);
+            throw invalid_file_format{};
+        }
+        void *mapping{::mmap(nullptr, length, PROT_READ | PROT_WRITE, write_back ? MAP_SHARED : MAP_PRIVATE, fd, 0)};
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+            throw file_error{};
+        return matrix<T, Allocator, Layout>(static_cast<size_t>(header.rows), static_cast<size_t>(header.cols), mapping, length, mapping_tag{});
+#else
+        (void)write_back;
+        return load(path);
+#endif
+    }
+
+    // ================
+    // Member functions
+    // ================
+
+    /**
+     * @brief Overloaded operator = to copy the elements of one matrix to another matrix. Elements of trivially copyable types are copied in bulk using `memcpy()`, split between threads for large matrices.
+     *
+     * @param m The matrix to be copied.
+     * @return matrix<T, Allocator, Layout>& A reference to the target matrix.
+     */
+    matrix<T, Allocator, Layout> &operator=(const matrix<T, Allocator, Layout> &m)
+    {
+        if (this == &m)
+            return *this;
+#if defined(MATRIX_INSTRUMENT)
+        const matrix_detail::instrument_scope scope{matrix_detail::operation::copy_assign, m.rows * m.cols, 0};
+#endif
+#if defined(MATRIX_COPY_ON_WRITE)
+        if (m.shareable())
+        {
+            rows = m.rows;
+            cols = m.cols;
+            stride = m.stride;
+            smart = m.smart;
+            elements = m.elements;
+            return *this;
+        }
+#endif
+        // Reuse the existing memory if it has the right size.
+        const bool reuse{elements != nullptr and lines() * stride == m.lines() * m.stride and not is_shared()};
+        rows = m.rows;
+        cols = m.cols;
+        stride = m.stride;
+        if (not reuse)
+            allocate();
+        copy_elements(m.elements);
+        return *this;
+    }
+
+    /**
+     * @brief Overloaded operator = to move the elements of one matrix to another matrix.
+     *
+     * @param m The matrix to be moved.
+     * @return matrix<T, Allocator, Layout>& A reference to the target matrix.
+     */
+    matrix<T, Allocator, Layout> &operator=(matrix<T, Allocator, Layout> &&m)
+    {
+        rows = m.rows;
+        cols = m.cols;
+        stride = m.stride;
+        smart = move(m.smart);
+        elements = smart.get();
+        m.rows = 0;
+        m.cols = 0;
+        m.stride = 0;
+        m.elements = nullptr;
+        return *this;
+    }
+
+    /**
+     * @brief Overloaded operator = to assign the result of an elementwise matrix expression to a matrix. If the matrix already has the same number of rows and columns as the expression, the result is written directly into its existing elements, with no memory allocation. The expression may refer to the target matrix itself, as in `a = a + b`; if it refers to the same elements in a different arrangement, as in `a = a.view().transpose()`, it is evaluated into a new matrix instead.
+     *
+     * @param e The expression to be evaluated.
+     * @return matrix<T, Allocator, Layout>& A reference to the target matrix.
+     */
+    template <matrix_detail::expression E>
+        requires std::same_as<typename E::value_type, T>
+    matrix<T, Allocator, Layout> &operator=(const E &e)
+    {
+        if (rows == e.get_rows() and cols == e.get_cols() and not is_shared() and not e.conflicts_with(matrix_view<const T>(*this)))
+        {
+#if defined(MATRIX_INSTRUMENT)
+            // The other branch is recorded by the constructor.
+            const matrix_detail::instrument_scope scope{matrix_detail::expression_operation<E>, rows * cols, static_cast<uint64_t>(rows) * cols * matrix_detail::expression_flops<E>};
+#endif
+            matrix_detail::evaluate(e, elements, get_row_stride(), get_col_stride());
+        }
+        else
+            *this = matrix<T, Allocator, Layout>(e);
+        return *this;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the number of rows in the matrix.
+     *
+     * @return The number of rows.
+     */
+    inline size_t get_rows() const
+    {
+        return rows;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the number of columns in the matrix
+     *
+     * @return The number of columns.
+     */
+    inline size_t get_cols() const
+    {
+        return cols;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the stride of the matrix, that is, the distance between the first elements of consecutive rows, or of consecutive columns for a column-major matrix (known as the leading dimension in BLAS and LAPACK). This is equal to the number of columns (or rows), unless the matrix was created with padded().
+     *
+     * @return The stride.
+     */
+    inline size_t get_stride() const
+    {
+        return stride;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the distance between consecutive rows of the matrix: get_stride() for a row-major matrix, or 1 for a column-major matrix.
+     *
+     * @return The row stride.
+     */
+    inline size_t get_row_stride() const
+    {
+        return (Layout == layout::row_major) ? stride : 1;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the distance between consecutive columns of the matrix: 1 for a row-major matrix, or get_stride() for a column-major matrix.
+     *
+     * @return The column stride.
+     */
+    inline size_t get_col_stride() const
+    {
+        return (Layout == layout::row_major) ? 1 : stride;
+    }
+
+    /**
+     * @brief Member function used to obtain direct access to the elements of the matrix, stored in flattened 1-dimensional form, with the element at row `i` and column `j` at index `(stride * i) + j` for a row-major matrix, or `i + (stride * j)` for a column-major matrix, where `stride` is given by get_stride().
+     *
+     * @return A pointer to the first element.
+     */
+    inline T *data()
+    {
+        unshare();
+        return elements;
+    }
+
+    /**
+     * @brief Member function used to obtain direct access to the elements of the matrix, stored in flattened 1-dimensional form, with the element at row `i` and column `j` at index `(stride * i) + j` for a row-major matrix, or `i + (stride * j)` for a column-major matrix, where `stride` is given by get_stride().
+     *
+     * @return A pointer to the first element, which cannot be used to modify the elements.
+     */
+    inline const T *data() const
+    {
+        return elements;
+    }
+
+    /**
+     * @brief Overloaded operator () used to access matrix elements WITHOUT range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return A reference to the element, which can also be used to modify it.
+     */
+    inline T &operator()(const size_t &row, const size_t &col)
+    {
+        unshare();
+        return elements[index(row, col)];
+    }
+
+    /**
+     * @brief Overloaded operator () used to access matrix elements WITHOUT range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return The value of the element.
+     */
+    inline T operator()(const size_t &row, const size_t &col) const
+    {
+        return elements[index(row, col)];
+    }
+
+    /**
+     * @brief Member function used to access matrix elements WITH range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return A reference to the element, which can also be used to modify it.
+     * @throws index_out_of_range if the requested element is out of range.
+     */
+    inline T &at(const size_t &row, const size_t &col)
+    {
+        if (row >= rows or col >= cols)
+            throw index_out_of_range{};
+        unshare();
+        return elements[index(row, col)];
+    }
+
+    /**
+     * @brief Member function used to access matrix elements WITH range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return The value of the element.
+     * @throws index_out_of_range if the requested element is out of range.
+     */
+    inline T at(const size_t &row, const size_t &col) const
+    {
+        if (row >= rows or col >= cols)
+            throw index_out_of_range{};
+        return elements[index(row, col)];
+    }
+
+    /**
+     * @brief Member function used to obtain a view of all of the elements of the matrix, which can be used to modify them.
+     *
+     * @return The view.
+     */
+    inline matrix_view<T> view()
+    {
+        unshare();
+        return matrix_view<T>(*this);
+    }
+
+    /**
+     * @brief Member function used to obtain a read-only view of all of the elements of the matrix.
+     *
+     * @return The view.
+     */
+    inline matrix_view<const T> view() const
+    {
+        return matrix_view<const T>(*this);
+    }
+
+    /**
+     * @brief Member function used to obtain a view of a rectangular block of the matrix, without copying any elements. See matrix_view::block().
+     */
+    inline matrix_view<T> block(const size_t &first_row, const size_t &first_col, const size_t &block_rows, const size_t &block_cols)
+    {
+        return view().block(first_row, first_col, block_rows, block_cols);
+    }
+
+    /**
+     * @brief Member function used to obtain a read-only view of a rectangular block of the matrix, without copying any elements. See matrix_view::block().
+     */
+    inline matrix_view<const T> block(const size_t &first_row, const size_t &first_col, const size_t &block_rows, const size_t &block_cols) const
+    {
+        return view().block(first_row, first_col, block_rows, block_cols);
+    }
+
+    /**
+     * @brief Member function used to obtain a view of one row of the matrix, without copying any elements. See matrix_view::row().
+     */
+    inline matrix_view<T> row(const size_t &row)
+    {
+        return view().row(row);
+    }
+
+    /**
+     * @brief Member function used to obtain a read-only view of one row of the matrix, without copying any elements. See matrix_view::row().
+     */
+    inline matrix_view<const T> row(const size_t &row) const
+    {
+        return view().row(row);
+    }
+
+    /**
+     * @brief Member function used to obtain a view of one column of the matrix, without copying any elements. See matrix_view::col().
+     */
+    inline matrix_view<T> col(const size_t &col)
+    {
+        return view().col(col);
+    }
+
+    /**
+     * @brief Member function used to obtain a read-only view of one column of the matrix, without copying any elements. See matrix_view::col().
+     */
+    inline matrix_view<const T> col(const size_t &col) const
+    {
+        return view().col(col);
+    }
+
+    /**
+     * @brief Member function used to obtain the transpose of the matrix as a new matrix. Uses a cache-oblivious blocked algorithm with SIMD shuffles for 4-byte and 8-byte elements, and is parallelized for large matrices, so it is much faster than copying the elements one by one. To use the transpose in an expression or a product without copying any elements, use `view().transpose()` instead.
+     *
+     * @return The transpose.
+     */
+    matrix<T, Allocator, Layout> transpose() const
+    {
+        matrix<T, Allocator, Layout> t(cols, rows);
+        // A column-major matrix is stored as the row-major transpose, so the same kernel applies with the dimensions swapped.
+        matrix_detail::transpose(lines(), line_length(), elements, stride, t.elements, t.stride);
+        return t;
+    }
+
+    /**
+     * @brief Member function used to replace the matrix with its transpose. Square matrices are transposed in place, with no memory allocation, by swapping tiles on either side of the diagonal. Other matrices are replaced with transpose(), which allocates new memory.
+     *
+     * @return A reference to this matrix.
+     */
+    matrix<T, Allocator, Layout> &transpose_in_place()
+    {
+        if (rows == cols)
+        {
+            unshare();
+            matrix_detail::transpose_in_place(rows, elements, stride);
+        }
+        else
+            *this = transpose();
+        return *this;
+    }
+
+    /**
+     * @brief Member function used to apply a function to each element of the matrix. The function is not applied immediately; instead, an elementwise expression is returned, which can be combined with other expressions, including further calls to map(), and is evaluated in a single fused loop when it is assigned to or converted to a matrix. For example, `matrix<double> c = (a + b).map(f);` computes `f(a(i, j) + b(i, j))` for all elements in one pass. See matrix_detail::map_expression for the requirements on the function.
+     *
+     * @param f The function, taking one element and returning the new element, which may be of a different type.
+     * @return An expression for the result.
+     */
+    template <typename F>
+    auto map(const F &f) const
+    {
+        return view().map(f);
+    }
+
+    /**
+     * @brief Member function used to replace each element of the matrix with the result of applying a function to it, in a single loop over the elements, split between threads for large matrices. The result of the function is converted to `T`.
+     *
+     * @param f The function, taking one element and returning the new element.
+     * @return A reference to this matrix.
+     */
+    template <typename F>
+    matrix<T, Allocator, Layout> &map_inplace(const F &f)
+    {
+        return *this = map([&f](const T &x)
+                           { return static_cast<T>(f(x)); });
+    }
+
+    /**
+     * @brief Member function used to write the matrix to a binary file, which can be read back using load() or mapped(). The file starts with a 64-byte header giving the type of the elements, the number of rows and columns, and the byte order, followed by the elements themselves in flattened 1-dimensional form, exactly as they are stored in memory, so no precision is lost. The elements are always written in row-major order, so a column-major matrix is first converted to a row-major copy.
+     *
+     * @param path The path of the file. If the file already exists, it is overwritten.
+     * @throws file_error if the file could not be opened or written.
+     */
+    void save(const std::string &path) const
+        requires std::is_trivially_copyable_v<T>
+    {
+        if constexpr (Layout != layout::row_major)
+        {
+            matrix<T, Allocator>(*this).save(path);
+            return;
+        }
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (not out)
+            throw file_error{};
+        matrix_detail::file_header header;
+        header.dtype = matrix_detail::dtype_code<T>();
+        header.element_size = sizeof(T);
+        header.rows = rows;
+        header.cols = cols;
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        if (stride == cols)
+            out.write(reinterpret_cast<const char *>(elements), static_cast<std::streamsize>(rows * cols * sizeof(T)));
+        else
+            for (size_t i{0}; i < rows; i++)
+                out.write(reinterpret_cast<const char *>(elements + (stride * i)), static_cast<std::streamsize>(cols * sizeof(T)));
+        if (not out.flush())
+            throw file_error{};
+    }
+
+    /**
+     * @brief Member function used to write the matrix to a stream in CSV format, one row per line, with the elements separated by commas or another delimiter. This is much faster than operator<<(), as the elements are formatted using `std::to_chars()` into a buffer that is written to the stream in large chunks. Floating-point elements are written with the shortest representation that reads back to exactly the same value. The matrix can be read back using read_csv().
+     *
+     * @param out The output stream.
+     * @param delimiter The character used to separate the elements in each row.
+     */
+    void write_csv(std::ostream &out, const char &delimiter = ',') const
+        requires matrix_detail::text_convertible<T>
+    {
+        matrix_detail::write_delimited(view(), out, delimiter);
+    }
+
+    /**
+     * @brief Member function used to write the matrix to a stream as plain text, one row per line, with the elements separated by spaces. Formatted in the same way as write_csv(). The matrix can be read back using read_text().
+     *
+     * @param out The output stream.
+     */
+    void write_text(std::ostream &out) const
+        requires matrix_detail::text_convertible<T>
+    {
+        matrix_detail::write_delimited(view(), out, ' ');
+    }
+
+    /**
+     * @brief Member function used to add a scalar multiple of another matrix to this matrix, that is, to compute `a = a + (alpha * b)` (known as "axpy" in BLAS). The result is computed directly into the existing elements of this matrix, in a single pass and with no memory allocation.
+     *
+     * @param alpha The scalar.
+     * @param b The matrix to be multiplied by the scalar and added. May also be an elementwise matrix expression.
+     * @return A reference to this matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <matrix_detail::operand E>
+        requires std::same_as<typename E::value_type, T>
+    matrix<T, Allocator, Layout> &add_scaled(const T &alpha, const E &b)
+    {
+#if defined(MATRIX_USE_BLAS)
+        if constexpr (std::same_as<E, matrix<T, Allocator, Layout>>)
+            if (blas_add_scaled(alpha, b))
+                return *this;
+#endif
+        return *this += alpha * b;
+    }
+
+    /**
+     * @brief Static member function used to set the character width of the matrix elements when printing a matrix to a stream.
+     *
+     * @param w The new character width of the matrix elements. Will be used in operator<<() by inserting `std::setw` into the output stream.
+     */
+    inline static void set_output_width(const int &w)
+    {
+        output_width = w;
+    }
+
+    /**
+     * @brief Static member function used to set the number of threads used to parallelize matrix operations on large matrices. The thread pool is shared by matrices of all element types, so this affects all of them.
+     *
+     * @param n The new number of threads, including the calling thread. If zero, the number of hardware threads is used, which is also the default. If one, all operations are performed serially.
+     */
+    inline static void set_num_threads(const size_t &n)
+    {
+        matrix_detail::thread_pool::global().set_num_threads(n);
+    }
+
+    /**
+     * @brief Static member function used to obtain the number of threads used to parallelize matrix operations on large matrices.
+     *
+     * @return The number of threads, including the calling thread.
+     */
+    inline static size_t get_num_threads()
+    {
+        return matrix_detail::thread_pool::global().get_num_threads();
+    }
+
+#if defined(MATRIX_USE_BLAS)
+    /**
+     * @brief Static member function used to set the sizes above which operations on `float` and `double` matrices are performed by the BLAS library. Only available if `MATRIX_USE_BLAS` is defined. The thresholds are shared by matrices of all element types.
+     *
+     * @param gemm The minimal value of m * n * k for which an m x k by k x n matrix product calls `sgemm` or `dgemm`. If zero, all products call the library; if `SIZE_MAX`, none do.
+     * @param vector The minimal number of elements for which `+=`, `-=`, add_scaled(), and `*=` by a scalar call `axpy` or `scal`.
+     */
+    inline static void set_blas_thresholds(const size_t &gemm, const size_t &vector)
+    {
+        matrix_detail::blas_gemm_threshold = gemm;
+        matrix_detail::blas_vector_threshold = vector;
+    }
+#endif
+
+    // ================
+    // Friend functions
+    // ================
+
+    /**
+     * @brief Overloaded binary operator `<<` used to easily print out a matrix to a stream.
+     *
+     * @param out The output stream.
+     * @param m The matrix to be printed.
+     * @return A reference to the output stream.
+     */
+    friend std::ostream &operator<<(std::ostream &out, const matrix<T, Allocator, Layout> &m)
+    {
+        if (m.rows == 0 and m.cols == 0)
+            out << "()\n";
+        else
+        {
+            for (size_t i{0}; i < m.rows; i++)
+            {
+                out << "( ";
+                for (size_t j{0}; j < m.cols; j++)
+                    out << std::setw(m.output_width) << m(i, j) << ' ';
+                out << ")\n";
+            }
+            out << '\n';
+        }
+        return out;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+=` used to add two matrices and assign the result to the first one. The sum is computed directly into the existing elements of the first matrix, in a single pass and with no memory allocation. The second operand may also be an elementwise matrix expression, such as in `a += 2.0 * b`.
+     *
+     * @param a The first matrix to be added. Will be replaced with the sum of the matrices.
+     * @param b The second matrix to be added.
+     * @return A reference to the first matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <matrix_detail::operand E>
+        requires std::same_as<typename E::value_type, T>
+    inline friend matrix<T, Allocator, Layout> &operator+=(matrix<T, Allocator, Layout> &a, const E &b)
+    {
+#if defined(MATRIX_USE_BLAS)
+        if constexpr (std::same_as<E, matrix<T, Allocator, Layout>>)
+            if (a.blas_add_scaled(T{1}, b))
+                return a;
+#endif
+        return a = a + b;
+    }
+
+    /**
+     * @brief Overloaded binary operator `-=` used to subtract two matrices and assign the result to the first one. The difference is computed directly into the existing elements of the first matrix, in a single pass and with no memory allocation. The second operand may also be an elementwise matrix expression.
+     *
+     * @param a The first matrix to be subtracted. Will be replaced with first matrix minus the second matrix.
+     * @param b The second matrix to be subtracted.
+     * @return A reference to the first matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <matrix_detail::operand E>
+        requires std::same_as<typename E::value_type, T>
+    inline friend matrix<T, Allocator, Layout> &operator-=(matrix<T, Allocator, Layout> &a, const E &b)
+    {
+#if defined(MATRIX_USE_BLAS)
+        if constexpr (std::same_as<E, matrix<T, Allocator, Layout>>)
+            if (a.blas_add_scaled(T{-1}, b))
+                return a;
+#endif
+        return a = a - b;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*=` used to multiply a matrix by a scalar and assign the result to the matrix. The elements are multiplied in place, with no memory allocation.
+     *
+     * @param m The matrix. Will be replaced with the product of the scalar with the matrix.
+     * @param s The scalar.
+     * @return A reference to the matrix.
+     */
+    inline friend matrix<T, Allocator, Layout> &operator*=(matrix<T, Allocator, Layout> &m, const T &s)
+    {
+#if defined(MATRIX_USE_BLAS)
+        if constexpr (matrix_detail::blas_type<T>)
+        {
+            if (m.rows * m.cols >= matrix_detail::blas_vector_threshold)
+            {
+                m.unshare();
+                if (m.stride == m.line_length())
+                    matrix_detail::blas_scal(m.rows * m.cols, s, m.elements);
+                else
+                    for (size_t i{0}; i < m.lines(); i++)
+                        matrix_detail::blas_scal(m.line_length(), s, m.elements + (i * m.stride));
+                return m;
+            }
+        }
+#endif
+        return m = s * m;
+    }
+
+    /**
+     * @brief Overloaded binary operator `/=` used to divide a matrix by a scalar and assign the result to the matrix. The elements are divided in place, with no memory allocation.
+     *
+     * @param m The matrix. Will be replaced with the matrix divided by the scalar.
+     * @param s The scalar.
+     * @return A reference to the matrix.
+     */
+    inline friend matrix<T, Allocator, Layout> &operator/=(matrix<T, Allocator, Layout> &m, const T &s)
+    {
+        m.unshare();
+        matrix_detail::evaluate(matrix_detail::unary_expression(matrix_detail::as_expression(m), matrix_detail::divide_op<T>{s}), m.elements, m.get_row_stride(), m.get_col_stride());
+        return m;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply two matrices.
+     * @details Large products are computed using a cache-blocked algorithm with a register-tiled micro-kernel. Each element of the product is accumulated in the same order as in the naive triple loop, so the result does not depend on the algorithm used (as long as the compiler is not allowed to contract multiplications and additions into fused multiply-add instructions, which would also affect the naive loop). If `MATRIX_USE_BLAS` is defined, large products of `float` and `double` matrices are computed by the BLAS library instead, which does not make this guarantee.
+     *
+     * @param a The first matrix to be multiplied.
+     * @param b The second matrix to be multiplied.
+     * @return The product of the matrices.
+     * @throws incompatible_sizes_multiply if the number of columns in the first matrix is not the same as the number of rows in the second matrix.
+     */
+    friend matrix<T, Allocator, Layout> operator*(const matrix<T, Allocator, Layout> &a, const matrix<T, Allocator, Layout> &b)
+    {
+        if (a.cols != b.rows)
+            throw incompatible_sizes_multiply{};
+#if defined(MATRIX_INSTRUMENT)
+        const matrix_detail::instrument_scope scope{matrix_detail::operation::multiply, a.rows * b.cols, 2 * static_cast<uint64_t>(a.rows) * a.cols * b.cols};
+#endif
+        matrix<T, Allocator, Layout> c(a.rows, b.cols);
+        matrix_detail::gemm(a.rows, b.cols, a.cols, a.elements, a.get_row_stride(), a.get_col_stride(), b.elements, b.get_row_stride(), b.get_col_stride(), c.elements, c.get_row_stride(), c.get_col_stride());
+        return c;
+    }
+
+    // ==========
+    // Exceptions
+    // ==========
+
+    /**
+     * @brief Exception to be thrown if the number of rows or columns given to the constructor is zero.
+     */
+    using zero_size = matrix_detail::zero_size<T>;
+
+    /**
+     * @brief Exception to be thrown if the size of the `vector` or `initializer_list` provided to the constructor does not equal the total number of matrix elements.
+     */
+    using initializer_wrong_size = matrix_detail::initializer_wrong_size<T>;
+
+    /**
+     * @brief Exception to be thrown if two matrices that are added or subtracted do not have the same number of rows and columns.
+     */
+    using incompatible_sizes_add = matrix_detail::incompatible_sizes_add<T>;
+
+    /**
+     * @brief Exception to be thrown when multiplying two matrices if the number of columns in the first matrix is not the same as the number of rows in the second matrix.
+     */
+    using incompatible_sizes_multiply = matrix_detail::incompatible_sizes_multiply<T>;
+
+    /**
+     * @brief Exception to be thrown if the requested matrix element is out of range.
+     */
+    using index_out_of_range = matrix_detail::index_out_of_range<T>;
+
+    /**
+     * @brief Exception to be thrown if a file could not be opened, read, written, or mapped into memory.
+     */
+    using file_error = matrix_detail::file_error<T>;
+
+    /**
+     * @brief Exception to be thrown if a file is not a valid binary matrix file, or does not contain elements of the right type, or if a text file could not be parsed.
+     */
+    using invalid_file_format = matrix_detail::invalid_file_format<T>;
+
+private:
+    /**
+     * @brief The number of rows.
+     */
+    size_t rows{0};
+
+    /**
+     * @brief The number of columns.
+     */
+    size_t cols{0};
+
+    /**
+     * @brief The stride, that is, the distance between the first elements of consecutive rows, or of consecutive columns for a column-major matrix.
+     */
+    size_t stride{0};
+
+    /**
+     * @brief The stride of a new matrix without padding: the number of columns for a row-major matrix, or the number of rows for a column-major matrix.
+     *
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @return The stride.
+     */
+    static size_t leading_dimension(const size_t &input_rows, const size_t &input_cols)
+    {
+        return (Layout == layout::row_major) ? input_cols : input_rows;
+    }
+
+    /**
+     * @brief The number of contiguous lines of elements: the number of rows for a row-major matrix, or of columns for a column-major matrix. The elements occupy `lines() * stride` positions in memory.
+     *
+     * @return The number of lines.
+     */
+    inline size_t lines() const
+    {
+        return (Layout == layout::row_major) ? rows : cols;
+    }
+
+    /**
+     * @brief The number of elements in each contiguous line: the number of columns for a row-major matrix, or of rows for a column-major matrix.
+     *
+     * @return The number of elements in each line.
+     */
+    inline size_t line_length() const
+    {
+        return (Layout == layout::row_major) ? cols : rows;
+    }
+
+    /**
+     * @brief The index in the array of elements of the element at a given row and column.
+     *
+     * @param row The row index.
+     * @param col The column index.
+     * @return The index.
+     */
+    inline size_t index(const size_t &row, const size_t &col) const
+    {
+        if constexpr (Layout == layout::row_major)
+            return (stride * row) + col;
+        else
+            return row + (stride * col);
+    }
+
+    /**
+     * @brief A pointer to an array storing the elements of the matrix in flattened 1-dimensional form.
+     */
+    T *elements{nullptr};
+
+    /**
+     * @brief The possible sources of the memory used for the matrix elements.
+     */
+    enum class storage
+    {
+        /**
+         * @brief The memory was allocated using the allocator.
+         */
+        allocator,
+
+        /**
+         * @brief The memory was taken from a matrix_arena, and is released by the arena.
+         */
+        arena,
+
+        /**
+         * @brief The memory is a file mapped into memory by mapped(), and is unmapped when the matrix is destroyed.
+         */
+        mapping,
+
+        /**
+         * @brief The memory consists of zero pages mapped from the operating system by allocate_zeroed(), and is unmapped when the matrix is destroyed.
+         */
+        zeroed
+    };
+
+    /**
+     * @brief A deleter used by the smart pointer to destroy the matrix elements and release their memory, according to where it came from.
+     */
+    struct deleter
+    {
+        /**
+         * @brief The number of elements that were allocated, or for a mapping, its length in bytes.
+         */
+        size_t size{0};
+
+        /**
+         * @brief Where the memory came from.
+         */
+        storage source{storage::allocator};
+
+        void operator()(T *p) const
+        {
+            if (source == storage::arena)
+                return;
+            if (source == storage::mapping)
+            {
+#if defined(__unix__) or defined(__APPLE__)
+                ::munmap(reinterpret_cast<std::byte *>(p) - sizeof(matrix_detail::file_header), size);
+#endif
+                return;
+            }
+            if (source == storage::zeroed)
+            {
+#if defined(__unix__) or defined(__APPLE__)
+                ::munmap(p, size);
+#endif
+                return;
+            }
+            if constexpr (not std::is_trivially_destructible_v<T>)
+                std::destroy_n(p, size);
+            Allocator allocator;
+            std::allocator_traits<Allocator>::deallocate(allocator, p, size);
+        }
+    };
+
+#if defined(MATRIX_COPY_ON_WRITE)
+    /**
+     * @brief A reference-counted smart pointer to manage the memory allocated for the matrix elements, which may be shared by several matrices until one of them is modified.
+     */
+    std::shared_ptr<T[]> smart{nullptr};
+
+    /**
+     * @brief Check whether copies of this matrix can share its elements. This is only the case for memory taken from the allocator or from zero pages: memory taken from a matrix_arena is released when the arena scope ends, and modifications to a mapped file should not depend on whether the matrix was copied.
+     *
+     * @return true if the elements can be shared.
+     */
+    inline bool shareable() const
+    {
+        const deleter *d{std::get_deleter<deleter>(smart)};
+        return d != nullptr and (d->source == storage::allocator or d->source == storage::zeroed);
+    }
+#else
+    /**
+     * @brief A smart pointer to manage the memory allocated for the matrix elements.
+     */
+    std::unique_ptr<T[], deleter> smart{nullptr};
+#endif
+
+    /**
+     * @brief Check whether the elements are shared with another matrix. Always false unless `MATRIX_COPY_ON_WRITE` is defined.
+     *
+     * @return true if the elements are shared.
+     */
+    inline bool is_shared() const
+    {
+#if defined(MATRIX_COPY_ON_WRITE)
+        return smart.use_count() > 1;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Give the matrix its own copy of its elements if they are shared with another matrix, so that they can be modified without affecting the other matrix. Called by every member function that gives write access to the elements. Does nothing unless `MATRIX_COPY_ON_WRITE` is defined.
+     */
+    inline void unshare()
+    {
+#if defined(MATRIX_COPY_ON_WRITE)
+        if (is_shared()) [[unlikely]]
+        {
+            // Keep a reference to the shared memory while copying from it, in case the other owners release it on another thread.
+            const std::shared_ptr<T[]> shared{smart};
+            const T *shared_elements{elements};
+            allocate();
+            copy_elements(shared_elements);
+        }
+#endif
+    }
+
+    /**
+     * @brief A tag type used to select the private constructor used by padded().
+     */
+    struct padding_tag
+    {
+    };
+
+    /**
+     * @brief Private constructor to create an UNINITIALIZED matrix with a given stride. Used by padded().
+     *
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @param input_stride The stride.
+     * @throws zero_size if the number of rows or columns is zero.
+     */
+    matrix(const size_t &input_rows, const size_t &input_cols, const size_t &input_stride, padding_tag)
+        : rows(input_rows), cols(input_cols), stride(input_stride)
+    {
+        if (rows == 0 or cols == 0)
+            throw zero_size{};
+        allocate();
+    }
+
+    /**
+     * @brief A tag type used to select the private constructor used by zeros().
+     */
+    struct zeros_tag
+    {
+    };
+
+    /**
+     * @brief Private constructor to create a matrix with all of its elements initialized to zero. Used by zeros().
+     *
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @throws zero_size if the number of rows or columns is zero.
+     */
+    matrix(const size_t &input_rows, const size_t &input_cols, zeros_tag)
+        : rows(input_rows), cols(input_cols), stride(leading_dimension(input_rows, input_cols))
+    {
+        if (rows == 0 or cols == 0)
+            throw zero_size{};
+        allocate_zeroed();
+    }
+
+    /**
+     * @brief A tag type used to select the private constructor used by mapped().
+     */
+    struct mapping_tag
+    {
+    };
+
+    /**
+     * @brief Private constructor to create a matrix whose elements are stored in a file mapped into memory. Used by mapped().
+     *
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @param mapping A pointer to the start of the mapping, where the file header is stored. The elements follow the header.
+     * @param length The length of the mapping in bytes.
+     */
+    matrix(const size_t &input_rows, const size_t &input_cols, void *mapping, const size_t &length, mapping_tag)
+        : rows(input_rows), cols(input_cols), stride(input_cols)
+    {
+        elements = reinterpret_cast<T *>(static_cast<std::byte *>(mapping) + sizeof(matrix_detail::file_header));
+        smart = std::unique_ptr<T[], deleter>(elements, deleter{length, storage::mapping});
+    }
+
+    /**
+     * @brief Whether matrices of this type take their memory from the active matrix_arena, if there is one. The arena never runs destructors, so only trivially destructible element types qualify, and only with the default allocator, since a custom allocator is an explicit request for a particular kind of memory.
+     */
+    static constexpr bool uses_arena{std::is_trivially_destructible_v<T> and alignof(T) <= 64 and std::same_as<Allocator, aligned_allocator<T>>};
+
+    /**
+     * @brief Allocate memory for `lines() * stride` elements, replacing any previously allocated memory. The memory is taken from the active matrix_arena if there is one (see uses_arena), or from the allocator otherwise. Elements of trivially default constructible types are left UNINITIALIZED, as with `new T[]`; other types are default constructed.
+     */
+    void allocate()
+    {
+        const size_t size{lines() * stride};
+#if defined(MATRIX_INSTRUMENT)
+        matrix_detail::record_allocation(size, static_cast<uint64_t>(size) * sizeof(T));
+#endif
+        if constexpr (uses_arena)
+        {
+            if (matrix_arena *arena{matrix_arena::active()})
+            {
+                if (size > static_cast<size_t>(-1) / sizeof(T))
+                    throw std::bad_array_new_length{};
+                T *p{static_cast<T *>(arena->allocate(size * sizeof(T), Allocator::alignment))};
+                if constexpr (not std::is_trivially_default_constructible_v<T>)
+                    std::uninitialized_default_construct_n(p, size);
+                smart = std::unique_ptr<T[], deleter>(p, deleter{size, storage::arena});
+                elements = p;
+                return;
+            }
+        }
+        Allocator allocator;
+        T *p{std::allocator_traits<Allocator>::allocate(allocator, size)};
+        if constexpr (not std::is_trivially_default_constructible_v<T>)
+        {
+            try
+            {
+                std::uninitialized_default_construct_n(p, size);
+            }
+            catch (...)
+            {
+                std::allocator_traits<Allocator>::deallocate(allocator, p, size);
+                throw;
+            }
+        }
+        smart = std::unique_ptr<T[], deleter>(p, deleter{size, storage::allocator});
+        elements = p;
+    }
+
+    /**
+     * @brief The smallest size in bytes for which allocate_zeroed() maps zero pages from the operating system instead of filling the memory with zeros. Smaller mappings would waste most of a page, and the system call costs more than zeroing the memory directly.
+     */
+    static constexpr size_t zeroed_mapping_threshold{size_t{1} << 20};
+
+    /**
+     * @brief Allocate memory for `lines() * stride` elements, replacing any previously allocated memory, and initialize all of them to zero. For large matrices of arithmetic types with the default allocator, outside any matrix_arena scope, anonymous memory is mapped from the operating system, whose pages are zero and only allocated when first accessed. Otherwise, the memory is obtained by allocate() and filled with zeros.
+     */
+    void allocate_zeroed()
+    {
+        const size_t size{lines() * stride};
+#if defined(__unix__) or defined(__APPLE__)
+        if constexpr (std::is_arithmetic_v<T> and std::same_as<Allocator, aligned_allocator<T>>)
+        {
+            if (size >= zeroed_mapping_threshold / sizeof(T) and size <= static_cast<size_t>(-1) / sizeof(T) and matrix_arena::active() == nullptr)
+            {
+                void *mapping{::mmap(nullptr, size * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+                if (mapping != MAP_FAILED)
+                {
+#if defined(MATRIX_INSTRUMENT)
+                    matrix_detail::record_allocation(size, static_cast<uint64_t>(size) * sizeof(T));
+#endif
+                    elements = static_cast<T *>(mapping);
+                    smart = std::unique_ptr<T[], deleter>(elements, deleter{size * sizeof(T), storage::zeroed});
+                    return;
+                }
+            }
+        }
+#endif
+        allocate();
+        matrix_detail::for_each_chunk(size, [&](const size_t &begin, const size_t &end)
+                                      { std::fill(elements + begin, elements + end, static_cast<T>(0)); });
+    }
+
+    /**
+     * @brief Copy the elements of a matrix with the same dimensions and stride, stored in flattened 1-dimensional form, into the already allocated memory of this matrix. If there is no padding, all of the elements are copied as one contiguous block, and otherwise each line is copied separately, skipping the padding. For trivially copyable types, `std::copy()` uses `memmove()`. Large matrices are split between threads.
+     *
+     * @param source A pointer to the first element of the source.
+     */
+    void copy_elements(const T *source)
+    {
+        if (stride == line_length())
+            matrix_detail::for_each_chunk(rows * cols, [&](const size_t &begin, const size_t &end)
+                                          { std::copy(source + begin, source + end, elements + begin); });
+        else
+            matrix_detail::for_each_row_chunk(lines(), line_length(), [&](const size_t &begin, const size_t &end)
+                                              {
+                                                  for (size_t i{begin}; i < end; i++)
+                                                      std::copy_n(source + (i * stride), line_length(), elements + (i * stride));
+                                              });
+    }
+
+    /**
+     * @brief Copy or move elements given in flattened 1-dimensional row-major form, as taken by the `vector` constructor, into the already allocated memory of this matrix, which must not be padded. For a row-major matrix, the elements are copied as one contiguous block; for a column-major matrix, they are rearranged column by column. Large matrices are split between threads.
+     *
+     * @tparam Iterator A random access iterator, such as a `const` iterator to copy the elements or a `std::move_iterator` to move them.
+     * @param source An iterator to the first element.
+     */
+    template <typename Iterator>
+    void assign_flattened(const Iterator &source)
+    {
+        if constexpr (Layout == layout::row_major)
+            matrix_detail::for_each_chunk(rows * cols, [&](const size_t &begin, const size_t &end)
+                                          { std::copy(source + static_cast<std::ptrdiff_t>(begin), source + static_cast<std::ptrdiff_t>(end), elements + begin); });
+        else
+            matrix_detail::for_each_row_chunk(cols, rows, [&](const size_t &begin, const size_t &end)
+                                              {
+                                                  for (size_t j{begin}; j < end; j++)
+                                                      for (size_t i{0}; i < rows; i++)
+                                                          elements[(stride * j) + i] = source[static_cast<std::ptrdiff_t>((cols * i) + j)];
+                                              });
+    }
+
+    /**
+     * @brief The character width of the matrix elements. Will be used in operator<<() by inserting std::setw into the output stream.
+     */
+    static int output_width;
+
+#if defined(MATRIX_USE_BLAS)
+    /**
+     * @brief Compute `a = a + (alpha * b)` in place by calling `axpy` from the BLAS library, if T is `float` or `double` and the matrices are large enough.
+     *
+     * @param alpha The scalar.
+     * @param b The matrix to be multiplied by the scalar and added.
+     * @return false if nothing was computed, in which case the caller should fall back to the built-in implementation. This is also the case if the matrices have different sizes, so that the built-in implementation throws the usual exception.
+     */
+    bool blas_add_scaled(const T &alpha, const matrix<T, Allocator, Layout> &b)
+    {
+        if constexpr (matrix_detail::blas_type<T>)
+        {
+            if (rows != b.rows or cols != b.cols or rows * cols < matrix_detail::blas_vector_threshold or elements == b.elements)
+                return false;
+            unshare();
+            if (stride == line_length() and b.stride == line_length())
+                matrix_detail::blas_axpy(rows * cols, alpha, b.elements, elements);
+            else
+                for (size_t i{0}; i < lines(); i++)
+                    matrix_detail::blas_axpy(line_length(), alpha, b.elements + (i * b.stride), elements + (i * stride));
+            return true;
+        }
+        else
+            return false;
+    }
+#endif
+};
+
+// Initialize output_width to have a default value of 5
+template <typename T, typename Allocator, layout Layout>
+int matrix<T, Allocator, Layout>::output_width{5};
+
+/**
+ * @brief Multiply two matrices using the Winograd variant of Strassen's algorithm, which performs asymptotically fewer arithmetic operations than operator*(), namely O(n^2.81) instead of O(n^3). The recursion stops once any of the dimensions is no larger than the cutoff, and the blocked kernel used by operator*() is used from there on. Matrices of any size are supported; odd dimensions are handled by peeling off the last row or column at each level.
+ * @details The temporary memory used is bounded: at most (mk + kn + mn) / 3 elements are allocated for an m x k matrix times a k x n matrix, which for square n x n matrices is n^2 elements, the size of the result.
+ *
+ * Strassen's algorithm is less accurate than the usual algorithm for floating-point types. The error is only bounded in norm, not for each element: the largest error in the result grows by a roughly constant factor with each level of recursion, on top of the error of the blocked kernel at the bottom. For example, for 4096x4096 matrices with random elements in [-1, 1], the largest absolute error in the result is about 5e-13 for `double` and 2e-4 for `float` with operator*(), 1e-12 and 7e-4 with 2 levels of recursion (cutoff 1024), and 5e-12 and 3e-3 with 4 levels (cutoff 256). Elements that are much smaller than the others may therefore have a large relative error. For integer types, the result is exact (as long as no intermediate result overflows).
+ *
+ * @param a The first matrix to be multiplied.
+ * @param b The second matrix to be multiplied.
+ * @param cutoff The size below which the blocked kernel is used. The recursion only pays off for large matrices. On a machine with AVX-512, a cutoff of 512 made 4096x4096 products about 1.4 times faster than operator*() for both `float` and `double`.
+ * @return The product of the matrices.
+ * @throws incompatible_sizes_multiply if the number of columns in the first matrix is not the same as the number of rows in the second matrix.
+ */
+template <typename T, typename Allocator, layout Layout>
+matrix<T, Allocator, Layout> multiply_strassen(const matrix<T, Allocator, Layout> &a, const matrix<T, Allocator, Layout> &b, const size_t &cutoff = 512)
+{
+    if (a.get_cols() != b.get_rows())
+        throw typename matrix<T, Allocator, Layout>::incompatible_sizes_multiply{};
+    matrix<T, Allocator, Layout> c(a.get_rows(), b.get_cols());
+    std::vector<T, aligned_allocator<T>> workspace(matrix_detail::strassen_workspace(a.get_rows(), b.get_cols(), a.get_cols(), cutoff));
+    matrix_detail::strassen(a.view(), b.view(), c.view(), workspace.data(), cutoff);
+    return c;
+}
+
+/**
+ * @brief Multiply a matrix by the transpose of another matrix, that is, compute A B^T, without creating the transpose. Both matrices are read along their rows, which are contiguous in memory for row-major matrices. The products A^T B and A^T B^T can be computed in the same way using `a.view().transpose() * b` and so on.
+ *
+ * @param a The first matrix A.
+ * @param b The second matrix B, whose transpose is multiplied.
+ * @return The product A B^T.
+ * @throws incompatible_sizes_multiply if the matrices do not have the same number of columns.
+ */
+template <typename T, typename Allocator, layout Layout>
+matrix<T, Allocator, Layout> multiply_transposed(const matrix<T, Allocator, Layout> &a, const matrix<T, Allocator, Layout> &b)
+{
+    if (a.get_cols() != b.get_cols())
+        throw typename matrix<T, Allocator, Layout>::incompatible_sizes_multiply{};
+#if defined(MATRIX_INSTRUMENT)
+    const matrix_detail::instrument_scope scope{matrix_detail::operation::multiply, a.get_rows() * b.get_rows(), 2 * static_cast<uint64_t>(a.get_rows()) * a.get_cols() * b.get_rows()};
+#endif
+    matrix<T, Allocator, Layout> c(a.get_rows(), b.get_rows());
+    matrix_detail::gemm(a.get_rows(), b.get_rows(), a.get_cols(), a.data(), a.get_row_stride(), a.get_col_stride(), b.data(), b.get_col_stride(), b.get_row_stride(), c.data(), c.get_row_stride(), c.get_col_stride());
+    return c;
+}
+
+/**
+ * @brief Multiply two matrices, accumulating the products in a different type than the elements of the matrices, as in `multiply<float>(a, b)` for `bf16` or `fp16` matrices, or `multiply<int32_t>(a, b)` for `int8_t` matrices. Unlike operator*(), which accumulates in the type of the elements, this gives accurate results for low-precision types, and reads only as much memory as the low-precision matrices themselves, instead of converting them to matrices of type `Acc` first.
+ * @details The elements are converted to `Acc` while they are packed for the multiplication kernel, so any types convertible to `Acc` may be used, and the two matrices may have different types. If the CPU supports it (compile with e.g. `-march=native`), products of `bf16` matrices into `float` use the AVX512-BF16 dot-product instructions, and products of `int8_t` matrices into `int32_t` use the AVX512-VNNI instructions. The former sum the products in pairs, so the results may differ slightly from those of the naive triple loop. The results for integers are always exact (modulo 2^32 for `int32_t`, as with the naive loop).
+ *
+ * @tparam Acc The type of the elements of the result, in which the products are accumulated. Must be specified explicitly.
+ * @param a The first matrix to be multiplied, as a view.
+ * @param b The second matrix to be multiplied, as a view.
+ * @return The product of the matrices.
+ * @throws incompatible_sizes_multiply if the number of columns in the first matrix is not the same as the number of rows in the second matrix.
+ */
+template <typename Acc, typename TA, typename TB>
+matrix<Acc> multiply(const matrix_view<TA> &a, const matrix_view<TB> &b)
+{
+    if (a.get_cols() != b.get_rows())
+        throw typename matrix<Acc>::incompatible_sizes_multiply{};
+#if defined(MATRIX_INSTRUMENT)
+    const matrix_detail::instrument_scope scope{matrix_detail::operation::multiply, a.get_rows() * b.get_cols(), 2 * static_cast<uint64_t>(a.get_rows()) * a.get_cols() * b.get_cols()};
+#endif
+    matrix<Acc> c(a.get_rows(), b.get_cols());
+    matrix_detail::gemm(a.get_rows(), b.get_cols(), a.get_cols(), a.data(), a.get_row_stride(), a.get_col_stride(), b.data(), b.get_row_stride(), b.get_col_stride(), c.data(), c.get_stride(), size_t{1});
+    return c;
+}
+
+/**
+ * @brief Multiply two matrices, accumulating the products in a different type than the elements of the matrices. See multiply(const matrix_view<TA> &, const matrix_view<TB> &) for details.
+ *
+ * @tparam Acc The type of the elements of the result, in which the products are accumulated. Must be specified explicitly.
+ * @param a The first matrix to be multiplied.
+ * @param b The second matrix to be multiplied.
+ * @return The product of the matrices.
+ * @throws incompatible_sizes_multiply if the number of columns in the first matrix is not the same as the number of rows in the second matrix.
+ */
+template <typename Acc, typename TA, typename AllocatorA, layout LayoutA, typename TB, typename AllocatorB, layout LayoutB>
+matrix<Acc> multiply(const matrix<TA, AllocatorA, LayoutA> &a, const matrix<TB, AllocatorB, LayoutB> &b)
+{
+    return multiply<Acc>(a.view(), b.view());
+}
+
+/**
+ * @brief Compute the matrix-vector product y = alpha A x + beta y, writing the result into memory provided by the caller. Unlike multiplying by an n x 1 matrix, this does not allocate any memory, and the rows of A are processed using SIMD dot products (or, if the columns of A are contiguous instead, as for a transposed view, by adding scaled columns of A to y). The rows of y are split between threads for large matrices.
+ *
+ * @param a The matrix A, as a view.
+ * @param x The vector x. Must have as many elements as A has columns.
+ * @param y The vector y, which is overwritten with the result. Must have as many elements as A has rows, and must not overlap with A or x.
+ * @param alpha The factor to multiply A x by.
+ * @param beta The factor to multiply the original y by. If it is zero (the default), the original elements of y are not read, so they do not need to be initialized.
+ * @throws incompatible_sizes_multiply if the sizes of the vectors are not compatible with the size of the matrix.
+ */
+template <typename T>
+void gemv(const matrix_view<T> &a, std::span<const std::remove_const_t<T>> x, std::span<std::remove_const_t<T>> y, const std::remove_const_t<T> &alpha = std::remove_const_t<T>{1}, const std::remove_const_t<T> &beta = std::remove_const_t<T>{0})
+{
+    if (x.size() != a.get_cols() or y.size() != a.get_rows())
+        throw matrix_detail::incompatible_sizes_multiply<std::remove_const_t<T>>{};
+    matrix_detail::gemv(a.get_rows(), a.get_cols(), a.data(), a.get_row_stride(), a.get_col_stride(), x.data(), y.data(), alpha, beta);
+}
+
+/**
+ * @brief Compute the matrix-vector product y = alpha A x + beta y, writing the result into memory provided by the caller. See gemv(const matrix_view<T> &, ...) for details.
+ *
+ * @param a The matrix A.
+ * @param x The vector x. Must have as many elements as A has columns.
+ * @param y The vector y, which is overwritten with the result. Must have as many elements as A has rows, and must not overlap with A or x.
+ * @param alpha The factor to multiply A x by.
+ * @param beta The factor to multiply the original y by. If it is zero (the default), the original elements of y are not read.
+ * @throws incompatible_sizes_multiply if the sizes of the vectors are not compatible with the size of the matrix.
+ */
+template <typename T, typename Allocator, layout Layout>
+void gemv(const matrix<T, Allocator, Layout> &a, std::type_identity_t<std::span<const T>> x, std::type_identity_t<std::span<T>> y, const std::type_identity_t<T> &alpha = T{1}, const std::type_identity_t<T> &beta = T{0})
+{
+    gemv(a.view(), x, y, alpha, beta);
+}
+
+/**
+ * @brief Multiply a batch of small matrices, C[p] = A[p] B[p] for p = 0, ..., batch - 1, where each matrix is stored row by row, and consecutive matrices of each batch are a fixed distance apart in memory. This is much faster than calling operator*() for each product, since no memory is allocated and no size checks or dispatching are done per product. Square products of size 2, 3, 4, 8, and 16 use fully unrolled kernels, and large batches are split between threads.
+ *
+ * @param batch The number of products.
+ * @param m The number of rows in each A and C matrix.
+ * @param n The number of columns in each B and C matrix.
+ * @param k The number of columns in each A matrix and rows in each B matrix.
+ * @param a A pointer to the first element of the first A matrix.
+ * @param stride_a The distance between the first elements of consecutive A matrices, usually m * k.
+ * @param b A pointer to the first element of the first B matrix.
+ * @param stride_b The distance between the first elements of consecutive B matrices, usually k * n. Can be zero to multiply every A matrix by the same B matrix.
+ * @param c A pointer to the first element of the first C matrix. The C matrices must not overlap with each other or with the A and B matrices.
+ * @param stride_c The distance between the first elements of consecutive C matrices, at least m * n.
+ */
+template <typename T>
+void batched_multiply(const size_t &batch, const size_t &m, const size_t &n, const size_t &k, const T *a, const size_t &stride_a, const T *b, const size_t &stride_b, T *c, const size_t &stride_c)
+{
+    if (batch == 0 or m == 0 or n == 0)
+        return;
+    if (k == 0)
+    {
+        for (size_t p{0}; p < batch; p++)
+            std::fill_n(c + (p * stride_c), m * n, T{0});
+        return;
+    }
+    matrix_detail::batched_gemm(a, stride_a, b, stride_b, c, stride_c, m, n, k, batch);
+}
+
+// =========================================
+// Operations writing into existing matrices
+// =========================================
+
+/**
+ * @brief Compute the product C = A B into an existing matrix or view, instead of returning a new matrix as operator*() does, so that a loop which computes a product of the same size in every iteration does not allocate any memory. If C overlaps with A or B, the product is computed into a temporary matrix first, which does allocate memory. To multiply by a transpose, pass a transposed view, such as `b.view().transpose()`.
+ *
+ * @param c The view to write the product C into.
+ * @param a The first matrix to be multiplied, as a matrix or a view.
+ * @param b The second matrix to be multiplied, as a matrix or a view.
+ * @throws incompatible_sizes_multiply if the number of columns in A is not the same as the number of rows in B, or if C does not have as many rows as A and as many columns as B.
+ */
+template <typename T>
+    requires(not std::is_const_v<T>)
+void multiply_into(matrix_view<T> c, const std::type_identity_t<matrix_view<const T>> &a, const std::type_identity_t<matrix_view<const T>> &b)
+{
+    if (a.get_cols() != b.get_rows() or c.get_rows() != a.get_rows() or c.get_cols() != b.get_cols())
+        throw matrix_detail::incompatible_sizes_multiply<T>{};
+#if defined(MATRIX_INSTRUMENT)
+    const matrix_detail::instrument_scope scope{matrix_detail::operation::multiply, a.get_rows() * b.get_cols(), 2 * static_cast<uint64_t>(a.get_rows()) * a.get_cols() * b.get_cols()};
+#endif
+    if (matrix_detail::overlaps(matrix_view<const T>(c), a) or matrix_detail::overlaps(matrix_view<const T>(c), b))
+    {
+        matrix<T> temp(c.get_rows(), c.get_cols());
+        matrix_detail::gemm(a, b, temp.view());
+        c = temp;
+    }
+    else
+        matrix_detail::gemm(a, b, c);
+}
+
+/**
+ * @brief Compute the product C = A B into an existing matrix. See multiply_into(matrix_view<T>, ...) for details.
+ *
+ * @param c The matrix to write the product C into. Must already have the right size.
+ * @param a The first matrix to be multiplied, as a matrix or a view.
+ * @param b The second matrix to be multiplied, as a matrix or a view.
+ * @throws incompatible_sizes_multiply if the number of columns in A is not the same as the number of rows in B, or if C does not have as many rows as A and as many columns as B.
+ */
+template <typename T, typename Allocator, layout Layout>
+void multiply_into(matrix<T, Allocator, Layout> &c, const std::type_identity_t<matrix_view<const T>> &a, const std::type_identity_t<matrix_view<const T>> &b)
+{
+    multiply_into(c.view(), a, b);
+}
+
+/**
+ * @brief Add the product A B to an existing matrix or view, computing C += A B directly into the elements of C, without allocating memory for the product. If C overlaps with A or B, the sum is computed into a temporary matrix first.
+ *
+ * @param c The view to add the product to.
+ * @param a The first matrix to be multiplied, as a matrix or a view.
+ * @param b The second matrix to be multiplied, as a matrix or a view.
+ * @throws incompatible_sizes_multiply if the number of columns in A is not the same as the number of rows in B, or if C does not have as many rows as A and as many columns as B.
+ */
+template <typename T>
+    requires(not std::is_const_v<T>)
+void multiply_add_into(matrix_view<T> c, const std::type_identity_t<matrix_view<const T>> &a, const std::type_identity_t<matrix_view<const T>> &b)
+{
+    if (a.get_cols() != b.get_rows() or c.get_rows() != a.get_rows() or c.get_cols() != b.get_cols())
+        throw matrix_detail::incompatible_sizes_multiply<T>{};
+#if defined(MATRIX_INSTRUMENT)
+    const matrix_detail::instrument_scope scope{matrix_detail::operation::multiply, a.get_rows() * b.get_cols(), 2 * static_cast<uint64_t>(a.get_rows()) * a.get_cols() * b.get_cols()};
+#endif
+    if (matrix_detail::overlaps(matrix_view<const T>(c), a) or matrix_detail::overlaps(matrix_view<const T>(c), b))
+    {
+        matrix<T> temp(c);
+        matrix_detail::gemm(a, b, temp.view(), true);
+        c = temp;
+    }
+    else
+        matrix_detail::gemm(a, b, c, true);
+}
+
+/**
+ * @brief Add the product A B to an existing matrix. See multiply_add_into(matrix_view<T>, ...) for details.
+ *
+ * @param c The matrix to add the product to.
+ * @param a The first matrix to be multiplied, as a matrix or a view.
+ * @param b The second matrix to be multiplied, as a matrix or a view.
+ * @throws incompatible_sizes_multiply if the number of columns in A is not the same as the number of rows in B, or if C does not have as many rows as A and as many columns as B.
+ */
+template <typename T, typename Allocator, layout Layout>
+void multiply_add_into(matrix<T, Allocator, Layout> &c, const std::type_identity_t<matrix_view<const T>> &a, const std::type_identity_t<matrix_view<const T>> &b)
+{
+    multiply_add_into(c.view(), a, b);
+}
+
+/**
+ * @brief Compute the sum A + B into an existing matrix or view, in a single pass and without allocating memory. The destination may be one of the operands, as in `add_into(a, a, b)`. If it refers to the same elements as an operand in a different arrangement, for example a transposed view, the sum is computed into a temporary matrix first.
+ *
+ * @param c The view to write the sum into.
+ * @param a The first matrix or elementwise matrix expression to be added.
+ * @param b The second matrix or elementwise matrix expression to be added.
+ * @throws incompatible_sizes_add if A, B, and C do not all have the same number of rows and columns.
+ */
+template <typename T, matrix_detail::operand L, matrix_detail::operand R>
+    requires(not std::is_const_v<T>) and std::same_as<typename L::value_type, T> and std::same_as<typename R::value_type, T>
+void add_into(matrix_view<T> c, const L &a, const R &b)
+{
+    c = a + b;
+}
+
+/**
+ * @brief Compute the sum A + B into an existing matrix. See add_into(matrix_view<T>, ...) for details.
+ *
+ * @param c The matrix to write the sum into. Must already have the right size.
+ * @param a The first matrix or elementwise matrix expression to be added.
+ * @param b The second matrix or elementwise matrix expression to be added.
+ * @throws incompatible_sizes_add if A, B, and C do not all have the same number of rows and columns.
+ */
+template <typename T, typename Allocator, layout Layout, matrix_detail::operand L, matrix_detail::operand R>
+    requires std::same_as<typename L::value_type, T> and std::same_as<typename R::value_type, T>
+void add_into(matrix<T, Allocator, Layout> &c, const L &a, const R &b)
+{
+    add_into(c.view(), a, b);
+}
+
+/**
+ * @brief Compute the difference A - B into an existing matrix or view. See add_into(matrix_view<T>, ...) for details.
+ *
+ * @param c The view to write the difference into.
+ * @param a The matrix or elementwise matrix expression to subtract from.
+ * @param b The matrix or elementwise matrix expression to be subtracted.
+ * @throws incompatible_sizes_add if A, B, and C do not all have the same number of rows and columns.
+ */
+template <typename T, matrix_detail::operand L, matrix_detail::operand R>
+    requires(not std::is_const_v<T>) and std::same_as<typename L::value_type, T> and std::same_as<typename R::value_type, T>
+void subtract_into(matrix_view<T> c, const L &a, const R &b)
+{
+    c = a - b;
+}
+
+/**
+ * @brief Compute the difference A - B into an existing matrix. See add_into(matrix_view<T>, ...) for details.
+ *
+ * @param c The matrix to write the difference into. Must already have the right size.
+ * @param a The matrix or elementwise matrix expression to subtract from.
+ * @param b The matrix or elementwise matrix expression to be subtracted.
+ * @throws incompatible_sizes_add if A, B, and C do not all have the same number of rows and columns.
+ */
+template <typename T, typename Allocator, layout Layout, matrix_detail::operand L, matrix_detail::operand R>
+    requires std::same_as<typename L::value_type, T> and std::same_as<typename R::value_type, T>
+void subtract_into(matrix<T, Allocator, Layout> &c, const L &a, const R &b)
+{
+    subtract_into(c.view(), a, b);
+}
+
+/**
+ * @brief Compute the product s A of a scalar and a matrix into an existing matrix or view. See add_into(matrix_view<T>, ...) for details.
+ *
+ * @param c The view to write the product into.
+ * @param s The scalar.
+ * @param a The matrix or elementwise matrix expression.
+ * @throws incompatible_sizes_add if A and C do not have the same number of rows and columns.
+ */
+template <typename T, matrix_detail::operand E>
+    requires(not std::is_const_v<T>) and std::same_as<typename E::value_type, T>
+void scale_into(matrix_view<T> c, const std::type_identity_t<T> &s, const E &a)
+{
+    c = s * a;
+}
+
+/**
+ * @brief Compute the product s A of a scalar and a matrix into an existing matrix. See add_into(matrix_view<T>, ...) for details.
+ *
+ * @param c The matrix to write the product into. Must already have the right size.
+ * @param s The scalar.
+ * @param a The matrix or elementwise matrix expression.
+ * @throws incompatible_sizes_add if A and C do not have the same number of rows and columns.
+ */
+template <typename T, typename Allocator, layout Layout, matrix_detail::operand E>
+    requires std::same_as<typename E::value_type, T>
+void scale_into(matrix<T, Allocator, Layout> &c, const std::type_identity_t<T> &s, const E &a)
+{
+    scale_into(c.view(), s, a);
+}
+
+/**
+ * @brief Write the transpose of a matrix into an existing matrix or view, using the same blocked algorithm as matrix::transpose() if the rows of both are contiguous, without allocating memory. If C overlaps with A, the transpose is computed into a temporary matrix first.
+ *
+ * @param c The view to write the transpose into.
+ * @param a The matrix to be transposed, as a matrix or a view.
+ * @throws incompatible_sizes_add if C does not have as many rows as A has columns and as many columns as A has rows.
+ */
+template <typename T>
+    requires(not std::is_const_v<T>)
+void transpose_into(matrix_view<T> c, const std::type_identity_t<matrix_view<const T>> &a)
+{
+    if (c.get_rows() != a.get_cols() or c.get_cols() != a.get_rows())
+        throw matrix_detail::incompatible_sizes_add<T>{};
+    if (c.get_col_stride() == 1 and a.get_col_stride() == 1 and not matrix_detail::overlaps(matrix_view<const T>(c), a))
+        matrix_detail::transpose(a.get_rows(), a.get_cols(), a.data(), a.get_row_stride(), c.data(), c.get_row_stride());
+    else
+        c = a.transpose();
+}
+
+/**
+ * @brief Write the transpose of a matrix into an existing matrix. See transpose_into(matrix_view<T>, ...) for details.
+ *
+ * @param c The matrix to write the transpose into. Must already have the right size.
+ * @param a The matrix to be transposed, as a matrix or a view.
+ * @throws incompatible_sizes_add if C does not have as many rows as A has columns and as many columns as A has rows.
+ */
+template <typename T, typename Allocator, layout Layout>
+void transpose_into(matrix<T, Allocator, Layout> &c, const std::type_identity_t<matrix_view<const T>> &a)
+{
+    transpose_into(c.view(), a);
+}
+
+// ==========
+// Reductions
+// ==========
+
+/**
+ * @brief The summation algorithms available for sum(), frobenius_norm(), dot(), row_sums(), and col_sums().
+ */
+enum class summation
+{
+    /**
+     * @brief Add the elements using several independent SIMD accumulators, and combine the sums of blocks of elements pairwise. The error typically grows with the square root of the number of elements within a block, and logarithmically with the number of blocks.
+     */
+    fast,
+
+    /**
+     * @brief Kahan (compensated) summation of each block, with the blocks also combined using Kahan summation, so the error is essentially independent of the number of elements. The compensated accumulators are vectorized as well, but each addition takes four floating-point operations instead of one. Equivalent to summation::fast for integer types. Does not work if the compiler is allowed to reassociate floating-point operations, for example with `-ffast-math`.
+     */
+    kahan
+};
+
+/**
+ * @brief Compute the sum of the elements of a matrix. The elements are split into blocks whose sums are computed using SIMD packets with several accumulators, in parallel for large matrices, and the blocks are split in the same way regardless of the number of threads, so the result does not depend on it.
+ *
+ * @param a The matrix, as a view.
+ * @param method The summation algorithm.
+ * @return The sum of the elements.
+ */
+template <typename T>
+std::remove_const_t<T> sum(const matrix_view<T> &a, const summation &method = summation::fast)
+{
+    const std::remove_const_t<T> *p{a.data()};
+    if (method == summation::kahan)
+        return matrix_detail::reduce_sum<true, matrix_detail::element_term>(a.get_rows(), a.get_cols(), p, a.get_row_stride(), a.get_col_stride(), p, a.get_row_stride(), a.get_col_stride());
+    return matrix_detail::reduce_sum<false, matrix_detail::element_term>(a.get_rows(), a.get_cols(), p, a.get_row_stride(), a.get_col_stride(), p, a.get_row_stride(), a.get_col_stride());
+}
+
+/**
+ * @brief Compute the sum of the elements of a matrix. See sum(const matrix_view<T> &, ...) for details.
+ *
+ * @param a The matrix.
+ * @param method The summation algorithm.
+ * @return The sum of the elements.
+ */
+template <typename T, typename Allocator, layout Layout>
+T sum(const matrix<T, Allocator, Layout> &a, const summation &method = summation::fast)
+{
+    return sum(a.view(), method);
+}
+
+/**
+ * @brief Compute the trace of a matrix, the sum of the elements on its main diagonal. For a non-square matrix, the main diagonal has as many elements as the smaller dimension.
+ *
+ * @param a The matrix, as a view.
+ * @return The trace.
+ */
+template <typename T>
+std::remove_const_t<T> trace(const matrix_view<T> &a)
+{
+    const std::remove_const_t<T> *p{a.data()};
+    const size_t stride{a.get_row_stride() + a.get_col_stride()};
+    return matrix_detail::reduce_sum<false, matrix_detail::element_term>(1, std::min(a.get_rows(), a.get_cols()), p, 0, stride, p, 0, stride);
+}
+
+/**
+ * @brief Compute the trace of a matrix. See trace(const matrix_view<T> &) for details.
+ *
+ * @param a The matrix.
+ * @return The trace.
+ */
+template <typename T, typename Allocator, layout Layout>
+T trace(const matrix<T, Allocator, Layout> &a)
+{
+    return trace(a.view());
+}
+
+/**
+ * @brief Find the smallest element of a matrix, using SIMD comparisons, in parallel for large matrices. NaNs are ignored, unless all of the elements are NaNs.
+ *
+ * @param a The matrix, as a view.
+ * @return The smallest element.
+ */
+template <typename T>
+std::remove_const_t<T> min(const matrix_view<T> &a)
+{
+    return matrix_detail::reduce_extremum<false>(a.get_rows(), a.get_cols(), static_cast<const std::remove_const_t<T> *>(a.data()), a.get_row_stride(), a.get_col_stride());
+}
+
+/**
+ * @brief Find the smallest element of a matrix. See min(const matrix_view<T> &) for details.
+ *
+ * @param a The matrix.
+ * @return The smallest element.
+ */
+template <typename T, typename Allocator, layout Layout>
+T min(const matrix<T, Allocator, Layout> &a)
+{
+    return min(a.view());
+}
+
+/**
+ * @brief Find the largest element of a matrix, using SIMD comparisons, in parallel for large matrices. NaNs are ignored, unless all of the elements are NaNs.
+ *
+ * @param a The matrix, as a view.
+ * @return The largest element.
+ */
+template <typename T>
+std::remove_const_t<T> max(const matrix_view<T> &a)
+{
+    return matrix_detail::reduce_extremum<true>(a.get_rows(), a.get_cols(), static_cast<const std::remove_const_t<T> *>(a.data()), a.get_row_stride(), a.get_col_stride());
+}
+
+/**
+ * @brief Find the largest element of a matrix. See max(const matrix_view<T> &) for details.
+ *
+ * @param a The matrix.
+ * @return The largest element.
+ */
+template <typename T, typename Allocator, layout Layout>
+T max(const matrix<T, Allocator, Layout> &a)
+{
+    return max(a.view());
+}
+
+/**
+ * @brief Find the position of the smallest element of a matrix, ignoring NaNs. The smallest value is found as in min(), followed by a serial search for its first occurrence.
+ *
+ * @param a The matrix, as a view.
+ * @return The row and column of the first smallest element in row-major order, or (0, 0) if all of the elements are NaNs.
+ */
+template <typename T>
+std::pair<size_t, size_t> argmin(const matrix_view<T> &a)
+{
+    return matrix_detail::find_first(a.get_rows(), a.get_cols(), static_cast<const std::remove_const_t<T> *>(a.data()), a.get_row_stride(), a.get_col_stride(), min(a));
+}
+
+/**
+ * @brief Find the position of the smallest element of a matrix. See argmin(const matrix_view<T> &) for details.
+ *
+ * @param a The matrix.
+ * @return The row and column of the first smallest element in row-major order, or (0, 0) if all of the elements are NaNs.
+ */
+template <typename T, typename Allocator, layout Layout>
+std::pair<size_t, size_t> argmin(const matrix<T, Allocator, Layout> &a)
+{
+    return argmin(a.view());
+}
+
+/**
+ * @brief Find the position of the largest element of a matrix, ignoring NaNs. The largest value is found as in max(), followed by a serial search for its first occurrence.
+ *
+ * @param a The matrix, as a view.
+ * @return The row and column of the first largest element in row-major order, or (0, 0) if all of the elements are NaNs.
+ */
+template <typename T>
+std::pair<size_t, size_t> argmax(const matrix_view<T> &a)
+{
+    return matrix_detail::find_first(a.get_rows(), a.get_cols(), static_cast<const std::remove_const_t<T> *>(a.data()), a.get_row_stride(), a.get_col_stride(), max(a));
+}
+
+/**
+ * @brief Find the position of the largest element of a matrix. See argmax(const matrix_view<T> &) for details.
+ *
+ * @param a The matrix.
+ * @return The row and column of the first largest element in row-major order, or (0, 0) if all of the elements are NaNs.
+ */
+template <typename T, typename Allocator, layout Layout>
+std::pair<size_t, size_t> argmax(const matrix<T, Allocator, Layout> &a)
+{
+    return argmax(a.view());
+}
+
+/**
+ * @brief Compute the Frobenius norm of a matrix, the square root of the sum of the squares of its elements. The sum is computed in the same way as in sum(). No scaling is done, so the squares may overflow if the elements are larger than about the square root of the largest representable number.
+ *
+ * @param a The matrix, as a view.
+ * @param method The summation algorithm.
+ * @return The Frobenius norm.
+ */
+template <typename T>
+    requires std::floating_point<std::remove_const_t<T>>
+std::remove_const_t<T> frobenius_norm(const matrix_view<T> &a, const summation &method = summation::fast)
+{
+    const std::remove_const_t<T> *p{a.data()};
+    if (method == summation::kahan)
+        return std::sqrt(matrix_detail::reduce_sum<true, matrix_detail::square_term>(a.get_rows(), a.get_cols(), p, a.get_row_stride(), a.get_col_stride(), p, a.get_row_stride(), a.get_col_stride()));
+    return std::sqrt(matrix_detail::reduce_sum<false, matrix_detail::square_term>(a.get_rows(), a.get_cols(), p, a.get_row_stride(), a.get_col_stride(), p, a.get_row_stride(), a.get_col_stride()));
+}
+
+/**
+ * @brief Compute the Frobenius norm of a matrix. See frobenius_norm(const matrix_view<T> &, ...) for details.
+ *
+ * @param a The matrix.
+ * @param method The summation algorithm.
+ * @return The Frobenius norm.
+ */
+template <typename T, typename Allocator, layout Layout>
+    requires std::floating_point<T>
+T frobenius_norm(const matrix<T, Allocator, Layout> &a, const summation &method = summation::fast)
+{
+    return frobenius_norm(a.view(), method);
+}
+
+/**
+ * @brief Compute the dot product (Frobenius inner product) of two matrices of the same size, the sum of the products of their corresponding elements, without forming the products as a matrix. The sum is computed in the same way as in sum(); if both matrices are stored contiguously in the same order, their elements are processed as two flat arrays.
+ *
+ * @param a The first matrix, as a view.
+ * @param b The second matrix, as a matrix or a view.
+ * @param method The summation algorithm.
+ * @return The dot product.
+ * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+ */
+template <typename T>
+std::remove_const_t<T> dot(const matrix_view<T> &a, const std::type_identity_t<matrix_view<const std::remove_const_t<T>>> &b, const summation &method = summation::fast)
+{
+    if (a.get_rows() != b.get_rows() or a.get_cols() != b.get_cols())
+        throw matrix_detail::incompatible_sizes_add<std::remove_const_t<T>>{};
+    const std::remove_const_t<T> *p{a.data()};
+    if (method == summation::kahan)
+        return matrix_detail::reduce_sum<true, matrix_detail::product_term>(a.get_rows(), a.get_cols(), p, a.get_row_stride(), a.get_col_stride(), b.data(), b.get_row_stride(), b.get_col_stride());
+    return matrix_detail::reduce_sum<false, matrix_detail::product_term>(a.get_rows(), a.get_cols(), p, a.get_row_stride(), a.get_col_stride(), b.data(), b.get_row_stride(), b.get_col_stride());
+}
+
+/**
+ * @brief Compute the dot product of two matrices of the same size. See dot(const matrix_view<T> &, ...) for details.
+ *
+ * @param a The first matrix.
+ * @param b The second matrix, as a matrix or a view.
+ * @param method The summation algorithm.
+ * @return The dot product.
+ * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+ */
+template <typename T, typename Allocator, layout Layout>
+T dot(const matrix<T, Allocator, Layout> &a, const std::type_identity_t<matrix_view<const T>> &b, const summation &method = summation::fast)
+{
+    return dot(a.view(), b, method);
+}
+
+/**
+ * @brief Compute the sum of each row of a matrix. If the rows are contiguous, each sum is computed with SIMD packets as in sum(); if instead the columns are contiguous (as for a transposed view), the columns are added to each other with SIMD packets. Either way the work is split between threads for large matrices, and the results do not depend on the number of threads.
+ *
+ * @param a The matrix, as a view.
+ * @param method The summation algorithm.
+ * @return A vector with the sum of each row.
+ */
+template <typename T>
+std::vector<std::remove_const_t<T>> row_sums(const matrix_view<T> &a, const summation &method = summation::fast)
+{
+    std::vector<std::remove_const_t<T>> sums(a.get_rows());
+    const std::remove_const_t<T> *p{a.data()};
+    const bool by_lines{a.get_col_stride() == 1 or a.get_row_stride() != 1};
+    if (method == summation::kahan)
+    {
+        if (by_lines)
+            matrix_detail::line_sums<true>(p, a.get_rows(), a.get_cols(), a.get_row_stride(), a.get_col_stride(), sums.data());
+        else
+            matrix_detail::cross_sums<true>(p, a.get_cols(), a.get_rows(), a.get_col_stride(), sums.data());
+    }
+    else
+    {
+        if (by_lines)
+            matrix_detail::line_sums<false>(p, a.get_rows(), a.get_cols(), a.get_row_stride(), a.get_col_stride(), sums.data());
+        else
+            matrix_detail::cross_sums<false>(p, a.get_cols(), a.get_rows(), a.get_col_stride(), sums.data());
+    }
+    return sums;
+}
+
+/**
+ * @brief Compute the sum of each row of a matrix. See row_sums(const matrix_view<T> &, ...) for details.
+ *
+ * @param a The matrix.
+ * @param method The summation algorithm.
+ * @return A vector with the sum of each row.
+ */
+template <typename T, typename Allocator, layout Layout>
+std::vector<T> row_sums(const matrix<T, Allocator, Layout> &a, const summation &method = summation::fast)
+{
+    return row_sums(a.view(), method);
+}
+
+/**
+ * @brief Compute the sum of each column of a matrix. If the rows are contiguous, the rows are added to each other with SIMD packets; if instead the columns are contiguous (as for a transposed view), each sum is computed with SIMD packets as in sum(). Either way the work is split between threads for large matrices, and the results do not depend on the number of threads.
+ *
+ * @param a The matrix, as a view.
+ * @param method The summation algorithm.
+ * @return A vector with the sum of each column.
+ */
+template <typename T>
+std::vector<std::remove_const_t<T>> col_sums(const matrix_view<T> &a, const summation &method = summation::fast)
+{
+    std::vector<std::remove_const_t<T>> sums(a.get_cols());
+    const std::remove_const_t<T> *p{a.data()};
+    const bool by_lines{a.get_col_stride() != 1};
+    if (method == summation::kahan)
+    {
+        if (by_lines)
+            matrix_detail::line_sums<true>(p, a.get_cols(), a.get_rows(), a.get_col_stride(), a.get_row_stride(), sums.data());
+        else
+            matrix_detail::cross_sums<true>(p, a.get_rows(), a.get_cols(), a.get_row_stride(), sums.data());
+    }
+    else
+    {
+        if (by_lines)
+            matrix_detail::line_sums<false>(p, a.get_cols(), a.get_rows(), a.get_col_stride(), a.get_row_stride(), sums.data());
+        else
+            matrix_detail::cross_sums<false>(p, a.get_rows(), a.get_cols(), a.get_row_stride(), sums.data());
+    }
+    return sums;
+}
+
+/**
+ * @brief Compute the sum of each column of a matrix. See col_sums(const matrix_view<T> &, ...) for details.
+ *
+ * @param a The matrix.
+ * @param method The summation algorithm.
+ * @return A vector with the sum of each column.
+ */
+template <typename T, typename Allocator, layout Layout>
+std::vector<T> col_sums(const matrix<T, Allocator, Layout> &a, const summation &method = summation::fast)
+{
+    return col_sums(a.view(), method);
+}
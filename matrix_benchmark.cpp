@@ -0,0 +1,1598 @@
+/**
+ * @file matrix_benchmark.cpp
+ * @author Barak Shoshany (baraksh@gmail.com) (http://baraksh.com)
+ * @version 0.1
+ * @date 2020-11-30
+ * @copyright Copyright (c) 2020
+ *
+ * @brief Micro-benchmarks for the matrix class template, using Google Benchmark.
+ *
+ * @details Every constructor and overloaded operator is measured for `float`, `double`, and `int`, on square matrices from 4x4 to 8192x8192. Each benchmark reports the number of bytes read and written per second (`bytes_per_second`), and, for operations that perform arithmetic, the number of arithmetic operations per second (`FLOP/s`). To compare against the baseline checked in beside this file, which includes all of the benchmarks as of the last time it was recorded, run
+ *
+ *     ./matrix_benchmark --benchmark_out=new.json --benchmark_out_format=json
+ *     compare.py benchmarks matrix_benchmark_baseline.json new.json
+ *
+ * where `compare.py` is the comparison script included with Google Benchmark.
+ *
+ * The backend benchmarks, whose names start with `backend/`, measure each implementation of matrix multiplication and addition separately (the naive reference loop, the blocked SIMD kernel, the BLAS library, and the automatic choice made by gemm() for products; the reference loop and the expression evaluator with and without SIMD packets for sums) for square, tall-skinny, and short-wide operands, and every thread count. Each implementation is first checked against the reference implementation, and reported as failed if the results differ by more than the bound on the rounding error. After they run, the fastest implementation for each size and the sizes from which more threads pay off are printed, so that the thresholds used by gemm() and the elementwise operations can be checked. To fail if any benchmark is more than 10% slower than a baseline written with `--benchmark_out`, run
+ *
+ *     ./matrix_benchmark --benchmark_filter=backend/ --regression_baseline=matrix_benchmark_baseline.json --regression_tolerance=0.1
+ *
+ * which returns a non-zero exit code if any benchmark is slower than its baseline, any implementation gives a wrong result, or none of the benchmarks that ran are in the baseline. Benchmarks missing from the baseline are listed.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "factorization.hpp"
+#include "matrix.hpp"
+#include "sparse_matrix.hpp"
+
+/**
+ * @brief The largest matrix size used in the benchmarks that print matrices, since printing an 8192x8192 matrix produces hundreds of megabytes of text.
+ */
+constexpr int64_t max_print_size{1024};
+
+/**
+ * @brief Create an n x n matrix with small, non-zero elements, so that the results of all operations (including division) stay finite and representable for every element type.
+ */
+template <typename T>
+matrix<T> make_matrix(const size_t &n)
+{
+    matrix<T> m(n, n);
+    for (size_t i{0}; i < n; i++)
+        for (size_t j{0}; j < n; j++)
+            m(i, j) = static_cast<T>(((i * 7) + (j * 3)) % 5 + 1);
+    return m;
+}
+
+/**
+ * @brief Record the throughput of a benchmark.
+ *
+ * @param state The benchmark state.
+ * @param bytes The number of bytes read and written in each iteration. Benchmarks that do not touch the elements, such as moves, pass zero and report no memory throughput.
+ * @param flops The number of arithmetic operations in each iteration.
+ */
+void set_throughput(benchmark::State &state, const double &bytes, const double &flops = 0)
+{
+    if (bytes > 0)
+        state.SetBytesProcessed(static_cast<int64_t>(bytes * static_cast<double>(state.iterations())));
+    if (flops > 0)
+        state.counters["FLOP/s"] = benchmark::Counter(flops, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// ============
+// Constructors
+// ============
+
+template <typename T>
+void BM_construct_uninitialized(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    for (auto _ : state)
+    {
+        matrix<T> m(n, n);
+        benchmark::DoNotOptimize(m.data());
+    }
+    set_throughput(state, 0);
+}
+
+template <typename T>
+void BM_construct_fill(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    for (auto _ : state)
+    {
+        matrix<T> m(n, n, T{1});
+        benchmark::DoNotOptimize(m.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(n * n * sizeof(T)));
+}
+
+// For large matrices, zeros() maps zero pages that are only allocated when first touched, so this measures the construction itself, and the cost of zeroing moves to the first pass over the elements.
+template <typename T>
+void BM_construct_zeros(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    for (auto _ : state)
+    {
+        matrix<T> m{matrix<T>::zeros(n, n)};
+        benchmark::DoNotOptimize(m.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(n * n * sizeof(T)));
+}
+
+template <typename T>
+void BM_construct_diagonal(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const std::vector<T> diagonal(n, T{1});
+    for (auto _ : state)
+    {
+        matrix<T> m(diagonal);
+        benchmark::DoNotOptimize(m.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>((n * n * sizeof(T)) + (n * sizeof(T))));
+}
+
+template <typename T>
+void BM_construct_vector(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const std::vector<T> elements(n * n, T{1});
+    for (auto _ : state)
+    {
+        matrix<T> m(n, n, elements);
+        benchmark::DoNotOptimize(m.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)));
+}
+
+template <typename T>
+void BM_construct_vector_move(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const std::vector<T> elements(n * n, T{1});
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::vector<T> copy{elements};
+        state.ResumeTiming();
+        matrix<T> m(n, n, std::move(copy));
+        benchmark::DoNotOptimize(m.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)));
+}
+
+// The initializer_list constructors can only be measured for the sizes written out here, since the size of an initializer_list is fixed at compile time.
+template <typename T>
+void BM_construct_initializer_list(benchmark::State &state)
+{
+    for (auto _ : state)
+    {
+        matrix<T> m(4, 4, {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16});
+        benchmark::DoNotOptimize(m.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * 16 * sizeof(T)));
+}
+
+template <typename T>
+void BM_construct_diagonal_initializer_list(benchmark::State &state)
+{
+    for (auto _ : state)
+    {
+        matrix<T> m{1, 2, 3, 4};
+        benchmark::DoNotOptimize(m.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>((16 + 4) * sizeof(T)));
+}
+
+template <typename T>
+void BM_construct_copy(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> m(a);
+        benchmark::DoNotOptimize(m.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)));
+}
+
+template <typename T>
+void BM_construct_move(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> m(std::move(a));
+        benchmark::DoNotOptimize(m.data());
+        a = std::move(m);
+    }
+    set_throughput(state, 0);
+}
+
+// ==========
+// Assignment
+// ==========
+
+template <typename T>
+void BM_assign_copy(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)};
+    matrix<T> m(n, n);
+    for (auto _ : state)
+    {
+        m = a;
+        benchmark::DoNotOptimize(m.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)));
+}
+
+template <typename T>
+void BM_assign_move(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    matrix<T> a{make_matrix<T>(n)};
+    matrix<T> m(n, n);
+    for (auto _ : state)
+    {
+        m = std::move(a);
+        a = std::move(m);
+        benchmark::DoNotOptimize(a.data());
+    }
+    set_throughput(state, 0);
+}
+
+// ==============
+// Element access
+// ==============
+
+template <typename T>
+void BM_access_unchecked(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        for (size_t i{0}; i < n; i++)
+            for (size_t j{0}; j < n; j++)
+                a(i, j) += T{1};
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)), static_cast<double>(n * n));
+}
+
+template <typename T>
+void BM_access_checked(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        for (size_t i{0}; i < n; i++)
+            for (size_t j{0}; j < n; j++)
+                a.at(i, j) += T{1};
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)), static_cast<double>(n * n));
+}
+
+// =====================
+// Elementwise operators
+// =====================
+
+template <typename T>
+void BM_add(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)}, b{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> c = a + b;
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(3 * n * n * sizeof(T)), static_cast<double>(n * n));
+}
+
+template <typename T>
+void BM_add_mixed_layout(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)};
+    const matrix<T, aligned_allocator<T>, layout::col_major> b{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> c = a + b;
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(3 * n * n * sizeof(T)), static_cast<double>(n * n));
+}
+
+template <typename T>
+void BM_subtract(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)}, b{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> c = a - b;
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(3 * n * n * sizeof(T)), static_cast<double>(n * n));
+}
+
+template <typename T>
+void BM_negate(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> c = -a;
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)), static_cast<double>(n * n));
+}
+
+template <typename T>
+void BM_scalar_multiply_left(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> c = T{2} * a;
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)), static_cast<double>(n * n));
+}
+
+template <typename T>
+void BM_scalar_multiply_right(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> c = a * T{2};
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)), static_cast<double>(n * n));
+}
+
+// A chain of elementwise operators, which is evaluated in a single fused loop.
+template <typename T>
+void BM_fused_expression(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)}, b{make_matrix<T>(n)}, c{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> d = a + b - (T{2} * c);
+        benchmark::DoNotOptimize(d.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(4 * n * n * sizeof(T)), static_cast<double>(3 * n * n));
+}
+
+// A chain of user-provided functions applied with map() and zip_with(), which is also evaluated in a single fused loop.
+template <typename T>
+void BM_map_zip(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)}, b{make_matrix<T>(n)};
+    matrix<T> c(n, n);
+    for (auto _ : state)
+    {
+        c = zip_with(a, b, [](const T &x, const T &y) { return std::max(x, y); }).map([](const T &x) { return (x > T{0}) ? x : T{0}; });
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(3 * n * n * sizeof(T)), static_cast<double>(2 * n * n));
+}
+
+template <typename T>
+void BM_map_inplace(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        a.map_inplace([](const T &x) { return (x > T{0}) ? x : T{0}; });
+        benchmark::DoNotOptimize(a.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)), static_cast<double>(n * n));
+}
+
+// =============================
+// Compound assignment operators
+// =============================
+
+template <typename T>
+void BM_add_assign(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    // Add zeros, so that the elements do not overflow after many iterations.
+    matrix<T> a{make_matrix<T>(n)};
+    const matrix<T> b(n, n, T{0});
+    for (auto _ : state)
+    {
+        a += b;
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(3 * n * n * sizeof(T)), static_cast<double>(n * n));
+}
+
+template <typename T>
+void BM_subtract_assign(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    matrix<T> a{make_matrix<T>(n)};
+    const matrix<T> b(n, n, T{0});
+    for (auto _ : state)
+    {
+        a -= b;
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(3 * n * n * sizeof(T)), static_cast<double>(n * n));
+}
+
+template <typename T>
+void BM_multiply_assign(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        a *= T{1};
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)), static_cast<double>(n * n));
+}
+
+template <typename T>
+void BM_divide_assign(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        a /= T{1};
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)), static_cast<double>(n * n));
+}
+
+template <typename T>
+void BM_add_scaled(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    matrix<T> a{make_matrix<T>(n)};
+    const matrix<T> b{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        a.add_scaled(T{0}, b);
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(3 * n * n * sizeof(T)), static_cast<double>(2 * n * n));
+}
+
+// =====================
+// Matrix multiplication
+// =====================
+
+template <typename T>
+void BM_multiply(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)}, b{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> c = a * b;
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(3 * n * n * sizeof(T)), 2.0 * static_cast<double>(n) * static_cast<double>(n) * static_cast<double>(n));
+}
+
+// Multiplication into an existing matrix, which allocates no memory in the loop.
+template <typename T>
+void BM_multiply_into(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)}, b{make_matrix<T>(n)};
+    matrix<T> c(n, n);
+    for (auto _ : state)
+    {
+        multiply_into(c, a, b);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(3 * n * n * sizeof(T)), 2.0 * static_cast<double>(n) * static_cast<double>(n) * static_cast<double>(n));
+}
+
+// Multiplication of low-precision matrices with the products accumulated in a wider type, such as bf16 into float or int8_t into int32_t.
+template <typename Acc, typename T>
+void BM_multiply_mixed(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)}, b{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<Acc> c = multiply<Acc>(a, b);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>((2 * n * n * sizeof(T)) + (n * n * sizeof(Acc))), 2.0 * static_cast<double>(n) * static_cast<double>(n) * static_cast<double>(n));
+}
+
+// Multiplication of a transposed view, which reads one of the operands with a large column stride.
+template <typename T>
+void BM_multiply_transposed_view(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)}, b{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> c = a.view().transpose() * b;
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(3 * n * n * sizeof(T)), 2.0 * static_cast<double>(n) * static_cast<double>(n) * static_cast<double>(n));
+}
+
+template <typename T>
+void BM_multiply_transposed(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)}, b{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> c = multiply_transposed(a, b);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(3 * n * n * sizeof(T)), 2.0 * static_cast<double>(n) * static_cast<double>(n) * static_cast<double>(n));
+}
+
+template <typename T>
+void BM_transpose(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> c = a.transpose();
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)));
+}
+
+template <typename T>
+void BM_transpose_in_place(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        a.transpose_in_place();
+        benchmark::DoNotOptimize(a.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)));
+}
+
+template <typename T>
+void BM_multiply_strassen(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)}, b{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> c = multiply_strassen(a, b);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    // Report the rate of the usual algorithm's operation count, so that it can be compared directly with BM_multiply.
+    set_throughput(state, static_cast<double>(3 * n * n * sizeof(T)), 2.0 * static_cast<double>(n) * static_cast<double>(n) * static_cast<double>(n));
+}
+
+template <typename T>
+void BM_lu_solve(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    matrix<T> a{make_matrix<T>(n)};
+    // Make the matrix diagonally dominant, so that it is far from singular.
+    for (size_t i{0}; i < n; i++)
+        a(i, i) += static_cast<T>(n);
+    const matrix<T> b{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        matrix<T> x = solve(a, b);
+        benchmark::DoNotOptimize(x.data());
+        benchmark::ClobberMemory();
+    }
+    // The factorization takes 2n^3/3 operations, and the two triangular solves with n right-hand sides take 2n^3.
+    set_throughput(state, static_cast<double>(3 * n * n * sizeof(T)), (8.0 / 3.0) * static_cast<double>(n) * static_cast<double>(n) * static_cast<double>(n));
+}
+
+template <typename T>
+void BM_gemv(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)};
+    const std::vector<T> x(n, T{1});
+    std::vector<T> y(n);
+    for (auto _ : state)
+    {
+        gemv(a, x, y);
+        benchmark::DoNotOptimize(y.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>((n * n + 2 * n) * sizeof(T)), 2.0 * static_cast<double>(n) * static_cast<double>(n));
+}
+
+template <typename T>
+void BM_batched_multiply(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))}, batch{1024};
+    const std::vector<T> a(batch * n * n, T{1}), b(batch * n * n, T{2});
+    std::vector<T> c(batch * n * n);
+    for (auto _ : state)
+    {
+        batched_multiply(batch, n, n, n, a.data(), n * n, b.data(), n * n, c.data(), n * n);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(3 * batch * n * n * sizeof(T)), 2.0 * static_cast<double>(batch * n * n * n));
+}
+
+// ==========
+// Reductions
+// ==========
+
+template <typename T>
+void BM_sum(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(sum(a));
+    set_throughput(state, static_cast<double>(n * n * sizeof(T)), static_cast<double>(n) * static_cast<double>(n));
+}
+
+// Compensated summation, which takes four floating-point operations per element instead of one.
+template <typename T>
+void BM_sum_kahan(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(sum(a, summation::kahan));
+    set_throughput(state, static_cast<double>(n * n * sizeof(T)), static_cast<double>(n) * static_cast<double>(n));
+}
+
+template <typename T>
+void BM_dot(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)}, b{make_matrix<T>(n)};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(dot(a, b));
+    set_throughput(state, static_cast<double>(2 * n * n * sizeof(T)), 2.0 * static_cast<double>(n) * static_cast<double>(n));
+}
+
+template <typename T>
+void BM_max(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(max(a));
+    set_throughput(state, static_cast<double>(n * n * sizeof(T)));
+}
+
+// Column sums of a row-major matrix, which add whole rows to a vector of partial sums.
+template <typename T>
+void BM_col_sums(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)};
+    for (auto _ : state)
+    {
+        std::vector<T> sums{col_sums(a)};
+        benchmark::DoNotOptimize(sums.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(n * n * sizeof(T)), static_cast<double>(n) * static_cast<double>(n));
+}
+
+// ===============
+// Sparse matrices
+// ===============
+
+/**
+ * @brief Create an n x n sparse matrix in CSR format with (up to) 8 non-zero elements in each row, in a band around the diagonal plus a few scattered columns, similar to the matrices arising from discretized differential equations.
+ */
+template <typename T>
+sparse_matrix<T> make_sparse_matrix(const size_t &n)
+{
+    typename sparse_matrix<T>::builder b(n, n);
+    b.reserve(8 * n);
+    for (size_t i{0}; i < n; i++)
+        for (size_t k{0}; k < 8; k++)
+            b.add(i, (i + (k * k * 37)) % n, static_cast<T>((k % 5) + 1));
+    return b.build();
+}
+
+template <typename T>
+void BM_sparse_multiply_vector(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const sparse_matrix<T> s{make_sparse_matrix<T>(n)};
+    const std::vector<T> x(n, T{1});
+    for (auto _ : state)
+    {
+        std::vector<T> y = s * x;
+        benchmark::DoNotOptimize(y.data());
+        benchmark::ClobberMemory();
+    }
+    const double nonzeros{static_cast<double>(s.get_nonzeros())};
+    set_throughput(state, (nonzeros * static_cast<double>(sizeof(T) + sizeof(size_t))) + static_cast<double>(2 * n * sizeof(T)), 2.0 * nonzeros);
+}
+
+template <typename T>
+void BM_sparse_multiply_dense(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const sparse_matrix<T> s{make_sparse_matrix<T>(n)};
+    const matrix<T> b(n, 16, T{1});
+    for (auto _ : state)
+    {
+        matrix<T> c = s * b;
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    const double nonzeros{static_cast<double>(s.get_nonzeros())};
+    set_throughput(state, (nonzeros * static_cast<double>(sizeof(T) + sizeof(size_t))) + static_cast<double>(2 * n * 16 * sizeof(T)), 2.0 * 16 * nonzeros);
+}
+
+// ======
+// Output
+// ======
+
+template <typename T>
+void BM_print(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)};
+    std::ostringstream out;
+    for (auto _ : state)
+    {
+        out.str("");
+        out << a;
+        benchmark::DoNotOptimize(out.tellp());
+    }
+    set_throughput(state, static_cast<double>(n * n * sizeof(T)));
+}
+
+template <typename T>
+void BM_write_csv(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    const matrix<T> a{make_matrix<T>(n)};
+    std::ostringstream out;
+    for (auto _ : state)
+    {
+        out.str("");
+        a.write_csv(out);
+        benchmark::DoNotOptimize(out.tellp());
+    }
+    set_throughput(state, static_cast<double>(n * n * sizeof(T)));
+}
+
+template <typename T>
+void BM_read_csv(benchmark::State &state)
+{
+    const size_t n{static_cast<size_t>(state.range(0))};
+    std::ostringstream out;
+    make_matrix<T>(n).write_csv(out);
+    const std::string text{out.str()};
+    for (auto _ : state)
+    {
+        std::istringstream in(text);
+        matrix<T> m{matrix<T>::read_csv(in)};
+        benchmark::DoNotOptimize(m.data());
+    }
+    set_throughput(state, static_cast<double>(n * n * sizeof(T)));
+}
+
+// ========
+// Backends
+// ========
+
+/**
+ * @brief The implementations of an operation that the backend benchmarks compare. Each one is checked against the reference implementation before it is timed.
+ */
+enum class backend
+{
+    /**
+     * @brief The naive implementation: the triple loop of gemm_small() for products, or a loop over the elements using operator() for elementwise operations. Always single-threaded.
+     */
+    reference,
+
+    /**
+     * @brief For elementwise operations, the expression evaluator without SIMD packets, as used for zip_with() and map().
+     */
+    scalar,
+
+    /**
+     * @brief For elementwise operations, the expression evaluator with SIMD packets, as used by the arithmetic operators.
+     */
+    simd,
+
+    /**
+     * @brief For products, the cache-blocked SIMD kernel gemm_blocked(), regardless of the size of the product.
+     */
+    blocked,
+
+    /**
+     * @brief For products of `float` and `double` matrices, the BLAS library, regardless of the size of the product. Only available if `MATRIX_USE_BLAS` is defined.
+     */
+    blas,
+
+    /**
+     * @brief For products, gemm(), which chooses one of the others depending on the size of the product, exactly as operator* does.
+     */
+    dispatch
+};
+
+/**
+ * @brief The shapes of the operands used by the backend benchmarks. For a given size n, all three shapes perform the same amount of work.
+ */
+enum class shape
+{
+    /**
+     * @brief Products of n x n matrices, or elementwise operations on n x n matrices.
+     */
+    square,
+
+    /**
+     * @brief Products of a 16n x n/4 matrix and an n/4 x n/4 matrix, or elementwise operations on 16n x n/16 matrices.
+     */
+    tall_skinny,
+
+    /**
+     * @brief Products of an n/4 x n/4 matrix and an n/4 x 16n matrix, or elementwise operations on n/16 x 16n matrices.
+     */
+    short_wide
+};
+
+/**
+ * @brief The names of the backends, in the order in which they are declared.
+ */
+const std::array<std::string, 6> backend_names{"reference", "scalar", "simd", "blocked", "blas", "dispatch"};
+
+/**
+ * @brief The names of the shapes, in the order in which they are declared.
+ */
+const std::array<std::string, 3> shape_names{"square", "tall_skinny", "short_wide"};
+
+/**
+ * @brief A description of a backend benchmark, used to group the results in the crossover report.
+ */
+struct backend_benchmark
+{
+    std::string operation;
+    std::string type;
+    backend method{backend::reference};
+    shape form{shape::square};
+    size_t threads{1};
+    size_t size{0};
+};
+
+/**
+ * @brief The backend benchmarks that have been registered, by name.
+ */
+std::map<std::string, backend_benchmark> backend_benchmarks;
+
+/**
+ * @brief Create a matrix with pseudo-random elements, uniformly distributed in [-1, 1] for floating-point types or in [-8, 8] for integer types, so that the products of the benchmark sizes cannot overflow.
+ *
+ * @param rows The number of rows.
+ * @param cols The number of columns.
+ * @param seed The seed of the random number generator.
+ */
+template <typename T>
+matrix<T> make_random_matrix(const size_t &rows, const size_t &cols, const uint32_t &seed)
+{
+    std::mt19937 generator(seed);
+    matrix<T> m(rows, cols);
+    for (size_t i{0}; i < rows; i++)
+        for (size_t j{0}; j < cols; j++)
+        {
+            if constexpr (std::is_floating_point_v<T>)
+                m(i, j) = std::uniform_real_distribution<T>(-1, 1)(generator);
+            else
+                m(i, j) = static_cast<T>(std::uniform_int_distribution<int>(-8, 8)(generator));
+        }
+    return m;
+}
+
+/**
+ * @brief The dimensions m, n, and k of a product of the given shape and size, where the first matrix is m x k and the second is k x n.
+ */
+std::array<size_t, 3> product_dimensions(const shape &form, const size_t &size)
+{
+    if (form == shape::tall_skinny)
+        return {16 * size, size / 4, size / 4};
+    if (form == shape::short_wide)
+        return {size / 4, 16 * size, size / 4};
+    return {size, size, size};
+}
+
+/**
+ * @brief The number of rows and columns of the operands of an elementwise operation of the given shape and size.
+ */
+std::array<size_t, 2> elementwise_dimensions(const shape &form, const size_t &size)
+{
+    if (form == shape::tall_skinny)
+        return {16 * size, size / 16};
+    if (form == shape::short_wide)
+        return {size / 16, 16 * size};
+    return {size, size};
+}
+
+/**
+ * @brief Set the number of threads used by the matrix operations, if it is not already set.
+ */
+void use_threads(const size_t &threads)
+{
+    if (matrix_detail::thread_pool::global().get_num_threads() != threads)
+        matrix<double>::set_num_threads(threads);
+}
+
+/**
+ * @brief The operands of a product, together with the product computed by the reference implementation and the product of the absolute values of the operands, which bounds the rounding error. Products are benchmarked for every backend and thread count in turn, so only the operands of the most recent shape and size are kept.
+ */
+template <typename T>
+struct product_operands
+{
+    shape form{shape::square};
+    size_t size{0};
+    matrix<T> a{1, 1}, b{1, 1}, reference{1, 1}, magnitude{1, 1};
+
+    /**
+     * @brief Get the operands for a given shape and size, creating them if they are not the operands of the previous call.
+     */
+    static const product_operands &get(const shape &form, const size_t &size)
+    {
+        static product_operands operands;
+        if (operands.size != size or operands.form != form)
+        {
+            const auto [m, n, k] = product_dimensions(form, size);
+            operands.form = form;
+            operands.size = size;
+            operands.a = make_random_matrix<T>(m, k, 1);
+            operands.b = make_random_matrix<T>(k, n, 2);
+            operands.reference = matrix<T>(m, n);
+            matrix_detail::gemm_small(m, n, k, operands.a.data(), k, size_t{1}, operands.b.data(), n, size_t{1}, operands.reference.data(), n, size_t{1});
+            const matrix<T> abs_a{operands.a.map([](const T &x)
+                                                 { return static_cast<T>(x < 0 ? -x : x); })},
+                abs_b{operands.b.map([](const T &x)
+                                     { return static_cast<T>(x < 0 ? -x : x); })};
+            operands.magnitude = matrix<T>(m, n);
+            matrix_detail::gemm_small(m, n, k, abs_a.data(), k, size_t{1}, abs_b.data(), n, size_t{1}, operands.magnitude.data(), n, size_t{1});
+        }
+        return operands;
+    }
+};
+
+/**
+ * @brief Compute a product using one of the backends.
+ *
+ * @param method The backend.
+ * @param a The first matrix.
+ * @param b The second matrix.
+ * @param c The matrix to store the product in.
+ * @return false if the backend is not available for this type.
+ */
+template <typename T>
+bool multiply_with(const backend &method, const matrix<T> &a, const matrix<T> &b, matrix<T> &c)
+{
+    const size_t m{a.get_rows()}, n{b.get_cols()}, k{a.get_cols()};
+    switch (method)
+    {
+    case backend::reference:
+        matrix_detail::gemm_small(m, n, k, a.data(), k, size_t{1}, b.data(), n, size_t{1}, c.data(), n, size_t{1});
+        return true;
+    case backend::blocked:
+        matrix_detail::gemm_blocked(m, n, k, a.data(), k, size_t{1}, b.data(), n, size_t{1}, c.data(), n, size_t{1});
+        return true;
+    case backend::blas:
+#if defined(MATRIX_USE_BLAS)
+        if constexpr (matrix_detail::blas_type<T>)
+        {
+            const size_t threshold{matrix_detail::blas_gemm_threshold};
+            matrix_detail::blas_gemm_threshold = 0;
+            matrix_detail::blas_gemm(m, n, k, a.data(), k, size_t{1}, b.data(), n, size_t{1}, c.data(), n, size_t{1}, false);
+            matrix_detail::blas_gemm_threshold = threshold;
+            return true;
+        }
+#endif
+        return false;
+    case backend::dispatch:
+        matrix_detail::gemm(m, n, k, a.data(), k, size_t{1}, b.data(), n, size_t{1}, c.data(), n, size_t{1});
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Benchmark a product computed by one of the backends, after checking that it agrees with the reference implementation. For floating-point types, each element may differ from the reference by at most 2k times the machine epsilon times the corresponding element of |A| |B|, which bounds the rounding error of any order of summation; for integer types, the results must be equal.
+ */
+template <typename T>
+void BM_backend_multiply(benchmark::State &state, const backend &method, const shape &form, const size_t &size, const size_t &threads)
+{
+    use_threads(threads);
+    const product_operands<T> &operands{product_operands<T>::get(form, size)};
+    const size_t m{operands.a.get_rows()}, n{operands.b.get_cols()}, k{operands.a.get_cols()};
+    matrix<T> c(m, n);
+    if (not multiply_with(method, operands.a, operands.b, c))
+    {
+        state.SkipWithError("backend not available for this type");
+        return;
+    }
+    for (size_t i{0}; i < m; i++)
+        for (size_t j{0}; j < n; j++)
+        {
+            const T error{c(i, j) > operands.reference(i, j) ? c(i, j) - operands.reference(i, j) : operands.reference(i, j) - c(i, j)};
+            T tolerance{0};
+            if constexpr (std::is_floating_point_v<T>)
+                tolerance = 2 * static_cast<T>(k) * std::numeric_limits<T>::epsilon() * operands.magnitude(i, j);
+            if (not(error <= tolerance))
+            {
+                state.SkipWithError("result differs from the reference implementation");
+                return;
+            }
+        }
+    for (auto _ : state)
+    {
+        multiply_with(method, operands.a, operands.b, c);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(((m * k) + (k * n) + (m * n)) * sizeof(T)), 2.0 * static_cast<double>(m) * static_cast<double>(n) * static_cast<double>(k));
+}
+
+/**
+ * @brief Benchmark the sum of two matrices computed by one of the backends, after checking that it is exactly equal to the sum computed by the reference implementation.
+ */
+template <typename T>
+void BM_backend_add(benchmark::State &state, const backend &method, const shape &form, const size_t &size, const size_t &threads)
+{
+    use_threads(threads);
+    const auto [rows, cols] = elementwise_dimensions(form, size);
+    const matrix<T> a{make_random_matrix<T>(rows, cols, 1)}, b{make_random_matrix<T>(rows, cols, 2)};
+    matrix<T> c(rows, cols);
+    const auto add{[&]
+                   {
+                       if (method == backend::reference)
+                       {
+                           for (size_t i{0}; i < rows; i++)
+                               for (size_t j{0}; j < cols; j++)
+                                   c(i, j) = a(i, j) + b(i, j);
+                       }
+                       else if (method == backend::scalar)
+                           c.view() = zip_with(a, b, std::plus<T>{});
+                       else
+                           c.view() = a + b;
+                   }};
+    add();
+    for (size_t i{0}; i < rows; i++)
+        for (size_t j{0}; j < cols; j++)
+            if (c(i, j) != a(i, j) + b(i, j))
+            {
+                state.SkipWithError("result differs from the reference implementation");
+                return;
+            }
+    for (auto _ : state)
+    {
+        add();
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, static_cast<double>(3 * rows * cols * sizeof(T)), static_cast<double>(rows * cols));
+}
+
+/**
+ * @brief The thread counts used by the backend benchmarks: the powers of two below the number of hardware threads, and the number of hardware threads itself.
+ */
+std::vector<size_t> backend_thread_counts()
+{
+    const size_t hardware{std::max(1U, std::thread::hardware_concurrency())};
+    std::vector<size_t> counts;
+    for (size_t t{1}; t < hardware; t *= 2)
+        counts.push_back(t);
+    counts.push_back(hardware);
+    return counts;
+}
+
+/**
+ * @brief Register one backend benchmark, named `backend/<operation><<type>>/<shape>/<backend>/threads:<threads>/size:<size>`, so that, for example, `--benchmark_filter=backend/multiply<double>/square` selects all of the square products of `double` matrices.
+ */
+template <typename F>
+void register_backend_benchmark(const std::string &operation, const std::string &type, const backend &method, const shape &form, const size_t &threads, const size_t &size, const F &function)
+{
+    const std::string name{"backend/" + operation + "<" + type + ">/" + shape_names[static_cast<size_t>(form)] + "/" + backend_names[static_cast<size_t>(method)] + "/threads:" + std::to_string(threads) + "/size:" + std::to_string(size)};
+    backend_benchmarks[name] = backend_benchmark{operation, type, method, form, threads, size};
+    benchmark::RegisterBenchmark(name.c_str(), function, method, form, size, threads)->Unit(benchmark::kMicrosecond)->UseRealTime();
+}
+
+/**
+ * @brief Register the backend benchmarks for one element type: products of sizes 8 to 1024 and sums of sizes 64 to 4096, for every shape, backend, and thread count. The reference implementation is only run with one thread, and the BLAS library only for `float` and `double` when `MATRIX_USE_BLAS` is defined.
+ */
+template <typename T>
+void register_backend_benchmarks(const std::string &type)
+{
+    const std::vector<size_t> thread_counts{backend_thread_counts()};
+    for (const shape form : {shape::square, shape::tall_skinny, shape::short_wide})
+    {
+        for (size_t size{8}; size <= 1024; size *= 2)
+        {
+            register_backend_benchmark("multiply", type, backend::reference, form, 1, size, BM_backend_multiply<T>);
+            for (const size_t threads : thread_counts)
+            {
+                register_backend_benchmark("multiply", type, backend::blocked, form, threads, size, BM_backend_multiply<T>);
+#if defined(MATRIX_USE_BLAS)
+                if constexpr (matrix_detail::blas_type<T>)
+                    register_backend_benchmark("multiply", type, backend::blas, form, threads, size, BM_backend_multiply<T>);
+#endif
+                register_backend_benchmark("multiply", type, backend::dispatch, form, threads, size, BM_backend_multiply<T>);
+            }
+        }
+        for (size_t size{64}; size <= 4096; size *= 2)
+        {
+            register_backend_benchmark("add", type, backend::reference, form, 1, size, BM_backend_add<T>);
+            for (const size_t threads : thread_counts)
+            {
+                register_backend_benchmark("add", type, backend::scalar, form, threads, size, BM_backend_add<T>);
+                register_backend_benchmark("add", type, backend::simd, form, threads, size, BM_backend_add<T>);
+            }
+        }
+    }
+}
+
+// ============
+// Registration
+// ============
+
+/**
+ * @brief Register a benchmark for square matrices of sizes 4, 16, 64, 256, 1024, 4096, and 8192.
+ */
+#define MATRIX_BENCHMARK(name)                                         \
+    BENCHMARK_TEMPLATE(name, float)->RangeMultiplier(4)->Range(4, 8192);  \
+    BENCHMARK_TEMPLATE(name, double)->RangeMultiplier(4)->Range(4, 8192); \
+    BENCHMARK_TEMPLATE(name, int)->RangeMultiplier(4)->Range(4, 8192)
+
+/**
+ * @brief Register a benchmark for the large matrix multiplications, which take many seconds per iteration for the largest sizes.
+ */
+#define MATRIX_BENCHMARK_MULTIPLY(name)                                                                             \
+    BENCHMARK_TEMPLATE(name, float)->RangeMultiplier(4)->Range(4, 8192)->Unit(benchmark::kMillisecond)->UseRealTime();  \
+    BENCHMARK_TEMPLATE(name, double)->RangeMultiplier(4)->Range(4, 8192)->Unit(benchmark::kMillisecond)->UseRealTime(); \
+    BENCHMARK_TEMPLATE(name, int)->RangeMultiplier(4)->Range(4, 8192)->Unit(benchmark::kMillisecond)->UseRealTime()
+
+/**
+ * @brief Register a benchmark for a single fixed size.
+ */
+#define MATRIX_BENCHMARK_FIXED(name)  \
+    BENCHMARK_TEMPLATE(name, float);  \
+    BENCHMARK_TEMPLATE(name, double); \
+    BENCHMARK_TEMPLATE(name, int)
+
+MATRIX_BENCHMARK(BM_construct_uninitialized);
+MATRIX_BENCHMARK(BM_construct_fill);
+MATRIX_BENCHMARK(BM_construct_zeros);
+MATRIX_BENCHMARK(BM_construct_diagonal);
+MATRIX_BENCHMARK(BM_construct_vector);
+MATRIX_BENCHMARK(BM_construct_vector_move);
+MATRIX_BENCHMARK_FIXED(BM_construct_initializer_list);
+MATRIX_BENCHMARK_FIXED(BM_construct_diagonal_initializer_list);
+MATRIX_BENCHMARK(BM_construct_copy);
+MATRIX_BENCHMARK(BM_construct_move);
+MATRIX_BENCHMARK(BM_assign_copy);
+MATRIX_BENCHMARK(BM_assign_move);
+MATRIX_BENCHMARK(BM_access_unchecked);
+MATRIX_BENCHMARK(BM_access_checked);
+MATRIX_BENCHMARK(BM_add);
+MATRIX_BENCHMARK(BM_add_mixed_layout);
+MATRIX_BENCHMARK(BM_subtract);
+MATRIX_BENCHMARK(BM_negate);
+MATRIX_BENCHMARK(BM_scalar_multiply_left);
+MATRIX_BENCHMARK(BM_scalar_multiply_right);
+MATRIX_BENCHMARK(BM_fused_expression);
+MATRIX_BENCHMARK(BM_map_zip);
+MATRIX_BENCHMARK(BM_map_inplace);
+MATRIX_BENCHMARK(BM_add_assign);
+MATRIX_BENCHMARK(BM_subtract_assign);
+MATRIX_BENCHMARK(BM_multiply_assign);
+MATRIX_BENCHMARK(BM_divide_assign);
+MATRIX_BENCHMARK(BM_add_scaled);
+MATRIX_BENCHMARK_MULTIPLY(BM_multiply);
+MATRIX_BENCHMARK_MULTIPLY(BM_multiply_into);
+BENCHMARK_TEMPLATE(BM_multiply_mixed, float, bf16)->RangeMultiplier(4)->Range(4, 8192)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_multiply_mixed, float, fp16)->RangeMultiplier(4)->Range(4, 8192)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_multiply_mixed, int32_t, int8_t)->RangeMultiplier(4)->Range(4, 8192)->Unit(benchmark::kMillisecond)->UseRealTime();
+MATRIX_BENCHMARK_MULTIPLY(BM_multiply_transposed_view);
+MATRIX_BENCHMARK_MULTIPLY(BM_multiply_transposed);
+MATRIX_BENCHMARK(BM_transpose);
+MATRIX_BENCHMARK(BM_transpose_in_place);
+BENCHMARK_TEMPLATE(BM_multiply_strassen, float)->RangeMultiplier(4)->Range(1024, 8192)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_multiply_strassen, double)->RangeMultiplier(4)->Range(1024, 8192)->Unit(benchmark::kMillisecond)->UseRealTime();
+MATRIX_BENCHMARK(BM_gemv);
+MATRIX_BENCHMARK(BM_sum);
+BENCHMARK_TEMPLATE(BM_sum_kahan, float)->RangeMultiplier(4)->Range(4, 8192);
+BENCHMARK_TEMPLATE(BM_sum_kahan, double)->RangeMultiplier(4)->Range(4, 8192);
+MATRIX_BENCHMARK(BM_dot);
+MATRIX_BENCHMARK(BM_max);
+MATRIX_BENCHMARK(BM_col_sums);
+BENCHMARK_TEMPLATE(BM_lu_solve, float)->RangeMultiplier(4)->Range(16, 4096)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_lu_solve, double)->RangeMultiplier(4)->Range(16, 4096)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_batched_multiply, float)->DenseRange(2, 16, 1);
+BENCHMARK_TEMPLATE(BM_batched_multiply, double)->DenseRange(2, 16, 1);
+BENCHMARK_TEMPLATE(BM_sparse_multiply_vector, float)->RangeMultiplier(8)->Range(1024, 1 << 21);
+BENCHMARK_TEMPLATE(BM_sparse_multiply_vector, double)->RangeMultiplier(8)->Range(1024, 1 << 21);
+BENCHMARK_TEMPLATE(BM_sparse_multiply_dense, float)->RangeMultiplier(8)->Range(1024, 1 << 18);
+BENCHMARK_TEMPLATE(BM_sparse_multiply_dense, double)->RangeMultiplier(8)->Range(1024, 1 << 18);
+BENCHMARK_TEMPLATE(BM_print, float)->RangeMultiplier(4)->Range(4, max_print_size);
+BENCHMARK_TEMPLATE(BM_print, double)->RangeMultiplier(4)->Range(4, max_print_size);
+BENCHMARK_TEMPLATE(BM_print, int)->RangeMultiplier(4)->Range(4, max_print_size);
+BENCHMARK_TEMPLATE(BM_write_csv, float)->RangeMultiplier(4)->Range(4, max_print_size);
+BENCHMARK_TEMPLATE(BM_write_csv, double)->RangeMultiplier(4)->Range(4, max_print_size);
+BENCHMARK_TEMPLATE(BM_write_csv, int)->RangeMultiplier(4)->Range(4, max_print_size);
+BENCHMARK_TEMPLATE(BM_read_csv, float)->RangeMultiplier(4)->Range(4, max_print_size);
+BENCHMARK_TEMPLATE(BM_read_csv, double)->RangeMultiplier(4)->Range(4, max_print_size);
+BENCHMARK_TEMPLATE(BM_read_csv, int)->RangeMultiplier(4)->Range(4, max_print_size);
+
+// ==================
+// Regression harness
+// ==================
+
+/**
+ * @brief The number of seconds in one unit of a given time unit, as written by Google Benchmark.
+ */
+double seconds_per_unit(const std::string &unit)
+{
+    if (unit == "ns")
+        return 1e-9;
+    if (unit == "us")
+        return 1e-6;
+    if (unit == "ms")
+        return 1e-3;
+    return 1;
+}
+
+/**
+ * @brief A console reporter that also keeps the results of every benchmark, so that they can be summarized and compared with a baseline once all of the benchmarks have finished. Colors are not used, so that the output can be redirected to a file.
+ */
+class recording_reporter : public benchmark::ConsoleReporter
+{
+public:
+    recording_reporter()
+        : ConsoleReporter(OO_None) {}
+
+    /**
+     * @brief The real time per iteration in seconds of each benchmark that ran successfully, by its full name, as written to the output file.
+     */
+    std::map<std::string, double> times;
+
+    /**
+     * @brief The real time per iteration in seconds of each backend benchmark that ran successfully, by the name it was registered with. If the benchmark was repeated, the fastest repetition is kept.
+     */
+    std::map<std::string, double> backend_times;
+
+    /**
+     * @brief The names of the benchmarks that failed, for example because a backend gave a wrong result.
+     */
+    std::vector<std::string> failures;
+
+    void ReportRuns(const std::vector<Run> &reports) override
+    {
+        ConsoleReporter::ReportRuns(reports);
+        for (const Run &run : reports)
+        {
+            if (run.error_occurred)
+            {
+                if (run.error_message != "backend not available for this type")
+                    failures.push_back(run.benchmark_name());
+            }
+            else
+            {
+                const double time{run.GetAdjustedRealTime() * seconds_per_unit(benchmark::GetTimeUnitString(run.time_unit))};
+                times[run.benchmark_name()] = time;
+                if (run.run_type == Run::RT_Iteration and backend_benchmarks.contains(run.run_name.function_name))
+                {
+                    const auto [entry, inserted] = backend_times.try_emplace(run.run_name.function_name, time);
+                    if (not inserted)
+                        entry->second = std::min(entry->second, time);
+                }
+            }
+        }
+    }
+};
+
+/**
+ * @brief Read the real time per iteration of each benchmark from a file written by Google Benchmark using `--benchmark_out_format=json`, such as matrix_benchmark_baseline.json. Each benchmark in such a file is written with one field per line, so the fields are read line by line instead of parsing the JSON in full.
+ *
+ * @param path The path of the file.
+ * @return The real time per iteration in seconds of each benchmark, by name.
+ */
+std::map<std::string, double> read_baseline(const std::string &path)
+{
+    std::ifstream in(path);
+    if (not in)
+        throw std::runtime_error("could not open the baseline file " + path);
+    std::map<std::string, double> times;
+    std::string line, name;
+    double time{0};
+    const auto field{[&line](const std::string &key) -> std::optional<std::string>
+                     {
+                         const std::string prefix{"\"" + key + "\": "};
+                         const size_t start{line.find(prefix)};
+                         if (start == std::string::npos)
+                             return std::nullopt;
+                         std::string value{line.substr(start + prefix.size())};
+                         while (not value.empty() and (value.back() == ',' or value.back() == '\r'))
+                             value.pop_back();
+                         if (value.size() >= 2 and value.front() == '"' and value.back() == '"')
+                             value = value.substr(1, value.size() - 2);
+                         return value;
+                     }};
+    while (std::getline(in, line))
+    {
+        if (const std::optional<std::string> value{field("name")})
+            name = *value;
+        else if (const std::optional<std::string> real_time{field("real_time")})
+            time = std::stod(*real_time);
+        else if (const std::optional<std::string> unit{field("time_unit")})
+            times[name] = time * seconds_per_unit(*unit);
+    }
+    return times;
+}
+
+/**
+ * @brief Format a time in seconds with a suitable unit.
+ */
+std::string format_time(const double &seconds)
+{
+    std::ostringstream out;
+    out << std::setprecision(3);
+    if (seconds < 1e-6)
+        out << seconds * 1e9 << " ns";
+    else if (seconds < 1e-3)
+        out << seconds * 1e6 << " us";
+    else if (seconds < 1)
+        out << seconds * 1e3 << " ms";
+    else
+        out << seconds << " s";
+    return out.str();
+}
+
+/**
+ * @brief Print the crossover points of the backend benchmarks that ran: for each operation, type, shape, and thread count, the range of sizes in which each backend is the fastest, and for each backend, the size from which each thread count is faster than one thread. These are the points at which gemm() and the elementwise operations should switch between implementations, and can be compared with the thresholds that are currently used, which are printed first.
+ *
+ * @param times The real time per iteration of each backend benchmark, by the name it was registered with.
+ */
+void print_crossover_report(const std::map<std::string, double> &times)
+{
+    // For each group of benchmarks that differ only in the backend, the fastest backend and its time for each size. The dispatching backend is not an implementation in its own right, so it is not included, but its times are kept to check whether it chooses well.
+    std::map<std::tuple<std::string, std::string, shape, size_t>, std::map<size_t, std::pair<backend, double>>> fastest;
+    std::map<std::tuple<std::string, std::string, shape, size_t>, std::map<size_t, double>> dispatched;
+    // For each group of benchmarks that differ only in the number of threads, the time for each thread count and size.
+    std::map<std::tuple<std::string, std::string, shape, backend>, std::map<size_t, std::map<size_t, double>>> scaling;
+    for (const auto &[name, time] : times)
+    {
+        const auto found{backend_benchmarks.find(name)};
+        if (found == backend_benchmarks.end())
+            continue;
+        const backend_benchmark &info{found->second};
+        if (info.method != backend::reference)
+            scaling[{info.operation, info.type, info.form, info.method}][info.threads][info.size] = time;
+        if (info.method == backend::dispatch)
+        {
+            dispatched[{info.operation, info.type, info.form, info.threads}][info.size] = time;
+            continue;
+        }
+        for (const size_t threads : backend_thread_counts())
+        {
+            if (info.method != backend::reference and threads != info.threads)
+                continue;
+            std::pair<backend, double> &best{fastest[{info.operation, info.type, info.form, threads}].try_emplace(info.size, info.method, time).first->second};
+            if (time < best.second)
+                best = {info.method, time};
+        }
+    }
+    if (fastest.empty())
+        return;
+    std::cout << "\nCurrent thresholds: gemm() uses the blocked kernel for m * n * k >= " << matrix_detail::gemm_blocked_threshold;
+#if defined(MATRIX_USE_BLAS)
+    std::cout << " and the BLAS library for m * n * k >= " << matrix_detail::blas_gemm_threshold;
+#endif
+    std::cout << ", and elementwise operations use several threads for at least " << matrix_detail::parallel_elementwise_threshold << " elements.\n";
+    std::cout << "\nFastest backend by size (the reference implementation always uses one thread):\n";
+    for (const auto &[key, sizes] : fastest)
+    {
+        const auto &[operation, type, form, threads] = key;
+        std::cout << "  " << operation << "<" << type << "> " << shape_names[static_cast<size_t>(form)] << ", " << threads << (threads == 1 ? " thread: " : " threads: ");
+        for (auto i{sizes.begin()}; i != sizes.end();)
+        {
+            auto next{i};
+            while (next != sizes.end() and next->second.first == i->second.first)
+                next++;
+            const size_t last{std::prev(next)->first};
+            std::cout << backend_names[static_cast<size_t>(i->second.first)] << " for size " << i->first;
+            if (last != i->first)
+                std::cout << " to " << last;
+            i = next;
+            std::cout << (i == sizes.end() ? "\n" : ", ");
+        }
+        // Sizes at which gemm() is much slower than the fastest backend suggest that its thresholds should change.
+        const auto dispatch{dispatched.find(key)};
+        if (dispatch == dispatched.end())
+            continue;
+        std::ostringstream slow;
+        for (const auto &[size, time] : dispatch->second)
+        {
+            const auto best{sizes.find(size)};
+            if (best != sizes.end() and time > 1.1 * best->second.second)
+                slow << " " << size << " (" << std::setprecision(3) << time / best->second.second << "x)";
+        }
+        if (not slow.str().empty())
+            std::cout << "    dispatch is more than 10% slower than the fastest backend for size" << slow.str() << "\n";
+    }
+    std::ostringstream scaling_report;
+    for (const auto &[key, threads_sizes] : scaling)
+    {
+        const auto &[operation, type, form, method] = key;
+        const auto single{threads_sizes.find(1)};
+        if (single == threads_sizes.end() or threads_sizes.size() < 2)
+            continue;
+        scaling_report << "  " << operation << "<" << type << "> " << shape_names[static_cast<size_t>(form)] << ", " << backend_names[static_cast<size_t>(method)] << ":";
+        for (const auto &[threads, sizes] : threads_sizes)
+        {
+            if (threads == 1)
+                continue;
+            scaling_report << " " << threads << " threads from ";
+            // The crossover is the smallest size from which the threads are faster for every larger size.
+            std::optional<size_t> crossover;
+            for (const auto &[size, time] : sizes)
+            {
+                const auto one{single->second.find(size)};
+                if (one == single->second.end())
+                    continue;
+                if (time < one->second)
+                {
+                    if (not crossover)
+                        crossover = size;
+                }
+                else
+                    crossover.reset();
+            }
+            if (crossover)
+                scaling_report << "size " << *crossover << ";";
+            else
+                scaling_report << "never;";
+        }
+        scaling_report << "\n";
+    }
+    if (not scaling_report.str().empty())
+        std::cout << "\nSmallest size from which more threads are faster than one thread:\n"
+                  << scaling_report.str();
+}
+
+/**
+ * @brief Compare the results of the benchmarks that ran with a baseline, and print the benchmarks that are slower than the baseline by more than the tolerance. Benchmarks that are not in the baseline cannot be compared, so they are listed, and the comparison fails if none of the benchmarks that ran are in the baseline, since it would then pass without checking anything.
+ *
+ * @param times The real time per iteration of each benchmark, by name.
+ * @param path The path of the baseline, written by Google Benchmark using `--benchmark_out_format=json`.
+ * @param tolerance The largest allowed relative increase in the time per iteration.
+ * @return `true` if at least one benchmark was compared and none of them are slower than the baseline, or `false` otherwise.
+ */
+bool check_baseline(const std::map<std::string, double> &times, const std::string &path, const double &tolerance)
+{
+    const std::map<std::string, double> baseline{read_baseline(path)};
+    size_t compared{0}, regressions{0};
+    std::vector<std::string> missing;
+    std::cout << "\nComparison with " << path << " (tolerance " << tolerance * 100 << "%):\n";
+    for (const auto &[name, time] : times)
+    {
+        const auto found{baseline.find(name)};
+        if (found == baseline.end() or found->second <= 0)
+        {
+            missing.push_back(name);
+            continue;
+        }
+        compared++;
+        if (time > found->second * (1 + tolerance))
+        {
+            regressions++;
+            std::cout << "  SLOWER: " << name << ": " << format_time(found->second) << " -> " << format_time(time) << " (" << std::showpos << std::setprecision(3) << ((time / found->second) - 1) * 100 << std::noshowpos << "%)\n";
+        }
+    }
+    for (const std::string &name : missing)
+        std::cout << "  NOT IN BASELINE: " << name << "\n";
+    std::cout << "  " << regressions << " of " << compared << " benchmarks with a baseline are slower than the baseline";
+    if (not missing.empty())
+        std::cout << ", and " << missing.size() << " of " << times.size() << " benchmarks that ran have no baseline";
+    std::cout << ".\n";
+    if (compared == 0)
+    {
+        std::cout << "  ERROR: None of the benchmarks that ran are in the baseline, so nothing was compared. Record a new baseline using --benchmark_out, or check --benchmark_filter.\n";
+        return false;
+    }
+    return regressions == 0;
+}
+
+/**
+ * @brief Run the benchmarks, and then print the crossover report for the backend benchmarks that ran. In addition to the options of Google Benchmark, accepts `--regression_baseline=<file>` to compare the results with a baseline written using `--benchmark_out_format=json`, and `--regression_tolerance=<fraction>` (by default 0.1) to set the largest allowed slowdown.
+ *
+ * @return 1 if any backend gave a wrong result, any benchmark was slower than the baseline, or no benchmark could be compared with the baseline, or 0 otherwise.
+ */
+int main(int argc, char **argv)
+{
+    std::string baseline_path;
+    double tolerance{0.1};
+    std::vector<char *> arguments;
+    for (int i{0}; i < argc; i++)
+    {
+        const std::string argument{argv[i]};
+        if (argument.starts_with("--regression_baseline="))
+            baseline_path = argument.substr(argument.find('=') + 1);
+        else if (argument.starts_with("--regression_tolerance="))
+            tolerance = std::stod(argument.substr(argument.find('=') + 1));
+        else
+            arguments.push_back(argv[i]);
+    }
+    int remaining{static_cast<int>(arguments.size())};
+    benchmark::Initialize(&remaining, arguments.data());
+    if (benchmark::ReportUnrecognizedArguments(remaining, arguments.data()))
+        return 1;
+    register_backend_benchmarks<float>("float");
+    register_backend_benchmarks<double>("double");
+    register_backend_benchmarks<int>("int");
+    recording_reporter reporter;
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+    print_crossover_report(reporter.backend_times);
+    bool matches_baseline{true};
+    if (not baseline_path.empty())
+        matches_baseline = check_baseline(reporter.times, baseline_path, tolerance);
+    if (not reporter.failures.empty())
+    {
+        std::cout << "\nThe following benchmarks failed:\n";
+        for (const std::string &name : reporter.failures)
+            std::cout << "  " << name << "\n";
+    }
+    return (not matches_baseline or not reporter.failures.empty()) ? 1 : 0;
+}
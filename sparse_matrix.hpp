@@ -0,0 +1,856 @@
+#pragma once
+
+/**
+ * @file sparse_matrix.hpp
+ * @author Barak Shoshany (baraksh@gmail.com) (http://baraksh.com)
+ * @version 0.1
+ * @date 2020-11-30
+ * @copyright Copyright (c) 2020
+ *
+ * @brief A C++ class template for sparse matrices in compressed sparse row (CSR) or compressed sparse column (CSC) format, interoperable with the dense matrix class template in matrix.hpp.
+ *
+ * @details A sparse matrix only stores its non-zero elements, so both the memory used and the time taken by operations such as multiplication by a vector are proportional to the number of non-zero elements, rather than to the total number of elements. Sparse matrices can be built from (row, column, value) triplets using sparse_matrix::builder, or converted from dense matrices, and can be multiplied by vectors and dense matrices, and added to dense matrices. Conversions from and to dense matrices accept either layout, but the operators with dense operands walk the rows of the dense matrix through `data()`, so they only accept row-major matrices; convert a column-major matrix explicitly first.
+ */
+
+#include "matrix.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+#include <iostream>
+#include <vector>
+
+/**
+ * @brief The storage formats of a sparse matrix.
+ */
+enum class sparse_format
+{
+    /**
+     * @brief Compressed sparse row: the non-zero elements are stored row by row, sorted by column within each row. Best for multiplying by vectors, which is done in parallel over the rows.
+     */
+    csr,
+
+    /**
+     * @brief Compressed sparse column: the non-zero elements are stored column by column, sorted by row within each column.
+     */
+    csc
+};
+
+/**
+ * @brief A class template for sparse matrices, which only store their non-zero elements.
+ * @details The non-zero elements are stored in compressed form: in CSR format, `values` and `indices` hold the value and column of each non-zero element, row after row, and the elements of row `i` are at positions `offsets[i]` to `offsets[i + 1] - 1`. CSC format is the same with the roles of rows and columns exchanged.
+ *
+ * @tparam T The type to use for the matrix elements. Can be any type that has addition, subtraction, negation, and multiplication defined.
+ */
+template <typename T>
+class sparse_matrix
+{
+public:
+    /**
+     * @brief The type of the matrix elements.
+     */
+    using value_type = T;
+
+    /**
+     * @brief A builder used to create a sparse matrix from a list of (row, column, value) triplets, given in any order.
+     */
+    class builder
+    {
+    public:
+        /**
+         * @brief Construct a new builder for a sparse matrix of a given size.
+         *
+         * @param input_rows The number of rows.
+         * @param input_cols The number of columns.
+         * @throws zero_size if the number of rows or columns is zero.
+         */
+        builder(const size_t &input_rows, const size_t &input_cols)
+            : rows(input_rows), cols(input_cols)
+        {
+            if (rows == 0 or cols == 0)
+                throw zero_size{};
+        }
+
+        /**
+         * @brief Reserve memory for a number of triplets, to avoid reallocations when the number of triplets is known in advance.
+         *
+         * @param n The number of triplets.
+         */
+        void reserve(const size_t &n)
+        {
+            triplets.reserve(n);
+        }
+
+        /**
+         * @brief Add an element. If several elements are added at the same row and column, their values are summed.
+         *
+         * @param row The row index (starting from zero).
+         * @param col The column index (starting from zero).
+         * @param value The value of the element.
+         * @throws index_out_of_range if the row or column is out of range.
+         */
+        void add(const size_t &row, const size_t &col, const T &value)
+        {
+            if (row >= rows or col >= cols)
+                throw index_out_of_range{};
+            triplets.push_back({row, col, value});
+        }
+
+        /**
+         * @brief Build the sparse matrix from the triplets added so far.
+         *
+         * @param format The storage format of the sparse matrix.
+         * @return The sparse matrix.
+         */
+        sparse_matrix<T> build(const sparse_format &format = sparse_format::csr) const
+        {
+            const bool csr{format == sparse_format::csr};
+            std::vector<triplet> sorted(triplets);
+            std::stable_sort(sorted.begin(), sorted.end(), [&](const triplet &a, const triplet &b)
+                      { return csr ? ((a.row < b.row) or (a.row == b.row and a.col < b.col)) : ((a.col < b.col) or (a.col == b.col and a.row < b.row)); });
+            sparse_matrix<T> s(rows, cols, format);
+            s.indices.reserve(sorted.size());
+            s.values.reserve(sorted.size());
+            for (size_t i{0}; i < sorted.size(); i++)
+            {
+                const size_t major{csr ? sorted[i].row : sorted[i].col}, minor{csr ? sorted[i].col : sorted[i].row};
+                if (i != 0 and sorted[i].row == sorted[i - 1].row and sorted[i].col == sorted[i - 1].col)
+                    s.values.back() = s.values.back() + sorted[i].value;
+                else
+                {
+                    s.indices.push_back(minor);
+                    s.values.push_back(sorted[i].value);
+                    s.offsets[major + 1]++;
+                }
+            }
+            for (size_t i{0}; i < s.major_size(); i++)
+                s.offsets[i + 1] += s.offsets[i];
+            return s;
+        }
+
+    private:
+        /**
+         * @brief A (row, column, value) triplet.
+         */
+        struct triplet
+        {
+            size_t row{0};
+            size_t col{0};
+            T value;
+        };
+
+        /**
+         * @brief The number of rows.
+         */
+        size_t rows{0};
+
+        /**
+         * @brief The number of columns.
+         */
+        size_t cols{0};
+
+        /**
+         * @brief The triplets added so far.
+         */
+        std::vector<triplet> triplets;
+    };
+
+    // ============
+    // Constructors
+    // ============
+
+    /**
+     * @brief Constructor to create a sparse matrix with no non-zero elements.
+     *
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @param input_format The storage format.
+     * @throws zero_size if the number of rows or columns is zero.
+     */
+    sparse_matrix(const size_t &input_rows, const size_t &input_cols, const sparse_format &input_format = sparse_format::csr)
+        : rows(input_rows), cols(input_cols), format(input_format)
+    {
+        if (rows == 0 or cols == 0)
+            throw zero_size{};
+        offsets.assign(major_size() + 1, 0);
+    }
+
+    /**
+     * @brief Constructor to create a sparse diagonal matrix from a `vector`. Only the diagonal is stored, so this uses memory proportional to the size of the `vector`, unlike the corresponding constructor of the dense matrix.
+     *
+     * @param input_diagonal A `vector` containing the elements on the diagonal. The number of rows and columns is inferred automatically from the size of the `vector`.
+     * @throws zero_size if the size of the `vector` is zero.
+     */
+    sparse_matrix(const std::vector<T> &input_diagonal)
+        : sparse_matrix(input_diagonal.size(), input_diagonal.size())
+    {
+        values = input_diagonal;
+        indices.resize(rows);
+        for (size_t i{0}; i < rows; i++)
+        {
+            indices[i] = i;
+            offsets[i + 1] = i + 1;
+        }
+    }
+
+    /**
+     * @brief Constructor to create a sparse diagonal matrix from an `initializer_list`.
+     *
+     * @param input_diagonal An `initializer_list` containing the elements on the diagonal. The number of rows and columns is inferred automatically from the size of the `initializer_list`.
+     * @throws zero_size if the size of the `initializer_list` is zero.
+     */
+    sparse_matrix(const std::initializer_list<T> &input_diagonal)
+        : sparse_matrix(std::vector<T>{input_diagonal}) {}
+
+    /**
+     * @brief Constructor to create a sparse matrix from arrays that are already in compressed form, for example as read from a file or received from another library. See the class description for the meaning of the arrays.
+     *
+     * @param input_rows The number of rows.
+     * @param input_cols The number of columns.
+     * @param input_format The storage format.
+     * @param input_offsets The offsets of the rows (in CSR format) or columns (in CSC format). Must have one more element than the number of rows or columns.
+     * @param input_indices The column (in CSR format) or row (in CSC format) of each non-zero element.
+     * @param input_values The value of each non-zero element.
+     * @throws zero_size if the number of rows or columns is zero.
+     * @throws initializer_wrong_size if the sizes of the arrays are not consistent with each other and with the number of rows and columns.
+     */
+    sparse_matrix(const size_t &input_rows, const size_t &input_cols, const sparse_format &input_format, std::vector<size_t> input_offsets, std::vector<size_t> input_indices, std::vector<T> input_values)
+        : rows(input_rows), cols(input_cols), format(input_format), offsets(std::move(input_offsets)), indices(std::move(input_indices)), values(std::move(input_values))
+    {
+        if (rows == 0 or cols == 0)
+            throw zero_size{};
+        if (offsets.size() != major_size() + 1 or offsets.front() != 0 or offsets.back() != values.size() or indices.size() != values.size() or not std::is_sorted(offsets.begin(), offsets.end()))
+            throw initializer_wrong_size{};
+        for (const size_t &index : indices)
+            if (index >= minor_size())
+                throw initializer_wrong_size{};
+    }
+
+    /**
+     * @brief Constructor to create a sparse matrix from the non-zero elements of a dense matrix.
+     *
+     * @param m The dense matrix.
+     * @param input_format The storage format.
+     */
+    template <typename Allocator, layout Layout>
+    explicit sparse_matrix(const matrix<T, Allocator, Layout> &m, const sparse_format &input_format = sparse_format::csr)
+        : sparse_matrix(m.get_rows(), m.get_cols(), input_format)
+    {
+        for (size_t major{0}; major < major_size(); major++)
+        {
+            for (size_t minor{0}; minor < minor_size(); minor++)
+            {
+                const T &value{(format == sparse_format::csr) ? m(major, minor) : m(minor, major)};
+                if (value != T{0})
+                {
+                    indices.push_back(minor);
+                    values.push_back(value);
+                }
+            }
+            offsets[major + 1] = values.size();
+        }
+    }
+
+    // ================
+    // Member functions
+    // ================
+
+    /**
+     * @brief Convert this sparse matrix to a dense matrix with the same elements.
+     *
+     * @tparam Allocator The allocator of the dense matrix.
+     * @tparam Layout The storage order of the dense matrix.
+     * @return The dense matrix.
+     */
+    template <typename Allocator = aligned_allocator<T>, layout Layout = layout::row_major>
+    matrix<T, Allocator, Layout> to_matrix() const
+    {
+        matrix<T, Allocator, Layout> m(rows, cols, T{0});
+        for_each_nonzero([&](const size_t &row, const size_t &col, const T &value)
+                         { m(row, col) = value; });
+        return m;
+    }
+
+    /**
+     * @brief Convert this sparse matrix to a given storage format.
+     *
+     * @param target_format The storage format.
+     * @return A sparse matrix with the same elements in the given format (a copy of this matrix if it is already in that format).
+     */
+    sparse_matrix<T> to_format(const sparse_format &target_format) const
+    {
+        if (target_format == format)
+            return *this;
+        // Transposing the compressed arrays, using a counting sort on the minor index, converts between the formats.
+        sparse_matrix<T> s(rows, cols, target_format);
+        for (const size_t &index : indices)
+            s.offsets[index + 1]++;
+        for (size_t i{0}; i < s.major_size(); i++)
+            s.offsets[i + 1] += s.offsets[i];
+        s.indices.resize(values.size());
+        s.values.resize(values.size());
+        std::vector<size_t> next(s.offsets.begin(), s.offsets.end() - 1);
+        for (size_t major{0}; major < major_size(); major++)
+            for (size_t p{offsets[major]}; p < offsets[major + 1]; p++)
+            {
+                const size_t q{next[indices[p]]++};
+                s.indices[q] = major;
+                s.values[q] = values[p];
+            }
+        return s;
+    }
+
+    /**
+     * @brief Member function used to obtain the transpose of this sparse matrix. Only the format changes, from CSR to CSC or vice versa, so no sorting is needed.
+     *
+     * @return The transpose.
+     */
+    sparse_matrix<T> transpose() const
+    {
+        return sparse_matrix<T>(cols, rows, (format == sparse_format::csr) ? sparse_format::csc : sparse_format::csr, offsets, indices, values);
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the number of rows in the matrix.
+     *
+     * @return The number of rows.
+     */
+    inline size_t get_rows() const
+    {
+        return rows;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the number of columns in the matrix.
+     *
+     * @return The number of columns.
+     */
+    inline size_t get_cols() const
+    {
+        return cols;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the number of stored non-zero elements.
+     *
+     * @return The number of non-zero elements.
+     */
+    inline size_t get_nonzeros() const
+    {
+        return values.size();
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the storage format.
+     *
+     * @return The storage format.
+     */
+    inline sparse_format get_format() const
+    {
+        return format;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the offsets of the rows (in CSR format) or columns (in CSC format) in the compressed arrays.
+     *
+     * @return A reference to the offsets.
+     */
+    inline const std::vector<size_t> &get_offsets() const
+    {
+        return offsets;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the column (in CSR format) or row (in CSC format) of each non-zero element.
+     *
+     * @return A reference to the indices.
+     */
+    inline const std::vector<size_t> &get_indices() const
+    {
+        return indices;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the value of each non-zero element.
+     *
+     * @return A reference to the values.
+     */
+    inline const std::vector<T> &get_values() const
+    {
+        return values;
+    }
+
+    /**
+     * @brief Overloaded operator () used to obtain the value of an element WITHOUT range checking. This takes time logarithmic in the number of non-zero elements in the row (in CSR format) or column (in CSC format).
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return The value of the element, which is zero if the element is not stored.
+     */
+    T operator()(const size_t &row, const size_t &col) const
+    {
+        const size_t major{(format == sparse_format::csr) ? row : col}, minor{(format == sparse_format::csr) ? col : row};
+        const auto begin{indices.begin() + static_cast<std::ptrdiff_t>(offsets[major])}, end{indices.begin() + static_cast<std::ptrdiff_t>(offsets[major + 1])};
+        const auto it{std::lower_bound(begin, end, minor)};
+        return (it != end and *it == minor) ? values[static_cast<size_t>(it - indices.begin())] : T{0};
+    }
+
+    /**
+     * @brief Member function used to obtain the value of an element WITH range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return The value of the element, which is zero if the element is not stored.
+     * @throws index_out_of_range if the requested element is out of range.
+     */
+    T at(const size_t &row, const size_t &col) const
+    {
+        if (row >= rows or col >= cols)
+            throw index_out_of_range{};
+        return (*this)(row, col);
+    }
+
+    // ====================
+    // Overloaded operators
+    // ====================
+
+    /**
+     * @brief Overloaded binary operator `<<` used to print out a sparse matrix to a stream, in the same format as a dense matrix, including the zeros. Intended for small matrices.
+     *
+     * @param out The output stream.
+     * @param s The sparse matrix to be printed.
+     * @return A reference to the output stream.
+     */
+    friend std::ostream &operator<<(std::ostream &out, const sparse_matrix<T> &s)
+    {
+        return out << s.to_matrix();
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a sparse matrix by a vector (SpMV). In CSR format, the rows are processed in parallel for large matrices, split so that each thread gets a similar number of non-zero elements.
+     *
+     * @param s The sparse matrix.
+     * @param x The vector.
+     * @return The product, as a vector.
+     * @throws incompatible_sizes_multiply if the size of the vector is not the same as the number of columns in the matrix.
+     */
+    friend std::vector<T> operator*(const sparse_matrix<T> &s, const std::vector<T> &x)
+    {
+        if (x.size() != s.cols)
+            throw incompatible_sizes_multiply{};
+        std::vector<T> y(s.rows, T{0});
+        if (s.format == sparse_format::csr)
+            s.for_each_row_chunk([&](const size_t &begin, const size_t &end)
+                                 {
+                                     for (size_t i{begin}; i < end; i++)
+                                     {
+                                         T sum{0};
+                                         for (size_t p{s.offsets[i]}; p < s.offsets[i + 1]; p++)
+                                             sum += s.values[p] * x[s.indices[p]];
+                                         y[i] = sum;
+                                     }
+                                 });
+        else
+            for (size_t j{0}; j < s.cols; j++)
+                for (size_t p{s.offsets[j]}; p < s.offsets[j + 1]; p++)
+                    y[s.indices[p]] += s.values[p] * x[j];
+        return y;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a sparse matrix on the left by a dense matrix on the right (SpMM). The rows of the result are processed in parallel for large matrices. Matrices in CSC format are converted to CSR format first.
+     *
+     * @param s The sparse matrix.
+     * @param b The dense matrix.
+     * @return The product, as a dense matrix.
+     * @throws incompatible_sizes_multiply if the number of columns in the sparse matrix is not the same as the number of rows in the dense matrix.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator*(const sparse_matrix<T> &s, const matrix<T, Allocator> &b)
+    {
+        if (s.cols != b.get_rows())
+            throw incompatible_sizes_multiply{};
+        if (s.format == sparse_format::csc)
+            return s.to_format(sparse_format::csr) * b;
+        const size_t n{b.get_cols()};
+        matrix<T, Allocator> c(s.rows, n, T{0});
+        s.for_each_row_chunk([&](const size_t &begin, const size_t &end)
+                             {
+                                 for (size_t i{begin}; i < end; i++)
+                                 {
+                                     T *c_row{c.data() + (c.get_stride() * i)};
+                                     for (size_t p{s.offsets[i]}; p < s.offsets[i + 1]; p++)
+                                     {
+                                         const T value{s.values[p]};
+                                         const T *b_row{b.data() + (b.get_stride() * s.indices[p])};
+                                         for (size_t j{0}; j < n; j++)
+                                             c_row[j] += value * b_row[j];
+                                     }
+                                 }
+                             });
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a dense matrix on the left by a sparse matrix on the right. The rows of the result are processed in parallel for large matrices.
+     *
+     * @param a The dense matrix.
+     * @param s The sparse matrix.
+     * @return The product, as a dense matrix.
+     * @throws incompatible_sizes_multiply if the number of columns in the dense matrix is not the same as the number of rows in the sparse matrix.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator*(const matrix<T, Allocator> &a, const sparse_matrix<T> &s)
+    {
+        if (a.get_cols() != s.rows)
+            throw incompatible_sizes_multiply{};
+        const size_t m{a.get_rows()};
+        matrix<T, Allocator> c(m, s.cols, T{0});
+        // Each row of the result takes time proportional to the number of non-zero elements.
+        matrix_detail::for_each_row_chunk(m, std::max<size_t>(1, s.get_nonzeros()), [&](const size_t &begin, const size_t &end)
+                                          {
+                                              for (size_t i{begin}; i < end; i++)
+                                              {
+                                                  T *c_row{c.data() + (c.get_stride() * i)};
+                                                  const T *a_row{a.data() + (a.get_stride() * i)};
+                                                  if (s.format == sparse_format::csr)
+                                                  {
+                                                      // Row i of the result is the sum of the rows of the sparse matrix, weighted by row i of the dense matrix.
+                                                      for (size_t k{0}; k < s.rows; k++)
+                                                          for (size_t p{s.offsets[k]}; p < s.offsets[k + 1]; p++)
+                                                              c_row[s.indices[p]] += a_row[k] * s.values[p];
+                                                  }
+                                                  else
+                                                  {
+                                                      // Each element of row i of the result is the dot product of row i of the dense matrix with a column of the sparse matrix.
+                                                      for (size_t j{0}; j < s.cols; j++)
+                                                      {
+                                                          T sum{0};
+                                                          for (size_t p{s.offsets[j]}; p < s.offsets[j + 1]; p++)
+                                                              sum += a_row[s.indices[p]] * s.values[p];
+                                                          c_row[j] = sum;
+                                                      }
+                                                  }
+                                              }
+                                          });
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add a sparse matrix and a dense matrix. Since the result is generally dense, it is returned as a dense matrix.
+     *
+     * @param s The sparse matrix.
+     * @param m The dense matrix.
+     * @return The sum, as a dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator+(const sparse_matrix<T> &s, const matrix<T, Allocator> &m)
+    {
+        matrix<T, Allocator> c(m);
+        c += s;
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add a dense matrix and a sparse matrix. Since the result is generally dense, it is returned as a dense matrix.
+     *
+     * @param m The dense matrix.
+     * @param s The sparse matrix.
+     * @return The sum, as a dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator+(const matrix<T, Allocator> &m, const sparse_matrix<T> &s)
+    {
+        matrix<T, Allocator> c(m);
+        c += s;
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `-` used to subtract a dense matrix from a sparse matrix, returning a dense matrix.
+     *
+     * @param s The sparse matrix.
+     * @param m The dense matrix to be subtracted.
+     * @return The difference, as a dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator-(const sparse_matrix<T> &s, const matrix<T, Allocator> &m)
+    {
+        matrix<T, Allocator> c = -m;
+        c += s;
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `-` used to subtract a sparse matrix from a dense matrix, returning a dense matrix.
+     *
+     * @param m The dense matrix.
+     * @param s The sparse matrix to be subtracted.
+     * @return The difference, as a dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator-(const matrix<T, Allocator> &m, const sparse_matrix<T> &s)
+    {
+        matrix<T, Allocator> c(m);
+        c -= s;
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+=` used to add a sparse matrix to a dense matrix in place. Only the elements that are stored in the sparse matrix are touched.
+     *
+     * @param m The dense matrix.
+     * @param s The sparse matrix to be added.
+     * @return A reference to the dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> &operator+=(matrix<T, Allocator> &m, const sparse_matrix<T> &s)
+    {
+        if (m.get_rows() != s.rows or m.get_cols() != s.cols)
+            throw incompatible_sizes_add{};
+        s.for_each_nonzero([&](const size_t &row, const size_t &col, const T &value)
+                           { m(row, col) += value; });
+        return m;
+    }
+
+    /**
+     * @brief Overloaded binary operator `-=` used to subtract a sparse matrix from a dense matrix in place. Only the elements that are stored in the sparse matrix are touched.
+     *
+     * @param m The dense matrix.
+     * @param s The sparse matrix to be subtracted.
+     * @return A reference to the dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> &operator-=(matrix<T, Allocator> &m, const sparse_matrix<T> &s)
+    {
+        if (m.get_rows() != s.rows or m.get_cols() != s.cols)
+            throw incompatible_sizes_add{};
+        s.for_each_nonzero([&](const size_t &row, const size_t &col, const T &value)
+                           { m(row, col) -= value; });
+        return m;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add two sparse matrices. The result is in the format of the first matrix.
+     *
+     * @param a The first sparse matrix to be added.
+     * @param b The second sparse matrix to be added.
+     * @return The sum, as a sparse matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    friend sparse_matrix<T> operator+(const sparse_matrix<T> &a, const sparse_matrix<T> &b)
+    {
+        return merge(a, b, [](const T &x, const T &y)
+                     { return x + y; });
+    }
+
+    /**
+     * @brief Overloaded binary operator `-` used to subtract two sparse matrices. The result is in the format of the first matrix.
+     *
+     * @param a The first sparse matrix.
+     * @param b The second sparse matrix, to be subtracted from the first.
+     * @return The difference, as a sparse matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    friend sparse_matrix<T> operator-(const sparse_matrix<T> &a, const sparse_matrix<T> &b)
+    {
+        return merge(a, b, [](const T &x, const T &y)
+                     { return x - y; });
+    }
+
+    /**
+     * @brief Overloaded unary operator `-` used to take the negative of a sparse matrix.
+     *
+     * @param s The sparse matrix.
+     * @return The negative of the sparse matrix.
+     */
+    friend sparse_matrix<T> operator-(sparse_matrix<T> s)
+    {
+        for (T &value : s.values)
+            value = -value;
+        return s;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a scalar on the left and a sparse matrix on the right.
+     *
+     * @param x The scalar.
+     * @param s The sparse matrix.
+     * @return The scalar multiple of the sparse matrix.
+     */
+    friend sparse_matrix<T> operator*(const T &x, sparse_matrix<T> s)
+    {
+        for (T &value : s.values)
+            value = x * value;
+        return s;
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a sparse matrix on the left and a scalar on the right.
+     *
+     * @param s The sparse matrix.
+     * @param x The scalar.
+     * @return The scalar multiple of the sparse matrix.
+     */
+    friend sparse_matrix<T> operator*(const sparse_matrix<T> &s, const T &x)
+    {
+        return x * s;
+    }
+
+    // ==========
+    // Exceptions
+    // ==========
+
+    /**
+     * @brief Exception to be thrown if the number of rows or columns given to the constructor is zero.
+     */
+    using zero_size = matrix_detail::zero_size<T>;
+
+    /**
+     * @brief Exception to be thrown if the compressed arrays given to the constructor are not consistent.
+     */
+    using initializer_wrong_size = matrix_detail::initializer_wrong_size<T>;
+
+    /**
+     * @brief Exception to be thrown if two matrices that are added or subtracted do not have the same number of rows and columns.
+     */
+    using incompatible_sizes_add = matrix_detail::incompatible_sizes_add<T>;
+
+    /**
+     * @brief Exception to be thrown when multiplying if the number of columns in the first operand is not the same as the number of rows in the second operand.
+     */
+    using incompatible_sizes_multiply = matrix_detail::incompatible_sizes_multiply<T>;
+
+    /**
+     * @brief Exception to be thrown if the requested matrix element is out of range.
+     */
+    using index_out_of_range = matrix_detail::index_out_of_range<T>;
+
+private:
+    /**
+     * @brief The number of rows (in CSR format) or columns (in CSC format), which is the number of segments in the compressed arrays.
+     */
+    inline size_t major_size() const
+    {
+        return (format == sparse_format::csr) ? rows : cols;
+    }
+
+    /**
+     * @brief The number of columns (in CSR format) or rows (in CSC format).
+     */
+    inline size_t minor_size() const
+    {
+        return (format == sparse_format::csr) ? cols : rows;
+    }
+
+    /**
+     * @brief Call `f(row, col, value)` for each stored element.
+     */
+    template <typename F>
+    void for_each_nonzero(F &&f) const
+    {
+        for (size_t major{0}; major < major_size(); major++)
+            for (size_t p{offsets[major]}; p < offsets[major + 1]; p++)
+            {
+                if (format == sparse_format::csr)
+                    f(major, indices[p], values[p]);
+                else
+                    f(indices[p], major, values[p]);
+            }
+    }
+
+    /**
+     * @brief Call `f(begin, end)` on chunks of the range of rows of a matrix in CSR format, in parallel using the global thread pool for matrices with many non-zero elements. The chunks are split so that each one has a similar number of non-zero elements, rather than a similar number of rows.
+     */
+    template <typename F>
+    void for_each_row_chunk(F &&f) const
+    {
+        const size_t nonzeros{values.size()};
+        if (nonzeros < matrix_detail::parallel_elementwise_threshold)
+        {
+            f(size_t{0}, rows);
+            return;
+        }
+        // Split the non-zero elements into chunks, and give each row to the chunk containing its first element. Empty rows at the end go to the last chunk.
+        matrix_detail::for_each_chunk(nonzeros, [&](const size_t &begin, const size_t &end)
+                                      {
+                                          const size_t first_row{static_cast<size_t>(std::lower_bound(offsets.begin(), offsets.end() - 1, begin) - offsets.begin())};
+                                          const size_t last_row{(end == nonzeros) ? rows : static_cast<size_t>(std::lower_bound(offsets.begin(), offsets.end() - 1, end) - offsets.begin())};
+                                          f(first_row, last_row);
+                                      });
+    }
+
+    /**
+     * @brief Merge two sparse matrices elementwise, combining the elements stored in either one using `f` (with zero standing for the elements stored in only one of them).
+     */
+    template <typename F>
+    static sparse_matrix<T> merge(const sparse_matrix<T> &a, const sparse_matrix<T> &input_b, const F &f)
+    {
+        if (a.rows != input_b.rows or a.cols != input_b.cols)
+            throw incompatible_sizes_add{};
+        const sparse_matrix<T> b{input_b.to_format(a.format)};
+        sparse_matrix<T> c(a.rows, a.cols, a.format);
+        c.indices.reserve(a.values.size() + b.values.size());
+        c.values.reserve(a.values.size() + b.values.size());
+        for (size_t major{0}; major < a.major_size(); major++)
+        {
+            size_t p{a.offsets[major]}, q{b.offsets[major]};
+            const size_t p_end{a.offsets[major + 1]}, q_end{b.offsets[major + 1]};
+            while (p < p_end or q < q_end)
+            {
+                if (q == q_end or (p < p_end and a.indices[p] < b.indices[q]))
+                {
+                    c.indices.push_back(a.indices[p]);
+                    c.values.push_back(f(a.values[p++], T{0}));
+                }
+                else if (p == p_end or b.indices[q] < a.indices[p])
+                {
+                    c.indices.push_back(b.indices[q]);
+                    c.values.push_back(f(T{0}, b.values[q++]));
+                }
+                else
+                {
+                    c.indices.push_back(a.indices[p]);
+                    c.values.push_back(f(a.values[p++], b.values[q++]));
+                }
+            }
+            c.offsets[major + 1] = c.values.size();
+        }
+        return c;
+    }
+
+    /**
+     * @brief The number of rows.
+     */
+    size_t rows{0};
+
+    /**
+     * @brief The number of columns.
+     */
+    size_t cols{0};
+
+    /**
+     * @brief The storage format.
+     */
+    sparse_format format{sparse_format::csr};
+
+    /**
+     * @brief The offsets of the rows (in CSR format) or columns (in CSC format) in the compressed arrays.
+     */
+    std::vector<size_t> offsets;
+
+    /**
+     * @brief The column (in CSR format) or row (in CSC format) of each non-zero element.
+     */
+    std::vector<size_t> indices;
+
+    /**
+     * @brief The value of each non-zero element.
+     */
+    std::vector<T> values;
+};
@@ -0,0 +1,1572 @@
+#pragma once
+
+/**
+ * @file structured_matrix.hpp
+ * @author Barak Shoshany (baraksh@gmail.com) (http://baraksh.com)
+ * @version 0.1
+ * @date 2020-11-30
+ * @copyright Copyright (c) 2020
+ *
+ * @brief C++ class templates for square matrices with a known structure: diagonal, upper and lower triangular, symmetric, and banded matrices, interoperable with the dense matrix class template in matrix.hpp.
+ *
+ * @details Each structured matrix only stores the elements that its structure allows to be non-zero (or, for symmetric matrices, only one copy of each pair of equal elements), and its operators only visit those elements. For example, an n x n diagonal matrix stores n elements instead of n^2, and multiplying it by an n x n dense matrix scales the rows of the dense matrix in O(n^2) time instead of performing an O(n^3) matrix multiplication. Triangular and diagonal systems of equations can be solved directly using solve(). Structured matrices can be constructed explicitly from dense matrices of either layout, and converted back to dense matrices of either layout using `to_matrix()`. The operators and solve() process the dense operand one row at a time, so they only accept row-major dense matrices.
+ */
+
+#include "matrix.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+#include <iostream>
+#include <vector>
+
+namespace matrix_detail
+{
+    // =============================
+    // Structured matrix operations
+    // =============================
+
+    /**
+     * @brief Multiply a structured matrix on the left by a dense matrix on the right. Row `i` of the result is the sum of the rows of the dense matrix, weighted by the stored elements of row `i` of the structured matrix, so only the stored elements are visited.
+     *
+     * @param s The structured matrix. Must have the member functions `get_size()`, `row_work()`, and `for_each_in_row()`.
+     * @param b The dense matrix.
+     * @return The product.
+     * @throws incompatible_sizes_multiply if the sizes are not compatible.
+     */
+    template <typename S, typename T, typename Allocator>
+    matrix<T, Allocator> structured_multiply(const S &s, const matrix<T, Allocator> &b)
+    {
+        const size_t n{s.get_size()}, m{b.get_cols()};
+        if (b.get_rows() != n)
+            throw incompatible_sizes_multiply<T>{};
+        matrix<T, Allocator> c(n, m, T{0});
+        for_each_row_chunk(n, s.row_work() * m, [&](const size_t &begin, const size_t &end)
+                           {
+                               for (size_t i{begin}; i < end; i++)
+                               {
+                                   T *c_row{c.data() + (c.get_stride() * i)};
+                                   s.for_each_in_row(i, [&](const size_t &k, const T &value)
+                                                     {
+                                                         const T *b_row{b.data() + (b.get_stride() * k)};
+                                                         for (size_t j{0}; j < m; j++)
+                                                             c_row[j] += value * b_row[j];
+                                                     });
+                               }
+                           });
+        return c;
+    }
+
+    /**
+     * @brief Multiply a dense matrix on the left by a structured matrix on the right. Row `i` of the result is the sum of the rows of the structured matrix, weighted by row `i` of the dense matrix, so only the stored elements are visited.
+     *
+     * @param a The dense matrix.
+     * @param s The structured matrix. Must have the member functions `get_size()`, `row_work()`, and `for_each_in_row()`.
+     * @return The product.
+     * @throws incompatible_sizes_multiply if the sizes are not compatible.
+     */
+    template <typename S, typename T, typename Allocator>
+    matrix<T, Allocator> structured_multiply(const matrix<T, Allocator> &a, const S &s)
+    {
+        const size_t n{s.get_size()}, m{a.get_rows()};
+        if (a.get_cols() != n)
+            throw incompatible_sizes_multiply<T>{};
+        matrix<T, Allocator> c(m, n, T{0});
+        for_each_row_chunk(m, s.row_work() * n, [&](const size_t &begin, const size_t &end)
+                           {
+                               for (size_t i{begin}; i < end; i++)
+                               {
+                                   T *c_row{c.data() + (c.get_stride() * i)};
+                                   const T *a_row{a.data() + (a.get_stride() * i)};
+                                   for (size_t k{0}; k < n; k++)
+                                   {
+                                       const T a_ik{a_row[k]};
+                                       s.for_each_in_row(k, [&](const size_t &j, const T &value)
+                                                         { c_row[j] += a_ik * value; });
+                                   }
+                               }
+                           });
+        return c;
+    }
+
+    /**
+     * @brief Multiply a structured matrix by a vector.
+     *
+     * @param s The structured matrix. Must have the member functions `get_size()`, `row_work()`, and `for_each_in_row()`.
+     * @param x The vector.
+     * @return The product, as a vector.
+     * @throws incompatible_sizes_multiply if the size of the vector is not the same as the size of the matrix.
+     */
+    template <typename S, typename T>
+    std::vector<T> structured_multiply(const S &s, const std::vector<T> &x)
+    {
+        const size_t n{s.get_size()};
+        if (x.size() != n)
+            throw incompatible_sizes_multiply<T>{};
+        std::vector<T> y(n);
+        for_each_row_chunk(n, s.row_work(), [&](const size_t &begin, const size_t &end)
+                           {
+                               for (size_t i{begin}; i < end; i++)
+                               {
+                                   T sum{0};
+                                   s.for_each_in_row(i, [&](const size_t &k, const T &value)
+                                                     { sum += value * x[k]; });
+                                   y[i] = sum;
+                               }
+                           });
+        return y;
+    }
+
+    /**
+     * @brief Add a structured matrix to a dense matrix. Only the stored elements of the structured matrix are visited.
+     *
+     * @param s The structured matrix. Must have the member functions `get_size()`, `row_work()`, and `for_each_in_row()`.
+     * @param m The dense matrix.
+     * @return The sum, as a dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename S, typename T, typename Allocator>
+    matrix<T, Allocator> structured_add(const S &s, const matrix<T, Allocator> &m)
+    {
+        const size_t n{s.get_size()};
+        if (m.get_rows() != n or m.get_cols() != n)
+            throw incompatible_sizes_add<T>{};
+        matrix<T, Allocator> c(m);
+        for_each_row_chunk(n, s.row_work(), [&](const size_t &begin, const size_t &end)
+                           {
+                               for (size_t i{begin}; i < end; i++)
+                               {
+                                   T *c_row{c.data() + (c.get_stride() * i)};
+                                   s.for_each_in_row(i, [&](const size_t &j, const T &value)
+                                                     { c_row[j] += value; });
+                               }
+                           });
+        return c;
+    }
+
+    /**
+     * @brief Convert a structured matrix to a dense matrix.
+     *
+     * @param s The structured matrix. Must have the member functions `get_size()`, `row_work()`, and `for_each_in_row()`.
+     * @return The dense matrix.
+     */
+    template <typename Allocator, layout Layout, typename S>
+    matrix<typename S::value_type, Allocator, Layout> structured_to_matrix(const S &s)
+    {
+        using T = typename S::value_type;
+        const size_t n{s.get_size()};
+        matrix<T, Allocator, Layout> c(n, n, T{0});
+        for (size_t i{0}; i < n; i++)
+            s.for_each_in_row(i, [&](const size_t &j, const T &value)
+                              { c(i, j) = value; });
+        return c;
+    }
+
+    /**
+     * @brief Check that a dense matrix used to construct a structured matrix is square.
+     *
+     * @param m The dense matrix.
+     * @return The number of rows and columns.
+     * @throws initializer_wrong_size if the matrix is not square.
+     */
+    template <typename T, typename Allocator, layout Layout>
+    size_t square_size(const matrix<T, Allocator, Layout> &m)
+    {
+        if (m.get_rows() != m.get_cols())
+            throw initializer_wrong_size<T>{};
+        return m.get_rows();
+    }
+} // namespace matrix_detail
+
+// ================
+// Diagonal matrix
+// ================
+
+/**
+ * @brief A class template for n x n diagonal matrices, which store only the n elements on the diagonal.
+ *
+ * @tparam T The type to use for the matrix elements.
+ */
+template <typename T>
+class diagonal_matrix
+{
+public:
+    /**
+     * @brief The type of the matrix elements.
+     */
+    using value_type = T;
+
+    /**
+     * @brief Constructor to create a diagonal matrix with zeros on the diagonal.
+     *
+     * @param input_size The number of rows and columns.
+     * @throws zero_size if the size is zero.
+     */
+    explicit diagonal_matrix(const size_t &input_size)
+        : diagonal(input_size, T{0})
+    {
+        if (input_size == 0)
+            throw zero_size{};
+    }
+
+    /**
+     * @brief Constructor to create a diagonal matrix from a `vector`.
+     *
+     * @param input_diagonal A `vector` containing the elements on the diagonal. The number of rows and columns is inferred automatically from the size of the `vector`.
+     * @throws zero_size if the size of the `vector` is zero.
+     */
+    diagonal_matrix(std::vector<T> input_diagonal)
+        : diagonal(std::move(input_diagonal))
+    {
+        if (diagonal.empty())
+            throw zero_size{};
+    }
+
+    /**
+     * @brief Constructor to create a diagonal matrix from an `initializer_list`.
+     *
+     * @param input_diagonal An `initializer_list` containing the elements on the diagonal. The number of rows and columns is inferred automatically from the size of the `initializer_list`.
+     * @throws zero_size if the size of the `initializer_list` is zero.
+     */
+    diagonal_matrix(const std::initializer_list<T> &input_diagonal)
+        : diagonal_matrix(std::vector<T>{input_diagonal}) {}
+
+    /**
+     * @brief Constructor to create a diagonal matrix from the diagonal of a square dense matrix. The elements off the diagonal are ignored.
+     *
+     * @param m The dense matrix.
+     * @throws initializer_wrong_size if the matrix is not square.
+     */
+    template <typename Allocator, layout Layout>
+    explicit diagonal_matrix(const matrix<T, Allocator, Layout> &m)
+        : diagonal_matrix(matrix_detail::square_size(m))
+    {
+        for (size_t i{0}; i < diagonal.size(); i++)
+            diagonal[i] = m(i, i);
+    }
+
+    /**
+     * @brief Convert this matrix to a dense matrix with the same elements.
+     *
+     * @tparam Allocator The allocator of the dense matrix.
+     * @tparam Layout The storage order of the dense matrix.
+     * @return The dense matrix.
+     */
+    template <typename Allocator = aligned_allocator<T>, layout Layout = layout::row_major>
+    matrix<T, Allocator, Layout> to_matrix() const
+    {
+        return matrix_detail::structured_to_matrix<Allocator, Layout>(*this);
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the number of rows and columns in the matrix.
+     *
+     * @return The number of rows and columns.
+     */
+    inline size_t get_size() const
+    {
+        return diagonal.size();
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the elements on the diagonal.
+     *
+     * @return A reference to the elements on the diagonal.
+     */
+    inline const std::vector<T> &get_diagonal() const
+    {
+        return diagonal;
+    }
+
+    /**
+     * @brief Overloaded operator [] used to access an element on the diagonal WITHOUT range checking.
+     *
+     * @param i The index of the element on the diagonal (starting from zero).
+     * @return A reference to the element.
+     */
+    inline T &operator[](const size_t &i)
+    {
+        return diagonal[i];
+    }
+
+    /**
+     * @brief Overloaded operator [] used to access an element on the diagonal WITHOUT range checking.
+     *
+     * @param i The index of the element on the diagonal (starting from zero).
+     * @return A const reference to the element.
+     */
+    inline const T &operator[](const size_t &i) const
+    {
+        return diagonal[i];
+    }
+
+    /**
+     * @brief Overloaded operator () used to obtain the value of any element WITHOUT range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return The value of the element, which is zero off the diagonal.
+     */
+    inline T operator()(const size_t &row, const size_t &col) const
+    {
+        return (row == col) ? diagonal[row] : T{0};
+    }
+
+    /**
+     * @brief Call `f(col, value)` for each stored element in a row.
+     *
+     * @param row The row index (starting from zero).
+     * @param f The function to call.
+     */
+    template <typename F>
+    inline void for_each_in_row(const size_t &row, F &&f) const
+    {
+        f(row, diagonal[row]);
+    }
+
+    /**
+     * @brief The number of stored elements in each row, used to decide how to split operations between threads.
+     */
+    inline size_t row_work() const
+    {
+        return 1;
+    }
+
+    /**
+     * @brief Overloaded binary operator `<<` used to print out a diagonal matrix to a stream, in the same format as a dense matrix.
+     *
+     * @param out The output stream.
+     * @param d The diagonal matrix to be printed.
+     * @return A reference to the output stream.
+     */
+    friend std::ostream &operator<<(std::ostream &out, const diagonal_matrix<T> &d)
+    {
+        return out << d.to_matrix();
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a diagonal matrix and a dense matrix, which scales the rows of the dense matrix.
+     *
+     * @param d The diagonal matrix.
+     * @param b The dense matrix.
+     * @return The product.
+     * @throws incompatible_sizes_multiply if the number of rows in the dense matrix is not the same as the size of the diagonal matrix.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator*(const diagonal_matrix<T> &d, const matrix<T, Allocator> &b)
+    {
+        return matrix_detail::structured_multiply(d, b);
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a dense matrix and a diagonal matrix, which scales the columns of the dense matrix.
+     *
+     * @param a The dense matrix.
+     * @param d The diagonal matrix.
+     * @return The product.
+     * @throws incompatible_sizes_multiply if the number of columns in the dense matrix is not the same as the size of the diagonal matrix.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator*(const matrix<T, Allocator> &a, const diagonal_matrix<T> &d)
+    {
+        return matrix_detail::structured_multiply(a, d);
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a diagonal matrix by a vector.
+     *
+     * @param d The diagonal matrix.
+     * @param x The vector.
+     * @return The product, as a vector.
+     * @throws incompatible_sizes_multiply if the size of the vector is not the same as the size of the matrix.
+     */
+    friend std::vector<T> operator*(const diagonal_matrix<T> &d, const std::vector<T> &x)
+    {
+        return matrix_detail::structured_multiply(d, x);
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply two diagonal matrices.
+     *
+     * @param a The first diagonal matrix.
+     * @param b The second diagonal matrix.
+     * @return The product, as a diagonal matrix.
+     * @throws incompatible_sizes_multiply if the two matrices do not have the same size.
+     */
+    friend diagonal_matrix<T> operator*(const diagonal_matrix<T> &a, const diagonal_matrix<T> &b)
+    {
+        if (a.get_size() != b.get_size())
+            throw incompatible_sizes_multiply{};
+        diagonal_matrix<T> c(a.get_size());
+        for (size_t i{0}; i < a.get_size(); i++)
+            c[i] = a[i] * b[i];
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add two diagonal matrices.
+     *
+     * @param a The first diagonal matrix.
+     * @param b The second diagonal matrix.
+     * @return The sum, as a diagonal matrix.
+     * @throws incompatible_sizes_add if the two matrices do not have the same size.
+     */
+    friend diagonal_matrix<T> operator+(const diagonal_matrix<T> &a, const diagonal_matrix<T> &b)
+    {
+        if (a.get_size() != b.get_size())
+            throw incompatible_sizes_add{};
+        diagonal_matrix<T> c(a.get_size());
+        for (size_t i{0}; i < a.get_size(); i++)
+            c[i] = a[i] + b[i];
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add a diagonal matrix and a dense matrix, which only adds to the diagonal of the dense matrix.
+     *
+     * @param d The diagonal matrix.
+     * @param m The dense matrix.
+     * @return The sum, as a dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator+(const diagonal_matrix<T> &d, const matrix<T, Allocator> &m)
+    {
+        return matrix_detail::structured_add(d, m);
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add a dense matrix and a diagonal matrix, which only adds to the diagonal of the dense matrix.
+     *
+     * @param m The dense matrix.
+     * @param d The diagonal matrix.
+     * @return The sum, as a dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator+(const matrix<T, Allocator> &m, const diagonal_matrix<T> &d)
+    {
+        return matrix_detail::structured_add(d, m);
+    }
+
+    /**
+     * @brief Solve the linear system D x = b, by dividing each element of b by the corresponding element on the diagonal.
+     *
+     * @param d The diagonal matrix D.
+     * @param b The vector b.
+     * @return The solution x.
+     * @throws incompatible_sizes_multiply if the size of the vector is not the same as the size of the matrix.
+     */
+    friend std::vector<T> solve(const diagonal_matrix<T> &d, std::vector<T> b)
+    {
+        if (b.size() != d.get_size())
+            throw incompatible_sizes_multiply{};
+        for (size_t i{0}; i < b.size(); i++)
+            b[i] /= d[i];
+        return b;
+    }
+
+    /**
+     * @brief Solve the linear system D X = B for every column of B at once, by dividing each row of B by the corresponding element on the diagonal.
+     *
+     * @param d The diagonal matrix D.
+     * @param b The dense matrix B.
+     * @return The solution X.
+     * @throws incompatible_sizes_multiply if the number of rows in B is not the same as the size of the diagonal matrix.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> solve(const diagonal_matrix<T> &d, const matrix<T, Allocator> &b)
+    {
+        if (b.get_rows() != d.get_size())
+            throw incompatible_sizes_multiply{};
+        matrix<T, Allocator> x(b);
+        for (size_t i{0}; i < x.get_rows(); i++)
+            for (size_t j{0}; j < x.get_cols(); j++)
+                x(i, j) /= d[i];
+        return x;
+    }
+
+    /**
+     * @brief Exception to be thrown if the size given to the constructor is zero.
+     */
+    using zero_size = matrix_detail::zero_size<T>;
+
+    /**
+     * @brief Exception to be thrown if a dense matrix given to the constructor is not square.
+     */
+    using initializer_wrong_size = matrix_detail::initializer_wrong_size<T>;
+
+    /**
+     * @brief Exception to be thrown if two matrices that are added do not have the same number of rows and columns.
+     */
+    using incompatible_sizes_add = matrix_detail::incompatible_sizes_add<T>;
+
+    /**
+     * @brief Exception to be thrown when multiplying or solving if the sizes of the operands are not compatible.
+     */
+    using incompatible_sizes_multiply = matrix_detail::incompatible_sizes_multiply<T>;
+
+private:
+    /**
+     * @brief The elements on the diagonal.
+     */
+    std::vector<T> diagonal;
+};
+
+// ===================
+// Triangular matrices
+// ===================
+
+/**
+ * @brief The two kinds of triangular matrices.
+ */
+enum class triangle
+{
+    /**
+     * @brief Upper triangular: all elements below the diagonal are zero.
+     */
+    upper,
+
+    /**
+     * @brief Lower triangular: all elements above the diagonal are zero.
+     */
+    lower
+};
+
+/**
+ * @brief A class template for n x n upper or lower triangular matrices, which store only the n(n+1)/2 elements in the triangle, packed row by row.
+ *
+ * @tparam T The type to use for the matrix elements.
+ * @tparam Triangle Whether the matrix is upper or lower triangular.
+ */
+template <typename T, triangle Triangle>
+class triangular_matrix
+{
+public:
+    /**
+     * @brief The type of the matrix elements.
+     */
+    using value_type = T;
+
+    /**
+     * @brief Constructor to create a triangular matrix with all elements zero.
+     *
+     * @param input_size The number of rows and columns.
+     * @throws zero_size if the size is zero.
+     */
+    explicit triangular_matrix(const size_t &input_size)
+        : size(input_size), elements((input_size * (input_size + 1)) / 2, T{0})
+    {
+        if (size == 0)
+            throw zero_size{};
+    }
+
+    /**
+     * @brief Constructor to create a triangular matrix from the elements in the triangle, packed row by row. For an upper triangular matrix, row `i` contributes the elements in columns `i` to `n - 1`; for a lower triangular matrix, row `i` contributes the elements in columns `0` to `i`.
+     *
+     * @param input_size The number of rows and columns.
+     * @param input_elements A `vector` containing the n(n+1)/2 elements in the triangle.
+     * @throws zero_size if the size is zero.
+     * @throws initializer_wrong_size if the number of elements does not match the size.
+     */
+    triangular_matrix(const size_t &input_size, std::vector<T> input_elements)
+        : size(input_size), elements(std::move(input_elements))
+    {
+        if (size == 0)
+            throw zero_size{};
+        if (elements.size() != (size * (size + 1)) / 2)
+            throw initializer_wrong_size{};
+    }
+
+    /**
+     * @brief Constructor to create a triangular matrix from the triangle of a square dense matrix. The elements outside the triangle are ignored.
+     *
+     * @param m The dense matrix.
+     * @throws initializer_wrong_size if the matrix is not square.
+     */
+    template <typename Allocator, layout Layout>
+    explicit triangular_matrix(const matrix<T, Allocator, Layout> &m)
+        : triangular_matrix(matrix_detail::square_size(m))
+    {
+        for (size_t i{0}; i < size; i++)
+            for (size_t j{first_col(i)}; j < end_col(i); j++)
+                elements[index(i, j)] = m(i, j);
+    }
+
+    /**
+     * @brief Convert this matrix to a dense matrix with the same elements.
+     *
+     * @tparam Allocator The allocator of the dense matrix.
+     * @tparam Layout The storage order of the dense matrix.
+     * @return The dense matrix.
+     */
+    template <typename Allocator = aligned_allocator<T>, layout Layout = layout::row_major>
+    matrix<T, Allocator, Layout> to_matrix() const
+    {
+        return matrix_detail::structured_to_matrix<Allocator, Layout>(*this);
+    }
+
+    /**
+     * @brief Member function used to obtain the transpose of this matrix, which is a triangular matrix of the opposite kind.
+     *
+     * @return The transpose.
+     */
+    triangular_matrix<T, (Triangle == triangle::upper) ? triangle::lower : triangle::upper> transpose() const
+    {
+        triangular_matrix<T, (Triangle == triangle::upper) ? triangle::lower : triangle::upper> t(size);
+        for (size_t i{0}; i < size; i++)
+            for (size_t j{first_col(i)}; j < end_col(i); j++)
+                t.at(j, i) = elements[index(i, j)];
+        return t;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the number of rows and columns in the matrix.
+     *
+     * @return The number of rows and columns.
+     */
+    inline size_t get_size() const
+    {
+        return size;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the elements in the triangle, packed row by row.
+     *
+     * @return A reference to the elements.
+     */
+    inline const std::vector<T> &get_elements() const
+    {
+        return elements;
+    }
+
+    /**
+     * @brief Overloaded operator () used to obtain the value of any element WITHOUT range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return The value of the element, which is zero outside the triangle.
+     */
+    inline T operator()(const size_t &row, const size_t &col) const
+    {
+        return in_triangle(row, col) ? elements[index(row, col)] : T{0};
+    }
+
+    /**
+     * @brief Member function used to access an element in the triangle WITH range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return A reference to the element.
+     * @throws index_out_of_range if the requested element is out of range or outside the triangle.
+     */
+    inline T &at(const size_t &row, const size_t &col)
+    {
+        if (row >= size or col >= size or not in_triangle(row, col))
+            throw index_out_of_range{};
+        return elements[index(row, col)];
+    }
+
+    /**
+     * @brief Call `f(col, value)` for each stored element in a row.
+     *
+     * @param row The row index (starting from zero).
+     * @param f The function to call.
+     */
+    template <typename F>
+    inline void for_each_in_row(const size_t &row, F &&f) const
+    {
+        const T *row_elements{elements.data() + index(row, first_col(row))};
+        const size_t begin{first_col(row)}, end{end_col(row)};
+        for (size_t j{begin}; j < end; j++)
+            f(j, row_elements[j - begin]);
+    }
+
+    /**
+     * @brief The average number of stored elements in each row, used to decide how to split operations between threads.
+     */
+    inline size_t row_work() const
+    {
+        return (size + 1) / 2;
+    }
+
+    /**
+     * @brief Overloaded binary operator `<<` used to print out a triangular matrix to a stream, in the same format as a dense matrix.
+     *
+     * @param out The output stream.
+     * @param t The triangular matrix to be printed.
+     * @return A reference to the output stream.
+     */
+    friend std::ostream &operator<<(std::ostream &out, const triangular_matrix<T, Triangle> &t)
+    {
+        return out << t.to_matrix();
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a triangular matrix and a dense matrix, performing about half the operations of a dense product.
+     *
+     * @param t The triangular matrix.
+     * @param b The dense matrix.
+     * @return The product.
+     * @throws incompatible_sizes_multiply if the number of rows in the dense matrix is not the same as the size of the triangular matrix.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator*(const triangular_matrix<T, Triangle> &t, const matrix<T, Allocator> &b)
+    {
+        return matrix_detail::structured_multiply(t, b);
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a dense matrix and a triangular matrix, performing about half the operations of a dense product.
+     *
+     * @param a The dense matrix.
+     * @param t The triangular matrix.
+     * @return The product.
+     * @throws incompatible_sizes_multiply if the number of columns in the dense matrix is not the same as the size of the triangular matrix.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator*(const matrix<T, Allocator> &a, const triangular_matrix<T, Triangle> &t)
+    {
+        return matrix_detail::structured_multiply(a, t);
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a triangular matrix by a vector.
+     *
+     * @param t The triangular matrix.
+     * @param x The vector.
+     * @return The product, as a vector.
+     * @throws incompatible_sizes_multiply if the size of the vector is not the same as the size of the matrix.
+     */
+    friend std::vector<T> operator*(const triangular_matrix<T, Triangle> &t, const std::vector<T> &x)
+    {
+        return matrix_detail::structured_multiply(t, x);
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply two triangular matrices of the same kind, whose product is also a triangular matrix of that kind. Each element of the product only sums over the columns where both rows are in the triangle, for about a sixth of the operations of a dense product.
+     *
+     * @param a The first triangular matrix.
+     * @param b The second triangular matrix.
+     * @return The product, as a triangular matrix.
+     * @throws incompatible_sizes_multiply if the two matrices do not have the same size.
+     */
+    friend triangular_matrix<T, Triangle> operator*(const triangular_matrix<T, Triangle> &a, const triangular_matrix<T, Triangle> &b)
+    {
+        if (a.size != b.size)
+            throw incompatible_sizes_multiply{};
+        triangular_matrix<T, Triangle> c(a.size);
+        matrix_detail::for_each_row_chunk(a.size, a.row_work() * a.row_work(), [&](const size_t &begin, const size_t &end)
+                                          {
+                                              for (size_t i{begin}; i < end; i++)
+                                              {
+                                                  // Row k of b is in the triangle of row i of c whenever a(i, k) is, so it can be added to row i of c directly.
+                                                  T *c_row{c.elements.data() + c.index(i, first_col(i))};
+                                                  const size_t c_begin{first_col(i)};
+                                                  a.for_each_in_row(i, [&](const size_t &k, const T &a_ik)
+                                                                    { b.for_each_in_row(k, [&](const size_t &j, const T &b_kj)
+                                                                                        { c_row[j - c_begin] += a_ik * b_kj; }); });
+                                              }
+                                          });
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add two triangular matrices of the same kind.
+     *
+     * @param a The first triangular matrix.
+     * @param b The second triangular matrix.
+     * @return The sum, as a triangular matrix.
+     * @throws incompatible_sizes_add if the two matrices do not have the same size.
+     */
+    friend triangular_matrix<T, Triangle> operator+(const triangular_matrix<T, Triangle> &a, const triangular_matrix<T, Triangle> &b)
+    {
+        if (a.size != b.size)
+            throw incompatible_sizes_add{};
+        triangular_matrix<T, Triangle> c(a.size);
+        for (size_t i{0}; i < c.elements.size(); i++)
+            c.elements[i] = a.elements[i] + b.elements[i];
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add a triangular matrix and a dense matrix.
+     *
+     * @param t The triangular matrix.
+     * @param m The dense matrix.
+     * @return The sum, as a dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator+(const triangular_matrix<T, Triangle> &t, const matrix<T, Allocator> &m)
+    {
+        return matrix_detail::structured_add(t, m);
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add a dense matrix and a triangular matrix.
+     *
+     * @param m The dense matrix.
+     * @param t The triangular matrix.
+     * @return The sum, as a dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator+(const matrix<T, Allocator> &m, const triangular_matrix<T, Triangle> &t)
+    {
+        return matrix_detail::structured_add(t, m);
+    }
+
+    /**
+     * @brief Solve the linear system T x = b by forward substitution (for a lower triangular matrix) or back substitution (for an upper triangular matrix), in O(n^2) time. The elements on the diagonal must be non-zero; no check is made.
+     *
+     * @param t The triangular matrix T.
+     * @param b The vector b.
+     * @return The solution x.
+     * @throws incompatible_sizes_multiply if the size of the vector is not the same as the size of the matrix.
+     */
+    friend std::vector<T> solve(const triangular_matrix<T, Triangle> &t, std::vector<T> b)
+    {
+        if (b.size() != t.size)
+            throw incompatible_sizes_multiply{};
+        for (size_t step{0}; step < t.size; step++)
+        {
+            const size_t i{(Triangle == triangle::lower) ? step : t.size - 1 - step};
+            T sum{b[i]}, diagonal{0};
+            t.for_each_in_row(i, [&](const size_t &k, const T &value)
+                              {
+                                  if (k == i)
+                                      diagonal = value;
+                                  else
+                                      sum -= value * b[k];
+                              });
+            b[i] = sum / diagonal;
+        }
+        return b;
+    }
+
+    /**
+     * @brief Solve the linear system T X = B for every column of B at once, by forward substitution (for a lower triangular matrix) or back substitution (for an upper triangular matrix). Whole rows of B are updated at a time, so the inner loops are contiguous. The elements on the diagonal must be non-zero; no check is made.
+     *
+     * @param t The triangular matrix T.
+     * @param b The dense matrix B.
+     * @return The solution X.
+     * @throws incompatible_sizes_multiply if the number of rows in B is not the same as the size of the triangular matrix.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> solve(const triangular_matrix<T, Triangle> &t, const matrix<T, Allocator> &b)
+    {
+        if (b.get_rows() != t.size)
+            throw incompatible_sizes_multiply{};
+        matrix<T, Allocator> x(b);
+        const size_t m{x.get_cols()};
+        // The columns of X are independent, so large right-hand sides are split between threads by columns.
+        matrix_detail::for_each_row_chunk(m, t.size * t.row_work(), [&](const size_t &col_begin, const size_t &col_end)
+                                          {
+                                              for (size_t step{0}; step < t.size; step++)
+                                              {
+                                                  const size_t i{(Triangle == triangle::lower) ? step : t.size - 1 - step};
+                                                  T *x_row{x.data() + (x.get_stride() * i)};
+                                                  T diagonal{0};
+                                                  t.for_each_in_row(i, [&](const size_t &k, const T &value)
+                                                                    {
+                                                                        if (k == i)
+                                                                            diagonal = value;
+                                                                        else
+                                                                        {
+                                                                            const T *x_k{x.data() + (x.get_stride() * k)};
+                                                                            for (size_t j{col_begin}; j < col_end; j++)
+                                                                                x_row[j] -= value * x_k[j];
+                                                                        }
+                                                                    });
+                                                  for (size_t j{col_begin}; j < col_end; j++)
+                                                      x_row[j] /= diagonal;
+                                              }
+                                          });
+        return x;
+    }
+
+    /**
+     * @brief Exception to be thrown if the size given to the constructor is zero.
+     */
+    using zero_size = matrix_detail::zero_size<T>;
+
+    /**
+     * @brief Exception to be thrown if the number of elements given to the constructor does not match the size, or if a dense matrix given to the constructor is not square.
+     */
+    using initializer_wrong_size = matrix_detail::initializer_wrong_size<T>;
+
+    /**
+     * @brief Exception to be thrown if two matrices that are added do not have the same number of rows and columns.
+     */
+    using incompatible_sizes_add = matrix_detail::incompatible_sizes_add<T>;
+
+    /**
+     * @brief Exception to be thrown when multiplying or solving if the sizes of the operands are not compatible.
+     */
+    using incompatible_sizes_multiply = matrix_detail::incompatible_sizes_multiply<T>;
+
+    /**
+     * @brief Exception to be thrown if the requested element is out of range or outside the triangle.
+     */
+    using index_out_of_range = matrix_detail::index_out_of_range<T>;
+
+private:
+    /**
+     * @brief Check whether an element is in the triangle.
+     */
+    static inline bool in_triangle(const size_t &row, const size_t &col)
+    {
+        return (Triangle == triangle::upper) ? (col >= row) : (col <= row);
+    }
+
+    /**
+     * @brief The first column in the triangle in a given row.
+     */
+    static inline size_t first_col(const size_t &row)
+    {
+        return (Triangle == triangle::upper) ? row : 0;
+    }
+
+    /**
+     * @brief One past the last column in the triangle in a given row.
+     */
+    inline size_t end_col(const size_t &row) const
+    {
+        return (Triangle == triangle::upper) ? size : row + 1;
+    }
+
+    /**
+     * @brief The position of an element in the triangle in the packed storage.
+     */
+    inline size_t index(const size_t &row, const size_t &col) const
+    {
+        if constexpr (Triangle == triangle::upper)
+            return ((row * ((2 * size) - row + 1)) / 2) + (col - row);
+        else
+            return ((row * (row + 1)) / 2) + col;
+    }
+
+    /**
+     * @brief The number of rows and columns.
+     */
+    size_t size{0};
+
+    /**
+     * @brief The elements in the triangle, packed row by row.
+     */
+    std::vector<T> elements;
+};
+
+/**
+ * @brief An alias for upper triangular matrices.
+ */
+template <typename T>
+using upper_triangular_matrix = triangular_matrix<T, triangle::upper>;
+
+/**
+ * @brief An alias for lower triangular matrices.
+ */
+template <typename T>
+using lower_triangular_matrix = triangular_matrix<T, triangle::lower>;
+
+// =================
+// Symmetric matrix
+// =================
+
+/**
+ * @brief A class template for n x n symmetric matrices, which store only the n(n+1)/2 elements in the lower triangle, packed row by row. Element (i, j) above the diagonal is the same stored element as (j, i).
+ *
+ * @tparam T The type to use for the matrix elements.
+ */
+template <typename T>
+class symmetric_matrix
+{
+public:
+    /**
+     * @brief The type of the matrix elements.
+     */
+    using value_type = T;
+
+    /**
+     * @brief Constructor to create a symmetric matrix with all elements zero.
+     *
+     * @param input_size The number of rows and columns.
+     * @throws zero_size if the size is zero.
+     */
+    explicit symmetric_matrix(const size_t &input_size)
+        : size(input_size), elements((input_size * (input_size + 1)) / 2, T{0})
+    {
+        if (size == 0)
+            throw zero_size{};
+    }
+
+    /**
+     * @brief Constructor to create a symmetric matrix from the elements in the lower triangle, packed row by row: row `i` contributes the elements in columns `0` to `i`.
+     *
+     * @param input_size The number of rows and columns.
+     * @param input_elements A `vector` containing the n(n+1)/2 elements in the lower triangle.
+     * @throws zero_size if the size is zero.
+     * @throws initializer_wrong_size if the number of elements does not match the size.
+     */
+    symmetric_matrix(const size_t &input_size, std::vector<T> input_elements)
+        : size(input_size), elements(std::move(input_elements))
+    {
+        if (size == 0)
+            throw zero_size{};
+        if (elements.size() != (size * (size + 1)) / 2)
+            throw initializer_wrong_size{};
+    }
+
+    /**
+     * @brief Constructor to create a symmetric matrix from the lower triangle of a square dense matrix. The elements above the diagonal are ignored, so the matrix is assumed to be symmetric, but this is not checked.
+     *
+     * @param m The dense matrix.
+     * @throws initializer_wrong_size if the matrix is not square.
+     */
+    template <typename Allocator, layout Layout>
+    explicit symmetric_matrix(const matrix<T, Allocator, Layout> &m)
+        : symmetric_matrix(matrix_detail::square_size(m))
+    {
+        for (size_t i{0}; i < size; i++)
+            for (size_t j{0}; j <= i; j++)
+                elements[index(i, j)] = m(i, j);
+    }
+
+    /**
+     * @brief Convert this matrix to a dense matrix with the same elements.
+     *
+     * @tparam Allocator The allocator of the dense matrix.
+     * @tparam Layout The storage order of the dense matrix.
+     * @return The dense matrix.
+     */
+    template <typename Allocator = aligned_allocator<T>, layout Layout = layout::row_major>
+    matrix<T, Allocator, Layout> to_matrix() const
+    {
+        return matrix_detail::structured_to_matrix<Allocator, Layout>(*this);
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the number of rows and columns in the matrix.
+     *
+     * @return The number of rows and columns.
+     */
+    inline size_t get_size() const
+    {
+        return size;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the elements in the lower triangle, packed row by row.
+     *
+     * @return A reference to the elements.
+     */
+    inline const std::vector<T> &get_elements() const
+    {
+        return elements;
+    }
+
+    /**
+     * @brief Overloaded operator () used to obtain the value of any element WITHOUT range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return The value of the element.
+     */
+    inline T operator()(const size_t &row, const size_t &col) const
+    {
+        return elements[(col <= row) ? index(row, col) : index(col, row)];
+    }
+
+    /**
+     * @brief Member function used to access an element WITH range checking. Since (row, col) and (col, row) are the same stored element, modifying one also modifies the other.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return A reference to the element.
+     * @throws index_out_of_range if the requested element is out of range.
+     */
+    inline T &at(const size_t &row, const size_t &col)
+    {
+        if (row >= size or col >= size)
+            throw index_out_of_range{};
+        return elements[(col <= row) ? index(row, col) : index(col, row)];
+    }
+
+    /**
+     * @brief Call `f(col, value)` for each element in a row. The elements up to the diagonal are contiguous in the packed storage, and the rest are read from the corresponding column of the lower triangle.
+     *
+     * @param row The row index (starting from zero).
+     * @param f The function to call.
+     */
+    template <typename F>
+    inline void for_each_in_row(const size_t &row, F &&f) const
+    {
+        const T *row_elements{elements.data() + index(row, 0)};
+        for (size_t j{0}; j <= row; j++)
+            f(j, row_elements[j]);
+        for (size_t j{row + 1}; j < size; j++)
+            f(j, elements[index(j, row)]);
+    }
+
+    /**
+     * @brief The number of elements in each row, used to decide how to split operations between threads.
+     */
+    inline size_t row_work() const
+    {
+        return size;
+    }
+
+    /**
+     * @brief Overloaded binary operator `<<` used to print out a symmetric matrix to a stream, in the same format as a dense matrix.
+     *
+     * @param out The output stream.
+     * @param s The symmetric matrix to be printed.
+     * @return A reference to the output stream.
+     */
+    friend std::ostream &operator<<(std::ostream &out, const symmetric_matrix<T> &s)
+    {
+        return out << s.to_matrix();
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a symmetric matrix and a dense matrix.
+     *
+     * @param s The symmetric matrix.
+     * @param b The dense matrix.
+     * @return The product.
+     * @throws incompatible_sizes_multiply if the number of rows in the dense matrix is not the same as the size of the symmetric matrix.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator*(const symmetric_matrix<T> &s, const matrix<T, Allocator> &b)
+    {
+        return matrix_detail::structured_multiply(s, b);
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a dense matrix and a symmetric matrix.
+     *
+     * @param a The dense matrix.
+     * @param s The symmetric matrix.
+     * @return The product.
+     * @throws incompatible_sizes_multiply if the number of columns in the dense matrix is not the same as the size of the symmetric matrix.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator*(const matrix<T, Allocator> &a, const symmetric_matrix<T> &s)
+    {
+        return matrix_detail::structured_multiply(a, s);
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a symmetric matrix by a vector.
+     *
+     * @param s The symmetric matrix.
+     * @param x The vector.
+     * @return The product, as a vector.
+     * @throws incompatible_sizes_multiply if the size of the vector is not the same as the size of the matrix.
+     */
+    friend std::vector<T> operator*(const symmetric_matrix<T> &s, const std::vector<T> &x)
+    {
+        return matrix_detail::structured_multiply(s, x);
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add two symmetric matrices, adding only the stored halves.
+     *
+     * @param a The first symmetric matrix.
+     * @param b The second symmetric matrix.
+     * @return The sum, as a symmetric matrix.
+     * @throws incompatible_sizes_add if the two matrices do not have the same size.
+     */
+    friend symmetric_matrix<T> operator+(const symmetric_matrix<T> &a, const symmetric_matrix<T> &b)
+    {
+        if (a.size != b.size)
+            throw incompatible_sizes_add{};
+        symmetric_matrix<T> c(a.size);
+        for (size_t i{0}; i < c.elements.size(); i++)
+            c.elements[i] = a.elements[i] + b.elements[i];
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add a symmetric matrix and a dense matrix.
+     *
+     * @param s The symmetric matrix.
+     * @param m The dense matrix.
+     * @return The sum, as a dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator+(const symmetric_matrix<T> &s, const matrix<T, Allocator> &m)
+    {
+        return matrix_detail::structured_add(s, m);
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add a dense matrix and a symmetric matrix.
+     *
+     * @param m The dense matrix.
+     * @param s The symmetric matrix.
+     * @return The sum, as a dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator+(const matrix<T, Allocator> &m, const symmetric_matrix<T> &s)
+    {
+        return matrix_detail::structured_add(s, m);
+    }
+
+    /**
+     * @brief Exception to be thrown if the size given to the constructor is zero.
+     */
+    using zero_size = matrix_detail::zero_size<T>;
+
+    /**
+     * @brief Exception to be thrown if the number of elements given to the constructor does not match the size, or if a dense matrix given to the constructor is not square.
+     */
+    using initializer_wrong_size = matrix_detail::initializer_wrong_size<T>;
+
+    /**
+     * @brief Exception to be thrown if two matrices that are added do not have the same number of rows and columns.
+     */
+    using incompatible_sizes_add = matrix_detail::incompatible_sizes_add<T>;
+
+    /**
+     * @brief Exception to be thrown when multiplying if the sizes of the operands are not compatible.
+     */
+    using incompatible_sizes_multiply = matrix_detail::incompatible_sizes_multiply<T>;
+
+    /**
+     * @brief Exception to be thrown if the requested element is out of range.
+     */
+    using index_out_of_range = matrix_detail::index_out_of_range<T>;
+
+private:
+    /**
+     * @brief The position of an element in the lower triangle in the packed storage.
+     */
+    static inline size_t index(const size_t &row, const size_t &col)
+    {
+        return ((row * (row + 1)) / 2) + col;
+    }
+
+    /**
+     * @brief The number of rows and columns.
+     */
+    size_t size{0};
+
+    /**
+     * @brief The elements in the lower triangle, packed row by row.
+     */
+    std::vector<T> elements;
+};
+
+// ==============
+// Banded matrix
+// ==============
+
+/**
+ * @brief A class template for n x n banded matrices with bandwidth k, in which all elements more than k places away from the diagonal are zero. Each row stores the 2k + 1 elements in the band, so an n x n banded matrix uses n(2k + 1) elements; the positions in the first and last k rows that fall outside the matrix are stored as zeros.
+ *
+ * @tparam T The type to use for the matrix elements.
+ */
+template <typename T>
+class banded_matrix
+{
+public:
+    /**
+     * @brief The type of the matrix elements.
+     */
+    using value_type = T;
+
+    /**
+     * @brief Constructor to create a banded matrix with all elements zero.
+     *
+     * @param input_size The number of rows and columns.
+     * @param input_bandwidth The bandwidth: the number of non-zero diagonals above (and below) the main diagonal. A bandwidth of 0 is a diagonal matrix, and a bandwidth of 1 is a tridiagonal matrix.
+     * @throws zero_size if the size is zero.
+     */
+    banded_matrix(const size_t &input_size, const size_t &input_bandwidth)
+        : size(input_size), bandwidth(input_bandwidth), elements(input_size * ((2 * input_bandwidth) + 1), T{0})
+    {
+        if (size == 0)
+            throw zero_size{};
+    }
+
+    /**
+     * @brief Constructor to create a banded matrix from the band of a square dense matrix. The elements outside the band are ignored.
+     *
+     * @param m The dense matrix.
+     * @param input_bandwidth The bandwidth.
+     * @throws initializer_wrong_size if the matrix is not square.
+     */
+    template <typename Allocator, layout Layout>
+    banded_matrix(const matrix<T, Allocator, Layout> &m, const size_t &input_bandwidth)
+        : banded_matrix(matrix_detail::square_size(m), input_bandwidth)
+    {
+        for (size_t i{0}; i < size; i++)
+            for (size_t j{first_col(i)}; j < end_col(i); j++)
+                elements[index(i, j)] = m(i, j);
+    }
+
+    /**
+     * @brief Convert this matrix to a dense matrix with the same elements.
+     *
+     * @tparam Allocator The allocator of the dense matrix.
+     * @tparam Layout The storage order of the dense matrix.
+     * @return The dense matrix.
+     */
+    template <typename Allocator = aligned_allocator<T>, layout Layout = layout::row_major>
+    matrix<T, Allocator, Layout> to_matrix() const
+    {
+        return matrix_detail::structured_to_matrix<Allocator, Layout>(*this);
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the number of rows and columns in the matrix.
+     *
+     * @return The number of rows and columns.
+     */
+    inline size_t get_size() const
+    {
+        return size;
+    }
+
+    /**
+     * @brief Member function used to obtain (but not modify) the bandwidth.
+     *
+     * @return The bandwidth.
+     */
+    inline size_t get_bandwidth() const
+    {
+        return bandwidth;
+    }
+
+    /**
+     * @brief Overloaded operator () used to obtain the value of any element WITHOUT range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return The value of the element, which is zero outside the band.
+     */
+    inline T operator()(const size_t &row, const size_t &col) const
+    {
+        return in_band(row, col) ? elements[index(row, col)] : T{0};
+    }
+
+    /**
+     * @brief Member function used to access an element in the band WITH range checking.
+     *
+     * @param row The row index (starting from zero).
+     * @param col The column index (starting from zero).
+     * @return A reference to the element.
+     * @throws index_out_of_range if the requested element is out of range or outside the band.
+     */
+    inline T &at(const size_t &row, const size_t &col)
+    {
+        if (row >= size or col >= size or not in_band(row, col))
+            throw index_out_of_range{};
+        return elements[index(row, col)];
+    }
+
+    /**
+     * @brief Call `f(col, value)` for each element of a row in the band.
+     *
+     * @param row The row index (starting from zero).
+     * @param f The function to call.
+     */
+    template <typename F>
+    inline void for_each_in_row(const size_t &row, F &&f) const
+    {
+        const size_t begin{first_col(row)}, end{end_col(row)};
+        const T *row_elements{elements.data() + index(row, begin)};
+        for (size_t j{begin}; j < end; j++)
+            f(j, row_elements[j - begin]);
+    }
+
+    /**
+     * @brief The number of elements of each row in the band, used to decide how to split operations between threads.
+     */
+    inline size_t row_work() const
+    {
+        return (2 * bandwidth) + 1;
+    }
+
+    /**
+     * @brief Overloaded binary operator `<<` used to print out a banded matrix to a stream, in the same format as a dense matrix.
+     *
+     * @param out The output stream.
+     * @param b The banded matrix to be printed.
+     * @return A reference to the output stream.
+     */
+    friend std::ostream &operator<<(std::ostream &out, const banded_matrix<T> &b)
+    {
+        return out << b.to_matrix();
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a banded matrix and a dense matrix, in time proportional to the bandwidth rather than the size.
+     *
+     * @param s The banded matrix.
+     * @param b The dense matrix.
+     * @return The product.
+     * @throws incompatible_sizes_multiply if the number of rows in the dense matrix is not the same as the size of the banded matrix.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator*(const banded_matrix<T> &s, const matrix<T, Allocator> &b)
+    {
+        return matrix_detail::structured_multiply(s, b);
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a dense matrix and a banded matrix, in time proportional to the bandwidth rather than the size.
+     *
+     * @param a The dense matrix.
+     * @param s The banded matrix.
+     * @return The product.
+     * @throws incompatible_sizes_multiply if the number of columns in the dense matrix is not the same as the size of the banded matrix.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator*(const matrix<T, Allocator> &a, const banded_matrix<T> &s)
+    {
+        return matrix_detail::structured_multiply(a, s);
+    }
+
+    /**
+     * @brief Overloaded binary operator `*` used to multiply a banded matrix by a vector.
+     *
+     * @param s The banded matrix.
+     * @param x The vector.
+     * @return The product, as a vector.
+     * @throws incompatible_sizes_multiply if the size of the vector is not the same as the size of the matrix.
+     */
+    friend std::vector<T> operator*(const banded_matrix<T> &s, const std::vector<T> &x)
+    {
+        return matrix_detail::structured_multiply(s, x);
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add two banded matrices. The bandwidth of the sum is the larger of the two bandwidths.
+     *
+     * @param a The first banded matrix.
+     * @param b The second banded matrix.
+     * @return The sum, as a banded matrix.
+     * @throws incompatible_sizes_add if the two matrices do not have the same size.
+     */
+    friend banded_matrix<T> operator+(const banded_matrix<T> &a, const banded_matrix<T> &b)
+    {
+        if (a.size != b.size)
+            throw incompatible_sizes_add{};
+        banded_matrix<T> c(a.size, std::max(a.bandwidth, b.bandwidth));
+        for (size_t i{0}; i < c.size; i++)
+        {
+            T *c_row{c.elements.data() + c.index(i, c.first_col(i))};
+            const size_t c_begin{c.first_col(i)};
+            a.for_each_in_row(i, [&](const size_t &j, const T &value)
+                              { c_row[j - c_begin] += value; });
+            b.for_each_in_row(i, [&](const size_t &j, const T &value)
+                              { c_row[j - c_begin] += value; });
+        }
+        return c;
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add a banded matrix and a dense matrix.
+     *
+     * @param s The banded matrix.
+     * @param m The dense matrix.
+     * @return The sum, as a dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator+(const banded_matrix<T> &s, const matrix<T, Allocator> &m)
+    {
+        return matrix_detail::structured_add(s, m);
+    }
+
+    /**
+     * @brief Overloaded binary operator `+` used to add a dense matrix and a banded matrix.
+     *
+     * @param m The dense matrix.
+     * @param s The banded matrix.
+     * @return The sum, as a dense matrix.
+     * @throws incompatible_sizes_add if the matrices do not have the same number of rows and columns.
+     */
+    template <typename Allocator>
+    friend matrix<T, Allocator> operator+(const matrix<T, Allocator> &m, const banded_matrix<T> &s)
+    {
+        return matrix_detail::structured_add(s, m);
+    }
+
+    /**
+     * @brief Exception to be thrown if the size given to the constructor is zero.
+     */
+    using zero_size = matrix_detail::zero_size<T>;
+
+    /**
+     * @brief Exception to be thrown if a dense matrix given to the constructor is not square.
+     */
+    using initializer_wrong_size = matrix_detail::initializer_wrong_size<T>;
+
+    /**
+     * @brief Exception to be thrown if two matrices that are added do not have the same number of rows and columns.
+     */
+    using incompatible_sizes_add = matrix_detail::incompatible_sizes_add<T>;
+
+    /**
+     * @brief Exception to be thrown when multiplying if the sizes of the operands are not compatible.
+     */
+    using incompatible_sizes_multiply = matrix_detail::incompatible_sizes_multiply<T>;
+
+    /**
+     * @brief Exception to be thrown if the requested element is out of range or outside the band.
+     */
+    using index_out_of_range = matrix_detail::index_out_of_range<T>;
+
+private:
+    /**
+     * @brief Check whether an element is in the band.
+     */
+    inline bool in_band(const size_t &row, const size_t &col) const
+    {
+        return (col + bandwidth >= row) and (row + bandwidth >= col);
+    }
+
+    /**
+     * @brief The first column in the band in a given row.
+     */
+    inline size_t first_col(const size_t &row) const
+    {
+        return (row > bandwidth) ? row - bandwidth : 0;
+    }
+
+    /**
+     * @brief One past the last column in the band in a given row.
+     */
+    inline size_t end_col(const size_t &row) const
+    {
+        return std::min(size, row + bandwidth + 1);
+    }
+
+    /**
+     * @brief The position of an element in the band in the storage.
+     */
+    inline size_t index(const size_t &row, const size_t &col) const
+    {
+        return (row * ((2 * bandwidth) + 1)) + (col + bandwidth - row);
+    }
+
+    /**
+     * @brief The number of rows and columns.
+     */
+    size_t size{0};
+
+    /**
+     * @brief The bandwidth.
+     */
+    size_t bandwidth{0};
+
+    /**
+     * @brief The elements in the band, 2k + 1 for each row.
+     */
+    std::vector<T> elements;
+};